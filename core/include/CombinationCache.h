@@ -0,0 +1,55 @@
+/**
+ * Gamma Combination
+ *
+ * A workspace shared by several combinations, into which every
+ * PDF is imported only once.
+ *
+ **/
+
+#ifndef CombinationCache_h
+#define CombinationCache_h
+
+#include <iostream>
+#include <map>
+
+#include "RooWorkspace.h"
+#include "TString.h"
+
+#include "PDF_Abs.h"
+
+using namespace std;
+
+///
+/// Holds the imported, uniquified PDFs ("blocks") of all combinations
+/// that use it, in one workspace. A Combiner that uses the cache
+/// imports only the PDFs not imported before, and adds its own
+/// top-level product and parameter sets. Combinations that differ
+/// by a few PDFs, as made by the "-c 26:+12" mechanism, so only
+/// cost the import of these few PDFs.
+///
+/// A block is never changed after its import. If a PDF was modified
+/// since (e.g. observables loaded from a file for one combination),
+/// canImport() is false, and the combination has to build its own
+/// workspace.
+///
+/// All combinations using the cache share their parameters.
+///
+class CombinationCache
+{
+public:
+	CombinationCache();
+	~CombinationCache();
+
+	bool              canImport(PDF_Abs* pdf);
+	void              import(PDF_Abs* pdf);
+	inline RooWorkspace* getWorkspace(){return w;};
+	static void       importPdf(RooWorkspace* w, PDF_Abs* pdf);
+
+private:
+	TString           fingerprint(PDF_Abs* pdf);
+
+	RooWorkspace*     w;         ///< holds all blocks and the combinations built from them
+	map<TString,TString> blocks; ///< name of each imported PDF -> fingerprint at import
+};
+
+#endif
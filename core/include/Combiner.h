@@ -8,6 +8,7 @@
 #ifndef Combiner_h
 #define Combiner_h
 
+#include "CombinationCache.h"
 #include "PDF_Abs.h"
 #include "OptParser.h"
 #include "Utils.h"
@@ -62,9 +63,12 @@ public:
 	void										 setParametersConstant(); // helper function for combine()
   inline void              setTitle(TString title){this->title=title;};
 	inline vector<FixPar> 	 getConstVars(){return constVars;};
+  inline void             setCache(CombinationCache* c){cache=c;}; ///< Share imported PDFs with other combiners. Call before combine().
 
 private:
   vector<PDF_Abs*>        pdfs;        // holds all pdfs to be combined
+  vector<int>             uids;        // unique ID of each pdf inside this combiner, see PDF_Abs::uniquify()
+  int                     nextUid;     // unique ID for the next added pdf
   TString                 title;       // title of the combination, used in plots
   TString                 name;        // name of the combination, used to refer to it and as part of file names
   TString                 pdfName;     // Name of combined pdf. Call combine() first.
@@ -72,6 +76,8 @@ private:
   TString                 obsName;     // Name of combined observables set. Call combine() first.
   OptParser*              arg;         // command line arguments
   RooWorkspace*           w;           // holds all input pdfs, parameters, and observables, as well as the combination
+  bool                    ownsWorkspace; // false if w belongs to the cache
+  CombinationCache*       cache;       // if set, combine() imports into its shared workspace
   vector<string>          pdfNames;    // hold all unique names of the pdfs to be combined
   bool                    _isCombined; // make sure we'll only combine once - else all PDFs get double counted!
   vector<FixPar>         	constVars;   // hold variables that will be set constant (filled by fixParameter())
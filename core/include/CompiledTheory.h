@@ -0,0 +1,98 @@
+/**
+ * Gamma Combination
+ *
+ * The theory relations of a PDF, compiled into a single function.
+ *
+ **/
+
+#ifndef CompiledTheory_h
+#define CompiledTheory_h
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "RooAbsReal.h"
+#include "RooRealVar.h"
+#include "TString.h"
+
+using namespace std;
+
+///
+/// The theory relations of a PDF_Abs are RooFormulaVars, which are
+/// evaluated one by one through their formula on every chi2 evaluation.
+/// A CompiledTheory translates the formulas of a list of relations into
+/// C++, and compiles them with the interpreter into one function that
+/// computes all of them from an array of parameter values:
+///
+/// \code
+/// void theory_0(const double* x, double* out)
+/// {
+///     out[0] = x[0]*TMath::Cos(x[1]-x[2]);
+///     out[1] = x[0]*TMath::Sin(x[1]-x[2]);
+/// }
+/// \endcode
+///
+/// The formulas are translated by TFormula, so the syntax is that of
+/// RooFormulaVar. Before it is used, every compiled function is checked
+/// against the RooFormulaVars at the current parameters and at random
+/// points within the parameter ranges. Lists containing anything but
+/// RooFormulaVars, or failing that check, aren't compiled.
+///
+/// A second function computes the relations at many parameter points
+/// at once, from one array per parameter, for GaussianChi2::evaluate():
+///
+/// \code
+/// void theory_batch_0(int n, const double* const* x, double* const* out)
+/// {
+///     for ( int p=0; p<n; p++ ) out[0][p] = x[0][p]*TMath::Cos(x[1][p]-x[2][p]);
+///     for ( int p=0; p<n; p++ ) out[1][p] = x[0][p]*TMath::Sin(x[1][p]-x[2][p]);
+/// }
+/// \endcode
+///
+/// Its loops run over contiguous arrays, so the compiler can vectorize
+/// them across the points.
+///
+/// Compiling takes some time, so the compiled functions are kept for
+/// the whole job, by their code. They get all parameters through x and
+/// keep no pointers, so each CompiledTheory binds its own parameters and
+/// lives as long as its owner, e.g. a GaussianChi2. One built from the
+/// same formulas reuses the compiled function.
+///
+class CompiledTheory
+{
+public:
+	CompiledTheory(const vector<RooAbsReal*>& relations);
+	~CompiledTheory();
+
+	void                    evaluate(double* out) const;
+	void                    evaluate(int n, const double* const* x, double* const* out) const;
+	inline int              getNRelations() const {return relations.size();};
+	inline const vector<RooAbsReal*>& getParameters() const {return pars;};
+	inline bool             isValid() const {return kernel!=0;};
+
+private:
+	typedef void (*Kernel)(const double* x, double* out);
+	typedef void (*BatchKernel)(int n, const double* const* x, double* const* out);
+	struct Kernels
+	{
+		Kernel              kernel;
+		BatchKernel         batchKernel;
+	};
+
+	bool                    build();
+	bool                    selfCheck();
+	TString                 translate(RooAbsReal* relation);
+
+	vector<RooAbsReal*>     relations;  ///< the relations, not owned
+	vector<RooAbsReal*>     pars;       ///< the parameters the relations depend on, x[k] in the kernel
+	Kernel                  kernel;     ///< the compiled function, 0 if the relations couldn't be compiled
+	BatchKernel             batchKernel; ///< the compiled function for many points
+	mutable vector<double>  x;          ///< parameter values passed to the kernel
+
+	static map<TString, Kernels> kernels;       ///< all compiled functions, by their code. 0 if they failed to compile or the self check.
+	static map<TString, TString> translations;  ///< the C++ of all translated formulas, by the formula
+	static int              nKernels;           ///< number of compiled functions, to make their names unique
+};
+
+#endif
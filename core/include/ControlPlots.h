@@ -17,6 +17,9 @@
 #include "OptParser.h"
 #include "Utils.h"
 #include "TPaveStats.h"
+#include "THLimitsFinder.h"
+
+#include "HistogramFiller.h"
 
 #include "MethodProbScan.h"
 #include "ToyTree.h"
@@ -27,6 +30,11 @@ using namespace Utils;
 ///
 /// Class to make control plots of Plugin toys.
 ///
+/// The ctrlPlot*() functions only book their histograms. All
+/// histograms are then filled together in one pass over the toys
+/// (plus one more to find the axis ranges) by makeCtrlPlots(), which
+/// also draws them. saveCtrlPlots() calls makeCtrlPlots() first.
+///
 class ControlPlots
 {
 	public:
@@ -41,11 +49,16 @@ class ControlPlots
         void             ctrlPlotChi2();
 		void             ctrlPlotPvalue();
         void             ctrlPlotMore(MethodProbScan* profileLH);
+        void             makeCtrlPlots();
         void             saveCtrlPlots();
 
 	private:
 
+		typedef function<void()> Drawer;
+
+		void             getAxisRange(int rangeId, float& min, float& max, int nBins=100);
 		void             makePlotsNice(TString htemp="htemp", TString Graph="Graph");
+		bool             passesCuts(const double* row) const;
 		TCanvas*         selectNewCanvas(TString title);
 		TVirtualPad*     selectNewPad();
 		void             updateCurrentCanvas();
@@ -56,7 +69,11 @@ class ControlPlots
 		OptParser*       arg;              ///< command line arguments
 		vector<TCanvas*> ctrlPlotCanvases; ///< Pointers to the canvases of the control plots, see selectNewCanvas().
 		int              ctrlPadId;        ///< ID of currently selected pad, see selectNewPad().
-		TCut             ctrlPlotCuts;     ///< Cuts that are applied to all control plots.
+		HistogramFiller* filler;           ///< fills the histograms of all booked control plots in one pass
+		vector<function<Drawer()> > ctrlPlotBookers; ///< one per booked control plot, books its histograms and returns the function drawing them
+		int              colStatusFree;    ///< column indices of the branches used by passesCuts()
+		int              colStatusScan;
+		int              colId;
 };
 
 #endif
@@ -0,0 +1,78 @@
+/**
+ * Gamma Combination
+ *
+ * A columnar on-disk copy of a RooDataSet, mapped read-only into
+ * memory, so that all processes on a node share one copy of the data.
+ *
+ **/
+
+#ifndef DatasetCache_h
+#define DatasetCache_h
+
+#include <iostream>
+#include <vector>
+
+#include "RooArgSet.h"
+#include "RooCategory.h"
+#include "RooDataSet.h"
+#include "RooRealVar.h"
+#include "TString.h"
+
+using namespace std;
+
+///
+/// The cache file holds one column of doubles per variable of the
+/// dataset (category indices for RooCategories), plus the event weights
+/// for weighted datasets. exportDataSet() writes it once. A DatasetCache
+/// then maps the file read-only: the columns are read straight from the
+/// page cache, which the kernel shares between all processes mapping
+/// the same file, instead of every batch job decompressing and
+/// streaming the dataset from the workspace file.
+///
+/// makeDataSet() fills a RooDataSet from the columns. RooFit's data
+/// stores own their values, so this is still one copy per process, as
+/// when the dataset is taken from the workspace. What the cache saves is
+/// reading and decompressing the dataset from the workspace file in
+/// every job, and a second copy in memory: the workspace has to be saved
+/// without the dataset, see tutorial_dataset_build_workspace.cpp.
+///
+/// The header holds a fingerprint of the source of the data, see
+/// fingerprint(). Readers compare it to that of their source and
+/// rebuild the cache if they differ, so an edited dataset is never
+/// replaced by a stale cache.
+///
+/// File layout (native byte order): the magic "GCDSCAC2", the number
+/// of entries and of columns (8 bytes each), a flag for weighted data,
+/// the source fingerprint and the column names as length and
+/// characters, padding to 8 bytes, and then the columns one after the
+/// other. The weights, if any, are the last column.
+///
+class DatasetCache
+{
+public:
+	DatasetCache(TString fileName);
+	~DatasetCache();
+
+	static bool       exportDataSet(RooDataSet* data, TString fileName, TString source);
+	static TString    fingerprint(TString dataName, TString sourceFile);
+	const double*     getColumn(TString name) const;
+	inline const vector<TString>& getColumnNames() const {return columnNames;};
+	inline Long64_t   getNEntries() const {return nEntries;};
+	inline TString    getSource() const {return source;};
+	inline bool       isValid() const {return valid;};
+	inline bool       isWeighted() const {return weighted;};
+	RooDataSet*       makeDataSet(const RooArgSet& vars, TString name) const;
+
+private:
+	TString           fileName;
+	void*             mapped;        ///< the mapped file
+	size_t            mapSize;       ///< size of the mapping in bytes
+	bool              valid;         ///< the file was mapped and its header is consistent
+	bool              weighted;      ///< the last column holds the event weights
+	Long64_t          nEntries;
+	TString           source;        ///< fingerprint of the source of the data
+	vector<TString>   columnNames;   ///< without the weights
+	vector<const double*> columns;   ///< into the mapped file, including the weights
+};
+
+#endif
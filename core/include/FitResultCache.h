@@ -9,6 +9,7 @@
 #define FitResultCache_h
 
 #include "OptParser.h"
+#include "ParameterBinding.h"
 #include "Utils.h"
 
 using namespace std;
@@ -23,6 +24,13 @@ using namespace Utils;
 /// - a round robin database to hold the N last fit results, so that in
 ///    the plugin scans we can refit multiple times with varying start
 ///    parameters
+/// - a predicted point: where the next fit is expected to end, e.g. the
+///    last fit result moved to the next scan point by a ScanPredictor
+///
+/// All points are stored as plain arrays of values in one buffer, in the
+/// order of the parameter set given to the first store call (the schema).
+/// All later calls have to pass the same set. Storing and restoring a
+/// point then neither allocates nor looks up parameters by name.
 ///
 class FitResultCache
 {
@@ -33,21 +41,30 @@ public:
 
 	void storeParsAtFunctionCall(const RooArgSet* set);
 	void storeParsAtGlobalMin(const RooArgSet* set);
+	void storeParsPredicted(const RooArgSet* set);
 	void storeParsRoundRobin(const RooArgSet* set);
 	void initRoundRobinDB(const RooArgSet* set);
-	const RooArgSet* getRoundRobinNminus(int n);
-	const inline RooArgSet* getParsAtFunctionCall(){assert(_parsAtFunctionCall); return _parsAtFunctionCall->get(0);};
-	const inline RooArgSet* getParsAtGlobalMin(){assert(_parsAtGlobalMin); return _parsAtGlobalMin->get(0);};	
+	ParameterSnapshot getRoundRobinNminus(int n);
+	ParameterSnapshot getParsAtFunctionCall();
+	ParameterSnapshot getParsAtGlobalMin();
+	ParameterSnapshot getParsPredicted();
 
 private:
-      
+
+	void bindSchema(const RooArgSet* set);
+	void store(int slot, const RooArgSet* set);
+	ParameterSnapshot get(int slot);
+
 	OptParser* _arg;                   	///< command line arguments
 	int _roundrobinsize;								///< size of the round robin database
 	int _roundrobinid;									///< id of currently active round robin cell
-	RooDataSet* _parsAtFunctionCall;
-	RooDataSet* _parsAtGlobalMin;
-	vector<RooDataSet*> _parsRoundRobin;
-
+	vector<RooRealVar*> _schema;        ///< the stored parameters, in the order of the set given to the first store call
+	vector<double> _values;             ///< all stored points, one block of _schema.size() values per slot
+	vector<bool> _filled;               ///< slots that hold a point
+	static const int _slotFunctionCall = 0;
+	static const int _slotGlobalMin = 1;
+	static const int _slotPredicted = 2;
+	static const int _slotFirstRoundRobin = 3;
 };
 
 #endif
@@ -10,6 +10,7 @@
 
 #include "PDF_Abs.h"
 #include "OptParser.h"
+#include "ParameterBinding.h"
 #include "Utils.h"
 
 using namespace std;
@@ -30,15 +31,15 @@ public:
     float                   getChi2();
     int                     getStatus();
     void                    print();
-    inline void             setStartpars(const RooArgSet* pars){setStartparsFirstFit(pars);};
-    inline void             setStartparsFirstFit(const RooArgSet* pars){startparsFirstFit=pars;};
-    inline void             setStartparsSecondFit(const RooArgSet* pars){startparsSecondFit=pars;};
+    inline void             setStartpars(ParameterSnapshot pars){setStartparsFirstFit(pars);};
+    inline void             setStartparsFirstFit(ParameterSnapshot pars){startparsFirstFit=pars;};
+    inline void             setStartparsSecondFit(ParameterSnapshot pars){startparsSecondFit=pars;};
     
     OptParser *arg;                     ///< command line arguments
     RooWorkspace *w;                    ///< holds all input pdfs, parameters, and observables, as well as the combination
     TString name;                       ///< Name of the pdf. Call combine() first.
-    RooArgSet const * startparsFirstFit;      	///< start parameters to be used by all fit routines that run one fit, and by the first fit of fitTwice()
-    RooArgSet const * startparsSecondFit;     	///< start parameters to be used by the second fit of fitTwice()
+    ParameterSnapshot startparsFirstFit;      	///< start parameters to be used by all fit routines that run one fit, and by the first fit of fitTwice()
+    ParameterSnapshot startparsSecondFit;     	///< start parameters to be used by the second fit of fitTwice()
     int nFit1Best;                      ///< counter, how many times did fit 1 of fitTwice() give smaller chi2
     int nFit2Best;                      ///< counter, how many times did fit 2 of fitTwice() give smaller chi2
     TString pdfName;                    ///< PDF name in workspace, derived from name
@@ -23,6 +23,7 @@
 #include "PDF_Abs.h"
 #include "ParameterCache.h"
 #include "ParameterEvolutionPlotter.h"
+#include "Profiler.h"
 #include "TApplication.h"
 #include "TColor.h"
 #include "TDatime.h"
@@ -81,6 +82,7 @@ class GammaComboEngine
 		void			defineColors();
 		void			disableSystematics();
 		void			fixParameters(Combiner *c, int cId);
+		bool			isCombinationCacheSafe(int cId);
 		TString			getStartParFileName(int cId);
 		bool			isScanVarObservable(Combiner *c, TString scanVar);
 		void 			loadStartParameters(MethodProbScan *s, ParameterCache *pCache, int cId);
@@ -116,6 +118,7 @@ class GammaComboEngine
 
 		OptParser*			arg;
 		vector<Combiner*> 	cmb;
+		CombinationCache*	combinationCache;   ///< shared workspace of the combinations, if requested (--combcache)
 		vector<int> 		colorsLine;
 		vector<int> 		colorsText;
     vector<int>     fillStyles;
@@ -0,0 +1,109 @@
+/**
+ * Gamma Combination
+ *
+ * The chi2 of a combination of Gaussian measurements, with its
+ * gradient, to be minimized by Minuit2.
+ *
+ **/
+
+#ifndef GaussianChi2_h
+#define GaussianChi2_h
+
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "CompiledTheory.h"
+#include "Math/IFunction.h"
+#include "RooAbsPdf.h"
+#include "RooArgList.h"
+#include "RooFitResult.h"
+#include "RooRealVar.h"
+#include "TMath.h"
+#include "TMatrixDSym.h"
+
+using namespace std;
+
+///
+/// The chi2 = -2ln(L) of a PDF that is a product of RooMultiVarGaussians,
+/// as PDF_Abs::buildPdf() makes them and Combiner::combine() multiplies
+/// them, as a function of its floating parameters.
+///
+/// Per Gaussian, chi2 = r^T C^-1 r with residuals r = x - mu(theta). The
+/// gradient is 2 J^T C^-1 r. The Jacobian J = dr/dtheta is sparse: every
+/// theory relation depends on a few parameters only. It is computed from
+/// central differences of just the relations that depend on a parameter,
+/// instead of differencing the full chi2 as Minuit does otherwise. One
+/// gradient then costs about as much as two chi2 evaluations, independent
+/// of the number of parameters.
+///
+/// The chi2 of every Gaussian is cached. An evaluation recomputes only
+/// the Gaussians depending on a parameter that changed since the last
+/// one, so steps in a single parameter, as in the numerical second
+/// derivatives of Hesse, cost a fraction of a full evaluation when the
+/// measurements depend on disjoint sets of parameters.
+///
+/// With compiledTheory, the theory relations of every Gaussian are
+/// evaluated at once by a CompiledTheory, where they can be compiled.
+///
+/// evaluate() computes the chi2 at many parameter points in one call,
+/// e.g. to screen start points or to fill a likelihood map. Gaussians
+/// with compiled relations are evaluated for all points at once, in
+/// loops over the points.
+///
+/// If the PDF contains anything else, isValid() is false and the fit
+/// has to be done the usual way.
+///
+class GaussianChi2 : public ROOT::Math::IMultiGradFunction
+{
+public:
+	GaussianChi2(RooAbsPdf* pdf, bool compiledTheory=false);
+	~GaussianChi2();
+
+	ROOT::Math::IMultiGradFunction* Clone() const;
+	void                  evaluate(int nPoints, const double* const* x, double* chi2) const;
+	inline const vector<RooRealVar*>& getParameters() const {return pars;};
+	void                  Gradient(const double* x, double* grad) const;
+	inline bool           isValid() const {return valid;};
+	RooFitResult*         minimize(bool thorough=false, int printLevel=-1);
+	unsigned int          NDim() const {return pars.size();};
+
+private:
+	struct Block
+	{
+		vector<RooAbsReal*> obs;   ///< the measured values x
+		vector<RooAbsReal*> th;    ///< the theory relations mu
+		TMatrixDSym         covI;  ///< inverse covariance matrix
+		shared_ptr<CompiledTheory> compiled; ///< all of th at once, or empty. Shared by the clones.
+		vector<int>         batchPars; ///< per parameter of compiled, its index into pars, or -1 if it stays constant
+		bool                batch;     ///< compiled, and only pars change with the parameters, see evaluate()
+	};
+	struct Dependency
+	{
+		int block;                 ///< index into blocks
+		int i;                     ///< index of the residual in the block
+	};
+
+	bool                  addPdf(RooAbsPdf* pdf);
+	double                DoDerivative(const double* x, unsigned int icoord) const;
+	double                blockChi2(int b) const;
+	double                derivative(const double* x, int k, const vector<vector<double> >& w) const;
+	double                DoEval(const double* x) const;
+	void                  residuals(vector<vector<double> >& r) const;
+	void                  residuals(int b, vector<double>& r) const;
+	void                  residuals(const vector<Dependency>& d, vector<double>& r) const;
+	void                  setParameters(const double* x) const;
+	void                  weightedResiduals(int b, const vector<double>& r, vector<double>& w) const;
+
+	RooAbsPdf*                  pdf;        ///< the PDF, not owned
+	vector<Block>               blocks;     ///< one per RooMultiVarGaussian
+	vector<RooRealVar*>         pars;       ///< the floating parameters, in Minuit order
+	vector<vector<Dependency> > deps;       ///< per parameter, the residuals depending on it
+	vector<vector<int> >        parBlocks;  ///< per parameter, the blocks depending on it
+	mutable vector<double>      chi2s;      ///< per block, the chi2 at lastX
+	mutable vector<double>      lastX;      ///< the parameters of the last DoEval(), empty before the first one
+	bool                        valid;      ///< the PDF is a product of RooMultiVarGaussians only
+};
+
+#endif
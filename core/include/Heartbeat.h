@@ -0,0 +1,69 @@
+/**
+ * Gamma Combination
+ *
+ * A small JSON file next to the output of a running job, with its
+ * progress and throughput, rewritten every few seconds.
+ *
+ **/
+
+#ifndef Heartbeat_h
+#define Heartbeat_h
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+
+#include "TString.h"
+
+using namespace std;
+
+///
+/// Machine-readable progress of a job, for monitoring many batch jobs
+/// without parsing their logs. The scans report finished toys, fit
+/// statuses and the current scan point; at most every interval seconds,
+/// and when the job ends, the heartbeat file is replaced by a new one:
+///
+/// \code
+/// {"status": "running", "pid": 1234, "host": "node01", "updated": 1700000000,
+///  "elapsed": 361.2, "stepsDone": 1200, "stepsTotal": 5000, "stepsPerSecond": 3.32,
+///  "eta": 1144.6, "fits": 2400, "fitsFailed": 12, "fitFailureRate": 0.005,
+///  "scanpoint": [0.35], "rssMB": 812.4}
+/// \endcode
+///
+/// A job whose "updated" time lags behind is stuck or dead; "status"
+/// is "done" once it finished. All methods may be called from several
+/// threads.
+///
+class Heartbeat
+{
+public:
+	Heartbeat(TString fileName, unsigned int nTotal, int interval);
+	~Heartbeat();
+
+	void              fitDone(int status);
+	void              fitsDone(int n, int nFailed);
+	static TString    getFileName(TString outputFile);
+	void              setScanpoint(double scanpoint);
+	void              setScanpoint(double scanpoint, double scanpointy);
+	void              step(unsigned int n=1);
+
+private:
+	static TString    jsonNumber(double x);
+	void              write(bool done);
+	void              writeIfDue();
+
+	TString           fileName;     ///< the heartbeat file
+	unsigned int      nTotal;       ///< number of steps (usually toys) of the job
+	unsigned int      nDone;        ///< steps done
+	Long64_t          nFits;        ///< fits reported by fitDone()
+	Long64_t          nFitsFailed;  ///< of those, fits with a status other than 0
+	double            scanpoint;    ///< the current scan point
+	double            scanpointy;   ///< the current scan point in y, for 2D scans
+	int               nScanpoint;   ///< number of coordinates of the scan point set so far (0, 1 or 2)
+	int               interval;     ///< seconds between two writes
+	chrono::steady_clock::time_point start;     ///< when the job started
+	chrono::steady_clock::time_point lastWrite; ///< when the file was last written
+	mutex             lock;         ///< guards all of the above
+};
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * Gamma Combination
+ *
+ * Fills many histograms from a tree in a single pass over its
+ * entries, optionally split over several threads. Replaces
+ * the one TTree::Draw() per histogram in the control plots.
+ *
+ **/
+
+#ifndef HistogramFiller_h
+#define HistogramFiller_h
+
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "TChain.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TLeaf.h"
+#include "TString.h"
+#include "TTree.h"
+
+using namespace std;
+
+///
+/// Declarative histogram booking on a tree of float branches.
+///
+/// Columns are booked by branch name first. Selections and fill
+/// expressions are compiled functions that receive the values of all
+/// booked columns of the current entry, indexed by the numbers column()
+/// returned. Histograms and ranges booked before a call to run() are
+/// all filled in that one pass. Ranges take the place of the automatic
+/// axis ranges of TTree::Draw(): book them, run(), then book the
+/// histograms with the ranges found, and run() again.
+///
+/// Example:
+/// \code
+///   HistogramFiller f(tree);
+///   int x = f.column("chi2minToy");
+///   f.book(new TH1F("h","h",100,0,10), [=](const double *r){return r[x]>0;}, [=](const double *r){return r[x];});
+///   f.run();
+/// \endcode
+///
+class HistogramFiller
+{
+public:
+	typedef function<bool(const double*)>   Selection;
+	typedef function<double(const double*)> Expression;
+
+	HistogramFiller(TTree* t, int nThreads=1);
+	~HistogramFiller();
+
+	int           column(TString branchName);
+	TH1*          book(TH1* h, Selection sel, Expression x);
+	TH2*          book(TH2* h, Selection sel, Expression x, Expression y);
+	int           bookRange(Selection sel, Expression x);
+	void          getRange(int id, float& min, float& max) const;
+	Long64_t      getRangeEntries(int id) const;
+	void          run();
+
+private:
+	struct Booking
+	{
+		TH1*       h;
+		Selection  sel;
+		Expression x;
+		Expression y;  ///< empty for 1D histograms
+	};
+	struct Range
+	{
+		Selection  sel;
+		Expression x;
+		double     min;
+		double     max;
+		Long64_t   n;
+	};
+
+	vector<TString> getFileNames() const;
+	void          process(TTree* tree, Long64_t first, Long64_t last,
+	                      vector<TH1*>& hists, vector<Range>& ranges) const;
+
+	TTree*          t;                 ///< the tree, not owned
+	int             nThreads;          ///< number of threads reading the tree, if it is a TChain
+	vector<TString> columns;           ///< names of the booked branches
+	vector<Booking> bookings;          ///< histograms to fill in the next run()
+	vector<Range>   ranges;            ///< all booked ranges
+	unsigned int    nRangesDone;       ///< ranges before this index were filled by an earlier run()
+};
+
+#endif
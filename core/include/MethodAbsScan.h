@@ -57,6 +57,7 @@ class MethodAbsScan
 		inline const vector<RooSlimFitResult*>& getCurveResults(){return curveResults;};
 		inline float                    getChi2minGlobal(){return chi2minGlobal;}
 		inline float                    getChi2minBkg(){return chi2minBkg;}
+		inline const RooFitResult*      getGlobalMin() const {return globalMin;};
 		float                           getCL(double val);
 		CLInterval                      getCLintervalCentral(int sigma=1);
 		CLInterval                      getCLinterval(int iSol=0, int sigma=1);
@@ -7,6 +7,8 @@
 #ifndef MethodBergerBoosScan_h
 #define MethodBergerBoosScan_h
 
+#include <map>
+
 #include "MethodPluginScan.h"
 #include "TLeaf.h"
 
@@ -20,6 +22,9 @@ public:
     int             getNBergerBoosPointsPerScanpoint(){return nBBPoints;}; ///< Return number of BB points per scan point
     void            readScan1dTrees(int runMin=1, int runMax=1); 
     int             scan1d(int nRun=1); 
+    inline void     setCommonRandomNumbers(bool b){useCrn=b;}; ///< Use the toys of the first BB point at all BB points of a scan point,
+                                        ///< shifted by the change of the theory predictions. Exact for Gaussian measurements.
+    inline void     setHalton(bool b){useHalton=b;}; ///< Place the BB points on a Halton sequence, see setHaltonBergerBoosPoint()
     inline void     setNBergerBoosPointsPerScanpoint(int n){nBBPoints=n;}; ///< Set number of BB points per scan point
                                             ///< Set number of Berger Boos points drawn from 
                                             ///< the BergerBoos CL intervals defined in the workspace
@@ -28,6 +33,9 @@ public:
                                         ///< BergerBoos ranges defined in the workspace
                                         ///< The parameter of interest (scan parameter) has to be set 
                                         ///< constant (and to its scan point value) after the function call.
+    void            setHaltonBergerBoosPoint(int m); ///< Sets the m-th point of a Halton sequence over the
+                                        ///< box spanned by the points in the BBTree, see setHalton().
+                                        ///< Same conventions as setNewBergerBoosPoint().
     void            drawBBPoints(TString varX, TString varY, int runMin=1, int runMax=1, bool save=true); ///< Draws 2D Histogram showing the BB points in varX-varY space
                                         ///< The boolian 'save' specifies if a copy of the plot will
                                         ///< be saved in the plots folder. 
@@ -36,8 +44,12 @@ public:
     TString dir;
     
 protected:
+    static double   halton(int index, int base);
 
     int             nBBPoints;          ///< number of sampled Berger Boos points per scan point
+    bool            useCrn;             ///< common random numbers for the toys of all BB points, see setCommonRandomNumbers()
+    bool            useHalton;          ///< BB points from a Halton sequence instead of the BBTree, see setHalton()
+    map<TString,pair<double,double> > bbBox; ///< range of each parameter in the BBTree, filled by setHaltonBergerBoosPoint()
 };
 
 #endif
@@ -8,8 +8,10 @@
 #ifndef MethodCoverageScan_h
 #define MethodCoverageScan_h
 
+#include <algorithm>
 #include <iostream>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "RooAddition.h"
 #include "RooArgSet.h"
@@ -13,10 +13,42 @@
 #include "MethodDatasetsProbScan.h"
 #include "ProgressBar.h"
 #include "PDF_Datasets.h"
+#include "QuantileSketch.h"
 #include "RooSlimFitResult.h"
 #include "TLeaf.h"
 #include "TBranch.h"
 
+///
+/// The toys of one scanpoint (datasets and global observables) and their
+/// free fits, kept to be reused at the following scanpoints (--reusetoys).
+///
+struct ReusedDatasetToys
+{
+    ReusedDatasetToys(float minEssFraction) : reweighter(minEssFraction), globalObs(0), parsFree(0) {};
+    ~ReusedDatasetToys() {clear();};
+    void clear() {
+        for (unsigned int j = 0; j < toys.size(); j++) delete toys[j];
+        toys.clear();
+        delete globalObs; globalObs = 0;
+        delete parsFree; parsFree = 0;
+        chi2minGlobalToy.clear();
+        chi2minGlobalToyPDF.clear();
+        statusFree.clear();
+        statusFreePDF.clear();
+        covQualFree.clear();
+        reweighter.clear();
+    };
+    ToyReweighter       reweighter;
+    vector<RooDataSet*> toys;                 ///< the toy datasets, generated at the source scanpoint
+    RooDataSet*         globalObs;            ///< per toy, the global observables
+    RooDataSet*         parsFree;             ///< per toy, the parameters after the free fit
+    vector<float>       chi2minGlobalToy;     ///< per toy, the free fit results as stored in the ToyTree
+    vector<float>       chi2minGlobalToyPDF;
+    vector<float>       statusFree;
+    vector<float>       statusFreePDF;
+    vector<float>       covQualFree;
+};
+
 class MethodDatasetsPluginScan : public MethodPluginScan
 {
 public:
@@ -49,7 +81,12 @@ protected:
 
 private:
     RooFitResult*       loadAndFit(PDF_Datasets* pdf); // in this Plugin class, this fits to toy!!
+    RooFitResult*       loadAndFit(PDF_Datasets* pdf, const TString& globalObsSnapshotName);
+    RooFitResult*       fitBkgOnlyToy(RooDataSet* bkgToy, const RooArgSet* bkgToyGlobalObs);
+    void                getClsTestStatistics(const ToyTree& t, double& bkgTestStat, double& sbTestStat);
     double              getPValueTTestStatistic(double test_statistic_value);
+    vector<double>      getToyLogDensities(ReusedDatasetToys* reuse);
+    bool                readClsSketches(TChain* c, TH1F* h, std::map<int,QuantileSketch>& bSketches, std::map<int,QuantileSketch>& sbSketches);
     void                setAndPrintFitStatusConstrainedToys(const ToyTree& ToyTree);
     void                setAndPrintFitStatusFreeToys(const ToyTree& ToyTree);
     void                checkExtProfileLH();
@@ -8,6 +8,8 @@
 #ifndef MethodDatasetsProbScan_h
 #define MethodDatasetsProbScan_h
 
+#include <map>
+
 #include "MethodProbScan.h"
 #include "ProgressBar.h"
 #include "PDF_Datasets.h"
@@ -21,6 +23,9 @@ class MethodDatasetsProbScan : public MethodProbScan
 public:
     MethodDatasetsProbScan(PDF_Datasets* PDF, OptParser* opt);
 
+    static double       asymptoticCLsExpected(double qA, double clb);
+    static double       asymptoticCLsObserved(double qA, double qObs);
+
     virtual void        initScan();
     void                loadScanFromFile(TString fileNameBaseIn = "default");
     void                loadFitResults(TString file);
@@ -47,6 +52,8 @@ public:
 protected:
 
 private:
+    void                computeAsymptoticCLs();
+    void                fitPoints2dInWorkers(std::map<std::pair<int,int>,std::pair<RooSlimFitResult*,double> >& results);
     TChain*             readFiles(TString fileNameBaseIn = "default");
     void                readScan1dTrees(TString fileNameBaseIn = "default");
     RooFitResult*       loadAndFit(PDF_Datasets* pdf);
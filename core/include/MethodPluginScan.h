@@ -49,6 +49,9 @@
 #include "MethodAbsScan.h"
 #include "MethodProbScan.h"
 #include "ProgressBar.h"
+#include "ScanPredictor.h"
+#include "ToyReweighter.h"
+#include "ToyTaskQueue.h"
 #include "ToyTree.h"
 #include "Utils.h"
 #include "PDF_Datasets.h"
@@ -57,6 +60,22 @@ using namespace RooFit;
 using namespace std;
 using namespace Utils;
 
+///
+/// The toys of one scan point and their free fits, which don't depend
+/// on the scan point, kept to be reused at the following scan points
+/// (--reusetoys).
+///
+struct ReusedToys
+{
+	ReusedToys(float minEssFraction) : reweighter(minEssFraction), toys(0), parsFree(0) {};
+	~ReusedToys(){delete toys; delete parsFree;};
+	ToyReweighter     reweighter;
+	RooDataSet*       toys;               ///< the toys, generated at the source point
+	RooDataSet*       parsFree;           ///< per toy, the parameters after the free fit
+	vector<float>     chi2minGlobalToy;   ///< per toy, the chi2 of the free fit
+	vector<float>     statusFree;         ///< per toy, the status of the free fit
+};
+
 class MethodPluginScan : public MethodAbsScan
 {
 	public:
@@ -66,6 +85,7 @@ class MethodPluginScan : public MethodAbsScan
 
 		inline void     setNtoysPerPoint(int n){nToys=n;};
 		void            setParevolPLH(MethodProbScan* s);
+		void            storeObservables();
 		virtual int     scan1d(int nRun=1);
 		virtual void    scan2d(int nRun=1);
 		virtual void    readScan1dTrees(int runMin=1, int runMax=1, TString fName="default");
@@ -75,10 +95,14 @@ class MethodPluginScan : public MethodAbsScan
 
 	protected:
 		TH1F*           	analyseToys(ToyTree* t, int id=-1);
-		void          		computePvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id, Fitter *f, ProgressBar *pb);
+		void          		computePvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id, Fitter *f, ProgressBar *pb,
+												ReusedToys* reuse=0, int nToysPoint=-1);
 		RooDataSet*				generateToys(int nToys);
+		vector<double>		getToyLogDensities(RooDataSet* toys);
 		double          	importance(double pvalue);
 		RooSlimFitResult*	getParevolPoint(float scanpoint);
+		void            	mergeToyWorkers(TString fileName, int nWorkers, int iWorker, const vector<pid_t>& workers);
+		void            	showProgressOfToyWorkers(ToyTaskQueue& queue, ProgressBar* pb);
 
 
 		int             nToys;              ///< number of toys to be generated at each scan point
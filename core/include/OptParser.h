@@ -39,9 +39,11 @@ class OptParser
 		vector<TString>	action;
 		vector<int>		asimov;
 		vector<TString> asimovfile;
+		bool			asymptoticcls;
 		bool			cacheStartingValues;
 		vector<int>		cls;
 		vector<int>		color;
+		bool			combcache;
 		vector<int>		combid;
 		vector<vector<int> >	combmodifications; // encodes requested modifications to the combiner ID through the -c 26:+12 syntax,format is [cmbid:[+pdf1,-pdf2,...]]
     bool            confirmsols;
@@ -58,8 +60,11 @@ class OptParser
 		vector<vector<RangePar> >   physRanges;
     vector<vector<TString> >    removeRanges;
     vector<vector<TString> >    randomizeToyVars;
+		bool            compiledtheory;
+		bool            gradient;
 		TString	        group;
 		TString	        groupPos;
+		int             heartbeat;
 		TString         hfagLabel;
     TString         hfagLabelPos;
     int             id;
@@ -85,6 +90,10 @@ class OptParser
 		int		npoints2dy;
 		int             npointstoy;
     int             ncoveragetoys;
+		int             ncpu;
+		int             coverageworkers;
+		int             controlplotthreads;
+		int             covCorrectThreads;
 		int		nrun;
 		int		ntoys;
     int   nsmooth;
@@ -124,11 +133,13 @@ class OptParser
 		TString 				probScanResult;
 		bool		printcor;
     float           printSolX;
+		TString         profile;
     float           printSolY;
 		vector<int>   	qh;
     TString         queue;
     vector<TString> readfromfile;
 		vector<TString> relation;
+		float           reusetoys;
 		bool 						runCLs;
     TString         save;
     bool            saveAtMin;
@@ -136,13 +147,20 @@ class OptParser
 		vector<float>   savenuisances2dx;
 		vector<float>   savenuisances2dy;
 		bool		scanforce;
+		bool		scanpredict;
+		int		scanworkers;
 		float           scanrangeMin;
 		float           scanrangeMax;
 		float           scanrangeyMin;
 		float           scanrangeyMax;
 		bool    smooth2d;
 		vector<TString> title;
+		int             toybasket;
+		TString         toycolumns;
+		int             toycompression;
     TString         toyFiles;
+		int             toyflush;
+		int             toyworkers;
 		bool            usage;
 		vector<TString> var;
 		bool		verbose;
@@ -17,6 +17,7 @@
 #ifndef PDF_Datasets_h
 #define PDF_Datasets_h
 
+#include "DatasetCache.h"
 #include "PDF_Abs.h"
 
 class PDF_Datasets : public PDF_Abs
@@ -33,9 +34,12 @@ public:
     virtual void          generateToysGlobalObservables(int SeedShift = 0);
     virtual void          generateBkgToys(int SeedShift = 0);
     virtual void          generateBkgToysGlobalObservables(int SeedShift = 0);
+    RooDataSet*           generateBkgAsimov();
+    double                getToyLogDensity(RooDataSet* toy);
 
     void                  initConstraints(const TString& setName);
     void                  initData(const TString& name);
+    void                  initData(const TString& name, const TString& cacheFile, const TString& sourceFile);
     void                  initObservables(const TString& setName);
     virtual void          initObservables();  //overriding the inherited virtual method
     void                  initGlobalObservables(const TString& setName);
@@ -87,18 +91,21 @@ public:
     inline  bool          notSetupToFit(bool fitToys) {return (!(isPdfSet && isDataSet) || (fitToys && !(isPdfSet && isToyDataSet))); }; // this comes from a previous if-statement
 
 
-    int                   NCPU;         //> number of CPU used
+    int                   NCPU;         //> number of CPU used to evaluate the NLL in fit() and fitBkg()
     float                 minNll;
 
     const TString         globalObsDataSnapshotName = "globalObsDataSnapshotName";
     //> name of a snapshot that stores the values of the global observables in data
     const TString         globalObsToySnapshotName = "globalObsToySnapshotName";
     //> name of a snapshot that stores the latest simulated values for the global observables
+    const TString         globalObsBkgToySnapshotName = "globalObsBkgToySnapshotName";
+    //> name of a snapshot that stores the latest values for the global observables simulated under the background-only hypothesis
 
 protected:
     void initializeRandomGenerator(int seedShift);
     RooWorkspace*   wspc;
     RooDataSet*     data;
+    bool            isDataOwned;    //> data was filled from a cache file, not taken from the workspace
     RooAbsReal*     _NLL; // possible pointer to minimization function
     RooAbsPdf*      _constraintPdf;
     TString         pdfName; //> name of the pdf in the workspace
@@ -14,6 +14,7 @@
 #include "TList.h"
 #include "TMath.h"
 #include "TFile.h"
+#include "TVectorD.h"
 
 class PValueCorrection {
 
@@ -26,6 +27,7 @@ class PValueCorrection {
 		void setTransFunc(TString tf) { transFunc = tf; }
 		void setFitParams(std::vector<double> fP) { fitParams = fP; }
 		void setFitParam(int i, double val);
+		void setNThreads(int n) { nThreads = n; }
 		void readFiles(TString name, int id=0, bool isPlugin=false);
 		void fitHist(TH1* h);
 		double transform(double x);
@@ -38,8 +40,15 @@ class PValueCorrection {
 		void write(TFile *f);
 
 	private:
+		bool loadCache(TString fname, TString key);
+		void readPvalues(const std::vector<TString>& files, int first, int last, bool isPlugin,
+				std::vector<float>& pvalues, Long64_t& nentries) const;
+		void saveCache(TString fname, TString key, const TVectorD& coverage);
+		void setFitFunc();
+
 		TString transFunc;
 		bool verbose;
+		int nThreads;
 		TString fitString;
 		TF1 fitFunc;
 		std::vector<double> fitParams;
@@ -0,0 +1,70 @@
+/**
+ * Gamma Combination
+ *
+ * Allocation- and lookup-free copying of parameter values, for
+ * the inner loops of the toy scans.
+ *
+ **/
+
+#ifndef ParameterBinding_h
+#define ParameterBinding_h
+
+#include <iostream>
+#include <vector>
+
+#include "RooAbsCollection.h"
+#include "RooRealVar.h"
+
+using namespace std;
+
+///
+/// A set of parameter values stored as a plain array, in the order
+/// of a schema: the list of RooRealVar* the values belong to. Neither
+/// the schema nor the values are owned, see FitResultCache.
+///
+class ParameterSnapshot
+{
+public:
+	ParameterSnapshot() : _schema(0), _values(0) {};
+	ParameterSnapshot(const vector<RooRealVar*>* schema, const double* values)
+		: _schema(schema), _values(values) {};
+
+	void              apply(bool floatingOnly=false) const;
+	inline bool       isValid() const {return _schema!=0;};
+
+private:
+	const vector<RooRealVar*>* _schema; ///< the parameters the values belong to
+	const double*              _values; ///< one value per schema entry
+};
+
+///
+/// Copies the values of one collection into the parameters of
+/// same name in another. The parameters are paired by name once,
+/// when the binding is made, so that apply() is a plain loop.
+/// The typical source is the row of a RooDataSet, which
+/// RooDataSet::get(i) loads into the same RooArgSet for every i:
+///
+/// \code
+///   ParameterBinding toyObs(w->set(obsName), toyDataSet->get());
+///   for ( int j=0; j<nToys; j++ ){
+///     toyDataSet->get(j);
+///     toyObs.apply();
+///     ...
+/// \endcode
+///
+class ParameterBinding
+{
+public:
+	ParameterBinding() {};
+	ParameterBinding(const RooAbsCollection* setMe, const RooAbsCollection* values);
+
+	void              apply(bool floatingOnly=false) const;
+	void              bind(const RooAbsCollection* setMe, const RooAbsCollection* values);
+	inline int        size() const {return _dst.size();};
+
+private:
+	vector<RooRealVar*>       _dst;   ///< parameters to be set
+	vector<const RooRealVar*> _src;   ///< where their values come from
+};
+
+#endif
@@ -0,0 +1,127 @@
+/**
+ * Gamma Combination
+ *
+ * Registry of scoped timers and counters for the hot paths
+ * (fits, toy generation, ToyTree I/O, parameter loading).
+ * Switched on by --profile, which also writes a report at exit.
+ *
+ **/
+
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TString.h"
+
+using namespace std;
+
+///
+/// Accumulated statistics of one timer or counter.
+/// Call durations are kept in a histogram with four bins
+/// per power of two, which is enough to quote percentiles
+/// to about 20%.
+///
+struct ProfilerEntry
+{
+	ProfilerEntry();
+	void      add(long long ns);
+	void      merge(const ProfilerEntry& other);
+	double    percentile(double p) const;
+
+	static const int nBins = 4*48;  ///< covers 1ns ... 3 days
+	bool               isCounter;   ///< counters only use 'calls'
+	unsigned long long calls;       ///< number of timed calls, or sum of the counter increments
+	long long          total;       ///< total time in ns
+	long long          max;         ///< longest call in ns
+	vector<unsigned long long> hist;///< log-binned histogram of the call durations
+};
+
+///
+/// The registry. Every thread books into its own table, so that
+/// timers don't need to lock. The tables are merged when the report
+/// is written, which has to happen after worker threads finished.
+/// Worker processes (see Utils::forkWorkers()) hand their tables to
+/// the parent through a file, see writeWorkerTables().
+///
+class Profiler
+{
+public:
+	static Profiler&    instance();
+	static inline bool  isEnabled(){return _enabled;};
+
+	void                enable(TString fileName);
+	void                addTime(const char* name, long long ns);
+	void                addCount(const char* name, long long n=1);
+	void                print();
+	void                writeReport();
+	void                startWorker();
+	void                writeWorkerTables(int iWorker);
+	void                mergeWorkerTables(int iWorker);
+
+private:
+	Profiler();
+	typedef unordered_map<const char*, ProfilerEntry> Table;
+	Table&              threadTable();
+	map<string, ProfilerEntry> mergeTables();
+	TString             workerTablesFileName(int iWorker, int parentPid);
+	static void         writeReportAtExit();
+
+	static bool         _enabled;       ///< global switch, checked by every timer
+	TString             _fileName;      ///< report file, .json or .csv
+	bool                _written;       ///< report was written already
+	mutex               _mutex;         ///< protects _tables
+	vector<Table*>      _tables;        ///< one table per thread that booked something
+	map<string, ProfilerEntry> _workerEntries; ///< merged tables of finished worker processes
+};
+
+///
+/// Scoped timer. Measures the time between construction and
+/// destruction and books it under 'name', which has to be a
+/// string literal. Costs one branch if profiling is off.
+///
+/// \code
+/// {
+///   ProfileTimer pt("Utils::fitToMin");
+///   ...
+/// }
+/// \endcode
+///
+class ProfileTimer
+{
+public:
+	inline ProfileTimer(const char* name)
+		: _name(name), _running(Profiler::isEnabled())
+	{
+		if ( _running ) _start = std::chrono::steady_clock::now();
+	}
+	inline ~ProfileTimer()
+	{
+		if ( !_running ) return;
+		long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-_start).count();
+		Profiler::instance().addTime(_name, ns);
+	}
+
+private:
+	const char* _name;
+	bool        _running;
+	std::chrono::steady_clock::time_point _start;
+};
+
+///
+/// Increase the counter 'name' by n, if profiling is on.
+///
+inline void profileCount(const char* name, long long n=1)
+{
+	if ( Profiler::isEnabled() ) Profiler::instance().addCount(name, n);
+}
+
+#endif
@@ -8,6 +8,7 @@
 #ifndef ProgressBar_h
 #define ProgressBar_h
 
+#include "Heartbeat.h"
 #include "OptParser.h"
 #include "Utils.h"
 
@@ -15,7 +16,8 @@ using namespace std;
 using namespace Utils;
 
 ///
-/// Class showing a progress bar.
+/// Class showing a progress bar. If a Heartbeat is attached,
+/// the progress is also reported to it.
 ///
 class ProgressBar
 {
@@ -24,7 +26,15 @@ public:
 	ProgressBar(OptParser *arg, unsigned int n);
 	~ProgressBar();
 
+	void      fitDone(int status);
+	inline int getNFits() const {return _nFits;};
+	inline int getNFitsFailed() const {return _nFitsFailed;};
 	void      progress();
+	inline void setHeartbeat(Heartbeat* hb){_heartbeat=hb;};
+	inline void setSilent(){_silent=true;};
+	void      setScanpoint(double x);
+	void      setScanpoint(double x, double y);
+	void      skipFits(int n, int nFailed);
 	void			skipSteps(unsigned int n);
     
 private:
@@ -38,6 +48,10 @@ private:
 	int _width;						///< width of the progress bar
 	int _resolution;			///< update the display this many times
 	bool _batch;					///< display progress in a log-file compatible way
+	bool _silent;					///< don't display anything, e.g. in worker processes
+	Heartbeat* _heartbeat;		///< if set, receives the progress too. Not owned.
+	int _nFits;						///< fits reported by fitDone()
+	int _nFitsFailed;				///< of those, fits with a status other than 0
 };
 
 #endif
@@ -0,0 +1,80 @@
+/**
+ * Gamma Combination
+ *
+ * A mergeable streaming quantile sketch (t-digest), to compute
+ * quantiles of large toy ensembles in bounded memory.
+ *
+ **/
+
+#ifndef QuantileSketch_h
+#define QuantileSketch_h
+
+#include <iostream>
+#include <vector>
+
+#include "TMath.h"
+#include "TString.h"
+#include "TVectorD.h"
+
+using namespace std;
+
+///
+/// A t-digest (T. Dunning, "Computing extremely accurate quantiles
+/// using t-digests"): the values are summarized by a sorted list of
+/// centroids (mean, weight). Centroids near the tails are kept small,
+/// so the precision is best at extreme quantiles, such as the
+/// +/-2 sigma quantiles of the expected CLs band. Two sketches of the
+/// same quantity can be merged, e.g. those of several toy files.
+///
+/// The sketch is exact as long as it holds fewer than 5 x compression
+/// values, and then agrees with Utils::Quantile() and
+/// Utils::getVectorFracAboveValue(). Beyond that, it holds about
+/// compression centroids.
+///
+/// Repeated values are kept as "atoms", which are never merged with
+/// different values. This keeps point masses exact, like the one-sided
+/// test statistic, which is zero for all toys that fit above the scan
+/// point.
+///
+/// Values can be added with a weight, e.g. the weights of reweighted
+/// toys; all counts and quantiles are then weighted.
+///
+class QuantileSketch
+{
+public:
+	QuantileSketch(double compression=500.);
+	QuantileSketch(const TVectorD& v);
+	~QuantileSketch();
+
+	void             add(double value, double weight=1.);
+	double           fracAbove(double value);
+	inline double    getN() const {return total;};
+	void             merge(const QuantileSketch& other);
+	double           quantile(double p);
+	vector<double>   quantiles(const vector<double>& probs);
+	TVectorD         toVector();
+
+private:
+	struct Centroid
+	{
+		double mean;
+		double weight;
+		bool   atom;       ///< made of identical values only
+		double n;          ///< number of values added, for atoms
+		bool operator<(const Centroid& other) const {return mean<other.mean;};
+	};
+
+	void             compress();
+	void             sort();
+	double           halfWeight(int i) const;
+
+	double           compression;  ///< the accuracy parameter delta, about the number of centroids
+	vector<Centroid> centroids;
+	bool             sorted;       ///< the centroids are sorted, and adjacent atoms of the same value are joined
+	int              nCompressed;  ///< number of centroids after the last compression
+	double           total;        ///< sum of all weights
+	double           min;          ///< smallest value added
+	double           max;          ///< largest value added
+};
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * Gamma Combination
+ *
+ * Predicts the nuisance parameters at the next point of a profile
+ * likelihood scan from the points already fitted, so that the fit
+ * of that point starts close to its minimum.
+ *
+ **/
+
+#ifndef ScanPredictor_h
+#define ScanPredictor_h
+
+#include <iostream>
+#include <vector>
+
+#include "RooFitResult.h"
+#include "RooRealVar.h"
+#include "RooWorkspace.h"
+#include "TString.h"
+
+#include "Utils.h"
+
+using namespace std;
+using namespace Utils;
+
+///
+/// Predictor step of a predictor-corrector profile scan.
+///
+/// The scan loop calls record() after each fit of a point, and
+/// predict() before fitting the next one: it extrapolates the
+/// nuisances of the last recorded points to the new value of the
+/// scan parameter, quadratically through the last three, linearly
+/// through the last two, and, for the first step after a single
+/// point, along the slope Cov(nuisance,scan)/Var(scan) of a fit
+/// result with the scan parameter floating, if one is given.
+/// The fit (the corrector) then only needs to remove the residual.
+///
+/// Angles are unwrapped across the recorded points, so that a
+/// profile crossing the 2pi boundary is extrapolated smoothly.
+/// Predictions are clipped to the parameter ranges.
+///
+class ScanPredictor
+{
+public:
+	ScanPredictor(RooWorkspace* w, TString parsName, TString scanVar, const RooFitResult* cov=0);
+	~ScanPredictor();
+
+	bool              predict(double scanvalue);
+	void              record(double scanvalue);
+	void              reset();
+	void              shift(double from, double to);
+	inline int        size() const {return _points.size();};
+
+private:
+	void              set(int i, double value);
+
+	vector<RooRealVar*>    _pars;         ///< the predicted parameters: all but the scan parameter
+	vector<bool>           _isAngle;      ///< per parameter, whether it is an angle
+	vector<double>         _slopes;       ///< per parameter, Cov(p,scan)/Var(scan), 0 if unknown
+	vector<double>         _x;            ///< scan parameter of the recorded points, oldest first
+	vector<vector<double> > _points;      ///< parameters of the recorded points, oldest first
+	static const unsigned int _nPoints = 3; ///< number of points kept for the extrapolation
+};
+
+#endif
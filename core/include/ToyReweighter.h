@@ -0,0 +1,56 @@
+/**
+ * Gamma Combination
+ *
+ * Importance weights that carry the toys generated at one scan
+ * point over to the neighbouring scan points.
+ *
+ **/
+
+#ifndef ToyReweighter_h
+#define ToyReweighter_h
+
+#include <iostream>
+#include <vector>
+
+#include "TMath.h"
+
+using namespace std;
+
+///
+/// Reweighting of a toy ensemble to a new generating point.
+///
+/// The toys x_j were generated at a source point theta_s. At a
+/// neighbouring point theta, each toy gets the weight
+/// w_j = p(x_j|theta)/p(x_j|theta_s), computed from the log densities
+/// of the toys at both points. The weights are normalized to a mean
+/// of 1. Weighted counts of the toys then estimate p-values at theta
+/// as if the toys were generated there.
+///
+/// The further theta is from theta_s, the more the weights spread,
+/// measured by the effective sample size ESS = (sum w)^2 / sum w^2.
+/// reweight() tells whether the ESS is still at least the given
+/// fraction of the number of toys. If not, the caller generates
+/// fresh toys, and makes them the new source with setSource().
+///
+class ToyReweighter
+{
+public:
+	ToyReweighter(float minEssFraction);
+	~ToyReweighter();
+
+	void              clear();
+	inline double     getEss() const {return ess;};
+	inline int        getNToys() const {return logDensitySource.size();};
+	inline float      getWeight(int j) const {return weights[j];};
+	inline bool       hasSource() const {return !logDensitySource.empty();};
+	bool              reweight(const vector<double>& logDensity);
+	void              setSource(const vector<double>& logDensity);
+
+private:
+	float             minEssFraction;    ///< reweighted toys are used if ESS >= minEssFraction x number of toys
+	vector<double>    logDensitySource;  ///< per toy, log p(x_j|theta_s)
+	vector<float>     weights;           ///< per toy, the weight at the last reweighted point
+	double            ess;               ///< effective sample size at the last reweighted point
+};
+
+#endif
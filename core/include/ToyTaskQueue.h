@@ -0,0 +1,64 @@
+/**
+ * Gamma Combination
+ *
+ * The toys of a plugin scan, split into small tasks that worker
+ * processes take one at a time.
+ *
+ **/
+
+#ifndef ToyTaskQueue_h
+#define ToyTaskQueue_h
+
+#include <iostream>
+
+using namespace std;
+
+///
+/// A queue of (scan point, block of toys) tasks shared by the worker
+/// processes started with Utils::forkWorkers(). Each worker takes the
+/// next task as soon as it is done with its last one, so a worker that
+/// got stuck at a slow scan point, e.g. close to a physical boundary,
+/// doesn't hold up the others: they take over the remaining blocks of
+/// that point and of all later ones. The wall time then follows the
+/// average cost of a task rather than that of the slowest point.
+///
+/// The queue lives in shared memory, so it has to be created before
+/// the workers are forked. Tasks are handed out point by point, in
+/// the order of the scan points. The workers also report their toys
+/// and fits through it, so that the first worker can show the progress
+/// of all of them.
+///
+class ToyTaskQueue
+{
+public:
+	ToyTaskQueue(int nPoints, int nToys, int blockSize);
+	~ToyTaskQueue();
+
+	void              done(int nToys, int nFits, int nFitsFailed);
+	void              getNewFitsOfOtherWorkers(int& nFits, int& nFitsFailed);
+	inline int        getNTasks() const {return nPoints*nBlocks;};
+	int               getNewToysOfOtherWorkers();
+	bool              next(int& point, int& nToys);
+
+private:
+	struct Shared
+	{
+		int nextTask;     ///< the next task to hand out
+		int toysDone;     ///< toys finished by all workers
+		int fitsDone;     ///< fits done by all workers
+		int fitsFailed;   ///< of those, fits with a status other than 0
+	};
+	Shared*           shared;         ///< in an anonymous shared mapping, seen by all workers
+	int               nPoints;        ///< number of scan points
+	int               nToys;          ///< toys per scan point
+	int               blockSize;      ///< toys per task
+	int               nBlocks;        ///< tasks per scan point
+	int               toysDoneHere;   ///< toys finished by this worker
+	int               toysSeenHere;   ///< toys of other workers already returned by getNewToysOfOtherWorkers()
+	int               fitsDoneHere;   ///< fits done by this worker
+	int               fitsFailedHere; ///< of those, failed fits
+	int               fitsSeenHere;   ///< fits of other workers already returned by getNewFitsOfOtherWorkers()
+	int               fitsFailedSeenHere; ///< of those, failed fits
+};
+
+#endif
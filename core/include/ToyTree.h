@@ -43,6 +43,7 @@ class ToyTree
 		void                    activateBranch(const TString& bName);
 		void                    fill();
 		void                    init();
+		void                    init(TString fName);
 		OptParser*              getArg(){return arg;};
 		Long64_t                GetEntries();
 		void                    GetEntry(Long64_t i);
@@ -95,6 +96,7 @@ class ToyTree
 		float nBergerBoos;
 		float BergerBoos_id;
 		float genericProbPValue;
+		float weight;           ///< importance weight of the toy, 1 unless it was reused from another scan point (--reusetoys)
 		float statusFreePDF;
 		float statusScanPDF;
 		float chi2minToyPDF;
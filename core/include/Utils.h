@@ -17,7 +17,6 @@
 #include "TCanvas.h"
 #include "TPad.h"
 #include "TPaveText.h"
-#include "rdtsc.h"
 #include "TMatrixDSym.h"
 #include "RooRealVar.h"
 #include "RooFitResult.h"
@@ -32,6 +31,7 @@
 #include "TMatrixDSymEigen.h"
 #include "TVectorD.h"
 #include <sys/stat.h>
+#include <sys/types.h>
 #include "boost/algorithm/string.hpp"
 #include "UtilsConfig.h"
 
@@ -40,8 +40,11 @@ using namespace RooFit;
 
 namespace Utils
 {
-	extern int countFitBringBackAngle;      ///< counts how many times an angle needed to be brought back
+	extern int countFitBringBackAngle;      ///< counts how many times an angle needed to be brought back by a refit
+	extern int countFitWrapAngle;           ///< counts how many times angles were brought back without a refit
 	extern int countAllFitBringBackAngle;   ///< counts how many times fitBringBackAngle() was called
+	extern bool fitWithGradient;            ///< let fitToMin() minimize Gaussian combinations with analytic gradients, see GaussianChi2
+	extern bool fitWithCompiledTheory;      ///< let GaussianChi2 evaluate the theory relations with compiled kernels, see CompiledTheory
 
 	// used to fix parameters in the combination, see e.g. Combiner::combine()
 	struct FixPar
@@ -79,6 +82,7 @@ namespace Utils
 	RooFitResult*   fitToMinForce(RooWorkspace *w, TString name, TString forceVariables="");
 	RooFitResult*   fitToMinImprove(RooWorkspace *w, TString name);
 	double          getChi2(RooAbsPdf *pdf);
+	vector<double>  getChi2(RooAbsPdf *pdf, const RooArgList& pars, const vector<vector<double> >& values);
 	TH1F*           histHardCopy(const TH1F* h, bool copyContent=true, bool uniqueName=true);
 	TH2F*           histHardCopy(const TH2F* h, bool copyContent=true, bool uniqueName=true);
 
@@ -88,6 +92,7 @@ namespace Utils
   TGraph* smoothHist(TH1* h, int option=0);
 
 	void mergeNamedSets(RooWorkspace *w, TString mergedSet, TString set1, TString set2);
+	void mergeNamedSets(RooWorkspace *w, TString mergedSet, const vector<TString>& sets);
 	void randomizeParameters(RooWorkspace* w, TString setname);
 	void randomizeParametersGaussian(RooWorkspace* w, TString setname, RooSlimFitResult *r);
 	void randomizeParametersUniform(RooWorkspace* w, TString setname, RooSlimFitResult *r, double sigmaRange);
@@ -116,6 +121,13 @@ namespace Utils
 	void savePlot(TCanvas *c1, TString name);
 	bool FileExists( TString strFilename );
 	void assertFileExists(TString strFilename);
+
+	int forkWorkers(int nWorkers, vector<pid_t>& pids);
+	void exitWorker(int iWorker);
+	void waitForWorkers(const vector<pid_t>& pids);
+	UInt_t seedWorker(UInt_t runSeed, int iWorker);
+	TString workerFileName(TString fileName, int iWorker);
+	TTree* mergeWorkerFiles(TString treeName, TString fileName, int nWorkers, TString sortBranch);
 	template<class T> inline bool isIn(vector<T> vec, T var){return (find(vec.begin(), vec.end(), var) != vec.end());};
 
 	static int uniqueRootNameId = 0;
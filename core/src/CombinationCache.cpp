@@ -0,0 +1,84 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "CombinationCache.h"
+#include "Profiler.h"
+
+CombinationCache::CombinationCache()
+{
+	TString wsname = "w"+getUniqueRootName();
+	w = new RooWorkspace(wsname, wsname);
+}
+
+CombinationCache::~CombinationCache()
+{
+	delete w;
+}
+
+///
+/// Everything that makes the block of a PDF: the PDF object itself,
+/// the names and values of its observables, and its covariance matrix.
+/// The name includes the unique ID given by PDF_Abs::uniquify().
+///
+TString CombinationCache::fingerprint(PDF_Abs* pdf)
+{
+	TString fp = Form("%p", (void*)pdf->getPdf());
+	RooArgList* obs = pdf->getObservables();
+	for ( int i=0; i<obs->getSize(); i++ ){
+		fp += Form(";%s=%.17g", obs->at(i)->GetName(), ((RooAbsReal*)obs->at(i))->getVal());
+	}
+	const TMatrixDSym& cov = pdf->covMatrix;
+	for ( int i=0; i<cov.GetNrows(); i++ ){
+		for ( int j=0; j<=i; j++ ) fp += Form(";%.17g", cov(i,j));
+	}
+	return fp;
+}
+
+///
+/// Check that a PDF can use the cache: either it wasn't imported
+/// before, or it is unchanged since. Call after PDF_Abs::uniquify().
+///
+bool CombinationCache::canImport(PDF_Abs* pdf)
+{
+	map<TString,TString>::const_iterator it = blocks.find(pdf->getName());
+	if ( it==blocks.end() ) return true;
+	return it->second==fingerprint(pdf);
+}
+
+///
+/// Import a PDF, unless it was imported before.
+/// Check canImport() first.
+///
+void CombinationCache::import(PDF_Abs* pdf)
+{
+	if ( blocks.find(pdf->getName())!=blocks.end() ){
+		profileCount("CombinationCache reused PDFs");
+		return;
+	}
+	importPdf(w, pdf);
+	blocks[pdf->getName()] = fingerprint(pdf);
+}
+
+///
+/// Add a PDF to a workspace, along with the named sets of
+/// its observables, parameters and theory relations.
+///
+void CombinationCache::importPdf(RooWorkspace* w, PDF_Abs* pdf)
+{
+	ProfileTimer pt("CombinationCache::importPdf");
+	RooMsgService::instance().setGlobalKillBelow(WARNING);
+	if ( pdf->isCrossCorPdf() ){
+		// cross correlation PDFs need the same observable names as the main PDFs,
+		// so link them together in the workspace
+		w->import(*pdf->getPdf(),RecycleConflictNodes());
+	}
+	else{
+		w->import(*pdf->getPdf());
+	}
+	w->defineSet("obs_"+pdf->getName(), *pdf->getObservables());
+	w->defineSet("par_"+pdf->getName(), *pdf->getParameters());
+	w->defineSet("th_" +pdf->getName(), *pdf->getTheory());
+	RooMsgService::instance().setGlobalKillBelow(INFO);
+}
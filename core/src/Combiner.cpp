@@ -11,6 +11,9 @@
 	this->arg = arg;
 	TString wsname = "w"+getUniqueRootName();
 	w = new RooWorkspace(wsname, wsname);
+	ownsWorkspace = true;
+	cache = 0;
+	nextUid = 0;
 	_isCombined = false;
 }
 
@@ -23,32 +26,43 @@
 	this->arg = arg;
 	TString wsname = "w"+getUniqueRootName();
 	w = new RooWorkspace(wsname, wsname);
+	ownsWorkspace = true;
+	cache = 0;
+	nextUid = 0;
 	_isCombined = false;
 }
 
 
 Combiner::~Combiner()
 {
-	delete w;
+	if ( ownsWorkspace ) delete w;
 }
 
 ///
-/// Clone an existing combiner.
+/// Clone an existing combiner. The clone keeps the unique IDs
+/// of the pdfs, and the cache.
 ///
 Combiner* Combiner::Clone(TString name, TString title)
 {
 	Combiner* cNew = new Combiner(this->arg, name, title);
 	cNew->pdfName = this->pdfName;
-	for ( int i=0; i<pdfs.size(); i++ ) cNew->addPdf(pdfs[i]);
+	cNew->pdfs = this->pdfs;
+	cNew->uids = this->uids;
+	cNew->nextUid = this->nextUid;
+	cNew->cache = this->cache;
 	cNew->_isCombined = this->_isCombined;
 	return cNew;
 }
 
-
+///
+/// Add a pdf. It gets the next free unique ID, so that the
+/// pdfs already added keep theirs, also in clones.
+///
 void Combiner::addPdf(PDF_Abs *p)
 {
 	assert(p);
 	pdfs.push_back(p);
+	uids.push_back(nextUid++);
 }
 
 void Combiner::addPdf(PDF_Abs *p1, PDF_Abs *p2)
@@ -89,11 +103,14 @@ void Combiner::delPdf(PDF_Abs *p)
 		return;
 	}
 	vector<PDF_Abs*> pdfsNew;
+	vector<int> uidsNew;
 	for (int i=0; i<pdfs.size(); i++ ){
 		if ( pdfs[i]->getUniqueGlobalID() == p->getUniqueGlobalID() ) continue;
 		pdfsNew.push_back(pdfs[i]);
+		uidsNew.push_back(uids[i]);
 	}
 	pdfs = pdfsNew;
+	uids = uidsNew;
 }
 
 void Combiner::delPdf(PDF_Abs *p1, PDF_Abs *p2)
@@ -164,7 +181,7 @@ void Combiner::combine()
 		}
 	}
 
-	// uniquify all input pdfs, add them to the workspace
+	// uniquify all input pdfs
 	for (int i=0; i<pdfs.size(); i++ ){
 		if ( arg->debug ) cout << "Combiner::combine() : processing PDF " << pdfs[i]->getName() << endl;
 		// check consistency of input pdfs
@@ -174,51 +191,63 @@ void Combiner::combine()
 			exit(1);
 		}
 		// uniquify pdf
-		pdfs[i]->uniquify(i); // Needs to be unique inside this combiner, not globally: it's important
+		pdfs[i]->uniquify(uids[i]); // Needs to be unique inside this combiner, not globally: it's important
 		// that same combiner's pdfs are named the same
 		// else we can't save toys from different combiners into
 		// the same ToyTree in the coverage test.
 		// Also, the "scan for observable" mechanism relies on the fact
-		// that the ID coincides with the number of the PDF in this combiner.
-		// add PDF to workspace
-		RooMsgService::instance().setGlobalKillBelow(WARNING);
-		if ( pdfs[i]->isCrossCorPdf() ){
-			// cross correlation PDFs need the same observable names as the main PDFs,
-			// so link them together in the workspace
-			w->import(*pdfs[i]->getPdf(),RecycleConflictNodes());
-		}
-		else{
-			w->import(*pdfs[i]->getPdf());
-		}
-		w->defineSet("obs_"+pdfs[i]->getName(), *pdfs[i]->getObservables());
-		w->defineSet("par_"+pdfs[i]->getName(), *pdfs[i]->getParameters());
-		w->defineSet("th_" +pdfs[i]->getName(), *pdfs[i]->getTheory());
-		RooMsgService::instance().setGlobalKillBelow(INFO);
+		// that the ID identifies the PDF in this combiner, see getPdfProvidingObservable().
 		// save unique pdf name
 		pdfNames.push_back((pdfs[i]->getName()).Data());
 	}
 
+	// Use the shared workspace of the cache, unless some pdf was changed
+	// since it was imported there, or we need to fix parameters, which
+	// would fix them for all combiners sharing the workspace.
+	bool useCache = cache!=0 && constVars.size()==0;
+	for (int i=0; useCache && i<pdfs.size(); i++ ){
+		if ( !cache->canImport(pdfs[i]) ){
+			if ( arg->debug ) cout << "Combiner::combine() : PDF " << pdfs[i]->getName()
+				<< " changed since it was cached. Not using the cache." << endl;
+			useCache = false;
+		}
+	}
+	if ( useCache ){
+		delete w;
+		w = cache->getWorkspace();
+		ownsWorkspace = false;
+	}
+
+	// add pdfs to the workspace
+	for (int i=0; i<pdfs.size(); i++ ){
+		if ( useCache ) cache->import(pdfs[i]);
+		else CombinationCache::importPdf(w, pdfs[i]);
+	}
+
 	// sort pdfs alphabetically
 	sort( pdfNames.begin(), pdfNames.end() );
 
-	// combine
+	// combine: multiply all pdfs in one product, and merge their sets
 	pdfName = pdfNames[0];
-	for (int i=1; i<pdfNames.size(); i++ )
-	{
-		// build name of combined pdf
-		TString newName = pdfName+"_"+pdfNames[i];
-		if ( w->pdf("pdf_"+newName) ) continue;
-
-		// combine pdfs by multiplying them one by one:
-		w->factory("PROD::pdf_"+newName+"(pdf_"+pdfName+", pdf_"+pdfNames[i]+")");
-
-		// define sets of combined parameters
-		parsName = "par_"+newName;
-		obsName = "obs_"+newName;
-		mergeNamedSets(w, parsName, "par_"+pdfName, "par_"+pdfNames[i]);
-		mergeNamedSets(w, obsName,  "obs_"+pdfName, "obs_"+pdfNames[i]);
-		mergeNamedSets(w, "th_"+newName, "th_" +pdfName, "th_" +pdfNames[i]);
-		pdfName = newName;
+	vector<TString> pars, obs, th;
+	TString factors = "pdf_"+pdfNames[0];
+	pars.push_back("par_"+pdfNames[0]);
+	obs.push_back("obs_"+pdfNames[0]);
+	th.push_back("th_"+pdfNames[0]);
+	for (int i=1; i<pdfNames.size(); i++ ){
+		pdfName += "_"+pdfNames[i];
+		factors += ", pdf_"+pdfNames[i];
+		pars.push_back("par_"+pdfNames[i]);
+		obs.push_back("obs_"+pdfNames[i]);
+		th.push_back("th_"+pdfNames[i]);
+	}
+	parsName = "par_"+pdfName;
+	obsName = "obs_"+pdfName;
+	if ( pdfNames.size()>1 && !w->pdf("pdf_"+pdfName) ){
+		w->factory("PROD::pdf_"+pdfName+"("+factors+")");
+		mergeNamedSets(w, parsName, pars);
+		mergeNamedSets(w, obsName, obs);
+		mergeNamedSets(w, "th_"+pdfName, th);
 	}
 	setParametersConstant();
 	_isCombined = true;
@@ -468,7 +497,9 @@ void Combiner::fixParameters(TString vars)
 /// that were generated from the current parameter values
 /// in the workspace.
 ///
-/// This can be used to perform a coverage test.
+/// This can be used to perform a coverage test. The random generator
+/// isn't reseeded, so that the toys follow the seed of the caller, see
+/// Utils::seedWorker().
 ///
 /// Only possible after the combiner was combined.
 ///
@@ -483,7 +514,6 @@ void Combiner::setObservablesToToyValues()
 		cout << "Combiner::setObservablesToToyValues() : setting observables to toy values generated from:" << endl;
 		getParameters()->Print("v");
 	}
-	RooRandom::randomGenerator()->SetSeed(0);
 	RooMsgService::instance().setStreamStatus(0,kFALSE);
 	RooMsgService::instance().setStreamStatus(1,kFALSE);
 	RooDataSet* dataset = w->pdf("pdf_"+pdfName)->generate(*w->set("obs_"+pdfName), 1, AutoBinned(false));
@@ -542,10 +572,9 @@ void Combiner::setName(TString name)
 
 ///
 /// Get the PDF that provides a certain observable.
-/// The observable needs to contain the unique ID, which
-/// corresponds to the number of the PDF in this combiner.
-/// This works before combine() was called. Note that delPdf()
-/// may change the order of the PDFs, and therefore the unique ID.
+/// The observable needs to contain the unique ID, which the
+/// PDF got in addPdf(). It is kept by delPdf() and Clone().
+/// This works before combine() was called.
 ///
 /// \param obsname	- name of the observable including the unique string
 /// \return pointer to the PDF
@@ -566,11 +595,12 @@ PDF_Abs* Combiner::getPdfProvidingObservable(TString obsname)
 	}
 	int id = obsnameparse.Atoi();
 	// get the PDF of given ID
-	if ( id<0 || id>=pdfs.size() ){
+	int iPdf = find(uids.begin(), uids.end(), id) - uids.begin();
+	if ( iPdf>=pdfs.size() ){
 		cout << "Combiner::getPdfProvidingObservable() : ERROR : observable ID not found in Combiner: ID=" << id << endl;
 		return 0;
 	}
-	PDF_Abs* foundpdf = pdfs[id];
+	PDF_Abs* foundpdf = pdfs[iPdf];
 	// check that the observable name exists in the PDF
 	obsnameparse = obsname;
 	obsnameparse.Replace(obsnameparse.Index(UID), obsnameparse.Length(), ""); // delete the unique ID. That should leave just the observable name.
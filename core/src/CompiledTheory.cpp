@@ -0,0 +1,304 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "CompiledTheory.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "RooFormulaVar.h"
+#include "TFormula.h"
+#include "TInterpreter.h"
+#include "TMath.h"
+#include "TRandom3.h"
+
+map<TString, CompiledTheory::Kernels> CompiledTheory::kernels;
+map<TString, TString> CompiledTheory::translations;
+int CompiledTheory::nKernels = 0;
+
+///
+/// \param relations - the theory relations, e.g. the means of a RooMultiVarGaussian.
+///                    Not owned. If they can't be compiled, isValid() is false.
+///
+CompiledTheory::CompiledTheory(const vector<RooAbsReal*>& relations)
+{
+	this->relations = relations;
+	kernel = 0;
+	batchKernel = 0;
+	build();
+}
+
+CompiledTheory::~CompiledTheory()
+{}
+
+///
+/// Evaluate all relations at the current parameter values.
+///
+/// \param out - filled with the values of the relations, in their order
+///
+void CompiledTheory::evaluate(double* out) const
+{
+	for ( unsigned int k=0; k<pars.size(); k++ ) x[k] = pars[k]->getVal();
+	kernel(x.empty() ? 0 : &x[0], out);
+}
+
+///
+/// Evaluate all relations at many parameter points.
+///
+/// \param n - number of points
+/// \param x - x[k][p] is the value of parameter k, see getParameters(), at point p
+/// \param out - out[i][p] is set to the value of relation i at point p
+///
+void CompiledTheory::evaluate(int n, const double* const* x, double* const* out) const
+{
+	batchKernel(n, x, out);
+}
+
+///
+/// The expression of a relation in the batch kernel, at point p:
+/// x[k] becomes x[k][p].
+///
+static TString batchExpression(const TString& expr)
+{
+	TString code;
+	int n = expr.Length();
+	for ( int c=0; c<n; c++ ){
+		code += expr[c];
+		if ( expr[c]!=']' ) continue;
+		int start = c-1;
+		while ( start>=0 && isdigit(expr[start]) ) start--;
+		if ( start>=1 && start<c-1 && expr[start]=='[' && expr[start-1]=='x'
+				&& (start==1 || !(isalnum(expr[start-2]) || expr[start-2]=='_')) ) code += "[p]";
+	}
+	return code;
+}
+
+///
+/// Translate the formula of a relation into C++, with its parameters
+/// replaced by x[k]. The parameters are added to pars.
+///
+/// \return the C++ expression, or "" if the relation can't be compiled
+///
+TString CompiledTheory::translate(RooAbsReal* relation)
+{
+	if ( relation->IsA()!=RooFormulaVar::Class() ) return "";
+	RooFormulaVar* f = (RooFormulaVar*)relation;
+
+	// the formula, see also PDF_Abs::print()
+	ostringstream stream;
+	f->printMetaArgs(stream);
+	TString formula = stream.str();
+	formula.ReplaceAll("formula=", "");
+	formula.ReplaceAll("\"", "");
+	formula = formula.Strip(TString::kBoth);
+	if ( formula=="" ) return "";
+
+	// the parameters of the relation, local index -> index into pars
+	vector<RooAbsReal*> local;
+	vector<int> global;
+	for ( int i=0; f->getParameter(i); i++ ){
+		RooAbsReal* p = dynamic_cast<RooAbsReal*>(f->getParameter(i));
+		if ( !p ) return "";
+		local.push_back(p);
+		int k = find(pars.begin(), pars.end(), p)-pars.begin();
+		if ( k==(int)pars.size() ) pars.push_back(p);
+		global.push_back(k);
+	}
+
+	// replace parameter names and @i by x[i], for TFormula
+	TString expr;
+	int n = formula.Length();
+	for ( int c=0; c<n; ){
+		char ch = formula[c];
+		if ( isalpha(ch) || ch=='_' ){
+			int start = c;
+			while ( c<n && (isalnum(formula[c]) || formula[c]=='_') ) c++;
+			TString word = formula(start, c-start);
+			int i = 0;
+			while ( i<(int)local.size() && word!=local[i]->GetName() ) i++;
+			expr += i<(int)local.size() ? TString(Form("x[%i]", i)) : word;
+		}
+		else if ( isdigit(ch) || (ch=='.' && c+1<n && isdigit(formula[c+1])) ){
+			int start = c;
+			while ( c<n && (isdigit(formula[c]) || formula[c]=='.') ) c++;
+			if ( c<n && (formula[c]=='e' || formula[c]=='E') ){
+				c++;
+				if ( c<n && (formula[c]=='+' || formula[c]=='-') ) c++;
+				while ( c<n && isdigit(formula[c]) ) c++;
+			}
+			expr += formula(start, c-start);
+		}
+		else if ( ch=='@' ){
+			int start = ++c;
+			while ( c<n && isdigit(formula[c]) ) c++;
+			int i = TString(formula(start, c-start)).Atoi();
+			if ( c==start || i>=(int)local.size() ) return "";
+			expr += Form("x[%i]", i);
+		}
+		else{
+			expr += ch;
+			c++;
+		}
+	}
+
+	// let TFormula turn it into C++, once per formula
+	TString cling;
+	map<TString, TString>::iterator it = translations.find(expr);
+	if ( it!=translations.end() ) cling = it->second;
+	else{
+		TFormula tf(Form("gammacombo_relation_%i", (int)translations.size()), expr, false);
+		if ( tf.IsValid() ) cling = tf.GetExpFormula("CLING");
+		translations[expr] = cling;
+	}
+	if ( cling=="" || cling.Contains("p[") ) return "";
+
+	// x[i] of the relation -> x[k] of the kernel
+	TString code;
+	n = cling.Length();
+	for ( int c=0; c<n; ){
+		if ( cling[c]=='x' && c+1<n && cling[c+1]=='[' && (c==0 || !(isalnum(cling[c-1]) || cling[c-1]=='_')) ){
+			int start = c+2;
+			int end = start;
+			while ( end<n && isdigit(cling[end]) ) end++;
+			if ( end==start || end>=n || cling[end]!=']' ) return "";
+			int i = TString(cling(start, end-start)).Atoi();
+			if ( i>=(int)global.size() ) return "";
+			code += Form("x[%i]", global[i]);
+			c = end+1;
+		}
+		else{
+			code += cling[c];
+			c++;
+		}
+	}
+	return code;
+}
+
+///
+/// Generate and compile the kernel, or take it from the kernels compiled
+/// before from the same formulas. New kernels have to pass selfCheck().
+///
+bool CompiledTheory::build()
+{
+	ProfileTimer pt("CompiledTheory::build");
+	vector<TString> exprs;
+	TString key;
+	for ( unsigned int i=0; i<relations.size(); i++ ){
+		TString e = translate(relations[i]);
+		if ( e=="" ) return false;
+		exprs.push_back(e);
+		key += e+";\n";
+	}
+	x.resize(pars.size());
+
+	map<TString, Kernels>::iterator it = kernels.find(key);
+	if ( it!=kernels.end() ){
+		kernel = it->second.kernel;
+		batchKernel = it->second.batchKernel;
+		return kernel!=0;
+	}
+
+	int id = nKernels++;
+	TString code = "#include \"TMath.h\"\n";
+	code += "#pragma cling optimize(2)\n"; // let the loops of the batch kernel be vectorized
+	code += "namespace GammaComboKernels {\n";
+	code += Form("void theory_%i(const double* x, double* out)\n{\n", id);
+	for ( unsigned int i=0; i<exprs.size(); i++ ) code += Form("\tout[%i] = %s;\n", i, exprs[i].Data());
+	code += "}\n";
+	code += Form("void theory_batch_%i(int n, const double* const* x, double* const* out)\n{\n", id);
+	for ( unsigned int i=0; i<exprs.size(); i++ ){
+		code += Form("\tfor ( int p=0; p<n; p++ ) out[%i][p] = %s;\n", i, batchExpression(exprs[i]).Data());
+	}
+	code += "}\n}\n";
+	if ( gInterpreter->Declare(code) ){
+		kernel = (Kernel)gInterpreter->Calc(Form("(long)&GammaComboKernels::theory_%i", id));
+		batchKernel = (BatchKernel)gInterpreter->Calc(Form("(long)&GammaComboKernels::theory_batch_%i", id));
+	}
+	else cout << "CompiledTheory::build() : WARNING : could not compile the relations:" << endl << code << endl;
+	if ( !kernel || !batchKernel || !selfCheck() ){
+		kernel = 0;
+		batchKernel = 0;
+	}
+	Kernels k = {kernel, batchKernel};
+	kernels[key] = k;
+	return kernel!=0;
+}
+
+///
+/// Compare the kernel to the RooFormulaVars, at the current parameter
+/// values and at random points inside the ranges of the parameters that
+/// are RooRealVars. The batch kernel is compared to the kernel at the
+/// same points. The parameters are restored afterwards.
+///
+/// \return true if all relations agree to within 1e-12, relatively
+///
+bool CompiledTheory::selfCheck()
+{
+	vector<RooRealVar*> vars;
+	vector<double> saved;
+	for ( unsigned int k=0; k<pars.size(); k++ ){
+		RooRealVar* p = dynamic_cast<RooRealVar*>(pars[k]);
+		if ( !p ) continue;
+		vars.push_back(p);
+		saved.push_back(p->getVal());
+	}
+
+	TRandom3 rnd(4357); // don't touch the random generator of the toys
+	vector<double> out(relations.size());
+	vector<vector<double> > xs, outs; // per point, for the batch kernel
+	bool ok = true;
+	for ( int point=0; point<10 && ok; point++ ){
+		if ( point>0 ){
+			for ( unsigned int k=0; k<vars.size(); k++ ){
+				RooRealVar* p = vars[k];
+				if ( p->hasMin() && p->hasMax() ) p->setVal(rnd.Uniform(p->getMin(), p->getMax()));
+				else p->setVal(saved[k]+rnd.Gaus(0., TMath::Max(1., fabs(saved[k]))));
+			}
+		}
+		evaluate(&out[0]);
+		for ( unsigned int i=0; i<relations.size(); i++ ){
+			double ref = relations[i]->getVal();
+			bool same = TMath::Finite(ref) ? fabs(out[i]-ref)<=1e-12*TMath::Max(1., fabs(ref)) : !TMath::Finite(out[i]);
+			if ( same ) continue;
+			cout << "CompiledTheory::selfCheck() : WARNING : compiled relation " << relations[i]->GetName()
+				<< " gives " << Form("%.17g", out[i]) << " instead of " << Form("%.17g", ref)
+				<< ". Using the RooFormulaVars." << endl;
+			ok = false;
+			break;
+		}
+		xs.push_back(x);
+		outs.push_back(out);
+	}
+
+	if ( ok ){
+		int n = xs.size();
+		vector<vector<double> > xBatch(pars.size(), vector<double>(n));
+		vector<vector<double> > outBatch(relations.size(), vector<double>(n));
+		vector<const double*> in(pars.size());
+		vector<double*> res(relations.size());
+		for ( unsigned int k=0; k<pars.size(); k++ ){
+			for ( int p=0; p<n; p++ ) xBatch[k][p] = xs[p][k];
+			in[k] = &xBatch[k][0];
+		}
+		for ( unsigned int i=0; i<relations.size(); i++ ) res[i] = &outBatch[i][0];
+		evaluate(n, in.empty() ? 0 : &in[0], &res[0]);
+		for ( int p=0; p<n && ok; p++ ){
+			for ( unsigned int i=0; i<relations.size(); i++ ){
+				double ref = outs[p][i];
+				bool same = TMath::Finite(ref) ? fabs(outBatch[i][p]-ref)<=1e-12*TMath::Max(1., fabs(ref)) : !TMath::Finite(outBatch[i][p]);
+				if ( same ) continue;
+				cout << "CompiledTheory::selfCheck() : WARNING : batch of compiled relation " << relations[i]->GetName()
+					<< " gives " << Form("%.17g", outBatch[i][p]) << " instead of " << Form("%.17g", ref)
+					<< ". Using the RooFormulaVars." << endl;
+				ok = false;
+				break;
+			}
+		}
+	}
+
+	for ( unsigned int k=0; k<vars.size(); k++ ) vars[k]->setVal(saved[k]);
+	return ok;
+}
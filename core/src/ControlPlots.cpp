@@ -7,97 +7,127 @@ ControlPlots::ControlPlots(ToyTree *tt)
 	t = tt->t;
 	name = tt->getName();
 	ctrlPadId    = 0;
-	ctrlPlotCuts = "statusFree==0 && statusScan==0";
-	// if ( arg->id!=-1 ) ctrlPlotCuts = ctrlPlotCuts && Form("BergerBoos_id==%i", arg->id);
-	if ( arg->id!=-1 ) ctrlPlotCuts = ctrlPlotCuts && Form("id==%i", arg->id);
+	filler = new HistogramFiller(t, arg->controlplotthreads);
+	colStatusFree = filler->column("statusFree");
+	colStatusScan = filler->column("statusScan");
+	colId         = filler->column("id");
 }
 
 
 ControlPlots::~ControlPlots()
-{}
+{
+	delete filler;
+}
 
+///
+/// Cuts that are applied to all control plots:
+/// both fits converged, and the toy belongs to the
+/// requested --id, if any.
+///
+bool ControlPlots::passesCuts(const double* row) const
+{
+	if ( row[colStatusFree]!=0 || row[colStatusScan]!=0 ) return false;
+	// if ( arg->id!=-1 && row[colBergerBoosId]!=arg->id ) return false;
+	if ( arg->id!=-1 && row[colId]!=arg->id ) return false;
+	return true;
+}
+
+///
+/// Axis range for nBins bins that contains a range booked in the filler,
+/// rounded the same way TTree::Draw() does for its automatic histograms.
+///
+void ControlPlots::getAxisRange(int rangeId, float& min, float& max, int nBins)
+{
+	filler->getRange(rangeId, min, max);
+	double xmin = min;
+	double xmax = max;
+	if ( xmax<=xmin ) xmax = xmin+1.;
+	xmax += 1e-6*(xmax-xmin); // so that the largest entry is not in the overflow bin
+	int newBins;
+	THLimitsFinder::OptimizeLimits(nBins, newBins, xmin, xmax, false);
+	min = xmin;
+	max = xmax;
+}
 
 ///
 /// Make p-value control plots.
 ///
 void ControlPlots::ctrlPlotPvalue()
 {
-	gStyle->SetOptStat(1111);
-	TCanvas *c2 = newNoWarnTCanvas(getUniqueRootName(), name + " P-value Plots", 900, 600);
-	c2->Divide(1,1);
-	int ip = 1;
-	TPad *pad;
-
-	// plot 2: individual Better, Bg, All histograms
-	pad = (TPad*)c2->cd(ip++);
-	// better toys
-	t->Draw(Form("chi2minToy-chi2minGlobalToy > (chi2min-chi2minGlobal):scanpoint>>htemp(%i,%f,%f,1,0.5,1.5)",
-				tt->getScanpointN(), tt->getScanpointMin(), tt->getScanpointMax()), ctrlPlotCuts, "colz");
-	TH1D* hBetter = ((TH2F*)(gPad->GetPrimitive("htemp")))->ProjectionX("hBetter",1,1);
-	// background toys
-	t->Draw(Form("chi2minToy-chi2minGlobalToy < -(chi2min-chi2minGlobal):scanpoint>>htemp(%i,%f,%f,1,0.5,1.5)",
-				tt->getScanpointN(), tt->getScanpointMin(), tt->getScanpointMax()), ctrlPlotCuts, "colz");
-	TH1D* hBg = ((TH2F*)(gPad->GetPrimitive("htemp")))->ProjectionX("hBg",1,1);
-	// all toys
-	t->Draw(Form("1:scanpoint>>htemp(%i,%f,%f,1,0.5,1.5)",
-				tt->getScanpointN(), tt->getScanpointMin(), tt->getScanpointMax()), ctrlPlotCuts, "colz");
-	TH1D* hAll = ((TH2F*)(gPad->GetPrimitive("htemp")))->ProjectionX("hAll",1,1);
-	// failed toys
-	TCut myCtrlPlotCuts = !ctrlPlotCuts;
-	if ( arg->id!=-1 ) myCtrlPlotCuts = myCtrlPlotCuts && Form("id==%i", arg->id); // add the id cut back in as it got lost through the inversion
-	//if ( arg->id!=-1 ) myCtrlPlotCuts = myCtrlPlotCuts && Form("BergerBoos_id==%i", arg->id);
-	t->Draw(Form("1:scanpoint>>htemp(%i,%f,%f,1,0.5,1.5)",
-				tt->getScanpointN(), tt->getScanpointMin(), tt->getScanpointMax()), myCtrlPlotCuts, "colz");
-	TH1D* hFailed = ((TH2F*)(gPad->GetPrimitive("htemp")))->ProjectionX("hFailed",1,1);
-	// construct nominal 1-CL histogram
-	TH1D* hOmcl = (TH1D*)hBetter->Clone("hOmcl");
-	hOmcl->Divide(hAll);
-	// float hOmclScale = hAll->GetBinContent(hOmcl->GetMaximumBin())/hOmcl->GetMaximum(); // scale so the 1-CL curve is in units of toys
-	float hOmclScale = hAll->GetMaximum()/hOmcl->GetMaximum(); // arb. units, else the plot looks bad when using --importance sampling
-	hOmcl->Scale(hOmclScale);
-	// construct background 1-CL histogram
-	TH1D* hOmclBg = (TH1D*)hBg->Clone("hOmclBg");
-	hOmclBg->Divide(hAll);
-	hOmclBg->Scale(hOmclScale); //  use same scale as hOmcl
-	// plot histos
-	hAll->GetYaxis()->SetRangeUser(1.,hAll->GetMaximum()); // start from 1 so we can set the plot to log scale
-	hAll->GetXaxis()->SetTitle("scanpoint");
-	hAll->GetYaxis()->SetTitle("toys");
-	hAll->SetStats(false);
-	hAll->Draw();
-	makePlotsNice("hAll");
-	hOmcl->SetLineWidth(2);
-	hOmcl->Draw("same");
-	hOmclBg->SetLineColor(kRed);
-	hOmclBg->Draw("same");
-	hFailed->SetLineColor(kMagenta);
-	hFailed->Draw("same");
-	// rescale pad to have space for the legend
-	pad->SetTopMargin(0.2182971);
-	// add legend
-	TLegend *leg = new TLegend(0.1599533,0.803442,0.9500348,0.9375);
-	leg->AddEntry(hAll,    "all toys surviving cuts");
-	leg->AddEntry(hFailed, "toys failing cuts");
-	leg->AddEntry(hOmcl,   "1-CL of 'sig' toys (arb. units)");
-	leg->AddEntry(hOmclBg, "1-CL of 'bkg' toys (same norm. as 'sig')");
-	leg->SetFillStyle(0);
-	leg->Draw();
-	c2->Update();
-
-	// // plot 6: log version of bg subtracted 1-CL plot
-	// pad = (TPad*)c2->cd(ip++);
-	// hBetter = (TH1D*)hBetter->Clone("hBetter2");
-	// hAll = (TH1D*)hAll->Clone("hAll2");
-	// hBg = (TH1D*)hBg->Clone("hBg2");
-	// hBetter->Add(hBg, -1.);
-	// hAll->Add(hBg, -1.);
-	// hBetter->Divide(hAll);
-	// TH1D* oneMinusCl = hBetter;
-	// oneMinusCl->GetXaxis()->SetTitle("scanpoint");
-	// oneMinusCl->GetYaxis()->SetTitle("p-value");
-	// oneMinusCl->Draw();
-	// pad->SetLogy();
-	// c2->Update();
+	int cScanpoint        = filler->column("scanpoint");
+	int cChi2min          = filler->column("chi2min");
+	int cChi2minGlobal    = filler->column("chi2minGlobal");
+	int cChi2minToy       = filler->column("chi2minToy");
+	int cChi2minGlobalToy = filler->column("chi2minGlobalToy");
+
+	ctrlPlotBookers.push_back([=]() -> Drawer
+	{
+		int nBins = tt->getScanpointN();
+		float spMin = tt->getScanpointMin();
+		float spMax = tt->getScanpointMax();
+		HistogramFiller::Expression scanpoint = [=](const double *r){return r[cScanpoint];};
+		// better toys
+		TH1D* hBetter = new TH1D(getUniqueRootName(), "better toys", nBins, spMin, spMax);
+		filler->book(hBetter, [=](const double *r){return passesCuts(r)
+				&& r[cChi2minToy]-r[cChi2minGlobalToy] > r[cChi2min]-r[cChi2minGlobal];}, scanpoint);
+		// background toys
+		TH1D* hBg = new TH1D(getUniqueRootName(), "background toys", nBins, spMin, spMax);
+		filler->book(hBg, [=](const double *r){return passesCuts(r)
+				&& r[cChi2minToy]-r[cChi2minGlobalToy] < -(r[cChi2min]-r[cChi2minGlobal]);}, scanpoint);
+		// all toys
+		TH1D* hAll = new TH1D(getUniqueRootName(), "all toys", nBins, spMin, spMax);
+		filler->book(hAll, [=](const double *r){return passesCuts(r);}, scanpoint);
+		// failed toys, keeping the id cut
+		TH1D* hFailed = new TH1D(getUniqueRootName(), "failed toys", nBins, spMin, spMax);
+		filler->book(hFailed, [=](const double *r){return !passesCuts(r)
+				&& ( arg->id==-1 || r[colId]==arg->id );}, scanpoint);
+
+		return [=]()
+		{
+			gStyle->SetOptStat(1111);
+			TCanvas *c2 = newNoWarnTCanvas(getUniqueRootName(), name + " P-value Plots", 900, 600);
+			c2->Divide(1,1);
+			int ip = 1;
+			TPad *pad;
+
+			// plot 2: individual Better, Bg, All histograms
+			pad = (TPad*)c2->cd(ip++);
+			// construct nominal 1-CL histogram
+			TH1D* hOmcl = (TH1D*)hBetter->Clone("hOmcl");
+			hOmcl->Divide(hAll);
+			// float hOmclScale = hAll->GetBinContent(hOmcl->GetMaximumBin())/hOmcl->GetMaximum(); // scale so the 1-CL curve is in units of toys
+			float hOmclScale = hAll->GetMaximum()/hOmcl->GetMaximum(); // arb. units, else the plot looks bad when using --importance sampling
+			hOmcl->Scale(hOmclScale);
+			// construct background 1-CL histogram
+			TH1D* hOmclBg = (TH1D*)hBg->Clone("hOmclBg");
+			hOmclBg->Divide(hAll);
+			hOmclBg->Scale(hOmclScale); //  use same scale as hOmcl
+			// plot histos
+			hAll->GetYaxis()->SetRangeUser(1.,hAll->GetMaximum()); // start from 1 so we can set the plot to log scale
+			hAll->GetXaxis()->SetTitle("scanpoint");
+			hAll->GetYaxis()->SetTitle("toys");
+			hAll->SetStats(false);
+			hAll->Draw();
+			makePlotsNice(hAll->GetName());
+			hOmcl->SetLineWidth(2);
+			hOmcl->Draw("same");
+			hOmclBg->SetLineColor(kRed);
+			hOmclBg->Draw("same");
+			hFailed->SetLineColor(kMagenta);
+			hFailed->Draw("same");
+			// rescale pad to have space for the legend
+			pad->SetTopMargin(0.2182971);
+			// add legend
+			TLegend *leg = new TLegend(0.1599533,0.803442,0.9500348,0.9375);
+			leg->AddEntry(hAll,    "all toys surviving cuts");
+			leg->AddEntry(hFailed, "toys failing cuts");
+			leg->AddEntry(hOmcl,   "1-CL of 'sig' toys (arb. units)");
+			leg->AddEntry(hOmclBg, "1-CL of 'bkg' toys (same norm. as 'sig')");
+			leg->SetFillStyle(0);
+			leg->Draw();
+			c2->Update();
+		};
+	});
 }
 
 ///
@@ -105,154 +135,185 @@ void ControlPlots::ctrlPlotPvalue()
 ///
 void ControlPlots::ctrlPlotChi2()
 {
-	gStyle->SetOptStat(1111);
-	TCanvas *c2 = newNoWarnTCanvas(getUniqueRootName(), name + " Chi2 Plots", 900, 600);
-	c2->Divide(3,2);
-	int ip = 1;
-	TPad *pad;
+	int cScanpoint        = filler->column("scanpoint");
+	int cChi2min          = filler->column("chi2min");
+	int cChi2minGlobal    = filler->column("chi2minGlobal");
+	int cChi2minToy       = filler->column("chi2minToy");
+	int cChi2minGlobalToy = filler->column("chi2minGlobalToy");
 
 	// get maximum chi2 to be plotted
-	pad = (TPad*)c2->cd(ip);
-	t->Draw("chi2minToy", ctrlPlotCuts && "abs(chi2minToy)<1000");
-	float maxPlottedChi2 = ((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->GetXmax();
-	maxPlottedChi2 = TMath::Min(maxPlottedChi2, (float)75.);
-
-	// plot 1: 2D plot of chi scan vs. chi2 global
-	pad = (TPad*)c2->cd(ip++);
-	t->Draw(Form("chi2minToy:chi2minGlobalToy>>htemp1(75,0,%f,75,0,%f)",
-				maxPlottedChi2,maxPlottedChi2), ctrlPlotCuts, "colz");
-	((TH2F*)(gPad->GetPrimitive("htemp1")))->GetYaxis()->SetTitle("#chi^{2} scan");
-	((TH2F*)(gPad->GetPrimitive("htemp1")))->GetXaxis()->SetTitle("#chi^{2} free");
-	makePlotsNice("htemp1");
-	pad->SetLogz();
-	c2->Update();
-
-	// plot 2:  chi2 distribution of the SCAN fit
-	pad = (TPad*)c2->cd(ip++);
-	t->Draw("chi2minToy", ctrlPlotCuts && Form("chi2minToy-chi2minGlobalToy>0 && chi2minToy<%f",maxPlottedChi2));
-	((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->SetTitle("#chi^{2} scan");
-	((TH1F*)(gPad->GetPrimitive("htemp")))->GetYaxis()->SetTitle("toys");
-	makePlotsNice();
-	c2->Update();
-
-	// plot 3: empty
-	pad = (TPad*)c2->cd(ip++);
-
-	// plot 4: chi2 distribution of the FREE fit
-	pad = (TPad*)c2->cd(ip++);
-	t->Draw("chi2minGlobalToy>>hChi2free", ctrlPlotCuts
-			&& Form("chi2minToy-chi2minGlobalToy>0 && chi2minGlobalToy<%f",maxPlottedChi2));
-	TH1F* hChi2free = (TH1F*)(gPad->GetPrimitive("hChi2free"));
-	// better toys
-	t->Draw(Form("chi2minToy-chi2minGlobalToy > (chi2min-chi2minGlobal):scanpoint>>htemp(%i,%f,%f,1,0.5,1.5)",
-				tt->getScanpointN(), tt->getScanpointMin(), tt->getScanpointMax()), ctrlPlotCuts, "colz");
-	TH1D* hBetter = ((TH2F*)(gPad->GetPrimitive("htemp")))->ProjectionX("hBetter",1,1);
-	// add the chi2 distribtion at the best fit value
-	t->Draw("chi2minGlobalToy>>hChi2BestFit", ctrlPlotCuts
-			&& Form("chi2minToy-chi2minGlobalToy>0 && chi2minGlobalToy<%f",maxPlottedChi2)
-			&& Form("%f<scanpoint && scanpoint<%f",
-				hBetter->GetBinCenter(hBetter->GetMaximumBin()-1),
-				hBetter->GetBinCenter(hBetter->GetMaximumBin()+1)));
-	TH1F* hChi2BestFit = (TH1F*)(gPad->GetPrimitive("hChi2BestFit"));
-	// draw first distribution
-	hChi2free->GetXaxis()->SetTitle("#chi^{2} free");
-	hChi2free->GetYaxis()->SetTitle("toys");
-	hChi2free->Draw();
-	// move first stat box a little
-	gPad->Update(); //  needed else FindObject() returns a null pointer
-	TPaveStats *st = (TPaveStats*)hChi2free->FindObject("stats");
-	st->SetName("hChi2freeStats");
-	st->SetX1NDC(0.7778305); st->SetY1NDC(0.4562937);
-	st->SetX2NDC(0.9772986); st->SetY2NDC(0.6056235);
-	// draw second distribution
-	hChi2BestFit->Scale(hChi2free->GetMaximum()/hChi2BestFit->GetMaximum()); // scale to same maximum
-	hChi2BestFit->SetLineColor(kRed);
-	hChi2BestFit->Draw("sames"); // s adds a second stat box
-	// move second stat box a little
-	gPad->Update();
-	st = (TPaveStats*)hChi2BestFit->FindObject("stats");
-	st->SetX1NDC(0.7778305); st->SetY1NDC(0.6274767);
-	st->SetX2NDC(0.9772986); st->SetY2NDC(0.7877331);
-	st->SetLineColor(kRed);
-	makePlotsNice("hChi2free");
-	// add legend
-	TLegend *leg4 = new TLegend(0.5,0.8023019,0.9772986,0.9370629);
-	leg4->AddEntry(hChi2free,    "#chi^{2} (all scan var values)");
-	leg4->AddEntry(hChi2BestFit, "#chi^{2} (at best fit value)");
-	leg4->SetFillStyle(1001);
-	leg4->Draw();
-	c2->Update();
-
-	// plot 5: delta chi2
-	pad = (TPad*)c2->cd(ip++);
-	// good toys
-	t->Draw("chi2minToy-chi2minGlobalToy",
-			ctrlPlotCuts && Form("chi2minToy-chi2minGlobalToy>=0 && chi2minToy<%f && chi2minGlobalToy<%f", maxPlottedChi2, maxPlottedChi2));
-	TH1F* h4sig = (TH1F*)(gPad->GetPrimitive("htemp"))->Clone("h4sig");
-	// possibly background
-	int nBkg = t->Draw("-(chi2minToy-chi2minGlobalToy)",
-			ctrlPlotCuts && Form("chi2minToy-chi2minGlobalToy<0 && chi2minToy<%f && chi2minGlobalToy<%f", maxPlottedChi2, maxPlottedChi2));
-	TH1F* h4bkg = (TH1F*)(gPad->GetPrimitive("htemp"))->Clone("h4bkg");
-	if ( nBkg==0 ) h4bkg->Scale(0); // if no bkg events the htemp from the signal Draw gets cloned again!
-	h4sig->Draw();
-	h4sig->GetXaxis()->SetTitle("#Delta#chi^{2} scan-free");
-	h4sig->GetYaxis()->SetTitle("toys");
-	makePlotsNice("h4sig");
-	// h4bkg->SetLineColor(kRed);
-	// h4bkg->Draw("same");
-	pad->SetLogy();
-	// move first stat box a little
-	gPad->Update(); //  needed else FindObject() returns a null pointer
-	st = (TPaveStats*)h4sig->FindObject("stats");
-	st->SetX1NDC(0.7778305); st->SetY1NDC(0.4562937);
-	st->SetX2NDC(0.9772986); st->SetY2NDC(0.6056235);
-	// add legend
-	TLegend *leg5 = new TLegend(0.5,0.8023019,0.9772986,0.9370629);
-	leg5->AddEntry(h4sig, "#Delta#chi^{2} of 'signal' toys");
-	leg5->AddEntry(h4bkg, "#Delta#chi^{2} of 'bg' toys");
-	leg5->SetFillStyle(1001);
-	leg5->Draw();
-	c2->Update();
-
-	// plot 6: chi2 p-value distribution
-	pad = (TPad*)c2->cd(ip++);
-	// good toys
-	int ndof = arg->var.size();
-	t->Draw(Form("TMath::Prob(chi2minToy-chi2minGlobalToy,%i)", ndof),
-			ctrlPlotCuts && Form("chi2minToy-chi2minGlobalToy>=0 && chi2minToy<%f && chi2minGlobalToy<%f", maxPlottedChi2, maxPlottedChi2));
-	TH1F* h5sig = (TH1F*)(gPad->GetPrimitive("htemp"))->Clone("h5sig");
-	h5sig->SetMaximum(h5sig->GetMaximum()*1.3);
-	h5sig->Draw();
-	h5sig->GetXaxis()->SetTitle("p(#Delta#chi^{2} scan-free)");
-	h5sig->GetYaxis()->SetTitle("toys");
-	makePlotsNice("h5sig");
-	// move stat box a little
-	gPad->Update(); //  needed else FindObject() returns a null pointer
-	st = (TPaveStats*)h5sig->FindObject("stats");
-	st->SetX1NDC(0.7778305); st->SetY1NDC(0.4562937);
-	st->SetX2NDC(0.9772986); st->SetY2NDC(0.6056235);
-	c2->Update();
-	// add legend
-	TLegend *leg6 = new TLegend(0.5,0.8023019,0.9772986,0.9370629);
-	leg6->AddEntry(h5sig, Form("Prob(#Delta#chi^{2}, ndof=%i)",ndof));
-	leg6->SetFillStyle(1001);
-	leg6->Draw();
-
-	ctrlPlotCanvases.push_back(c2);
+	int rChi2 = filler->bookRange([=](const double *r){return passesCuts(r) && fabs(r[cChi2minToy])<1000;},
+			[=](const double *r){return r[cChi2minToy];});
+
+	ctrlPlotBookers.push_back([=]() -> Drawer
+	{
+		float minPlottedChi2, maxPlottedChi2;
+		getAxisRange(rChi2, minPlottedChi2, maxPlottedChi2);
+		maxPlottedChi2 = TMath::Min(maxPlottedChi2, (float)75.);
+		const float m = maxPlottedChi2;
+		int ndof = arg->var.size();
+		HistogramFiller::Expression chi2Toy       = [=](const double *r){return r[cChi2minToy];};
+		HistogramFiller::Expression chi2GlobalToy = [=](const double *r){return r[cChi2minGlobalToy];};
+		HistogramFiller::Expression deltaChi2     = [=](const double *r){return r[cChi2minToy]-r[cChi2minGlobalToy];};
+		HistogramFiller::Selection  belowMax      = [=](const double *r){return passesCuts(r)
+			&& r[cChi2minToy]<m && r[cChi2minGlobalToy]<m;};
+
+		// plot 1: 2D plot of chi scan vs. chi2 global
+		TH2F* h1 = new TH2F(getUniqueRootName(), "chi2minToy:chi2minGlobalToy", 75, 0, m, 75, 0, m);
+		filler->book(h1, [=](const double *r){return passesCuts(r);}, chi2GlobalToy, chi2Toy);
+		// plot 2:  chi2 distribution of the SCAN fit
+		TH1F* h2 = new TH1F(getUniqueRootName(), "chi2minToy", 100, 0, m);
+		filler->book(h2, [=](const double *r){return passesCuts(r)
+				&& r[cChi2minToy]-r[cChi2minGlobalToy]>0 && r[cChi2minToy]<m;}, chi2Toy);
+		// plot 4: chi2 distribution of the FREE fit, for all scan points and
+		// at the best fit value, which is the scan point with the most better toys
+		HistogramFiller::Selection freeSel = [=](const double *r){return passesCuts(r)
+			&& r[cChi2minToy]-r[cChi2minGlobalToy]>0 && r[cChi2minGlobalToy]<m;};
+		TH1F* hChi2free = new TH1F(getUniqueRootName(), "chi2minGlobalToy", 100, 0, m);
+		filler->book(hChi2free, freeSel, chi2GlobalToy);
+		TH1D* hBetter = new TH1D(getUniqueRootName(), "better toys", tt->getScanpointN(), tt->getScanpointMin(), tt->getScanpointMax());
+		filler->book(hBetter, [=](const double *r){return passesCuts(r)
+				&& r[cChi2minToy]-r[cChi2minGlobalToy] > r[cChi2min]-r[cChi2minGlobal];},
+				[=](const double *r){return r[cScanpoint];});
+		TH2F* hChi2VsScanpoint = new TH2F(getUniqueRootName(), "chi2minGlobalToy:scanpoint",
+				tt->getScanpointN(), tt->getScanpointMin(), tt->getScanpointMax(), 100, 0, m);
+		filler->book(hChi2VsScanpoint, freeSel, [=](const double *r){return r[cScanpoint];}, chi2GlobalToy);
+		// plot 5: delta chi2
+		TH1F* h4sig = new TH1F(getUniqueRootName(), "chi2minToy-chi2minGlobalToy", 100, 0, m);
+		filler->book(h4sig, [=](const double *r){return belowMax(r) && r[cChi2minToy]-r[cChi2minGlobalToy]>=0;}, deltaChi2);
+		TH1F* h4bkg = new TH1F(getUniqueRootName(), "-(chi2minToy-chi2minGlobalToy)", 100, 0, m);
+		filler->book(h4bkg, [=](const double *r){return belowMax(r) && r[cChi2minToy]-r[cChi2minGlobalToy]<0;},
+				[=](const double *r){return -(r[cChi2minToy]-r[cChi2minGlobalToy]);});
+		// plot 6: chi2 p-value distribution
+		TH1F* h5sig = new TH1F(getUniqueRootName(), Form("TMath::Prob(chi2minToy-chi2minGlobalToy,%i)", ndof), 100, 0, 1);
+		filler->book(h5sig, [=](const double *r){return belowMax(r) && r[cChi2minToy]-r[cChi2minGlobalToy]>=0;},
+				[=](const double *r){return TMath::Prob(r[cChi2minToy]-r[cChi2minGlobalToy], ndof);});
+
+		return [=]()
+		{
+			gStyle->SetOptStat(1111);
+			TCanvas *c2 = newNoWarnTCanvas(getUniqueRootName(), name + " Chi2 Plots", 900, 600);
+			c2->Divide(3,2);
+			int ip = 1;
+			TPad *pad;
+
+			// plot 1: 2D plot of chi scan vs. chi2 global
+			pad = (TPad*)c2->cd(ip++);
+			h1->Draw("colz");
+			h1->GetYaxis()->SetTitle("#chi^{2} scan");
+			h1->GetXaxis()->SetTitle("#chi^{2} free");
+			makePlotsNice(h1->GetName());
+			pad->SetLogz();
+			c2->Update();
+
+			// plot 2:  chi2 distribution of the SCAN fit
+			pad = (TPad*)c2->cd(ip++);
+			h2->Draw();
+			h2->GetXaxis()->SetTitle("#chi^{2} scan");
+			h2->GetYaxis()->SetTitle("toys");
+			makePlotsNice(h2->GetName());
+			c2->Update();
+
+			// plot 3: empty
+			pad = (TPad*)c2->cd(ip++);
+
+			// plot 4: chi2 distribution of the FREE fit
+			pad = (TPad*)c2->cd(ip++);
+			int iBest = hBetter->GetMaximumBin();
+			TH1D* hChi2BestFit = hChi2VsScanpoint->ProjectionY(getUniqueRootName(), iBest, iBest);
+			hChi2BestFit->SetTitle("chi2minGlobalToy");
+			// draw first distribution
+			hChi2free->GetXaxis()->SetTitle("#chi^{2} free");
+			hChi2free->GetYaxis()->SetTitle("toys");
+			hChi2free->Draw();
+			// move first stat box a little
+			gPad->Update(); //  needed else FindObject() returns a null pointer
+			TPaveStats *st = (TPaveStats*)hChi2free->FindObject("stats");
+			st->SetName("hChi2freeStats");
+			st->SetX1NDC(0.7778305); st->SetY1NDC(0.4562937);
+			st->SetX2NDC(0.9772986); st->SetY2NDC(0.6056235);
+			// draw second distribution
+			if ( hChi2BestFit->GetMaximum()>0 ) hChi2BestFit->Scale(hChi2free->GetMaximum()/hChi2BestFit->GetMaximum()); // scale to same maximum
+			hChi2BestFit->SetLineColor(kRed);
+			hChi2BestFit->Draw("sames"); // s adds a second stat box
+			// move second stat box a little
+			gPad->Update();
+			st = (TPaveStats*)hChi2BestFit->FindObject("stats");
+			st->SetX1NDC(0.7778305); st->SetY1NDC(0.6274767);
+			st->SetX2NDC(0.9772986); st->SetY2NDC(0.7877331);
+			st->SetLineColor(kRed);
+			makePlotsNice(hChi2free->GetName());
+			// add legend
+			TLegend *leg4 = new TLegend(0.5,0.8023019,0.9772986,0.9370629);
+			leg4->AddEntry(hChi2free,    "#chi^{2} (all scan var values)");
+			leg4->AddEntry(hChi2BestFit, "#chi^{2} (at best fit value)");
+			leg4->SetFillStyle(1001);
+			leg4->Draw();
+			c2->Update();
+
+			// plot 5: delta chi2
+			pad = (TPad*)c2->cd(ip++);
+			h4sig->Draw();
+			h4sig->GetXaxis()->SetTitle("#Delta#chi^{2} scan-free");
+			h4sig->GetYaxis()->SetTitle("toys");
+			makePlotsNice(h4sig->GetName());
+			// h4bkg->SetLineColor(kRed);
+			// h4bkg->Draw("same");
+			pad->SetLogy();
+			// move first stat box a little
+			gPad->Update(); //  needed else FindObject() returns a null pointer
+			st = (TPaveStats*)h4sig->FindObject("stats");
+			st->SetX1NDC(0.7778305); st->SetY1NDC(0.4562937);
+			st->SetX2NDC(0.9772986); st->SetY2NDC(0.6056235);
+			// add legend
+			TLegend *leg5 = new TLegend(0.5,0.8023019,0.9772986,0.9370629);
+			leg5->AddEntry(h4sig, "#Delta#chi^{2} of 'signal' toys");
+			leg5->AddEntry(h4bkg, "#Delta#chi^{2} of 'bg' toys");
+			leg5->SetFillStyle(1001);
+			leg5->Draw();
+			c2->Update();
+
+			// plot 6: chi2 p-value distribution
+			pad = (TPad*)c2->cd(ip++);
+			h5sig->SetMaximum(h5sig->GetMaximum()*1.3);
+			h5sig->Draw();
+			h5sig->GetXaxis()->SetTitle("p(#Delta#chi^{2} scan-free)");
+			h5sig->GetYaxis()->SetTitle("toys");
+			makePlotsNice(h5sig->GetName());
+			// move stat box a little
+			gPad->Update(); //  needed else FindObject() returns a null pointer
+			st = (TPaveStats*)h5sig->FindObject("stats");
+			st->SetX1NDC(0.7778305); st->SetY1NDC(0.4562937);
+			st->SetX2NDC(0.9772986); st->SetY2NDC(0.6056235);
+			c2->Update();
+			// add legend
+			TLegend *leg6 = new TLegend(0.5,0.8023019,0.9772986,0.9370629);
+			leg6->AddEntry(h5sig, Form("Prob(#Delta#chi^{2}, ndof=%i)",ndof));
+			leg6->SetFillStyle(1001);
+			leg6->Draw();
+
+			ctrlPlotCanvases.push_back(c2);
+		};
+	});
 }
 
 ///
 /// Plot all fit results of the nuisances against
 /// the scan variable.
-/// Cuts are defined in the constructor (ctrlPlotCuts).
+/// Cuts are defined in passesCuts().
 ///
 void ControlPlots::ctrlPlotNuisances()
 {
-	selectNewCanvas("Nuisances 1");
+	struct Nuisance
+	{
+		TString varScan, varFree, varStart;   ///< axis titles
+		int     cScan, cFree, cStart;         ///< columns
+		bool    fold;                         ///< fold into [0,pi]
+		int     rScan, rFree;                 ///< automatic x ranges, -1 if folded
+	};
+	vector<Nuisance> nuisances;
 	vector<TString> usedVariableNames;
-
-	int nBinsX = 50;
-	int nBinsY = tt->getScanpointN()/2;
+	int cScanpoint = filler->column("scanpoint");
 
 	for ( int j=0; j<t->GetListOfBranches()->GetEntries(); j++)
 	{
@@ -269,119 +330,158 @@ void ControlPlots::ctrlPlotNuisances()
 		if ( nameWasUsed ) continue;
 		usedVariableNames.push_back(bBaseName);
 
-		TString varScan = bBaseName+"_scan";
-		TString varFree = bBaseName+"_free";
-		TString varStart = bBaseName+"_start";
-
-		float customRangeLo = 0.0; //  Customize histogram range. Default will be the Draw() automatic
-		float customRangeHi = 0.0; //  range. Anything outside this range will show in the overflow bins.
+		Nuisance n;
+		n.varScan  = bBaseName+"_scan";
+		n.varFree  = bBaseName+"_free";
+		n.varStart = bBaseName+"_start";
+		n.cScan    = filler->column(n.varScan);
+		n.cFree    = filler->column(n.varFree);
+		n.cStart   = filler->column(n.varStart);
+		n.fold     = false;
+		n.rScan    = -1;
+		n.rFree    = -1;
 
 		if ( ( bName.BeginsWith("d_") || bName.BeginsWith("g") ) //  pi symmetry is only in the B strong phases!
 				&& !( bName.BeginsWith("dD")) )
 		{
 			cout << "\nControlPlots::ctrlPlotNuisances() : WARNING : folding everything into the range [0,pi]. This is a remnant of the LHCb gamma combination.\n" << endl;
-			varScan = "fmod("+varScan+",3.14152)";
-			varFree = "fmod("+varFree+",3.14152)";
-			varStart = "fmod("+varStart+",3.14152)";
-			customRangeLo = 0.0;  customRangeHi = 3.14152;
+			n.varScan = "fmod("+n.varScan+",3.14152)";
+			n.varFree = "fmod("+n.varFree+",3.14152)";
+			n.varStart = "fmod("+n.varStart+",3.14152)";
+			n.fold = true;
+		}
+		else
+		{
+			// default is the automatic range, anything outside the custom range
+			// of the folded variables shows in the overflow bins
+			int cScan = n.cScan;
+			int cFree = n.cFree;
+			n.rScan = filler->bookRange([=](const double *r){return passesCuts(r);}, [=](const double *r){return r[cScan];});
+			n.rFree = filler->bookRange([=](const double *r){return passesCuts(r);}, [=](const double *r){return r[cFree];});
 		}
+		nuisances.push_back(n);
+	}
 
-		gStyle->SetOptStat(10000); //  print overflow bins!
+	ctrlPlotBookers.push_back([=]() -> Drawer
+	{
+		int nBinsX = 50;
+		int nBinsY = tt->getScanpointN()/2;
 		float spmin = tt->getScanpointMin() - 0.01*(tt->getScanpointMax()-tt->getScanpointMin()); //  add some offset so that
 		float spmax = tt->getScanpointMax() + 0.01*(tt->getScanpointMax()-tt->getScanpointMin()); //  the first/last scanpoint is also plotted
+		HistogramFiller::Selection cuts = [=](const double *r){return passesCuts(r);};
+		HistogramFiller::Expression scanpoint = [=](const double *r){return r[cScanpoint];};
 
+		// per nuisance: hScan, hStart, hFree, hStart2
+		vector<TH2F*> hists;
+		for ( unsigned int i=0; i<nuisances.size(); i++ )
 		{
-			selectNewPad();
-			if (arg->debug) cout << "ControlPlots::ctrlPlotNuisances() : plotting " << varScan << endl;
-			t->Draw("scanpoint:"+varScan, ctrlPlotCuts, "colz");  // first test plot to get the automatic x axis range
-			float xmin = customRangeLo==customRangeHi ? ((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->GetXmin() : customRangeLo;
-			float xmax = customRangeLo==customRangeHi ? ((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->GetXmax() : customRangeHi;
-			t->Draw("scanpoint:"+varScan+">>"
-					+Form("hScan%i(%i,%f,%f,%i,%f,%f)",j,nBinsX,xmin,xmax,nBinsY,spmin,spmax),
-					ctrlPlotCuts, "colz");
-			TH2F *hScan = ((TH2F*)(gPad->GetPrimitive(Form("hScan%i",j))));
-			t->Draw("scanpoint:"+varStart+">>"
-					+Form("hStart%i(%i,%f,%f,%i,%f,%f)",j,nBinsX,xmin,xmax,nBinsY,spmin,spmax),
-					ctrlPlotCuts, "box");
-			TH2F *hStart = ((TH2F*)(gPad->GetPrimitive(Form("hStart%i",j))));
-			gStyle->SetOptTitle(0);
-			hScan->Draw("colz");
-			hScan->GetXaxis()->SetTitle(varScan);
-			hScan->GetYaxis()->SetTitle("scan point");
-			hStart->Draw("boxsame");
-			makePlotsNice(Form("hScan%i",j));
-			updateCurrentCanvas();
+			const Nuisance& n = nuisances[i];
+			bool fold = n.fold;
+			int cScan = n.cScan;
+			int cFree = n.cFree;
+			int cStart = n.cStart;
+			HistogramFiller::Expression xScan  = [=](const double *r){return fold ? fmod(r[cScan],3.14152) : r[cScan];};
+			HistogramFiller::Expression xFree  = [=](const double *r){return fold ? fmod(r[cFree],3.14152) : r[cFree];};
+			HistogramFiller::Expression xStart = [=](const double *r){return fold ? fmod(r[cStart],3.14152) : r[cStart];};
+			float xmin = 0.0;
+			float xmax = 3.14152;
+			if ( !fold ) getAxisRange(n.rScan, xmin, xmax);
+			hists.push_back((TH2F*)filler->book(new TH2F(getUniqueRootName(), "scanpoint:"+n.varScan, nBinsX, xmin, xmax, nBinsY, spmin, spmax), cuts, xScan, scanpoint));
+			hists.push_back((TH2F*)filler->book(new TH2F(getUniqueRootName(), "scanpoint:"+n.varStart, nBinsX, xmin, xmax, nBinsY, spmin, spmax), cuts, xStart, scanpoint));
+			if ( !fold ) getAxisRange(n.rFree, xmin, xmax);
+			hists.push_back((TH2F*)filler->book(new TH2F(getUniqueRootName(), "scanpoint:"+n.varFree, nBinsX, xmin, xmax, nBinsY, spmin, spmax), cuts, xFree, scanpoint));
+			hists.push_back((TH2F*)filler->book(new TH2F(getUniqueRootName(), "scanpoint:"+n.varStart, nBinsX, xmin, xmax, nBinsY, spmin, spmax), cuts, xStart, scanpoint));
 		}
+
+		return [=]()
 		{
-			selectNewPad();
-			if (arg->debug) cout << "ControlPlots::ctrlPlotNuisances() : plotting " << varFree << endl;
-			t->Draw("scanpoint:"+varFree, ctrlPlotCuts, "colz");  // first test plot to get the automatic x axis range
-			float xmin = customRangeLo==customRangeHi ? ((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->GetXmin() : customRangeLo;
-			float xmax = customRangeLo==customRangeHi ? ((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->GetXmax() : customRangeHi;
-			t->Draw("scanpoint:"+varFree+">>"
-					+Form("hFree%i(%i,%f,%f,%i,%f,%f)",j,nBinsX,xmin,xmax,nBinsY,spmin,spmax),
-					ctrlPlotCuts, "colz");
-			TH2F *hFree = ((TH2F*)(gPad->GetPrimitive(Form("hFree%i",j))));
-			t->Draw("scanpoint:"+varStart+">>"
-					+Form("hStart2%i(%i,%f,%f,%i,%f,%f)",j,nBinsX,xmin,xmax,nBinsY,spmin,spmax),
-					ctrlPlotCuts, "box");
-			TH2F *hStart = ((TH2F*)(gPad->GetPrimitive(Form("hStart2%i",j))));
-			gStyle->SetOptTitle(0);
-			hFree->Draw("colz");
-			hFree->GetXaxis()->SetTitle(varFree);
-			hFree->GetYaxis()->SetTitle("scan point");
-			hStart->Draw("boxsame");
-			makePlotsNice(Form("hFree%i",j));
-			updateCurrentCanvas();
-		}
-	}
+			selectNewCanvas("Nuisances 1");
+			gStyle->SetOptStat(10000); //  print overflow bins!
+			for ( unsigned int i=0; i<nuisances.size(); i++ )
+			{
+				const Nuisance& n = nuisances[i];
+				for ( int k=0; k<2; k++ )
+				{
+					TH2F *h      = hists[4*i+2*k];
+					TH2F *hStart = hists[4*i+2*k+1];
+					selectNewPad();
+					if (arg->debug) cout << "ControlPlots::ctrlPlotNuisances() : plotting " << (k==0 ? n.varScan : n.varFree) << endl;
+					gStyle->SetOptTitle(0);
+					h->Draw("colz");
+					h->GetXaxis()->SetTitle(k==0 ? n.varScan : n.varFree);
+					h->GetYaxis()->SetTitle("scan point");
+					hStart->Draw("boxsame");
+					makePlotsNice(h->GetName());
+					updateCurrentCanvas();
+				}
+			}
+		};
+	});
 }
 
 ///
 /// Plot all observables against the scan variable.
-/// Cuts are defined in the constructor (ctrlPlotCuts).
+/// Cuts are defined in passesCuts().
 /// Overlay the theory parameters, which is where the toys
 /// where generated.
 ///
 void ControlPlots::ctrlPlotObservables()
 {
-	selectNewCanvas("Observables 1");
+	vector<TString> obsNames;
+	vector<int> cObs, cTh, rObs;
+	int cScanpoint = filler->column("scanpoint");
 	for ( int j=0; j<t->GetListOfBranches()->GetEntries(); j++)
 	{
 		TString bName = ((TBranch*)t->GetListOfBranches()[0][j])->GetName();
 		if ( ! bName.Contains("obs") ) continue;
-		TString bBaseName = bName;
-		bBaseName.ReplaceAll("_obs","");
-		if (arg->debug) cout << "ControlPlots::ctrlPlotObservables() : plotting " << bBaseName << endl;
-		int nBinsX = 50;
-		int nBinsY = tt->getScanpointN()/2;
-		selectNewPad();
-
-		// observables
-		t->Draw("scanpoint:"+bName,  ctrlPlotCuts, "colz");  // first test plot to get the automatic x axis range
-		float xmin = ((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->GetXmin();
-		float xmax = ((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->GetXmax();
-		t->Draw("scanpoint:"+bName+">>"
-				+Form("hObs%i(%i,%f,%f,%i,%f,%f)",j,nBinsX,xmin,xmax,nBinsY,tt->getScanpointMin(),tt->getScanpointMax()),
-				ctrlPlotCuts, "colz");
-		TH2F *hObs = ((TH2F*)(gPad->GetPrimitive(Form("hObs%i",j))));
-
-		// overlay theory (the branches have the same name but with th instead of obs)
+		// the theory branches have the same name but with th instead of obs
 		TString thName = bName;
 		thName.ReplaceAll("_obs","_th");
-		t->Draw("scanpoint:"+thName+">>"
-				+Form("hTh%i(%i,%f,%f,%i,%f,%f)",j,nBinsX,xmin,xmax,nBinsY,tt->getScanpointMin(),tt->getScanpointMax()),
-				ctrlPlotCuts, "box");
-		TH2F *hTh = ((TH2F*)(gPad->GetPrimitive(Form("hTh%i",j))));
-
-		gStyle->SetOptTitle(0);
-		hObs->Draw("colz");
-		hObs->GetXaxis()->SetTitle(bName);
-		hObs->GetYaxis()->SetTitle("scan point");
-		hTh->Draw("boxsame");
-		makePlotsNice(Form("hObs%i",j));
-		updateCurrentCanvas();
+		int c = filler->column(bName);
+		obsNames.push_back(bName);
+		cObs.push_back(c);
+		cTh.push_back(filler->column(thName));
+		rObs.push_back(filler->bookRange([=](const double *r){return passesCuts(r);}, [=](const double *r){return r[c];}));
 	}
+
+	ctrlPlotBookers.push_back([=]() -> Drawer
+	{
+		int nBinsX = 50;
+		int nBinsY = tt->getScanpointN()/2;
+		HistogramFiller::Selection cuts = [=](const double *r){return passesCuts(r);};
+		HistogramFiller::Expression scanpoint = [=](const double *r){return r[cScanpoint];};
+		vector<TH2F*> hObs, hTh;
+		for ( unsigned int i=0; i<obsNames.size(); i++ )
+		{
+			float xmin, xmax;
+			getAxisRange(rObs[i], xmin, xmax);
+			int c = cObs[i];
+			int cT = cTh[i];
+			hObs.push_back((TH2F*)filler->book(new TH2F(getUniqueRootName(), "scanpoint:"+obsNames[i], nBinsX, xmin, xmax, nBinsY, tt->getScanpointMin(), tt->getScanpointMax()),
+						cuts, [=](const double *r){return r[c];}, scanpoint));
+			hTh.push_back((TH2F*)filler->book(new TH2F(getUniqueRootName(), "scanpoint:"+obsNames[i], nBinsX, xmin, xmax, nBinsY, tt->getScanpointMin(), tt->getScanpointMax()),
+						cuts, [=](const double *r){return r[cT];}, scanpoint));
+		}
+
+		return [=]()
+		{
+			selectNewCanvas("Observables 1");
+			for ( unsigned int i=0; i<obsNames.size(); i++ )
+			{
+				TString bBaseName = obsNames[i];
+				bBaseName.ReplaceAll("_obs","");
+				if (arg->debug) cout << "ControlPlots::ctrlPlotObservables() : plotting " << bBaseName << endl;
+				selectNewPad();
+				gStyle->SetOptTitle(0);
+				hObs[i]->Draw("colz");
+				hObs[i]->GetXaxis()->SetTitle(obsNames[i]);
+				hObs[i]->GetYaxis()->SetTitle("scan point");
+				hTh[i]->Draw("boxsame");
+				makePlotsNice(hObs[i]->GetName());
+				updateCurrentCanvas();
+			}
+		};
+	});
 }
 
 ///
@@ -395,34 +495,70 @@ void ControlPlots::ctrlPlotChi2Distribution()
 	float scanpointMin = tt->getScanpointMin();
 	float scanpointMax = tt->getScanpointMax();
 	if ( scanpointMin==scanpointMax ) nBins=1;  // else we get 12x the same bin
-	selectNewCanvas("Chi2Distribution 1");
+	int cScanpoint        = filler->column("scanpoint");
+	int cChi2minToy       = filler->column("chi2minToy");
+	int cChi2minGlobalToy = filler->column("chi2minGlobalToy");
+	HistogramFiller::Expression deltaChi2 = [=](const double *r){return r[cChi2minToy]-r[cChi2minGlobalToy];};
+	vector<HistogramFiller::Selection> sel;
+	vector<int> rDeltaChi2;
 	for ( int i=0; i<nBins; i++ )
 	{
-		TVirtualPad *pad = selectNewPad();
 		float binMin = scanpointMin+(float)i*(scanpointMax-scanpointMin)/(float)nBins;
 		float binMax = binMin+(scanpointMax-scanpointMin)/(float)nBins;
-		TCut bincut = Form("%f<scanpoint && scanpoint<%f", binMin*0.999, binMax*1.001); // factors to allow for the case of binMin=binMax
-		float normEvents = t->Draw("chi2minToy-chi2minGlobalToy", ctrlPlotCuts && bincut && "chi2minToy-chi2minGlobalToy>0 && chi2minToy-chi2minGlobalToy<50");
-		if ( !gPad->GetPrimitive("htemp") ) continue;
-		TPaveText* txt = new TPaveText(0.3,0.8,0.9,0.9,"BRNDC");
-		txt->AddText(Form("%.3f < %s < %.3f", binMin, arg->var[0].Data(), binMax));
-		txt->SetBorderSize(0);
-		txt->SetFillStyle(0);
-		txt->SetTextAlign(12);
-		txt->Draw();
-		((TH1F*)(gPad->GetPrimitive("htemp")))->GetXaxis()->SetTitle("#Delta#chi^{2}");
-		makePlotsNice();
-		pad->SetLogy();
-		// draw a chi2 function
-		TF1 *f = new TF1("f", "[0]*x^([1]/2-1)*exp(-x/2)", 0, 30);
-		float binWidth = ((TH1F*)(gPad->GetPrimitive("htemp")))->GetBinWidth(1);
-		int ndof = arg->var.size();
-		float norm = 1./(pow(2,ndof/2.)*TMath::Gamma(ndof/2.)) * normEvents*binWidth;
-		f->SetParameter(0,norm);
-		f->SetParameter(1,ndof);
-		f->Draw("same");
-		updateCurrentCanvas();
+		// factors to allow for the case of binMin=binMax
+		sel.push_back([=](const double *r){return passesCuts(r)
+				&& binMin*0.999<r[cScanpoint] && r[cScanpoint]<binMax*1.001
+				&& r[cChi2minToy]-r[cChi2minGlobalToy]>0 && r[cChi2minToy]-r[cChi2minGlobalToy]<50;});
+		rDeltaChi2.push_back(filler->bookRange(sel[i], deltaChi2));
 	}
+
+	ctrlPlotBookers.push_back([=]() -> Drawer
+	{
+		vector<TH1F*> hists;
+		for ( int i=0; i<nBins; i++ )
+		{
+			if ( filler->getRangeEntries(rDeltaChi2[i])==0 ){
+				hists.push_back(0);
+				continue;
+			}
+			float xmin, xmax;
+			getAxisRange(rDeltaChi2[i], xmin, xmax);
+			hists.push_back((TH1F*)filler->book(new TH1F(getUniqueRootName(), "chi2minToy-chi2minGlobalToy", 100, xmin, xmax), sel[i], deltaChi2));
+		}
+
+		return [=]()
+		{
+			selectNewCanvas("Chi2Distribution 1");
+			for ( int i=0; i<nBins; i++ )
+			{
+				TVirtualPad *pad = selectNewPad();
+				TH1F *h = hists[i];
+				if ( !h ) continue;
+				float binMin = scanpointMin+(float)i*(scanpointMax-scanpointMin)/(float)nBins;
+				float binMax = binMin+(scanpointMax-scanpointMin)/(float)nBins;
+				h->Draw();
+				TPaveText* txt = new TPaveText(0.3,0.8,0.9,0.9,"BRNDC");
+				txt->AddText(Form("%.3f < %s < %.3f", binMin, arg->var[0].Data(), binMax));
+				txt->SetBorderSize(0);
+				txt->SetFillStyle(0);
+				txt->SetTextAlign(12);
+				txt->Draw();
+				h->GetXaxis()->SetTitle("#Delta#chi^{2}");
+				makePlotsNice(h->GetName());
+				pad->SetLogy();
+				// draw a chi2 function
+				TF1 *f = new TF1("f", "[0]*x^([1]/2-1)*exp(-x/2)", 0, 30);
+				float normEvents = filler->getRangeEntries(rDeltaChi2[i]);
+				float binWidth = h->GetBinWidth(1);
+				int ndof = arg->var.size();
+				float norm = 1./(pow(2,ndof/2.)*TMath::Gamma(ndof/2.)) * normEvents*binWidth;
+				f->SetParameter(0,norm);
+				f->SetParameter(1,ndof);
+				f->Draw("same");
+				updateCurrentCanvas();
+			}
+		};
+	});
 }
 
 ///
@@ -432,40 +568,69 @@ void ControlPlots::ctrlPlotChi2Parabola()
 {
 	if ( arg->debug ) cout << "ControlPlots::ctrlPlotChi2Parabola() : plotting ..." << endl;
 	int nBins = 12;       //  this many chi2 plots we want
-	selectNewCanvas("Chi2Parabola 1");
 	float scanpointMin = tt->getScanpointMin();
 	float scanpointMax = tt->getScanpointMax();
 	if ( scanpointMin==scanpointMax ) nBins=1;  // else we get 12x the same bin
-	gEnv->SetValue("Hist.Binning.2D.x",75);
-	gEnv->SetValue("Hist.Binning.2D.y",75);
-
-	TString plotExpression = "chi2minToy-chi2minGlobalToy:";
-	if ( tt->isWsVarAngle(arg->var[0]) ){
-		plotExpression += "fmod(scanbest-scanpoint,3.142)";
-		// plotExpression += "fmod(scanbest-scanpoint,6.283)";
-	}
-	else {
-		plotExpression += "scanbest-scanpoint";
-		// plotExpression += "scanbest";
-		// plotExpression += "a_gaus_obsUID0";
-	}
-
-	for ( int i=0; i<nBins; i++ ){
-		selectNewPad();
+	int cScanpoint        = filler->column("scanpoint");
+	int cScanbest         = filler->column("scanbest");
+	int cChi2minToy       = filler->column("chi2minToy");
+	int cChi2minGlobalToy = filler->column("chi2minGlobalToy");
+
+	TString xTitle = "scanbest-scanpoint";
+	bool isAngle = tt->isWsVarAngle(arg->var[0]);
+	if ( isAngle ) xTitle = "fmod(scanbest-scanpoint,3.142)";
+	HistogramFiller::Expression x = [=](const double *r){return isAngle ? fmod(r[cScanbest]-r[cScanpoint],3.142) : r[cScanbest]-r[cScanpoint];};
+	HistogramFiller::Expression y = [=](const double *r){return r[cChi2minToy]-r[cChi2minGlobalToy];};
+
+	vector<HistogramFiller::Selection> sel;
+	vector<int> rx, ry;
+	for ( int i=0; i<nBins; i++ )
+	{
 		float binMin = scanpointMin+(float)i*(scanpointMax-scanpointMin)/(float)nBins;
 		float binMax = binMin+(scanpointMax-scanpointMin)/(float)nBins;
-		TCut bincut = Form("%f<scanpoint && scanpoint<=%f", binMin*0.999, binMax*1.001);  // factors to allow for the case of binMin=binMax
-		t->Draw(plotExpression, ctrlPlotCuts && bincut && "chi2minToy-chi2minGlobalToy>0 && chi2minToy-chi2minGlobalToy<9", "colz");
-		if ( !gPad->GetPrimitive("htemp") ) continue;
-		TPaveText* txt = new TPaveText(0.3,0.8,0.9,0.9,"BRNDC");
-		txt->AddText(Form("%.3f<var<%.3f", binMin, binMax));
-		txt->SetBorderSize(0);
-		txt->SetFillStyle(0);
-		txt->SetTextAlign(12);
-		txt->Draw();
-		makePlotsNice();
-		updateCurrentCanvas();
+		// factors to allow for the case of binMin=binMax
+		sel.push_back([=](const double *r){return passesCuts(r)
+				&& binMin*0.999<r[cScanpoint] && r[cScanpoint]<=binMax*1.001
+				&& r[cChi2minToy]-r[cChi2minGlobalToy]>0 && r[cChi2minToy]-r[cChi2minGlobalToy]<9;});
+		rx.push_back(filler->bookRange(sel[i], x));
+		ry.push_back(filler->bookRange(sel[i], y));
 	}
+
+	ctrlPlotBookers.push_back([=]() -> Drawer
+	{
+		vector<TH2F*> hists;
+		for ( int i=0; i<nBins; i++ )
+		{
+			if ( filler->getRangeEntries(rx[i])==0 ){
+				hists.push_back(0);
+				continue;
+			}
+			float xmin, xmax, ymin, ymax;
+			getAxisRange(rx[i], xmin, xmax, 75);
+			getAxisRange(ry[i], ymin, ymax, 75);
+			hists.push_back((TH2F*)filler->book(new TH2F(getUniqueRootName(), "chi2minToy-chi2minGlobalToy:"+xTitle, 75, xmin, xmax, 75, ymin, ymax), sel[i], x, y));
+		}
+
+		return [=]()
+		{
+			selectNewCanvas("Chi2Parabola 1");
+			for ( int i=0; i<nBins; i++ ){
+				selectNewPad();
+				if ( !hists[i] ) continue;
+				float binMin = scanpointMin+(float)i*(scanpointMax-scanpointMin)/(float)nBins;
+				float binMax = binMin+(scanpointMax-scanpointMin)/(float)nBins;
+				hists[i]->Draw("colz");
+				TPaveText* txt = new TPaveText(0.3,0.8,0.9,0.9,"BRNDC");
+				txt->AddText(Form("%.3f<var<%.3f", binMin, binMax));
+				txt->SetBorderSize(0);
+				txt->SetFillStyle(0);
+				txt->SetTextAlign(12);
+				txt->Draw();
+				makePlotsNice(hists[i]->GetName());
+				updateCurrentCanvas();
+			}
+		};
+	});
 }
 
 ///
@@ -595,11 +760,29 @@ TVirtualPad* ControlPlots::selectNewPad()
 	return c1->cd(ctrlPadId);
 }
 
+///
+/// Fill the histograms of all control plots booked so far,
+/// and draw them. The first pass over the toys finds the axis
+/// ranges, the second one fills all histograms.
+///
+void ControlPlots::makeCtrlPlots()
+{
+	if ( ctrlPlotBookers.empty() ) return;
+	if ( arg->debug ) cout << "ControlPlots::makeCtrlPlots() : filling " << ctrlPlotBookers.size() << " control plots ..." << endl;
+	filler->run();
+	vector<Drawer> drawers;
+	for ( unsigned int i=0; i<ctrlPlotBookers.size(); i++ ) drawers.push_back(ctrlPlotBookers[i]());
+	filler->run();
+	for ( unsigned int i=0; i<drawers.size(); i++ ) drawers[i]();
+	ctrlPlotBookers.clear();
+}
+
 ///
 /// Save all control plots that were created so far.
 ///
 void ControlPlots::saveCtrlPlots()
 {
+	makeCtrlPlots();
 	for ( int i=0; i<ctrlPlotCanvases.size(); i++ ) {
 		TString fName = ctrlPlotCanvases[i]->GetTitle();
 		fName.ReplaceAll(name+" ", name+"_"+arg->var[0]+"_");
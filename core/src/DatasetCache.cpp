@@ -0,0 +1,247 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "DatasetCache.h"
+#include "Profiler.h"
+#include "RooGlobalFunc.h"
+#include "TMath.h"
+#include "TSystem.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char     datasetCacheMagic[8] = {'G','C','D','S','C','A','C','2'};
+static const TString  datasetCacheWeightName = "__weight";
+
+///
+/// Map a cache file written by exportDataSet(). Check isValid()
+/// before using it: a missing or inconsistent file leaves the
+/// cache invalid.
+///
+DatasetCache::DatasetCache(TString fileName)
+{
+	this->fileName = fileName;
+	mapped = 0;
+	mapSize = 0;
+	valid = false;
+	weighted = false;
+	nEntries = 0;
+
+	int fd = open(fileName.Data(), O_RDONLY);
+	if ( fd<0 ) return;
+	struct stat st;
+	if ( fstat(fd, &st)!=0 || st.st_size<(off_t)(sizeof(datasetCacheMagic)+3*sizeof(Long64_t)) ){
+		close(fd);
+		return;
+	}
+	mapSize = st.st_size;
+	mapped = mmap(0, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping stays valid
+	if ( mapped==MAP_FAILED ){
+		cout << "DatasetCache::DatasetCache() : WARNING : could not map " << fileName << endl;
+		mapped = 0;
+		return;
+	}
+
+	// parse the header
+	const char* p = (const char*)mapped;
+	const char* end = p+mapSize;
+	if ( memcmp(p, datasetCacheMagic, sizeof(datasetCacheMagic))!=0 ) return;
+	p += sizeof(datasetCacheMagic);
+	Long64_t header[3];
+	memcpy(header, p, sizeof(header));
+	p += sizeof(header);
+	nEntries = header[0];
+	Long64_t nColumns = header[1];
+	weighted = header[2]!=0;
+	if ( nEntries<0 || nColumns<(weighted ? 1 : 0) ) return;
+	vector<TString> names; // the source, then the columns
+	for ( Long64_t c=0; c<nColumns+1; c++ ){
+		Long64_t len;
+		if ( p+sizeof(len)>end ) return;
+		memcpy(&len, p, sizeof(len));
+		p += sizeof(len);
+		if ( len<0 || p+len>end ) return;
+		names.push_back(TString(p, len));
+		p += len;
+	}
+	source = names[0];
+	names.erase(names.begin());
+	size_t offset = p-(const char*)mapped;
+	offset = (offset+7)/8*8;
+	if ( offset+nColumns*nEntries*sizeof(double)!=mapSize ) return;
+	for ( Long64_t c=0; c<nColumns; c++ ){
+		columns.push_back((const double*)((const char*)mapped+offset)+c*nEntries);
+		if ( !weighted || c<nColumns-1 ) columnNames.push_back(names[c]);
+	}
+	valid = true;
+}
+
+DatasetCache::~DatasetCache()
+{
+	if ( mapped ) munmap(mapped, mapSize);
+}
+
+///
+/// The fingerprint of the source of a dataset: its name, and the name,
+/// size and modification time of the file it is read from, e.g. the
+/// workspace file.
+///
+/// \return the fingerprint, or "" if the file doesn't exist
+///
+TString DatasetCache::fingerprint(TString dataName, TString sourceFile)
+{
+	FileStat_t st;
+	if ( gSystem->GetPathInfo(sourceFile, st)!=0 ) return "";
+	return Form("%s;%s:%lld:%ld", dataName.Data(), sourceFile.Data(), (long long)st.fSize, st.fMtime);
+}
+
+///
+/// Write the columns of a dataset to a cache file. The file is
+/// written under a temporary name and then renamed, so that jobs
+/// starting at the same time never map a partial file.
+///
+/// \param data - the dataset. Its variables have to be RooRealVars
+///               or RooCategories.
+/// \param fileName - the cache file
+/// \param source - fingerprint of the source of the dataset, see fingerprint()
+/// \return false if the dataset can't be cached or the file can't
+///         be written
+///
+bool DatasetCache::exportDataSet(RooDataSet* data, TString fileName, TString source)
+{
+	ProfileTimer pt("DatasetCache::exportDataSet");
+	const RooArgSet* row = data->get();
+	vector<RooAbsArg*> vars;
+	TIterator* it = row->createIterator();
+	while ( RooAbsArg* a = (RooAbsArg*)it->Next() ){
+		if ( !a->InheritsFrom(RooRealVar::Class()) && !a->InheritsFrom(RooCategory::Class()) ){
+			cout << "DatasetCache::exportDataSet() : WARNING : can't cache variable " << a->GetName()
+				<< " of type " << a->ClassName() << ", dataset " << data->GetName() << " is not cached." << endl;
+			delete it;
+			return false;
+		}
+		vars.push_back(a);
+	}
+	delete it;
+
+	Long64_t nEntries = data->numEntries();
+	bool weighted = data->isWeighted();
+	Long64_t nColumns = vars.size()+(weighted ? 1 : 0);
+
+	TString tmpName = fileName+Form(".tmp%i", (int)getpid());
+	FILE* f = fopen(tmpName.Data(), "wb");
+	if ( !f ){
+		cout << "DatasetCache::exportDataSet() : WARNING : could not write " << tmpName << endl;
+		return false;
+	}
+	bool ok = true;
+	Long64_t header[3] = {nEntries, nColumns, weighted ? 1 : 0};
+	ok &= fwrite(datasetCacheMagic, sizeof(datasetCacheMagic), 1, f)==1;
+	ok &= fwrite(header, sizeof(header), 1, f)==1;
+	Long64_t sourceLen = source.Length();
+	ok &= fwrite(&sourceLen, sizeof(sourceLen), 1, f)==1;
+	ok &= fwrite(source.Data(), 1, sourceLen, f)==(size_t)sourceLen;
+	for ( Long64_t c=0; c<nColumns; c++ ){
+		TString name = c<(Long64_t)vars.size() ? TString(vars[c]->GetName()) : datasetCacheWeightName;
+		Long64_t len = name.Length();
+		ok &= fwrite(&len, sizeof(len), 1, f)==1;
+		ok &= fwrite(name.Data(), 1, len, f)==(size_t)len;
+	}
+	long offset = ftell(f);
+	long padded = (offset+7)/8*8;
+	for ( long i=offset; i<padded; i++ ) ok &= fputc(0, f)!=EOF;
+
+	// fill the columns block by block, to keep the memory bounded
+	const Long64_t blockSize = 100000;
+	for ( Long64_t first=0; first<nEntries && ok; first+=blockSize ){
+		Long64_t n = TMath::Min(blockSize, nEntries-first);
+		vector<vector<double> > values(nColumns, vector<double>(n));
+		for ( Long64_t i=0; i<n; i++ ){
+			data->get(first+i);
+			for ( unsigned int c=0; c<vars.size(); c++ ){
+				if ( vars[c]->InheritsFrom(RooRealVar::Class()) ) values[c][i] = ((RooRealVar*)vars[c])->getVal();
+				else values[c][i] = ((RooCategory*)vars[c])->getIndex();
+			}
+			if ( weighted ) values[nColumns-1][i] = data->weight();
+		}
+		for ( Long64_t c=0; c<nColumns; c++ ){
+			ok &= fseek(f, padded+(c*nEntries+first)*sizeof(double), SEEK_SET)==0;
+			ok &= fwrite(&values[c][0], sizeof(double), n, f)==(size_t)n;
+		}
+	}
+	ok &= fclose(f)==0;
+	if ( ok ) ok = rename(tmpName.Data(), fileName.Data())==0;
+	if ( !ok ){
+		cout << "DatasetCache::exportDataSet() : WARNING : could not write " << fileName << endl;
+		remove(tmpName.Data());
+		return false;
+	}
+	return true;
+}
+
+///
+/// A column of the cache, nEntries values. Returns 0 if there is
+/// no column of that name.
+///
+const double* DatasetCache::getColumn(TString name) const
+{
+	for ( unsigned int c=0; c<columnNames.size(); c++ ){
+		if ( columnNames[c]==name ) return columns[c];
+	}
+	return 0;
+}
+
+///
+/// Fill a new dataset from the cache.
+///
+/// \param vars - the variables of the dataset, usually those of the
+///               workspace. Every column needs a variable of its name,
+///               and every variable a column.
+/// \param name - name of the new dataset
+/// \return the dataset, owned by the caller. Exits if the cache
+///         doesn't match the variables.
+///
+RooDataSet* DatasetCache::makeDataSet(const RooArgSet& vars, TString name) const
+{
+	ProfileTimer pt("DatasetCache::makeDataSet");
+	if ( !valid ){
+		cout << "DatasetCache::makeDataSet() : ERROR : no valid cache in " << fileName << endl;
+		exit(1);
+	}
+	if ( vars.getSize()!=(int)columnNames.size() ){
+		cout << "DatasetCache::makeDataSet() : ERROR : " << vars.getSize() << " variables, but "
+			<< columnNames.size() << " columns in " << fileName << endl;
+		exit(1);
+	}
+	vector<RooAbsArg*> args;
+	for ( unsigned int c=0; c<columnNames.size(); c++ ){
+		RooAbsArg* a = vars.find(columnNames[c]);
+		if ( !a ){
+			cout << "DatasetCache::makeDataSet() : ERROR : no variable for column " << columnNames[c] << " of " << fileName << endl;
+			exit(1);
+		}
+		args.push_back(a);
+	}
+
+	RooRealVar weightVar(datasetCacheWeightName, datasetCacheWeightName, 1.);
+	RooArgSet allVars(vars);
+	if ( weighted ) allVars.add(weightVar);
+	RooDataSet* data = weighted ? new RooDataSet(name, name, allVars, RooFit::WeightVar(weightVar))
+		: new RooDataSet(name, name, allVars);
+	for ( Long64_t i=0; i<nEntries; i++ ){
+		for ( unsigned int c=0; c<args.size(); c++ ){
+			if ( args[c]->InheritsFrom(RooRealVar::Class()) ) ((RooRealVar*)args[c])->setVal(columns[c][i]);
+			else ((RooCategory*)args[c])->setIndex((int)columns[c][i]);
+		}
+		if ( weighted ) data->add(vars, columns.back()[i]);
+		else data->add(vars);
+	}
+	return data;
+}
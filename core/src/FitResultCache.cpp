@@ -5,20 +5,50 @@ FitResultCache::FitResultCache(OptParser *arg, int roundrobinsize)
   assert(arg);
   _arg = arg;
 	_roundrobinsize = roundrobinsize;
-	_parsAtFunctionCall = 0;
-	_parsAtGlobalMin = 0;
 	_roundrobinid = 0;
-	for ( int i=0; i<_roundrobinsize; i++ ) _parsRoundRobin.push_back(0);
+	_filled.resize(_slotFirstRoundRobin+_roundrobinsize, false);
 }
 
 
 FitResultCache::~FitResultCache()
+{}
+
+///
+/// Define the schema: the order of the parameters in the
+/// stored points. Allocates the storage for all slots.
+///
+void FitResultCache::bindSchema(const RooArgSet* set)
+{
+	TIterator* it = set->createIterator();
+	while ( RooRealVar* p = (RooRealVar*)it->Next() ) _schema.push_back(p);
+	delete it;
+	_values.resize(_schema.size()*_filled.size());
+}
+
+///
+/// Store the current values of the parameters into a slot.
+///
+void FitResultCache::store(int slot, const RooArgSet* set)
 {
-	if ( _parsAtFunctionCall ) delete _parsAtFunctionCall;
-	if ( _parsAtGlobalMin ) delete _parsAtGlobalMin;
-	for ( int i=0; i<_parsRoundRobin.size(); i++ ){
-		if ( _parsRoundRobin[i] ) delete _parsRoundRobin[i];
+	assert(set);
+	if ( _schema.empty() ) bindSchema(set);
+	if ( set->getSize()!=(int)_schema.size() ){
+		cout << "FitResultCache::store() : ERROR : "
+			"the parameter set differs from the one of the first call. Exit." << endl;
+		exit(1);
 	}
+	double *values = &_values[slot*_schema.size()];
+	for ( unsigned int i=0; i<_schema.size(); i++ ) values[i] = _schema[i]->getVal();
+	_filled[slot] = true;
+}
+
+///
+/// Get a stored point. Ownership stays with FitResultCache.
+///
+ParameterSnapshot FitResultCache::get(int slot)
+{
+	assert(_filled[slot]);
+	return ParameterSnapshot(&_schema, &_values[slot*_schema.size()]);
 }
 
 ///
@@ -29,28 +59,34 @@ FitResultCache::~FitResultCache()
 ///
 void FitResultCache::storeParsAtFunctionCall(const RooArgSet* set)
 {
-	if ( _parsAtFunctionCall ){
+	if ( _filled[_slotFunctionCall] ){
 		cout << "FitResultCache::storeParsAtFunctionCall() : ERROR : "
 			"Trying to overwrite the parameters at funciton call. Exit." << endl;
 		exit(1);
 	}
-	assert(set);
-	_parsAtFunctionCall = new RooDataSet("parsAtFunctionCall", "parsAtFunctionCall", *set);
-	_parsAtFunctionCall->add(*set);
+	store(_slotFunctionCall, set);
 }
 
 ///
-/// Store the parameters held by set. Can only be called once
-/// per instance of FitResultCache.
+/// Store the parameters held by set. Overwrites the
+/// previously stored point.
 ///
 /// \param set - the set of parameters to be saved
 ///
 void FitResultCache::storeParsAtGlobalMin(const RooArgSet* set)
 {
-	assert(set);
-	if ( _parsAtGlobalMin ) delete _parsAtGlobalMin;
-	_parsAtGlobalMin = new RooDataSet("parsAtGlobalMin", "parsAtGlobalMin", *set);
-	_parsAtGlobalMin->add(*set);
+	store(_slotGlobalMin, set);
+}
+
+///
+/// Store the parameters held by set as the predicted point.
+/// Overwrites the previously stored point.
+///
+/// \param set - the set of parameters to be saved
+///
+void FitResultCache::storeParsPredicted(const RooArgSet* set)
+{
+	store(_slotPredicted, set);
 }
 
 ///
@@ -60,12 +96,9 @@ void FitResultCache::storeParsAtGlobalMin(const RooArgSet* set)
 ///
 void FitResultCache::storeParsRoundRobin(const RooArgSet* set)
 {
-	assert(set);
 	_roundrobinid++;
 	if ( _roundrobinid>=_roundrobinsize ) _roundrobinid = 0;
-	if ( _parsRoundRobin[_roundrobinid] ) delete _parsRoundRobin[_roundrobinid];
-	_parsRoundRobin[_roundrobinid] = new RooDataSet("parsAtFunctionCall", "parsAtFunctionCall", *set);
-	_parsRoundRobin[_roundrobinid]->add(*set);
+	store(_slotFirstRoundRobin+_roundrobinid, set);
 }
 
 ///
@@ -76,7 +109,7 @@ void FitResultCache::storeParsRoundRobin(const RooArgSet* set)
 ///
 void FitResultCache::initRoundRobinDB(const RooArgSet* set)
 {
-	for ( int i=0; i<_parsRoundRobin.size(); i++ ){ 
+	for ( int i=0; i<_roundrobinsize; i++ ){
 		storeParsRoundRobin(set);
 	}
 }
@@ -84,17 +117,32 @@ void FitResultCache::initRoundRobinDB(const RooArgSet* set)
 ///
 /// Get an entry from the round robin database.
 /// Ownership stays with FitResultCache.
-/// 
+///
 /// \param n - the point we want to get, 0 is the most recent one
 ///
-const RooArgSet* FitResultCache::getRoundRobinNminus(int n)
+ParameterSnapshot FitResultCache::getRoundRobinNminus(int n)
 {
 	int id = _roundrobinid-n;
-	if ( id<0 ) id += _parsRoundRobin.size();
-	if ( id < 0 || id >=_parsRoundRobin.size() || _parsRoundRobin[id]==0 ){
+	if ( id<0 ) id += _roundrobinsize;
+	if ( id < 0 || id >=_roundrobinsize || !_filled[_slotFirstRoundRobin+id] ){
 		cout << "FitResultCache::getRoundRobinNminus() : ERROR : "
 			"Trying to access a round robin point that doesn't exist: id=" << id << ". Exit." << endl;
 		exit(1);
 	}
-	return _parsRoundRobin[id]->get(0);
+	return get(_slotFirstRoundRobin+id);
+}
+
+ParameterSnapshot FitResultCache::getParsAtFunctionCall()
+{
+	return get(_slotFunctionCall);
+}
+
+ParameterSnapshot FitResultCache::getParsAtGlobalMin()
+{
+	return get(_slotGlobalMin);
+}
+
+ParameterSnapshot FitResultCache::getParsPredicted()
+{
+	return get(_slotPredicted);
 }
@@ -1,4 +1,5 @@
 #include "Fitter.h"
+#include "Profiler.h"
 
 Fitter::Fitter(OptParser *arg, RooWorkspace *w, TString name)
 {
@@ -6,8 +7,6 @@ Fitter::Fitter(OptParser *arg, RooWorkspace *w, TString name)
   this->name = name;
   this->arg = arg;
   
-  startparsFirstFit = 0;
-  startparsSecondFit = 0;
   nFit1Best = 0;
   nFit2Best = 0;
   pdfName  = "pdf_"+name;
@@ -28,12 +27,12 @@ Fitter::~Fitter()
 ///
 void Fitter::fitTwice(){
   // first fit
-	setParametersFloating(w, parsName, startparsFirstFit);
+	startparsFirstFit.apply(true);
   RooFitResult *r1 = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
   bool f1failed = !(r1->edm()<1 && r1->covQual()==3);
   
   // second fit
-  setParametersFloating(w, parsName, startparsSecondFit);
+  startparsSecondFit.apply(true);
   RooFitResult *r2 = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
   bool f2failed = !(r2->edm()<1 && r2->covQual()==3);
   
@@ -76,7 +75,7 @@ void Fitter::fitTwice(){
 ///
 void Fitter::fitForce()
 {
-  setParametersFloating(w, parsName, startparsFirstFit);
+  startparsFirstFit.apply(true);
   theResult = fitToMinForce(w, name);
   setParametersFloating(w, parsName, theResult);
 }
@@ -111,9 +110,11 @@ int Fitter::getStatus()
 ///
 void Fitter::fit()
 {
+  ProfileTimer pt("Fitter::fit");
   if ( theResult ) delete theResult;
   if ( arg->scanforce ) fitForce();
   else fitTwice();
+  if ( getStatus()!=0 ) profileCount("Fitter::fit failed");
 }
 
 void Fitter::print()
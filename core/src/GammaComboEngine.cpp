@@ -17,6 +17,9 @@ GammaComboEngine::GammaComboEngine(TString name, int argc, char* argv[]):
 	arg->bookAllOptions();
 	arg->parseArguments(argc, argv);
 
+	// time the hot paths, if requested (--profile)
+	if ( arg->profile!="" ) Profiler::instance().enable(arg->profile);
+
 	// configure names
 	execname = argv[0];
 	if (arg->filenameaddition!="") name += "_"+arg->filenameaddition;
@@ -31,6 +34,7 @@ GammaComboEngine::GammaComboEngine(TString name, int argc, char* argv[]):
 
 	// initialize members
 	plot = 0;
+	combinationCache = arg->combcache ? new CombinationCache() : 0;
 }
 
 GammaComboEngine::GammaComboEngine(TString name, int argc, char* argv[], bool _runOnDataSet)
@@ -43,6 +47,7 @@ GammaComboEngine::~GammaComboEngine()
 {
 	delete m_fnamebuilder;
   delete m_batchscriptwriter;
+	delete combinationCache;
 }
 
 
@@ -899,6 +904,7 @@ void GammaComboEngine::make1dProbScan(MethodProbScan *scanner, int cId)
   	scanner->saveLocalMinima(m_fnamebuilder->getFileNameSolution(scanner));
 	scanner->calcCLintervals();
 	if (arg->cls.size()>0) scanner->calcCLintervals(1); // for prob method CLsType>1 doesn't exist
+	if (scanner->getHCLsFreq() && isIn<int>(arg->cls, 2)) scanner->calcCLintervals(2); // only filled with --asymptoticcls
 	if (!arg->isAction("pluginbatch") && !arg->plotpluginonly){
 		if ( arg->plotpulls ) scanner->plotPulls();
 		if ( arg->parevol ){
@@ -1028,6 +1034,7 @@ void GammaComboEngine::make1dProbPlot(MethodProbScan *scanner, int cId)
     if ( arg->cls.size()>0 ) {
       if ( runOnDataSet ) ((MethodDatasetsProbScan*)scanner)->plotFitRes(m_fnamebuilder->getFileNamePlot(cmb)+"_fit");
       scanner->plotOn(plot, 1); // for prob ClsType>1 doesn't exist
+      if ( scanner->getHCLsFreq() && isIn<int>(arg->cls, 2) ) scanner->plotOn(plot, 2); // only filled with --asymptoticcls
     }
 		scanner->plotOn(plot);
 		int colorId = cId;
@@ -1439,6 +1446,27 @@ void GammaComboEngine::writebatchscripts()
   exit(0);
 }
 
+///
+/// Check if the i-th combination on the command line can be built in the
+/// shared workspace of the combination cache. All combinations built there
+/// share their parameters, so none of them may change parameter ranges
+/// or observables, and only the Prob method is supported, as the toys
+/// of the other methods set the observables.
+///
+/// \param cId - index of the combination on the command line
+///
+bool GammaComboEngine::isCombinationCacheSafe(int cId)
+{
+	if ( arg->isAction("plugin") || arg->isAction("pluginbatch") || arg->isAction("coverage")
+		|| arg->isAction("coveragebatch") || arg->isAction("bb") || arg->isAction("bbbatch") ) return false;
+	if ( arg->save!="" ) return false;
+	if ( arg->isAsimovCombiner(cId) ) return false;
+	if ( cId<arg->physRanges.size() && arg->physRanges[cId].size()>0 ) return false;
+	if ( cId<arg->removeRanges.size() && arg->removeRanges[cId].size()>0 ) return false;
+	if ( cId<arg->randomizeToyVars.size() && arg->randomizeToyVars[cId].size()>0 ) return false;
+	return true;
+}
+
 ///
 /// make latex
 ///
@@ -1513,6 +1541,9 @@ void GammaComboEngine::scan()
 		// fix parameters according to the command line - only possible before combining
 		fixParameters(c, i);
 
+		// build the combination in the shared workspace, if requested and possible
+		if ( combinationCache && isCombinationCacheSafe(i) ) c->setCache(combinationCache);
+
 		// configure names to run an Asimov toy - only possible before combining
 		if ( arg->isAsimovCombiner(i) ) configureAsimovCombinerNames(c, i);
 
@@ -1569,6 +1600,7 @@ void GammaComboEngine::scan()
 			// pvalue corrector
 			if ( arg->coverageCorrectionID>0 ) {
 				PValueCorrection *pvalueCorrector = new PValueCorrection(arg->coverageCorrectionID, arg->verbose);
+				pvalueCorrector->setNThreads(arg->covCorrectThreads);
 				pvalueCorrector->readFiles(m_fnamebuilder->getFileBaseName(c),arg->coverageCorrectionPoint,false); // false means for prob
 				pvalueCorrector->write("root/pvalueCorrection_prob.root");
 				scannerProb->setPValueCorrector(pvalueCorrector);
@@ -1654,6 +1686,7 @@ void GammaComboEngine::scan()
 					else {
 						if ( arg->coverageCorrectionID>0 ) {
 							PValueCorrection *pvalueCorrector= new PValueCorrection(arg->coverageCorrectionID, arg->verbose);
+							pvalueCorrector->setNThreads(arg->covCorrectThreads);
 							pvalueCorrector->readFiles(m_fnamebuilder->getFileBaseName(c),arg->coverageCorrectionPoint,true); // true means for plugin
 							pvalueCorrector->write("root/pvalueCorrection_plugin.root");
 							scannerPlugin->setPValueCorrector(pvalueCorrector);
@@ -1749,6 +1782,9 @@ void GammaComboEngine::scanDataSet()
 {
    if ( arg->info || arg->latex ) return;
 
+  // the pdf may have been built before the options were parsed
+  ((PDF_Datasets*)pdf[0])->setNCPU(arg->ncpu);
+
   /////////////////////////////////////////////////////
   //
   // PROB - DATASETS
@@ -1881,7 +1917,11 @@ void GammaComboEngine::run()
   if ( arg->nbatchjobs>0 ) writebatchscripts();
 	customizeCombinerTitles();
 	setUpPlot();
+	fitWithGradient = arg->gradient;
+	fitWithCompiledTheory = arg->compiledtheory;
 	scan(); // most thing gets done here
+	if ( arg->debug ) cout << "GammaComboEngine::run() : " << countAllFitBringBackAngle << " fits, angles wrapped "
+		<< countFitWrapAngle << " times in place and " << countFitBringBackAngle << " times by a refit" << endl;
   if ( arg->info || arg->latex || (arg->save!="" && !arg->saveAtMin) ) return; // if only info is requested then we can go home
 	if (!arg->isAction("pluginbatch") && !arg->isAction("coveragebatch") && !arg->isAction("coverage") ) savePlot();
 	cout << endl;
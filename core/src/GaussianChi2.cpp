@@ -0,0 +1,503 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "GaussianChi2.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+#include "Math/Factory.h"
+#include "Math/Minimizer.h"
+#include "RooMultiVarGaussian.h"
+#include "RooProdPdf.h"
+
+///
+/// Read access to the observables, means and inverse covariance
+/// of a RooMultiVarGaussian, which RooFit keeps protected.
+///
+class MultiVarGaussianAccess : public RooMultiVarGaussian
+{
+public:
+	static const RooListProxy& x(const RooMultiVarGaussian* p){return p->*(&MultiVarGaussianAccess::_x);};
+	static const RooListProxy& mu(const RooMultiVarGaussian* p){return p->*(&MultiVarGaussianAccess::_mu);};
+	static const TMatrixDSym& covI(const RooMultiVarGaussian* p){return p->*(&MultiVarGaussianAccess::_covI);};
+};
+
+///
+/// A RooFitResult that can be filled from outside RooMinuit.
+///
+class GaussianChi2FitResult : public RooFitResult
+{
+public:
+	GaussianChi2FitResult(const char* name) : RooFitResult(name, name) {};
+	using RooFitResult::setConstParList;
+	using RooFitResult::setCovarianceMatrix;
+	using RooFitResult::setCovQual;
+	using RooFitResult::setEDM;
+	using RooFitResult::setFinalParList;
+	using RooFitResult::setInitParList;
+	using RooFitResult::setMinNLL;
+	using RooFitResult::setNumInvalidNLL;
+	using RooFitResult::setStatus;
+};
+
+///
+/// \param pdf - the PDF, usually the combined PDF of a Combiner.
+///              Its floating parameters become the Minuit parameters.
+/// \param compiledTheory - evaluate the theory relations with compiled
+///              kernels where possible, see CompiledTheory
+///
+GaussianChi2::GaussianChi2(RooAbsPdf* pdf, bool compiledTheory)
+{
+	this->pdf = pdf;
+	valid = addPdf(pdf);
+	if ( !valid ) return;
+	if ( compiledTheory ){
+		for ( unsigned int b=0; b<blocks.size(); b++ ){
+			CompiledTheory* c = new CompiledTheory(blocks[b].th);
+			if ( c->isValid() ) blocks[b].compiled.reset(c);
+			else delete c;
+		}
+	}
+
+	RooArgSet* params = pdf->getParameters((RooArgSet*)0);
+	TIterator* it = params->createIterator();
+	while ( RooAbsArg* a = (RooAbsArg*)it->Next() ){
+		if ( a->isConstant() ) continue;
+		RooRealVar* p = dynamic_cast<RooRealVar*>(a);
+		if ( !p ){
+			valid = false;
+			break;
+		}
+		pars.push_back(p);
+	}
+	delete it;
+	delete params;
+
+	// sparsity pattern of the Jacobian
+	deps.resize(pars.size());
+	for ( unsigned int k=0; k<pars.size(); k++ ){
+		for ( unsigned int b=0; b<blocks.size(); b++ ){
+			for ( unsigned int i=0; i<blocks[b].th.size(); i++ ){
+				if ( !blocks[b].th[i]->dependsOn(*pars[k]) && !blocks[b].obs[i]->dependsOn(*pars[k]) ) continue;
+				Dependency d;
+				d.block = b;
+				d.i = i;
+				deps[k].push_back(d);
+			}
+		}
+	}
+	parBlocks.resize(pars.size());
+	for ( unsigned int k=0; k<pars.size(); k++ ){
+		for ( unsigned int l=0; l<deps[k].size(); l++ ){
+			if ( parBlocks[k].empty() || parBlocks[k].back()!=deps[k][l].block ) parBlocks[k].push_back(deps[k][l].block);
+		}
+	}
+	chi2s.assign(blocks.size(), 0.);
+
+	// Gaussians that evaluate() can do for many points at once: the
+	// observables and the parameters of the relations that aren't
+	// floating must not depend on the floating parameters
+	RooArgSet floating;
+	for ( unsigned int k=0; k<pars.size(); k++ ) floating.add(*pars[k]);
+	for ( unsigned int b=0; b<blocks.size(); b++ ){
+		Block& bl = blocks[b];
+		if ( !bl.compiled ) continue;
+		bl.batch = true;
+		for ( unsigned int i=0; i<bl.obs.size(); i++ ){
+			if ( bl.obs[i]->dependsOn(floating) ) bl.batch = false;
+		}
+		const vector<RooAbsReal*>& cPars = bl.compiled->getParameters();
+		for ( unsigned int k=0; k<cPars.size(); k++ ){
+			int l = find(pars.begin(), pars.end(), cPars[k])-pars.begin();
+			if ( l==(int)pars.size() ){
+				l = -1;
+				if ( cPars[k]->dependsOn(floating) ) bl.batch = false;
+			}
+			bl.batchPars.push_back(l);
+		}
+	}
+}
+
+GaussianChi2::~GaussianChi2()
+{}
+
+ROOT::Math::IMultiGradFunction* GaussianChi2::Clone() const
+{
+	return new GaussianChi2(*this);
+}
+
+///
+/// Collect the Gaussians of a PDF, descending into products.
+/// \return false if the PDF contains anything else
+///
+bool GaussianChi2::addPdf(RooAbsPdf* p)
+{
+	if ( p->InheritsFrom(RooProdPdf::Class()) ){
+		TIterator* it = ((RooProdPdf*)p)->pdfList().createIterator();
+		bool ok = true;
+		while ( RooAbsPdf* c = (RooAbsPdf*)it->Next() ) ok = ok && addPdf(c);
+		delete it;
+		return ok;
+	}
+	if ( p->IsA()!=RooMultiVarGaussian::Class() ) return false;
+	const RooMultiVarGaussian* g = (const RooMultiVarGaussian*)p;
+	Block b;
+	const RooListProxy& x = MultiVarGaussianAccess::x(g);
+	const RooListProxy& mu = MultiVarGaussianAccess::mu(g);
+	for ( int i=0; i<x.getSize(); i++ ){
+		b.obs.push_back((RooAbsReal*)x.at(i));
+		b.th.push_back((RooAbsReal*)mu.at(i));
+	}
+	b.covI.ResizeTo(MultiVarGaussianAccess::covI(g));
+	b.covI = MultiVarGaussianAccess::covI(g);
+	b.batch = false;
+	blocks.push_back(b);
+	return true;
+}
+
+void GaussianChi2::setParameters(const double* x) const
+{
+	for ( unsigned int k=0; k<pars.size(); k++ ) pars[k]->setVal(x[k]);
+}
+
+///
+/// Residuals x - mu of all blocks, at the current parameter values.
+///
+void GaussianChi2::residuals(vector<vector<double> >& r) const
+{
+	r.resize(blocks.size());
+	for ( unsigned int b=0; b<blocks.size(); b++ ) residuals(b, r[b]);
+}
+
+///
+/// Residuals x - mu of one block.
+///
+void GaussianChi2::residuals(int b, vector<double>& r) const
+{
+	const Block& bl = blocks[b];
+	r.resize(bl.th.size());
+	if ( bl.compiled ){
+		bl.compiled->evaluate(&r[0]);
+		for ( unsigned int i=0; i<bl.th.size(); i++ ) r[i] = bl.obs[i]->getVal() - r[i];
+	}
+	else{
+		for ( unsigned int i=0; i<bl.th.size(); i++ ) r[i] = bl.obs[i]->getVal() - bl.th[i]->getVal();
+	}
+}
+
+///
+/// The residuals a parameter acts on. Compiled blocks are evaluated
+/// as a whole, the others relation by relation.
+///
+void GaussianChi2::residuals(const vector<Dependency>& d, vector<double>& r) const
+{
+	r.resize(d.size());
+	vector<double> rb;
+	int last = -1;
+	for ( unsigned int l=0; l<d.size(); l++ ){
+		const Block& bl = blocks[d[l].block];
+		if ( !bl.compiled ){
+			r[l] = bl.obs[d[l].i]->getVal() - bl.th[d[l].i]->getVal();
+			continue;
+		}
+		if ( d[l].block!=last ){
+			residuals(d[l].block, rb);
+			last = d[l].block;
+		}
+		r[l] = rb[d[l].i];
+	}
+}
+
+///
+/// The chi2 r^T C^-1 r of one block, at the current parameter values.
+///
+double GaussianChi2::blockChi2(int b) const
+{
+	vector<double> r;
+	residuals(b, r);
+	const TMatrixDSym& covI = blocks[b].covI;
+	double chi2 = 0.;
+	for ( unsigned int i=0; i<r.size(); i++ ){
+		double s = 0.;
+		for ( unsigned int j=0; j<r.size(); j++ ) s += covI(i,j)*r[j];
+		chi2 += r[i]*s;
+	}
+	return chi2;
+}
+
+///
+/// The chi2, sum over all blocks of r^T C^-1 r. This is exactly
+/// -2ln of the product of the (unnormalized) RooMultiVarGaussians.
+/// Only the blocks that depend on parameters that differ from the
+/// last call are recomputed; observables and constant parameters
+/// don't change while a GaussianChi2 is minimized.
+///
+double GaussianChi2::DoEval(const double* x) const
+{
+	setParameters(x);
+	if ( lastX.empty() ){
+		for ( unsigned int b=0; b<blocks.size(); b++ ) chi2s[b] = blockChi2(b);
+		profileCount("GaussianChi2::DoEval blocks evaluated", blocks.size());
+	}
+	else{
+		vector<bool> dirty(blocks.size(), false);
+		for ( unsigned int k=0; k<pars.size(); k++ ){
+			if ( x[k]==lastX[k] ) continue;
+			for ( unsigned int l=0; l<parBlocks[k].size(); l++ ) dirty[parBlocks[k][l]] = true;
+		}
+		for ( unsigned int b=0; b<blocks.size(); b++ ){
+			if ( !dirty[b] ) continue;
+			chi2s[b] = blockChi2(b);
+			profileCount("GaussianChi2::DoEval blocks evaluated");
+		}
+	}
+	profileCount("GaussianChi2::DoEval blocks total", blocks.size());
+	lastX.assign(x, x+pars.size());
+
+	// always add up in the same order, so the result doesn't depend
+	// on the history of the cache
+	double chi2 = 0.;
+	for ( unsigned int b=0; b<blocks.size(); b++ ) chi2 += chi2s[b];
+	return chi2;
+}
+
+///
+/// The chi2 at many parameter points. The points are given as one array
+/// per parameter, so that the Gaussians with compiled relations are
+/// evaluated for all points at once: the relations by their batch
+/// kernel, the residuals and r^T C^-1 r in loops over the points, which
+/// the compiler vectorizes. The other Gaussians are evaluated point by
+/// point. The chi2 values agree with DoEval() up to rounding. The
+/// parameters are left at their values.
+///
+/// \param nPoints - number of points
+/// \param x - x[k][p] is the value of parameter k, in the order of
+///             getParameters(), at point p
+/// \param chi2 - set to the chi2 at each point
+///
+void GaussianChi2::evaluate(int nPoints, const double* const* x, double* chi2) const
+{
+	ProfileTimer pt("GaussianChi2::evaluate");
+	if ( nPoints<1 ) return;
+	profileCount("GaussianChi2::evaluate points", nPoints);
+	for ( int p=0; p<nPoints; p++ ) chi2[p] = 0.;
+
+	vector<int> perPoint;
+	vector<const double*> in;
+	vector<vector<double> > constant, r;
+	vector<double*> res;
+	for ( unsigned int b=0; b<blocks.size(); b++ ){
+		const Block& bl = blocks[b];
+		if ( !bl.batch ){
+			perPoint.push_back(b);
+			continue;
+		}
+
+		// theory relations at all points, constant parameters as constant arrays
+		int nIn = bl.batchPars.size();
+		in.resize(nIn);
+		constant.resize(nIn);
+		for ( int k=0; k<nIn; k++ ){
+			if ( bl.batchPars[k]>=0 ){
+				in[k] = x[bl.batchPars[k]];
+				continue;
+			}
+			constant[k].assign(nPoints, bl.compiled->getParameters()[k]->getVal());
+			in[k] = &constant[k][0];
+		}
+		int n = bl.th.size();
+		r.resize(n);
+		res.resize(n);
+		for ( int i=0; i<n; i++ ){
+			r[i].resize(nPoints);
+			res[i] = &r[i][0];
+		}
+		bl.compiled->evaluate(nPoints, in.empty() ? 0 : &in[0], &res[0]);
+
+		// residuals
+		for ( int i=0; i<n; i++ ){
+			double obs = bl.obs[i]->getVal();
+			double* ri = res[i];
+			for ( int p=0; p<nPoints; p++ ) ri[p] = obs - ri[p];
+		}
+
+		// r^T C^-1 r, using the symmetry of C^-1
+		for ( int i=0; i<n; i++ ){
+			const double* ri = res[i];
+			for ( int j=i; j<n; j++ ){
+				const double* rj = res[j];
+				double c = i==j ? bl.covI(i,j) : 2.*bl.covI(i,j);
+				for ( int p=0; p<nPoints; p++ ) chi2[p] += c*ri[p]*rj[p];
+			}
+		}
+	}
+	profileCount("GaussianChi2::evaluate blocks per point", perPoint.size());
+	if ( perPoint.empty() ) return;
+
+	vector<double> saved(pars.size());
+	vector<double> xp(pars.size());
+	for ( unsigned int k=0; k<pars.size(); k++ ) saved[k] = pars[k]->getVal();
+	for ( int p=0; p<nPoints; p++ ){
+		for ( unsigned int k=0; k<pars.size(); k++ ) xp[k] = x[k][p];
+		setParameters(xp.data());
+		for ( unsigned int l=0; l<perPoint.size(); l++ ) chi2[p] += blockChi2(perPoint[l]);
+	}
+	setParameters(saved.data());
+}
+
+///
+/// The gradient 2 J^T C^-1 r. The derivatives of the residuals are
+/// central differences, evaluating only the relations that depend
+/// on the parameter. Steps stay inside the parameter ranges.
+///
+void GaussianChi2::Gradient(const double* x, double* grad) const
+{
+	profileCount("GaussianChi2::Gradient");
+	setParameters(x);
+	vector<vector<double> > r;
+	residuals(r);
+
+	// C^-1 r per block
+	vector<vector<double> > w(blocks.size());
+	for ( unsigned int b=0; b<blocks.size(); b++ ) weightedResiduals(b, r[b], w[b]);
+
+	for ( unsigned int k=0; k<pars.size(); k++ ) grad[k] = derivative(x, k, w);
+}
+
+///
+/// One component of the gradient, see Gradient(). Only the Gaussians
+/// depending on the parameter are evaluated, so Minuit asking for single
+/// components doesn't cost a full gradient each.
+///
+double GaussianChi2::DoDerivative(const double* x, unsigned int icoord) const
+{
+	profileCount("GaussianChi2::DoDerivative");
+	if ( deps[icoord].empty() ) return 0.;
+	setParameters(x);
+	vector<vector<double> > w(blocks.size());
+	vector<double> r;
+	const vector<int>& bs = parBlocks[icoord];
+	for ( unsigned int l=0; l<bs.size(); l++ ){
+		residuals(bs[l], r);
+		weightedResiduals(bs[l], r, w[bs[l]]);
+	}
+	return derivative(x, icoord, w);
+}
+
+///
+/// C^-1 r of one Gaussian.
+///
+/// \param b - index of the Gaussian
+/// \param r - its residuals
+/// \param w - set to C^-1 r
+///
+void GaussianChi2::weightedResiduals(int b, const vector<double>& r, vector<double>& w) const
+{
+	const TMatrixDSym& covI = blocks[b].covI;
+	w.assign(r.size(), 0.);
+	for ( unsigned int i=0; i<r.size(); i++ ){
+		for ( unsigned int j=0; j<r.size(); j++ ) w[i] += covI(i,j)*r[j];
+	}
+}
+
+///
+/// The derivative of the chi2 in parameter k, 2 J_k^T C^-1 r, with the
+/// parameters set to x.
+///
+/// \param w - C^-1 r per Gaussian, needed for those depending on parameter k
+///
+double GaussianChi2::derivative(const double* x, int k, const vector<vector<double> >& w) const
+{
+	const vector<Dependency>& d = deps[k];
+	if ( d.empty() ) return 0.;
+	RooRealVar* p = pars[k];
+	double h = 1e-5*TMath::Max(1., fabs(x[k]));
+	double hi = TMath::Min(x[k]+h, p->getMax());
+	double lo = TMath::Max(x[k]-h, p->getMin());
+	vector<double> up, down;
+	p->setVal(hi);
+	residuals(d, up);
+	p->setVal(lo);
+	residuals(d, down);
+	p->setVal(x[k]);
+	double grad = 0.;
+	for ( unsigned int l=0; l<d.size(); l++ ){
+		grad += 2.*w[d[l].block][d[l].i]*(up[l]-down[l])/(hi-lo);
+	}
+	return grad;
+}
+
+///
+/// Minimize the chi2 with Minuit2 Migrad, using the gradient, and
+/// leave the parameters at the minimum, like Utils::fitToMin() does.
+/// The settings follow those of Utils::fitToMin().
+///
+/// \param thorough - run Hesse after Migrad
+/// \param printLevel - -1 = no output, 1 verbose output
+/// \return a new fit result, or 0 if Minuit2 isn't available
+///
+RooFitResult* GaussianChi2::minimize(bool thorough, int printLevel)
+{
+	ProfileTimer pt("GaussianChi2::minimize");
+	assert(valid);
+	ROOT::Math::Minimizer* m = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
+	if ( !m ) return 0;
+	m->SetPrintLevel(printLevel<0 ? 0 : printLevel);
+	m->SetErrorDef(1.0);
+	m->SetStrategy(2);
+	m->SetMaxFunctionCalls(500*pars.size());
+	m->SetMaxIterations(500*pars.size());
+	m->SetFunction(*this);
+
+	RooArgList floating;
+	for ( unsigned int k=0; k<pars.size(); k++ ){
+		RooRealVar* p = pars[k];
+		floating.add(*p);
+		double step = p->getError()>0 ? p->getError() : 0.1*(p->getMax()-p->getMin());
+		if ( !p->hasMin() || !p->hasMax() ){
+			if ( p->getError()<=0 ) step = 1.;
+			m->SetVariable(k, p->GetName(), p->getVal(), step);
+		}
+		else m->SetLimitedVariable(k, p->GetName(), p->getVal(), step, p->getMin(), p->getMax());
+	}
+	RooArgSet* params = pdf->getParameters((RooArgSet*)0);
+	RooArgList constants;
+	TIterator* it = params->createIterator();
+	while ( RooAbsArg* a = (RooAbsArg*)it->Next() ){
+		if ( a->isConstant() ) constants.add(*a);
+	}
+	delete it;
+
+	GaussianChi2FitResult* r = new GaussianChi2FitResult(TString("fitresult_")+pdf->GetName());
+	r->setConstParList(constants);
+	r->setInitParList(floating);
+	delete params;
+
+	m->Minimize();
+	int status = m->Status();
+	if ( thorough ) m->Hesse();
+
+	// leave the parameters at the minimum
+	const double* xMin = m->X();
+	const double* errors = m->Errors();
+	for ( unsigned int k=0; k<pars.size(); k++ ){
+		pars[k]->setVal(xMin[k]);
+		pars[k]->setError(errors[k]);
+	}
+	TMatrixDSym cov(pars.size());
+	for ( unsigned int i=0; i<pars.size(); i++ ){
+		for ( unsigned int j=0; j<pars.size(); j++ ) cov(i,j) = m->CovMatrix(i,j);
+	}
+	r->setFinalParList(floating);
+	r->setMinNLL(m->MinValue());
+	r->setEDM(m->Edm());
+	r->setStatus(status);
+	r->setCovQual(m->CovMatrixStatus());
+	r->setNumInvalidNLL(0);
+	r->setCovarianceMatrix(cov);
+	delete m;
+	return r;
+}
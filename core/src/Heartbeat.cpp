@@ -0,0 +1,162 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "Heartbeat.h"
+
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+
+#include "TMath.h"
+#include "TSystem.h"
+
+///
+/// \param fileName - the heartbeat file, e.g. the output file with
+///                   the extension replaced by .heartbeat.json
+/// \param nTotal - number of steps the job will do
+/// \param interval - minimum number of seconds between two writes
+///
+Heartbeat::Heartbeat(TString fileName, unsigned int nTotal, int interval)
+{
+	this->fileName = fileName;
+	this->nTotal = nTotal;
+	this->interval = interval;
+	nDone = 0;
+	nFits = 0;
+	nFitsFailed = 0;
+	scanpoint = 0.;
+	scanpointy = 0.;
+	nScanpoint = 0;
+	start = chrono::steady_clock::now();
+	lastWrite = start;
+	lock_guard<mutex> guard(lock);
+	write(false);
+}
+
+///
+/// Writes the final heartbeat, with status "done".
+///
+Heartbeat::~Heartbeat()
+{
+	lock_guard<mutex> guard(lock);
+	write(true);
+}
+
+///
+/// The heartbeat file of a job writing the given output file:
+/// its .root extension replaced by .heartbeat.json.
+///
+TString Heartbeat::getFileName(TString outputFile)
+{
+	if ( outputFile.EndsWith(".root") ) outputFile.Remove(outputFile.Length()-5);
+	return outputFile+".heartbeat.json";
+}
+
+///
+/// Count finished steps, usually toys.
+///
+void Heartbeat::step(unsigned int n)
+{
+	lock_guard<mutex> guard(lock);
+	nDone += n;
+	writeIfDue();
+}
+
+///
+/// Count a fit, failed if its status is not 0 (see Fitter::getStatus()).
+///
+void Heartbeat::fitDone(int status)
+{
+	lock_guard<mutex> guard(lock);
+	nFits++;
+	if ( status!=0 ) nFitsFailed++;
+}
+
+///
+/// Count several fits at once, e.g. those of other worker processes.
+///
+/// \param n - number of fits
+/// \param nFailed - of those, fits with a status other than 0
+///
+void Heartbeat::fitsDone(int n, int nFailed)
+{
+	lock_guard<mutex> guard(lock);
+	nFits += n;
+	nFitsFailed += nFailed;
+}
+
+///
+/// Set the scan point the job is working on.
+///
+void Heartbeat::setScanpoint(double scanpoint)
+{
+	lock_guard<mutex> guard(lock);
+	this->scanpoint = scanpoint;
+	nScanpoint = 1;
+	writeIfDue();
+}
+
+///
+/// Set the scan point of a 2D scan.
+///
+void Heartbeat::setScanpoint(double scanpoint, double scanpointy)
+{
+	lock_guard<mutex> guard(lock);
+	this->scanpoint = scanpoint;
+	this->scanpointy = scanpointy;
+	nScanpoint = 2;
+	writeIfDue();
+}
+
+///
+/// Write if the last write is at least interval seconds ago.
+/// Call with the lock held.
+///
+void Heartbeat::writeIfDue()
+{
+	if ( chrono::steady_clock::now()-lastWrite < chrono::seconds(interval) ) return;
+	write(false);
+}
+
+///
+/// A number for the JSON file: JSON has no nan or inf, these are
+/// written as null.
+///
+TString Heartbeat::jsonNumber(double x)
+{
+	if ( !TMath::Finite(x) ) return "null";
+	return Form("%.6g", x);
+}
+
+///
+/// Write the heartbeat file. It is written under a temporary name and
+/// then renamed, so that readers never see a partial file. Call with
+/// the lock held.
+///
+void Heartbeat::write(bool done)
+{
+	lastWrite = chrono::steady_clock::now();
+	double elapsed = chrono::duration<double>(lastWrite-start).count();
+	double rate = elapsed>0. ? nDone/elapsed : 0.;
+	ProcInfo_t info;
+	gSystem->GetProcInfo(&info);
+
+	TString tmpName = fileName+".tmp";
+	FILE* f = fopen(tmpName.Data(), "w");
+	if ( !f ) return; // monitoring must never stop the job
+	fprintf(f, "{\"status\": \"%s\", \"pid\": %i, \"host\": \"%s\", \"updated\": %li, \"elapsed\": %.1f, ",
+			done ? "done" : "running", (int)getpid(), gSystem->HostName(), (long)time(0), elapsed);
+	fprintf(f, "\"stepsDone\": %u, \"stepsTotal\": %u, \"stepsPerSecond\": %.3f, ", nDone, nTotal, rate);
+	if ( rate>0. && nDone<nTotal ) fprintf(f, "\"eta\": %.1f, ", (nTotal-nDone)/rate);
+	else fprintf(f, "\"eta\": %s, ", nDone>=nTotal ? "0" : "null");
+	fprintf(f, "\"fits\": %lli, \"fitsFailed\": %lli, \"fitFailureRate\": %.4f, ",
+			nFits, nFitsFailed, nFits>0 ? nFitsFailed/(double)nFits : 0.);
+	if ( nScanpoint==2 ) fprintf(f, "\"scanpoint\": [%s, %s], ", jsonNumber(scanpoint).Data(), jsonNumber(scanpointy).Data());
+	else if ( nScanpoint==1 ) fprintf(f, "\"scanpoint\": [%s], ", jsonNumber(scanpoint).Data());
+	else fprintf(f, "\"scanpoint\": null, ");
+	fprintf(f, "\"rssMB\": %.1f}\n", info.fMemResident/1024.);
+	fclose(f);
+	rename(tmpName.Data(), fileName.Data());
+}
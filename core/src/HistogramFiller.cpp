@@ -0,0 +1,263 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include <cstdlib>
+#include <limits>
+#include <thread>
+
+#include "HistogramFiller.h"
+#include "Profiler.h"
+#include "RVersion.h"
+#include "TChainElement.h"
+#include "TROOT.h"
+
+// Reading one file from several threads needs ROOT::EnableThreadSafety().
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+#define HISTOGRAMFILLER_THREADS
+#endif
+
+///
+/// \param t - the tree to read. The tree is only read through its
+///            leaves, so branch addresses set by the caller (e.g. a
+///            ToyTree) stay valid.
+/// \param nThreads - number of threads. Only used if t is a TChain,
+///            in which case every thread opens its own chain of the
+///            same files and reads a contiguous block of entries.
+///
+HistogramFiller::HistogramFiller(TTree* t, int nThreads)
+{
+	this->t = t;
+	this->nThreads = nThreads;
+	nRangesDone = 0;
+}
+
+HistogramFiller::~HistogramFiller()
+{}
+
+///
+/// Book a branch. Its value is available to selections and
+/// expressions at the returned index. Booking a branch twice
+/// returns the same index. Branches that don't exist read as 0.
+///
+int HistogramFiller::column(TString branchName)
+{
+	for ( unsigned int i=0; i<columns.size(); i++ ){
+		if ( columns[i]==branchName ) return i;
+	}
+	if ( !t->GetBranch(branchName) ){
+		cout << "HistogramFiller::column() : WARNING : branch " << branchName << " not found in tree " << t->GetName() << ". Using 0." << endl;
+	}
+	columns.push_back(branchName);
+	return columns.size()-1;
+}
+
+///
+/// Book a 1D histogram, filled with x for every entry passing sel.
+/// The histogram is filled in the next run(). Returns h.
+///
+TH1* HistogramFiller::book(TH1* h, Selection sel, Expression x)
+{
+	Booking b;
+	b.h = h;
+	b.sel = sel;
+	b.x = x;
+	bookings.push_back(b);
+	return h;
+}
+
+///
+/// Book a 2D histogram, filled with (x,y) for every entry passing sel.
+/// The histogram is filled in the next run(). Returns h.
+///
+TH2* HistogramFiller::book(TH2* h, Selection sel, Expression x, Expression y)
+{
+	Booking b;
+	b.h = h;
+	b.sel = sel;
+	b.x = x;
+	b.y = y;
+	bookings.push_back(b);
+	return h;
+}
+
+///
+/// Book the range of x over all entries passing sel. The range is
+/// determined in the next run(), then available through getRange().
+/// Returns its id.
+///
+int HistogramFiller::bookRange(Selection sel, Expression x)
+{
+	Range r;
+	r.sel = sel;
+	r.x = x;
+	r.min = numeric_limits<double>::max();
+	r.max = -numeric_limits<double>::max();
+	r.n = 0;
+	ranges.push_back(r);
+	return ranges.size()-1;
+}
+
+///
+/// Get a range booked by bookRange(). Both ends are 0 if no
+/// entry passed the selection.
+///
+void HistogramFiller::getRange(int id, float& min, float& max) const
+{
+	if ( id<0 || id>=(int)nRangesDone ){
+		cout << "HistogramFiller::getRange() : ERROR : range " << id << " not filled yet. Call run() first." << endl;
+		exit(1);
+	}
+	const Range& r = ranges[id];
+	min = r.n>0 ? r.min : 0;
+	max = r.n>0 ? r.max : 0;
+}
+
+///
+/// Number of entries that passed the selection of a range.
+///
+Long64_t HistogramFiller::getRangeEntries(int id) const
+{
+	if ( id<0 || id>=(int)nRangesDone ){
+		cout << "HistogramFiller::getRangeEntries() : ERROR : range " << id << " not filled yet. Call run() first." << endl;
+		exit(1);
+	}
+	return ranges[id].n;
+}
+
+///
+/// Files of the tree, if it is a TChain, else an empty list.
+///
+vector<TString> HistogramFiller::getFileNames() const
+{
+	vector<TString> files;
+	if ( !t->InheritsFrom(TChain::Class()) ) return files;
+	TObjArray *elements = ((TChain*)t)->GetListOfFiles();
+	for ( int i=0; i<elements->GetEntries(); i++ ){
+		files.push_back(((TChainElement*)elements->At(i))->GetTitle());
+	}
+	return files;
+}
+
+///
+/// Loop over the entries [first,last) of a tree and fill the given
+/// histograms and ranges, which belong one-to-one to the bookings and
+/// to the ranges not yet done.
+///
+void HistogramFiller::process(TTree* tree, Long64_t first, Long64_t last,
+		vector<TH1*>& hists, vector<Range>& todo) const
+{
+	vector<double> row(columns.size(), 0.);
+	vector<TLeaf*> leaves(columns.size(), 0);
+	int treeNumber = -1;
+	for ( Long64_t i=first; i<last; i++ ){
+		Long64_t local = tree->LoadTree(i);
+		if ( local<0 ) break;
+		if ( tree->GetTreeNumber()!=treeNumber ){
+			treeNumber = tree->GetTreeNumber();
+			for ( unsigned int c=0; c<columns.size(); c++ ) leaves[c] = tree->GetTree()->GetLeaf(columns[c]);
+		}
+		for ( unsigned int c=0; c<columns.size(); c++ ){
+			if ( !leaves[c] ) continue;
+			leaves[c]->GetBranch()->GetEntry(local);
+			row[c] = leaves[c]->GetValue();
+		}
+		const double *r = &row[0];
+		for ( unsigned int j=0; j<bookings.size(); j++ ){
+			const Booking& b = bookings[j];
+			if ( !b.sel(r) ) continue;
+			if ( b.y ) ((TH2*)hists[j])->Fill(b.x(r), b.y(r));
+			else hists[j]->Fill(b.x(r));
+		}
+		for ( unsigned int j=0; j<todo.size(); j++ ){
+			Range& rg = todo[j];
+			if ( !rg.sel(r) ) continue;
+			double x = rg.x(r);
+			if ( x<rg.min ) rg.min = x;
+			if ( x>rg.max ) rg.max = x;
+			rg.n++;
+		}
+	}
+}
+
+///
+/// Fill all histograms and ranges booked since the last run()
+/// in one pass over the tree.
+///
+void HistogramFiller::run()
+{
+	if ( bookings.empty() && nRangesDone==ranges.size() ) return;
+	ProfileTimer pt("HistogramFiller::run");
+
+	vector<Range> todo(ranges.begin()+nRangesDone, ranges.end());
+	vector<TH1*> hists;
+	for ( unsigned int j=0; j<bookings.size(); j++ ) hists.push_back(bookings[j].h);
+
+	Long64_t nEntries = t->GetEntries();
+	vector<TString> files = getFileNames();
+	int nUsed = 1;
+	#ifdef HISTOGRAMFILLER_THREADS
+	if ( files.size()>0 && nThreads>1 ) nUsed = nThreads;
+	if ( nEntries<1000*nUsed ) nUsed = 1;  // not worth the overhead of opening the files again
+	#endif
+
+	if ( nUsed==1 ){
+		// read the tree itself, make sure the booked branches are active
+		vector<bool> status;
+		for ( unsigned int c=0; c<columns.size(); c++ ){
+			bool exists = t->GetBranch(columns[c])!=0;
+			status.push_back(exists ? t->GetBranchStatus(columns[c]) : true);
+			if ( exists ) t->SetBranchStatus(columns[c], 1);
+		}
+		process(t, 0, nEntries, hists, todo);
+		for ( unsigned int c=0; c<columns.size(); c++ ){
+			if ( !status[c] ) t->SetBranchStatus(columns[c], 0);
+		}
+	}
+	#ifdef HISTOGRAMFILLER_THREADS
+	else {
+		ROOT::EnableThreadSafety();
+		vector<vector<TH1*> >  threadHists(nUsed);
+		vector<vector<Range> > threadRanges(nUsed, todo);
+		for ( int k=0; k<nUsed; k++ ){
+			for ( unsigned int j=0; j<hists.size(); j++ ){
+				TH1* h = (TH1*)hists[j]->Clone(Form("%s_thread%i", hists[j]->GetName(), k));
+				h->SetDirectory(0);
+				h->Reset();
+				threadHists[k].push_back(h);
+			}
+		}
+		TString treeName = t->GetName();
+		vector<thread> workers;
+		for ( int k=0; k<nUsed; k++ ){
+			Long64_t first = nEntries*k/nUsed;
+			Long64_t last = nEntries*(k+1)/nUsed;
+			workers.push_back(thread([this, k, first, last, &files, &treeName, &threadHists, &threadRanges](){
+				TChain chain(treeName);
+				for ( unsigned int i=0; i<files.size(); i++ ) chain.Add(files[i]);
+				process(&chain, first, last, threadHists[k], threadRanges[k]);
+			}));
+		}
+		for ( unsigned int k=0; k<workers.size(); k++ ) workers[k].join();
+
+		// merge in thread order, so the result doesn't depend on timing
+		for ( int k=0; k<nUsed; k++ ){
+			for ( unsigned int j=0; j<hists.size(); j++ ){
+				hists[j]->Add(threadHists[k][j]);
+				delete threadHists[k][j];
+			}
+			for ( unsigned int j=0; j<todo.size(); j++ ){
+				const Range& rg = threadRanges[k][j];
+				if ( rg.min<todo[j].min ) todo[j].min = rg.min;
+				if ( rg.max>todo[j].max ) todo[j].max = rg.max;
+				todo[j].n += rg.n;
+			}
+		}
+	}
+	#endif
+
+	for ( unsigned int j=0; j<todo.size(); j++ ) ranges[nRangesDone+j] = todo[j];
+	nRangesDone = ranges.size();
+	bookings.clear();
+}
@@ -6,6 +6,7 @@
  */
 
 #include "MethodAbsScan.h"
+#include "Profiler.h"
 
     MethodAbsScan::MethodAbsScan()
 	: rndm()
@@ -295,6 +296,7 @@ void MethodAbsScan::initScan()
 ///
 void MethodAbsScan::saveScanner(TString fName)
 {
+	ProfileTimer pt("MethodAbsScan::saveScanner");
 	if ( fName=="" ){
 		FileNameBuilder fb(arg);
 		fName = fb.getFileNameScanner(this);
@@ -331,6 +333,7 @@ void MethodAbsScan::saveScanner(TString fName)
 ///
 bool MethodAbsScan::loadScanner(TString fName)
 {
+	ProfileTimer pt("MethodAbsScan::loadScanner");
 	if ( fName=="" ){
 		FileNameBuilder fb(arg);
 		fName = fb.getFileNameScanner(this);
@@ -1306,7 +1309,7 @@ void MethodAbsScan::confirmSolutions()
 	if ( arg->debug ) printLocalMinima();
 	removeDuplicateSolutions();
 	// reset parameters
-	setParameters(w, parsName, frCache.getParsAtFunctionCall());
+	frCache.getParsAtFunctionCall().apply();
 }
 
 ///
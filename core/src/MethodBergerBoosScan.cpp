@@ -22,6 +22,8 @@
 		this->dir           = d;
 	}
 	nBBPoints           = 1;
+	useCrn              = false;
+	useHalton           = false;
 	//std::cout << "open the file" << std::endl;
 	TString fName;
 	if(this->dir == "XX"){
@@ -376,6 +378,26 @@ int MethodBergerBoosScan::scan1d(int nRun)
 	frCache.storeParsAtFunctionCall(w->set(parsName));
 	frCache.initRoundRobinDB(w->set(parsName));
 
+	// Pair the observables with their theory predictions, to shift
+	// the toys for common random numbers (setCommonRandomNumbers()).
+	vector<RooRealVar*> crnObs;
+	vector<RooAbsReal*> crnTh;
+	if ( useCrn ){
+		TIterator* it = w->set(obsName)->createIterator();
+		while ( RooRealVar* pObs = (RooRealVar*)it->Next() ){
+			TString thName = pObs->GetName();
+			thName.ReplaceAll("_obs","_th");
+			if ( !w->function(thName) ){
+				cout << "MethodBergerBoosScan::scan1d() : WARNING : no theory prediction for observable "
+					<< pObs->GetName() << ", its toys are not shifted." << endl;
+				continue;
+			}
+			crnObs.push_back(pObs);
+			crnTh.push_back(w->function(thName));
+		}
+		delete it;
+	}
+
 	// for the progress bar: if more than 100 steps, show 50 status messages.
 	int allSteps = nPoints1d*nToys*nBBPoints;
 	float printFreq = allSteps>51 ? 50 : allSteps;
@@ -394,6 +416,11 @@ int MethodBergerBoosScan::scan1d(int nRun)
 		// don't scan in unphysical region
 		if ( scanpoint < par->getMin() || scanpoint > par->getMax() ) continue;
 
+		// with common random numbers, the toys of the first Berger Boos
+		// point are used at all of them
+		RooDataSet *toyDataSet = 0;
+		vector<double> th0(crnTh.size());
+
 		for(int ii=0; ii<nBBPoints; ii++) // Berger Boos nuisance Loop
 		{
 			// Store BergerBoos_id to tree to be able to separate the Berger Boos
@@ -409,8 +436,9 @@ int MethodBergerBoosScan::scan1d(int nRun)
 
 			if(ii>0){
 				// From the second point in the nuisance parameter space onwards, new points are drawn randomly
-				// from their Berger Boos ranges
-				this->setNewBergerBoosPoint(StepCounter);
+				// from their Berger Boos ranges, or placed on a Halton sequence
+				if ( useHalton ) this->setHaltonBergerBoosPoint(ii);
+				else this->setNewBergerBoosPoint(StepCounter);
 				//continue;
 			}
 			StepCounter++;
@@ -430,7 +458,18 @@ int MethodBergerBoosScan::scan1d(int nRun)
 			t.chi2minGlobal = profileLH->getChi2minGlobal();
 
 			// Draw all toy datasets in advance. This is much faster.
-			RooDataSet *toyDataSet = w->pdf(pdfName)->generate(*w->set(obsName), nToys, AutoBinned(false));
+			// With common random numbers, the toys of the first point get shifted
+			// by the change of the theory predictions: for Gaussian measurements,
+			// this is the same as generating them here with the same random draws.
+			vector<double> crnShift(crnTh.size(), 0.);
+			if ( !toyDataSet ){
+				toyDataSet = w->pdf(pdfName)->generate(*w->set(obsName), nToys, AutoBinned(false));
+				for ( int k=0; k<crnTh.size(); k++ ) th0[k] = crnTh[k]->getVal();
+			}
+			else{
+				for ( int k=0; k<crnTh.size(); k++ ) crnShift[k] = crnTh[k]->getVal() - th0[k];
+			}
+			ParameterBinding toyObs(w->set(obsName), toyDataSet->get()); // get(j) loads into the same RooArgSet
 
 			for ( int j = 0; j<nToys; j++ )
 			{
@@ -444,8 +483,9 @@ int MethodBergerBoosScan::scan1d(int nRun)
 				// 1. Generate toys
 				//    (or select the right one)
 				//
-				const RooArgSet* toyData = toyDataSet->get(j);
-				setParameters(w, obsName, toyData);
+				toyDataSet->get(j);
+				toyObs.apply();
+				for ( int k=0; k<crnObs.size(); k++ ) crnObs[k]->setVal(crnObs[k]->getVal()+crnShift[k]);
 				t.storeObservables();
 
 				//
@@ -479,10 +519,14 @@ int MethodBergerBoosScan::scan1d(int nRun)
 			}
 
 			// reset
-			setParameters(w, parsName, frCache.getParsAtFunctionCall());
+			frCache.getParsAtFunctionCall().apply();
 			setParameters(w, obsName, obsDataset->get(0));
-			delete toyDataSet;
+			if ( !useCrn ){
+				delete toyDataSet;
+				toyDataSet = 0;
+			}
 		}
+		if ( toyDataSet ) delete toyDataSet;
 	}
 	myFit->print();
 	t.writeToFile();
@@ -506,3 +550,54 @@ void MethodBergerBoosScan::setNewBergerBoosPoint(int m){
 	}
 	delete iter;
 };
+
+///
+/// Set all parameters to the m-th point of a Halton sequence over the
+/// Berger Boos box, the range of each parameter in the BBTree. Unlike
+/// random points, the sequence covers the box evenly already for few
+/// points, and gives the same points at every scan point. The scan
+/// parameter gets no dimension of the sequence, it is set to the scan
+/// point afterwards.
+///
+/// \param m - index of the point, starting at 1
+///
+void MethodBergerBoosScan::setHaltonBergerBoosPoint(int m){
+	TIterator* iter           = w->set(parsName)->createIterator();
+	int base                  = 1;
+	while ( RooRealVar* par   = (RooRealVar*)iter->Next() ) {
+		if ( TString(par->GetName())==scanVar1 ) continue;
+		// next prime as the base of this dimension
+		bool isPrime = false;
+		while ( !isPrime ){
+			base++;
+			isPrime = true;
+			for ( int d=2; d*d<=base; d++ ) if ( base%d==0 ) isPrime = false;
+		}
+		TString name = par->GetName();
+		if ( bbBox.find(name)==bbBox.end() ){
+			if ( !BBtree || !BBtree->GetBranch(name) ){
+				cout << "MethodBergerBoosScan::setHaltonBergerBoosPoint() : ERROR : parameter not found in BBTree: " << name << endl;
+				exit(1);
+			}
+			bbBox[name] = make_pair(BBtree->GetMinimum(name), BBtree->GetMaximum(name));
+		}
+		const pair<double,double>& range = bbBox[name];
+		par->setVal(range.first + halton(m, base)*(range.second-range.first));
+	}
+	delete iter;
+};
+
+///
+/// The index-th element of the Halton sequence (van der Corput
+/// sequence) in a given base, in [0,1).
+///
+double MethodBergerBoosScan::halton(int index, int base){
+	double f = 1.;
+	double r = 0.;
+	while ( index>0 ){
+		f /= base;
+		r += f*(index%base);
+		index /= base;
+	}
+	return r;
+};
@@ -1,4 +1,5 @@
 #include "MethodCoverageScan.h"
+#include "Profiler.h"
 
 MethodCoverageScan::MethodCoverageScan(Combiner *comb)
   : MethodAbsScan(comb)
@@ -88,9 +89,33 @@ int MethodCoverageScan::scan1d(int nRun)
 	//OneMinusClPlot *plot = 0;
 	//if ( arg->isAction("test") ) plot = new OneMinusClPlot(arg, "coveragetest_plugin_omcl");
 
+  TString idStr = arg->id<0 ? "0" : Form("%d",arg->id);
+  TString dirname = "root/scan1dCoverage_"+name+"_"+scanVar1+"_id"+idStr;
+  TString fileName = Form(dirname+"/scan1dCoverage_"+name+"_"+scanVar1+"_id"+idStr+"_run%i.root", nRun);
+  system("mkdir -p "+dirname);
+
+  // Distribute the toys over worker processes (--coverageworkers). Each worker
+  // is a fork with its own copy of the combiner, and runs every
+  // nWorkers-th toy. The first worker is this process.
+  // Every worker gets its own seed, derived from one of the whole run.
+  int nWorkers = TMath::Max(1, TMath::Min(arg->coverageworkers, nToys));
+  RooRandom::randomGenerator()->SetSeed(0);
+  UInt_t runSeed = RooRandom::randomGenerator()->Integer(kMaxUInt);
+  vector<pid_t> workers;
+  int iWorker = forkWorkers(nWorkers, workers);
+  if ( iWorker<0 ){
+    cout << "MethodCoverageScan::scan1d() : ERROR : could not start the coverage workers" << endl;
+    exit(1);
+  }
+  seedWorker(runSeed, iWorker);
+
+  // one plugin scanner per worker, it gets the observed values of each toy
+  MethodPluginScan *scanner = new MethodPluginScan(combiner);
+
 	// toy loop
-	for ( int i=0; i<nToys; i++ )
+	for ( int i=iWorker; i<nToys; i+=nWorkers )
 	{
+		ProfileTimer pt("MethodCoverageScan::toy");
 		cout << "ITOY = " << i << endl;
 		tId = i;
 		RooWorkspace *w = combiner->getWorkspace();
@@ -153,7 +178,7 @@ int MethodCoverageScan::scan1d(int nRun)
     }
 
 		cout << "SCAN" << endl;
-		setParameters(w, parName, frCache.getParsAtFunctionCall());
+		frCache.getParsAtFunctionCall().apply();
 		w->var(varName)->setConstant(true);
 		RooFitResult* rToyScanFull = fitToMinForce(w, pdfName, forceVariables);
 		if ( !rToyScanFull ) continue;
@@ -163,7 +188,7 @@ int MethodCoverageScan::scan1d(int nRun)
 		w->var(varName)->setConstant(false);
 		delete rToyScanFull;
 
-		setParameters(w, parName, frCache.getParsAtFunctionCall());
+		frCache.getParsAtFunctionCall().apply();
 
 		//
 		// draw chi2
@@ -176,7 +201,7 @@ int MethodCoverageScan::scan1d(int nRun)
 		//
 		// compute p-value of the Plugin method
 		//
-		MethodPluginScan *scanner = new MethodPluginScan(combiner);
+		scanner->storeObservables();
 		tPvalue = scanner->getPvalue1d(rToyScan, tChi2free, myTree, i);
 		cout << "P VALUE IS " << tPvalue << endl;
 		hPvalues->Fill(tPvalue);
@@ -216,14 +241,35 @@ int MethodCoverageScan::scan1d(int nRun)
 		//
 		delete rToyScan;
 		delete rToyFree;
-		if ( !arg->isAction("test") ) delete scanner;
 	}
+  delete scanner;
+
+  // every worker saves its toys, the first one waits for the others
+  if ( nWorkers>1 ){
+    TFile *fw = new TFile(workerFileName(fileName, iWorker), "recreate");
+    t->Write();
+    fw->Close();
+    if ( iWorker>0 ) exitWorker(iWorker);
+    waitForWorkers(workers);
+  }
 
   // save trees
-  TString idStr = arg->id<0 ? "0" : Form("%d",arg->id);
-  TString dirname = "root/scan1dCoverage_"+name+"_"+scanVar1+"_id"+idStr;
-  system("mkdir -p "+dirname);
-  TFile *f = new TFile(Form(dirname+"/scan1dCoverage_"+name+"_"+scanVar1+"_id"+idStr+"_run%i.root", nRun), "recreate");
+  TFile *f = new TFile(fileName, "recreate");
+  if ( nWorkers>1 ){
+    t = mergeWorkerFiles("coverage", fileName, nWorkers, "id");
+    // the monitoring histograms only saw the toys of this worker
+    hDeltaChi2->Reset();
+    hPvalues->Reset();
+    t->SetBranchAddress("chi2free", &tChi2free);
+    t->SetBranchAddress("chi2scan", &tChi2scan);
+    t->SetBranchAddress("pvalue",   &tPvalue);
+    for ( Long64_t i=0; i<t->GetEntries(); i++ ){
+      t->GetEntry(i);
+      hDeltaChi2->Fill(tChi2scan-tChi2free);
+      hPvalues->Fill(tPvalue);
+    }
+    t->ResetBranchAddresses();
+  }
   t->Write();
   f->Close();
   return 0;
@@ -14,9 +14,11 @@
  */
 
 #include "MethodDatasetsPluginScan.h"
+#include "Profiler.h"
 #include "TRandom3.h"
 #include "TArrow.h"
 #include "TLatex.h"
+#include "TVectorD.h"
 #include <algorithm>
 #include <ios>
 #include <iomanip>
@@ -199,16 +201,60 @@ void MethodDatasetsPluginScan::checkExtProfileLH() {
 ///
 ////////////////////////////////////////////////////
 RooFitResult* MethodDatasetsPluginScan::loadAndFit(PDF_Datasets* pdf) {
+    return loadAndFit(pdf, pdf->globalObsToySnapshotName);
+};
+
+///
+/// Same as above, but loads the global observables from the given snapshot.
+///
+RooFitResult* MethodDatasetsPluginScan::loadAndFit(PDF_Datasets* pdf, const TString& globalObsSnapshotName) {
     // we want to fit to the latest simulated toys
     // first, try to simulated toy values of the global observables from a snapshot
-    if (!w->loadSnapshot(pdf->globalObsToySnapshotName)) {
-        std::cout << "FATAL in MethodDatasetsPluginScan::loadAndFit() - No snapshot globalObsToySnapshotName found!\n" << std::endl;
+    if (!w->loadSnapshot(globalObsSnapshotName)) {
+        std::cout << "FATAL in MethodDatasetsPluginScan::loadAndFit() - No snapshot " << globalObsSnapshotName << " found!\n" << std::endl;
         exit(EXIT_FAILURE);
     };
     // then, fit the pdf while passing it the simulated toy dataset
     return pdf->fit(pdf->getToyObservables());
 };
 
+///
+/// Fit the signal+background pdf to a background-only toy, using the
+/// global observables that were generated together with that toy.
+/// Retries with fit strategies 1 and 2 if the fit fails. Leaves the
+/// background-only toy set as toy data of the pdf.
+///
+/// \param bkgToy           the background-only toy dataset
+/// \param bkgToyGlobalObs  the global observables belonging to the toy
+///
+RooFitResult* MethodDatasetsPluginScan::fitBkgOnlyToy(RooDataSet* bkgToy, const RooArgSet* bkgToyGlobalObs) {
+    w->saveSnapshot(pdf->globalObsBkgToySnapshotName, *bkgToyGlobalObs, kTRUE);
+    pdf->setToyData( bkgToy );
+    pdf->setFitStrategy(0);
+    RooFitResult* rb = loadAndFit(pdf, pdf->globalObsBkgToySnapshotName);
+    assert(rb);
+    if (pdf->getFitStatus() != 0) {
+        pdf->setFitStrategy(1);
+        delete rb;
+        rb = loadAndFit(pdf, pdf->globalObsBkgToySnapshotName);
+        assert(rb);
+        if (pdf->getFitStatus() != 0) {
+            pdf->setFitStrategy(2);
+            delete rb;
+            rb = loadAndFit(pdf, pdf->globalObsBkgToySnapshotName);
+            assert(rb);
+        }
+    }
+    if (std::isinf(pdf->minNll) || std::isnan(pdf->minNll)) {
+        cout  << "++++ > background-only toy fit gives inf/nan: "  << endl
+              << "++++ > minNll: " << pdf->minNll << endl
+              << "++++ > status: " << pdf->getFitStatus() << endl;
+        pdf->setFitStatus(-99);
+    }
+    pdf->deleteNLL();
+    return rb;
+};
+
 ///
 /// load Parameter limits
 /// by default the "free" limit is loaded, can be changed to "phys" by command line argument
@@ -304,6 +350,7 @@ TChain* MethodDatasetsPluginScan::readFiles(int runMin, int runMax, int &nFilesR
 /////////////
 void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString fileNameBaseIn)
 {
+		ProfileTimer pt("MethodDatasetsPluginScan::readScan1dTrees");
 		int nFilesRead, nFilesMissing;
     TChain* c = this->readFiles(runMin, runMax, nFilesRead, nFilesMissing, fileNameBaseIn);
     ToyTree t(this->pdf, this->arg, c);
@@ -362,7 +409,13 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
     TH1F *h_tot           = (TH1F*)hCL->Clone("h_tot");
     // histogram illustrating the failure rate
     TH1F *h_fracGoodToys  = (TH1F*)hCL->Clone("h_fracGoodToys");
-    // map of vectors for CLb quantiles
+    h_all->Sumw2(); // for the effective number of reweighted toys (--reusetoys)
+    // streaming quantile sketches of the CLs test statistics, per bin (for expected CLs).
+    // Use the ones stored in the toy files, if all files have them.
+    std::map<int,QuantileSketch> bSketches;
+    std::map<int,QuantileSketch> sbSketches;
+    bool storedSketches = readClsSketches(c, h_all, bSketches, sbSketches);
+    // the full samples of the test statistics are only kept for the control plots
     std::map<int,std::vector<double> > sampledBValues;
     std::map<int,std::vector<double> > sampledSBValues;
     TH1F *h_pVals         = new TH1F("p", "p", 200, 0.0, 1e-2);
@@ -390,7 +443,7 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
 
         bool valid    = true;
 
-        h_tot->Fill(t.scanpoint);
+        h_tot->Fill(t.scanpoint, t.weight);
         if (t.scanpoint == 0.0) n0tot++;
         // criteria for GammaCombo
         bool convergedFits      = (t.statusFree == 0. && t.statusScan == 0.);
@@ -399,7 +452,7 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
         // apply cuts
         if ( tooHighLikelihood || !convergedFits  )
         {
-            h_failed->Fill(t.scanpoint);
+            h_failed->Fill(t.scanpoint, t.weight);
             if (t.scanpoint == 0) n0failed++;
             valid = false;
             nfailed++;
@@ -413,39 +466,41 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
 
         // build test statistic
         if ( valid && (t.chi2minToy - t.chi2minGlobalToy) >= (t.chi2min - this->chi2minGlobal) ) { //t.chi2minGlobal ){
-            h_better->Fill(t.scanpoint);
+            h_better->Fill(t.scanpoint, t.weight);
         }
         if ( valid && (t.chi2minToy - t.chi2minGlobalToy) >= (t.chi2min - this->chi2minBkg) ) { //t.chi2minGlobal ){
-            h_better_cls->Fill(t.scanpoint);
+            h_better_cls->Fill(t.scanpoint, t.weight);
         }
         if (t.scanpoint == 0.0) n0better++;
 
         // goodness-of-fit
         if ( inPhysicalRegion && t.chi2minGlobalToy > this->chi2minGlobal ) { //t.chi2minGlobal ){
-            h_gof->Fill(t.scanpoint);
+            h_gof->Fill(t.scanpoint, t.weight);
         }
         // all toys
         if ( valid) { //inPhysicalRegion )
             // not efficient! TMath::Prob evaluated each toy, only needed once.
             // come up with smarter way
-            h_all->Fill(t.scanpoint);
+            h_all->Fill(t.scanpoint, t.weight);
             h_probPValues->SetBinContent(h_probPValues->FindBin(t.scanpoint), this->getPValueTTestStatistic(t.chi2min - this->chi2minGlobal)); //t.chi2minGlobal));
             if (t.scanpoint == 0.0) n0all++;
         }
         int hBin = h_all->FindBin(t.scanpoint);
-        if ( sampledBValues.find(hBin) == sampledBValues.end() ) sampledBValues[hBin] = std::vector<double>();
-        if ( sampledSBValues.find(hBin) == sampledSBValues.end() ) sampledSBValues[hBin] = std::vector<double>();
-        double bkgTestStatVal = t.chi2minBkgToy - t.chi2minGlobalBkgToy;
-        bkgTestStatVal = t.scanbestBkg <= t.scanpoint ? bkgTestStatVal : 0.;  // if muhat < mu then q_mu = 0
-        sampledBValues[hBin].push_back( bkgTestStatVal );
-        double sbTestStatVal = t.chi2minToy - t.chi2minGlobalToy;
-        sbTestStatVal = t.scanbest <= t.scanpoint ? sbTestStatVal : 0.; // if muhat < mu then q_mu = 0
-        sampledSBValues[hBin].push_back( sbTestStatVal );
+        double bkgTestStatVal, sbTestStatVal;
+        getClsTestStatistics(t, bkgTestStatVal, sbTestStatVal);
+        if ( !storedSketches ) {
+            bSketches[hBin].add( bkgTestStatVal );
+            sbSketches[hBin].add( sbTestStatVal, t.weight );
+        }
+        if ( arg->controlplot ) {
+            sampledBValues[hBin].push_back( bkgTestStatVal );
+            sampledSBValues[hBin].push_back( sbTestStatVal );
+        }
 
         // use the unphysical events to estimate background (be careful with this,
         // at least inspect the control plots to judge if this can be at all reasonable)
         if ( valid && !inPhysicalRegion ) {
-            h_background->Fill(t.scanpoint);
+            h_background->Fill(t.scanpoint, t.weight);
         }
 
         if (n0tot % 1500 == 0 && n0all != 0) {
@@ -478,6 +533,9 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
         //nall = nall - nfailed + nbackground;
         float ntot = h_tot->GetBinContent(i);
         if ( nall == 0. ) continue;
+        // effective number of toys, smaller than nall for reweighted toys
+        float nallErr = h_all->GetBinError(i);
+        float neff = nallErr > 0. ? nall * nall / (nallErr * nallErr) : nall;
         h_background->SetBinContent(i, nbackground / nall);
         h_fracGoodToys->SetBinContent(i, (nall) / (float)ntot);
         // subtract background
@@ -489,21 +547,21 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
         float p = nbetter / nall;
         float p_cls = nbetter_cls / nall;
         hCL->SetBinContent(i, p);
-        hCL->SetBinError(i, sqrt(p * (1. - p) / nall));
+        hCL->SetBinError(i, sqrt(p * (1. - p) / neff));
         hCLs->SetBinContent(i, p_cls);
-        hCLs->SetBinError(i, sqrt(p_cls * (1. - p_cls) / nall));
+        hCLs->SetBinError(i, sqrt(p_cls * (1. - p_cls) / neff));
 
         // the quantiles of the CLb distribution (for expected CLs)
         std::vector<double> probs  = { TMath::Prob(4,1), TMath::Prob(1,1), 0.5, 1.-TMath::Prob(1,1), 1.-TMath::Prob(4,1) };
         std::vector<double> clb_vals  = { 1.-TMath::Prob(4,1), 1.-TMath::Prob(1,1), 0.5, TMath::Prob(1,1), TMath::Prob(4,1) };
-        std::vector<double> quantiles = Quantile<double>( sampledBValues[i], probs );
+        std::vector<double> quantiles = bSketches[i].quantiles( probs );
         std::vector<double> clsb_vals;
         //for (int k=0; k<quantiles.size(); k++) clsb_vals.push_back( TMath::Prob( quantiles[k], 1 ) );
         for (int k=0; k<quantiles.size(); k++ ){
           // asymptotic as chi2
           //clsb_vals.push_back( TMath::Prob( quantiles[k], 1 ) );
           // from toys
-          clsb_vals.push_back( getVectorFracAboveValue( sampledSBValues[i], quantiles[k] ) );
+          clsb_vals.push_back( sbSketches[i].fracAbove( quantiles[k] ) );
         }
 
         // check
@@ -536,13 +594,9 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
         //hCLsErr2Dn->SetBinContent( i, (float(nSBValsAboveBkg[4]) / sampledSBValues[i].size() ) / probs[4] );
 
         // CLs values in data
-        int nDataAboveBkgExp = 0;
         double dataTestStat = p>0 ? TMath::ChisquareQuantile(1.-p,1) : 1.e10;
-        for (int j=0; j<sampledBValues[i].size(); j++ ) {
-          if ( sampledBValues[i][j] >= dataTestStat ) nDataAboveBkgExp += 1;
-        }
-        float dataCLb    = float(nDataAboveBkgExp)/sampledBValues[i].size();
-        float dataCLbErr = sqrt( dataCLb * (1.-dataCLb) / sampledBValues[i].size() );
+        float dataCLb    = bSketches[i].fracAbove( dataTestStat );
+        float dataCLbErr = sqrt( dataCLb * (1.-dataCLb) / bSketches[i].getN() );
         if ( p/dataCLb >= 1. ) {
           hCLsFreq->SetBinContent(i, 1.);
           hCLsFreq->SetBinError  (i, 0.);
@@ -614,6 +668,64 @@ void MethodDatasetsPluginScan::readScan1dTrees(int runMin, int runMax, TString f
 
 
 
+///
+/// The one-sided test statistics of a toy for CLs: of the background-only
+/// toy under the scanpoint hypothesis, and of the signal+background toy.
+/// If the free fit prefers a value above the scanpoint (muhat > mu),
+/// the test statistic is zero.
+///
+void MethodDatasetsPluginScan::getClsTestStatistics(const ToyTree& t, double& bkgTestStat, double& sbTestStat)
+{
+    bkgTestStat = t.chi2minBkgToy - t.chi2minGlobalBkgToy;
+    bkgTestStat = t.scanbestBkg <= t.scanpoint ? bkgTestStat : 0.;
+    sbTestStat = t.chi2minToy - t.chi2minGlobalToy;
+    sbTestStat = t.scanbest <= t.scanpoint ? sbTestStat : 0.;
+}
+
+///
+/// Read the quantile sketches of the CLs test statistics, which scan1d()
+/// stores in the "clsSketches" directory of each toy file, and merge
+/// them per bin of h. This gives the expected CLs bands without
+/// sketching every toy again.
+///
+/// \return false if a file has no sketches (e.g. it was made by an older
+///         version), then the maps are left empty
+///
+bool MethodDatasetsPluginScan::readClsSketches(TChain* c, TH1F* h, std::map<int,QuantileSketch>& bSketches, std::map<int,QuantileSketch>& sbSketches)
+{
+    ProfileTimer pt("MethodDatasetsPluginScan::readClsSketches");
+    TObjArray* files = c->GetListOfFiles();
+    for ( int iFile = 0; iFile < files->GetEntries(); iFile++ ) {
+        TFile* f = TFile::Open(files->At(iFile)->GetTitle());
+        TVectorD* scanpoints = f ? (TVectorD*)f->Get("clsSketches/scanpoints") : NULL;
+        if ( !scanpoints ) {
+            delete f;
+            cout << "MethodDatasetsPluginScan::readClsSketches() : no CLs sketches in "
+                 << files->At(iFile)->GetTitle() << ", computing them from the toys." << endl;
+            bSketches.clear();
+            sbSketches.clear();
+            return false;
+        }
+        for ( int k = 0; k < scanpoints->GetNrows(); k++ ) {
+            TVectorD* b  = (TVectorD*)f->Get(Form("clsSketches/b_%i", k));
+            TVectorD* sb = (TVectorD*)f->Get(Form("clsSketches/sb_%i", k));
+            if ( !b || !sb ) {
+                cout << "MethodDatasetsPluginScan::readClsSketches() : ERROR : incomplete CLs sketches in "
+                     << files->At(iFile)->GetTitle() << endl;
+                exit(EXIT_FAILURE);
+            }
+            int hBin = h->FindBin((float)(*scanpoints)[k]);
+            bSketches[hBin].merge(QuantileSketch(*b));
+            sbSketches[hBin].merge(QuantileSketch(*sb));
+            delete b;
+            delete sb;
+        }
+        delete scanpoints;
+        delete f; // closes it
+    }
+    cout << "MethodDatasetsPluginScan::readClsSketches() : merged the CLs sketches of " << files->GetEntries() << " files." << endl;
+    return true;
+}
 
 
 double MethodDatasetsPluginScan::getPValueTTestStatistic(double test_statistic_value) {
@@ -671,7 +783,8 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
     // Define outputfile
     TString dirname = "root/scan1dDatasetsPlugin_" + this->pdf->getName() + "_" + scanVar1;
     system("mkdir -p " + dirname);
-    TFile* outputFile = new TFile(Form(dirname + "/scan1dDatasetsPlugin_" + this->pdf->getName() + "_" + scanVar1 + "_run%i.root", nRun), "RECREATE");
+    TString outputFileName = Form(dirname + "/scan1dDatasetsPlugin_" + this->pdf->getName() + "_" + scanVar1 + "_run%i.root", nRun);
+    TFile* outputFile = new TFile(outputFileName, "RECREATE");
 
     // Set up toy root tree
     ToyTree toyTree(this->pdf, arg);
@@ -684,63 +797,46 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
     RooDataSet* parsFunctionCall = new RooDataSet("parsFunctionCall", "parsFunctionCall", *w->set(pdf->getParName()));
     parsFunctionCall->add(*w->set(pdf->getParName()));
 
-		// if CLs toys we need to keep hold of what's going on in the bkg only case
-    // there is a small overhead here but it's necessary because the bkg only hypothesis
-    // might not necessarily be in the scan range (although often it will be the first point)
-		vector<RooDataSet*> cls_bkgOnlyToys;
+    // The background-only hypothesis does not depend on the scan point. So for CLs, one
+    // ensemble of background-only toys (datasets and global observables) is generated and
+    // fitted freely once per run, and then reused at every scan point.
+    vector<RooDataSet*> cls_bkgOnlyToys;
     vector<float> chi2minGlobalBkgToysStore;
     vector<float> scanbestBkgToysStore;
-    // Titus: Try importance sampling from the combination part -> works, but definitely needs improvement in precision
-    int nActualToys = nToys;
-    if ( arg->importance ){
-        float plhPvalue = TMath::Prob(toyTree.chi2min - toyTree.chi2minGlobal,1);
-        nActualToys = nToys*importance(plhPvalue);
-    }
-    for ( int j = 0; j < nActualToys; j++ ) {
-      if(pdf->getBkgPdf()){
-        pdf->generateBkgToys();
-        pdf->generateToysGlobalObservables();
-        RooDataSet* bkgOnlyToy = pdf->getBkgToyObservables();
-        cls_bkgOnlyToys.push_back( (RooDataSet*)bkgOnlyToy->Clone() ); // clone required because of deleteToys() call at end of loop
-        pdf->setToyData( bkgOnlyToy );
-        parameterToScan->setConstant(false);
-        RooFitResult *rb = loadAndFit(pdf);
-        assert(rb);
-        pdf->setMinNllScan(pdf->minNll);
-        if (pdf->getFitStatus() != 0) {
-            pdf->setFitStrategy(1);
-            delete rb;
-            rb = loadAndFit(pdf);
-            pdf->setMinNllScan(pdf->minNll);
-            assert(rb);
+    vector<int>   statusFreeBkgToysStore;
+    RooDataSet* bkgToysGlobalObs = NULL;
+    if ( pdf->getBkgPdf() ) {
+        cout << "MethodDatasetsPluginScan::scan1d_plugin() : generating and fitting " << nToys << " background-only toys ..." << endl;
+        bkgToysGlobalObs = new RooDataSet("bkgToysGlobalObs", "bkgToysGlobalObs", *w->set(pdf->getGlobalObsName()));
+        for ( int j = 0; j < nToys; j++ ) {
+            pdf->generateBkgToys();
+            pdf->generateBkgToysGlobalObservables();
+            bkgToysGlobalObs->add(*w->set(pdf->getGlobalObsName()));
+            // the toy is owned by cls_bkgOnlyToys from now on
+            cls_bkgOnlyToys.push_back( pdf->getBkgToyObservables() );
 
-            if (pdf->getFitStatus() != 0) {
-                pdf->setFitStrategy(2);
-                delete rb;
-                rb = loadAndFit(pdf);
-                assert(rb);
-            }
-        }
-
-        if (std::isinf(pdf->minNll) || std::isnan(pdf->minNll)) {
-            cout  << "++++ > second and a half fit gives inf/nan: "  << endl
-                  << "++++ > minNll: " << pdf->minNll << endl
-                  << "++++ > status: " << pdf->getFitStatus() << endl;
-            pdf->setFitStatus(-99);
+            parameterToScan->setConstant(false);
+            RooFitResult *rb = fitBkgOnlyToy(cls_bkgOnlyToys[j], bkgToysGlobalObs->get(j));
+            chi2minGlobalBkgToysStore.push_back( 2 * rb->minNll() );
+            scanbestBkgToysStore.push_back( ((RooRealVar*)w->set(pdf->getParName())->find(scanVar1))->getVal() );
+            statusFreeBkgToysStore.push_back( pdf->getFitStatus() );
+            delete rb;
         }
-        pdf->setMinNllScan(pdf->minNll);
+        setParameters(w, pdf->getParName(), parsFunctionCall->get(0));
+    }
 
-        chi2minGlobalBkgToysStore.push_back( 2 * rb->minNll() );
-        scanbestBkgToysStore.push_back( ((RooRealVar*)w->set(pdf->getParName())->find(scanVar1))->getVal() );
+    // toys carried over between the scanpoints
+    ReusedDatasetToys* reuse = arg->reusetoys > 0 ? new ReusedDatasetToys(arg->reusetoys) : NULL;
 
-        delete rb;
-        pdf->deleteToys();
-      }
-    }
+    // quantile sketches of the CLs test statistics per scanpoint, stored next to the toys
+    vector<QuantileSketch> bSketches(nPoints1d);
+    vector<QuantileSketch> sbSketches(nPoints1d);
+    vector<float> sketchScanpoints(nPoints1d, 0.);
 
     // start scan
     cout << "MethodDatasetsPluginScan::scan1d_plugin() : starting ... with " << nPoints1d << " scanpoints..." << endl;
     ProgressBar progressBar(arg, nPoints1d);
+    Heartbeat* heartbeat = arg->heartbeat > 0 ? new Heartbeat(Heartbeat::getFileName(outputFileName), nPoints1d * nToys, arg->heartbeat) : NULL;
     for ( int i = 0; i < nPoints1d; i++ )
     {
 
@@ -753,6 +849,7 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
 
         float scanpoint = parameterToScan_min + (parameterToScan_max - parameterToScan_min) * (double)i / ((double)nPoints1d - 1);
         toyTree.scanpoint = scanpoint;
+        if (heartbeat) heartbeat->setScanpoint(scanpoint);
 
 				if ( i==0 && scanpoint != 0 ) {
 					cout << "ERROR: For CLs option the first point in the scan must be zero not: " << scanpoint << endl;
@@ -765,6 +862,7 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
         // by default this means checking against "free" range
         if ( scanpoint < parameterToScan->getMin() || scanpoint > parameterToScan->getMax() + 2e-13 ) {
             cout << "not obvious: " << scanpoint << " < " << parameterToScan->getMin() << " and " << scanpoint << " > " << parameterToScan->getMax() + 2e-13 << endl;
+            if (heartbeat) heartbeat->step(nToys); // count the skipped toys as done
             continue;
         }
 
@@ -795,6 +893,28 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
             float plhPvalue = TMath::Prob(toyTree.chi2min - toyTree.chi2minGlobal,1);
             nActualToys = nToys*importance(plhPvalue);
         }
+
+        // Reuse the toys of an earlier scanpoint, if their weights at this scanpoint
+        // still leave enough effective toys. Else the new toys of this scanpoint
+        // replace them.
+        bool reusing = false;
+        if ( reuse && !reuse->toys.empty() ) {
+            reusing = reuse->reweighter.reweight(getToyLogDensities(reuse));
+            if (arg->verbose) {
+                cout << "MethodDatasetsPluginScan::scan1d_plugin() : effective sample size of reused toys at "
+                     << scanVar1 << "=" << scanpoint << ": " << Form("%.1f", reuse->reweighter.getEss())
+                     << (reusing ? "" : ", generating new toys") << endl;
+            }
+            if (!reusing) reuse->clear();
+            else profileCount("MethodDatasetsPluginScan reused toy sets");
+        }
+        bool collecting = reuse && !reusing;
+        vector<double> logDensities;
+        if ( collecting ) {
+            reuse->globalObs = new RooDataSet("reusedGlobalObs", "reusedGlobalObs", *w->set(pdf->getGlobalObsName()));
+            reuse->parsFree  = new RooDataSet("reusedParsFree", "reusedParsFree", *w->set(pdf->getParName()));
+        }
+
         //Titus: Debug histogram to see the different deltachisq distributions
         TH1F histdeltachi2("histdeltachi2", "histdeltachi2", 200,0,5);
         for ( int j = 0; j < nActualToys; j++ )
@@ -812,24 +932,21 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
             // This is called the PLUGIN method.
             this->setParevolPointByIndex(i);
 
-            this->pdf->generateToys(); // this is generating the toy dataset
-            this->pdf->generateToysGlobalObservables(); // this is generating the toy global observables and saves globalObs in snapshot
-
-
-            // TODO - DELETE THE FOLLOWING SMALL BLOCK
-            // keep hold of the background only toys -- this part is broken somehow
-            //if(i==0){
-              //if(pdf->getBkgPdf()){
-                //pdf->generateBkgToys();
-                //cls_bkgOnlyToys.push_back( (RooDataSet*)this->pdf->getBkgToyObservables()->Clone() ); //surely not optimal
-              //}
-              //else {
-              //cls_bkgOnlyToys.push_back( (RooDataSet*)this->pdf->getToyObservables()->Clone() ); // clone required because of deleteToys() call at end of loop
-                //}
-            //}
-            //else {
-              //assert( cls_bkgOnlyToys.size() == nToys );
-            //}
+            if ( reusing ) {
+                this->pdf->setToyData(reuse->toys[j]);
+                w->saveSnapshot(pdf->globalObsToySnapshotName, *reuse->globalObs->get(j), kTRUE);
+            }
+            else {
+                this->pdf->generateToys(); // this is generating the toy dataset
+                this->pdf->generateToysGlobalObservables(); // this is generating the toy global observables and saves globalObs in snapshot
+            }
+            if ( collecting ) {
+                reuse->toys.push_back(pdf->getToyObservables());
+                reuse->globalObs->add(*w->set(pdf->getGlobalObsName()));
+                logDensities.push_back(pdf->getToyLogDensity(pdf->getToyObservables()));
+            }
+            toyTree.weight = reusing ? reuse->reweighter.getWeight(j) : 1.;
+
 
             // \todo: comment the following back in once I know what it does ...
             //      t.storeParsGau( we need to pass a rooargset of the means of the global observables here);
@@ -883,6 +1000,7 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
             toyTree.statusScan          = r->status();
             toyTree.statusScanPDF       = pdf->getFitStatus(); //r->status();
             toyTree.storeParsScan();
+            if (heartbeat) heartbeat->fitDone(toyTree.statusScan);
 
             pdf->deleteNLL();
 
@@ -890,118 +1008,96 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
             parsAfterScanFit->add(*w->set(pdf->getParName()));
 
             //
-            // 2.5 Fit to bkg only toys with parameter of interest fixed to scanpoint
+            // 2.5 Fit to the background-only toy with parameter of interest fixed to scanpoint.
+            // The free fit to this toy was done before the scan. If it prefers a value above the
+            // scanpoint, the one-sided test statistic is zero anyway (see readScan1dTrees()),
+            // so the fit can be skipped.
             //
-            if (arg->debug)cout << "DEBUG in MethodDatasetsPluginScan::scan1d_plugin() - perform scan toy fit to background" << endl;
-
-            // set parameters to constrained data scan fit result again
-            this->setParevolPointByIndex(i);
-
-            // fixed parameter of interest
-            parameterToScan->setConstant(true);
-            this->pdf->setFitStrategy(0);
-            // temporarily store our current toy here so we can put it back in a minute
-            RooDataSet *tempData = (RooDataSet*)this->pdf->getToyObservables();
-            // now get our background only toy (to fit under this hypothesis)
-            RooDataSet *bkgToy = (RooDataSet*)cls_bkgOnlyToys[j];
-            if (arg->debug) cout << "Setting background toy as data " << bkgToy << endl;
-            this->pdf->setToyData( bkgToy );
-            RooFitResult* rb   = this->loadAndFit(this->pdf);
-            assert(rb);
-            pdf->setMinNllScan(pdf->minNll);
-
-            this->setAndPrintFitStatusFreeToys(toyTree);
-
-            if (pdf->getFitStatus() != 0) {
-                pdf->setFitStrategy(1);
-                delete rb;
-                rb = this->loadAndFit(this->pdf);
-                pdf->setMinNllScan(pdf->minNll);
-                assert(rb);
-
-                this->setAndPrintFitStatusFreeToys(toyTree);
-
-                if (pdf->getFitStatus() != 0) {
-                    pdf->setFitStrategy(2);
-                    delete rb;
-                    rb = this->loadAndFit(this->pdf);
-                    assert(rb);
+            RooFitResult* rb = NULL;
+            if ( pdf->getBkgPdf() ) {
+                assert( chi2minGlobalBkgToysStore.size() == nToys );
+                assert( scanbestBkgToysStore.size() == nToys );
+                toyTree.chi2minGlobalBkgToy = chi2minGlobalBkgToysStore[j];
+                toyTree.scanbestBkg         = scanbestBkgToysStore[j];
+
+                if ( toyTree.scanbestBkg > toyTree.scanpoint ) {
+                    toyTree.chi2minBkgToy    = toyTree.chi2minGlobalBkgToy;
+                    toyTree.chi2minBkgToyPDF = toyTree.chi2minGlobalBkgToy;
+                }
+                else {
+                    if (arg->debug)cout << "DEBUG in MethodDatasetsPluginScan::scan1d_plugin() - perform scan toy fit to background" << endl;
+
+                    // set parameters to constrained data scan fit result again
+                    this->setParevolPointByIndex(i);
+
+                    // fixed parameter of interest
+                    parameterToScan->setConstant(true);
+                    // temporarily store our current toy and its scan fit so we can put them back in a minute
+                    RooDataSet *tempData = (RooDataSet*)this->pdf->getToyObservables();
+                    float minNllScanToy = pdf->getMinNllScan();
+                    if (arg->debug) cout << "Setting background toy as data " << cls_bkgOnlyToys[j] << endl;
+                    rb = fitBkgOnlyToy(cls_bkgOnlyToys[j], bkgToysGlobalObs->get(j));
+                    toyTree.chi2minBkgToy    = 2 * rb->minNll();
+                    toyTree.chi2minBkgToyPDF = 2 * pdf->minNll;
+
+                    // set dataset back
+                    if (arg->debug) cout << "Setting toy back as data " << tempData << endl;
+                    this->pdf->setToyData( tempData );
+                    pdf->setMinNllScan(minNllScanToy);
                 }
             }
 
-            if (std::isinf(pdf->minNll) || std::isnan(pdf->minNll)) {
-                cout  << "++++ > second and a half fit gives inf/nan: "  << endl
-                      << "++++ > minNll: " << pdf->minNll << endl
-                      << "++++ > status: " << pdf->getFitStatus() << endl;
-                pdf->setFitStatus(-99);
-            }
-            pdf->setMinNllScan(pdf->minNll);
-
-
-            toyTree.chi2minBkgToy          = 2 * rb->minNll(); // 2*r->minNll(); //2*r->minNll();
-            toyTree.chi2minBkgToyPDF       = 2 * pdf->getMinNllScan();
-
-            pdf->deleteNLL();
-
             //
             // 3. Fit to toys with free parameter of interest
+            //    (it doesn't depend on the scanpoint, so reused toys keep the one
+            //    from their source scanpoint, unless it failed or the scan fit
+            //    now finds a lower minimum)
             //
-            if (arg->debug)cout << "DEBUG in MethodDatasetsPluginScan::scan1d_plugin() - perform free toy fit" << endl;
-            // Use parameters from the scanfit to data
-
-            this->setParevolPointByIndex(i);
-
-            // free parameter of interest
-            parameterToScan->setConstant(false);
-            //setLimit(w, scanVar1, "free");
-            w->var(scanVar1)->removeRange();
-
-						// set dataset back
-						if (arg->debug) cout << "Setting toy back as data " << tempData << endl;
-						this->pdf->setToyData( tempData );
-
-            // Fit
-            pdf->setFitStrategy(0);
-            RooFitResult* r1  = this->loadAndFit(this->pdf);
-            assert(r1);
-            pdf->setMinNllFree(pdf->minNll);
-            toyTree.chi2minGlobalToy = 2 * r1->minNll();
-
-            if (! std::isfinite(pdf->getMinNllFree())) {
-                cout << "----> nan/inf flag detected " << endl;
-                cout << "----> fit status: " << pdf->getFitStatus() << endl;
-                pdf->setFitStatus(-99);
+            RooFitResult* r1 = NULL;
+            bool freeFitReused = reusing && reuse->statusFree[j] == 0 && reuse->statusFreePDF[j] == 0
+                                 && toyTree.chi2minToy >= reuse->chi2minGlobalToy[j];
+            if ( freeFitReused ) {
+                Utils::setParameters(w, pdf->getParName(), reuse->parsFree->get(j));
+                toyTree.chi2minGlobalToy    = reuse->chi2minGlobalToy[j];
+                toyTree.chi2minGlobalToyPDF = reuse->chi2minGlobalToyPDF[j];
+                toyTree.statusFreePDF       = reuse->statusFreePDF[j];
+                toyTree.statusFree          = reuse->statusFree[j];
+                toyTree.covQualFree         = reuse->covQualFree[j];
             }
+            else {
+                if (arg->debug)cout << "DEBUG in MethodDatasetsPluginScan::scan1d_plugin() - perform free toy fit" << endl;
+                // Use parameters from the scanfit to data
 
-            bool negTestStat = toyTree.chi2minToy - toyTree.chi2minGlobalToy < 0;
-
-            this->setAndPrintFitStatusConstrainedToys(toyTree);
+                this->setParevolPointByIndex(i);
 
+                // free parameter of interest
+                parameterToScan->setConstant(false);
+                //setLimit(w, scanVar1, "free");
+                w->var(scanVar1)->removeRange();
 
-            if (pdf->getFitStatus() != 0 || negTestStat ) {
-
-                pdf->setFitStrategy(1);
-
-                if (arg->verbose) cout << "----> refit with strategy: 1" << endl;
-                delete r1;
+                // Fit
+                pdf->setFitStrategy(0);
                 r1  = this->loadAndFit(this->pdf);
                 assert(r1);
                 pdf->setMinNllFree(pdf->minNll);
                 toyTree.chi2minGlobalToy = 2 * r1->minNll();
+
                 if (! std::isfinite(pdf->getMinNllFree())) {
                     cout << "----> nan/inf flag detected " << endl;
                     cout << "----> fit status: " << pdf->getFitStatus() << endl;
                     pdf->setFitStatus(-99);
                 }
-                negTestStat = toyTree.chi2minToy - toyTree.chi2minGlobalToy < 0;
+
+                bool negTestStat = toyTree.chi2minToy - toyTree.chi2minGlobalToy < 0;
 
                 this->setAndPrintFitStatusConstrainedToys(toyTree);
 
+
                 if (pdf->getFitStatus() != 0 || negTestStat ) {
 
-                    pdf->setFitStrategy(2);
+                    pdf->setFitStrategy(1);
 
-                    if (arg->verbose) cout << "----> refit with strategy: 2" << endl;
+                    if (arg->verbose) cout << "----> refit with strategy: 1" << endl;
                     delete r1;
                     r1  = this->loadAndFit(this->pdf);
                     assert(r1);
@@ -1012,67 +1108,84 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
                         cout << "----> fit status: " << pdf->getFitStatus() << endl;
                         pdf->setFitStatus(-99);
                     }
+                    negTestStat = toyTree.chi2minToy - toyTree.chi2minGlobalToy < 0;
+
                     this->setAndPrintFitStatusConstrainedToys(toyTree);
 
-                    if ( (toyTree.chi2minToy - toyTree.chi2minGlobalToy) < 0) {
-                        cout << "+++++ > still negative test statistic after whole procedure!! " << endl;
-                        cout << "+++++ > try to fit with different starting values" << endl;
-                        cout << "+++++ > dChi2: " << toyTree.chi2minToy - toyTree.chi2minGlobalToy << endl;
-                        cout << "+++++ > dChi2PDF: " << 2 * (pdf->getMinNllScan() - pdf->getMinNllFree()) << endl;
-                        Utils::setParameters(this->pdf->getWorkspace(), pdf->getParName(), parsAfterScanFit->get(0));
-                        if (parameterToScan->getVal() < 1e-13) parameterToScan->setVal(0.67e-12);
-                        parameterToScan->setConstant(false);
-                        pdf->deleteNLL();
-                        RooFitResult* r_tmp = this->loadAndFit(this->pdf);
-                        assert(r_tmp);
-                        if (r_tmp->status() == 0 && r_tmp->minNll() < r1->minNll() && r_tmp->minNll() > -1e27) {
-                            pdf->setMinNllFree(pdf->minNll);
-                            cout << "+++++ > Improvement found in extra fit: Nll before: " << r1->minNll()
-                                 << " after: " << r_tmp->minNll() << endl;
-                            delete r1;
-                            r1 = r_tmp;
-                            cout << "+++++ > new minNll value: " << r1->minNll() << endl;
+                    if (pdf->getFitStatus() != 0 || negTestStat ) {
+
+                        pdf->setFitStrategy(2);
+
+                        if (arg->verbose) cout << "----> refit with strategy: 2" << endl;
+                        delete r1;
+                        r1  = this->loadAndFit(this->pdf);
+                        assert(r1);
+                        pdf->setMinNllFree(pdf->minNll);
+                        toyTree.chi2minGlobalToy = 2 * r1->minNll();
+                        if (! std::isfinite(pdf->getMinNllFree())) {
+                            cout << "----> nan/inf flag detected " << endl;
+                            cout << "----> fit status: " << pdf->getFitStatus() << endl;
+                            pdf->setFitStatus(-99);
                         }
-                        else {
-                            // set back parameter value to last fit value
-                            cout << "+++++ > no Improvement found, reset ws par value to last fit result" << endl;
-                            parameterToScan->setVal(static_cast<RooRealVar*>(r1->floatParsFinal().find(parameterToScan->GetName()))->getVal());
-                            delete r_tmp;
+                        this->setAndPrintFitStatusConstrainedToys(toyTree);
+
+                        if ( (toyTree.chi2minToy - toyTree.chi2minGlobalToy) < 0) {
+                            cout << "+++++ > still negative test statistic after whole procedure!! " << endl;
+                            cout << "+++++ > try to fit with different starting values" << endl;
+                            cout << "+++++ > dChi2: " << toyTree.chi2minToy - toyTree.chi2minGlobalToy << endl;
+                            cout << "+++++ > dChi2PDF: " << 2 * (pdf->getMinNllScan() - pdf->getMinNllFree()) << endl;
+                            Utils::setParameters(this->pdf->getWorkspace(), pdf->getParName(), parsAfterScanFit->get(0));
+                            if (parameterToScan->getVal() < 1e-13) parameterToScan->setVal(0.67e-12);
+                            parameterToScan->setConstant(false);
+                            pdf->deleteNLL();
+                            RooFitResult* r_tmp = this->loadAndFit(this->pdf);
+                            assert(r_tmp);
+                            if (r_tmp->status() == 0 && r_tmp->minNll() < r1->minNll() && r_tmp->minNll() > -1e27) {
+                                pdf->setMinNllFree(pdf->minNll);
+                                cout << "+++++ > Improvement found in extra fit: Nll before: " << r1->minNll()
+                                     << " after: " << r_tmp->minNll() << endl;
+                                delete r1;
+                                r1 = r_tmp;
+                                cout << "+++++ > new minNll value: " << r1->minNll() << endl;
+                            }
+                            else {
+                                // set back parameter value to last fit value
+                                cout << "+++++ > no Improvement found, reset ws par value to last fit result" << endl;
+                                parameterToScan->setVal(static_cast<RooRealVar*>(r1->floatParsFinal().find(parameterToScan->GetName()))->getVal());
+                                delete r_tmp;
+                            }
+                            delete parsAfterScanFit;
+                        };
+                        if (arg->debug) {
+                            cout  << "===== > compare free fit result with pdf parameters: " << endl;
+                            cout  << "===== > minNLL for fitResult: " << r1->minNll() << endl
+                                  << "===== > minNLL for pdfResult: " << pdf->getMinNllFree() << endl
+                                  << "===== > status for pdfResult: " << pdf->getFitStatus() << endl
+                                  << "===== > status for fitResult: " << r1->status() << endl;
                         }
-                        delete parsAfterScanFit;
-                    };
-                    if (arg->debug) {
-                        cout  << "===== > compare free fit result with pdf parameters: " << endl;
-                        cout  << "===== > minNLL for fitResult: " << r1->minNll() << endl
-                              << "===== > minNLL for pdfResult: " << pdf->getMinNllFree() << endl
-                              << "===== > status for pdfResult: " << pdf->getFitStatus() << endl
-                              << "===== > status for fitResult: " << r1->status() << endl;
                     }
                 }
+                // set the limit back again
+                setLimit(w, scanVar1, "scan");
+
+                toyTree.chi2minGlobalToy    = 2 * r1->minNll(); //2*r1->minNll();
+                toyTree.chi2minGlobalToyPDF = 2 * pdf->getMinNllFree(); //2*r1->minNll();
+                toyTree.statusFreePDF       = pdf->getFitStatus(); //r1->status();
+                toyTree.statusFree          = r1->status();
+                toyTree.covQualFree         = r1->covQual();
+                if (heartbeat) heartbeat->fitDone(toyTree.statusFree);
             }
-            // set the limit back again
-            setLimit(w, scanVar1, "scan");
-
-            toyTree.chi2minGlobalToy    = 2 * r1->minNll(); //2*r1->minNll();
-            toyTree.chi2minGlobalToyPDF = 2 * pdf->getMinNllFree(); //2*r1->minNll();
-            toyTree.statusFreePDF       = pdf->getFitStatus(); //r1->status();
-            toyTree.statusFree          = r1->status();
-            toyTree.covQualFree         = r1->covQual();
             toyTree.scanbest            = ((RooRealVar*)w->set(pdf->getParName())->find(scanVar1))->getVal();
             toyTree.storeParsFree();
             pdf->deleteNLL();
-
-            // now save the global min (and best fit val) for the background only toy for later (this just makes life easier even though we are duplicating a number in the tree)
-            //if ( i==0 ) {
-              //chi2minGlobalBkgToysStore.push_back( toyTree.chi2minGlobalToy );
-              //scanbestBkgToysStore.push_back( toyTree.scanbest );
-            //}
-            //else {
-              assert( chi2minGlobalBkgToysStore.size() == nToys );
-              assert( scanbestBkgToysStore.size() == nToys );
-              //}
-            toyTree.chi2minGlobalBkgToy = chi2minGlobalBkgToysStore[j];
-            toyTree.scanbestBkg      = scanbestBkgToysStore[j];
+            if ( collecting ) {
+                reuse->parsFree->add(*w->set(pdf->getParName()));
+                reuse->chi2minGlobalToy.push_back(toyTree.chi2minGlobalToy);
+                reuse->chi2minGlobalToyPDF.push_back(toyTree.chi2minGlobalToyPDF);
+                reuse->statusFree.push_back(toyTree.statusFree);
+                reuse->statusFreePDF.push_back(toyTree.statusFreePDF);
+                reuse->covQualFree.push_back(toyTree.covQualFree);
+            }
 
             if (arg->debug) {
                 cout << "#### > Fit summary: " << endl;
@@ -1091,7 +1204,7 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
                     r->Print("");
                     cout << "================" << endl;
                     cout << "FREE FIT result" << endl;
-                    r1->Print("");
+                    if (r1) r1->Print("");
                 }
 
                 cout << "DEBUG in MethodDatasetsPluginScan::scan1d_plugin() - ToyTree 2*minNll free fit: " << toyTree.chi2minGlobalToy << endl;
@@ -1105,12 +1218,21 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
             if (arg->debug) histdeltachi2.Fill(toyTree.chi2minToy-toyTree.chi2minGlobalToy);
 
             toyTree.fill();
+            double bkgTestStatVal, sbTestStatVal;
+            getClsTestStatistics(toyTree, bkgTestStatVal, sbTestStatVal);
+            bSketches[i].add(bkgTestStatVal);
+            sbSketches[i].add(sbTestStatVal, toyTree.weight);
+            sketchScanpoints[i] = toyTree.scanpoint;
             //remove dataset and pointers
             delete r;
             delete r1;
             delete rb;
-            pdf->deleteToys();
+            if ( !reuse ) pdf->deleteToys(); // else owned by reuse
+            if (heartbeat) heartbeat->step();
         } // End of toys loop
+        if (heartbeat && nActualToys < nToys) heartbeat->step(nToys - nActualToys); // skipped by importance sampling
+        if ( collecting ) reuse->reweighter.setSource(logDensities);
+        toyTree.weight = 1.;
 
         // reset
         setParameters(w, pdf->getParName(), parsFunctionCall->get(0));
@@ -1129,11 +1251,81 @@ int MethodDatasetsPluginScan::scan1d(int nRun)
 
     } // End of npoints loop
     toyTree.writeToFile();
+
+    // Store the CLs sketches of all scanpoints that have toys, so that readScan1dTrees()
+    // can merge them instead of sketching every toy again.
+    outputFile->cd();
+    TDirectory* sketchDir = outputFile->mkdir("clsSketches");
+    sketchDir->cd();
+    vector<double> sketchedPoints;
+    for ( int i = 0; i < nPoints1d; i++ ) {
+        if ( bSketches[i].getN() == 0 ) continue;
+        bSketches[i].toVector().Write(Form("b_%i", (int)sketchedPoints.size()));
+        sbSketches[i].toVector().Write(Form("sb_%i", (int)sketchedPoints.size()));
+        sketchedPoints.push_back(sketchScanpoints[i]);
+    }
+    TVectorD(sketchedPoints.size(), sketchedPoints.data()).Write("scanpoints");
+    outputFile->cd();
+
+    // Store the background-only ensemble next to the toys: free fit results and
+    // global observables of each toy in the "bkgToys" tree, the datasets themselves
+    // in the "bkgToyDatasets" directory (only for --toycolumns full).
+    if ( pdf->getBkgPdf() ) {
+        outputFile->cd();
+        TTree* bkgToysTree = new TTree("bkgToys", "bkgToys");
+        int   ntoy;
+        float chi2minGlobalBkgToy, scanbestBkg, statusFreeBkg;
+        bkgToysTree->Branch("ntoy",                &ntoy,                "ntoy/I");
+        bkgToysTree->Branch("chi2minGlobalBkgToy", &chi2minGlobalBkgToy, "chi2minGlobalBkgToy/F");
+        bkgToysTree->Branch("scanbestBkg",         &scanbestBkg,         "scanbestBkg/F");
+        bkgToysTree->Branch("statusFreeBkg",       &statusFreeBkg,       "statusFreeBkg/F");
+        const RooArgSet* globalObs = bkgToysGlobalObs->get();
+        vector<float> globalObsVals(globalObs->getSize(), 0.);
+        for ( int k = 0; k < globalObs->getSize(); k++ ) {
+            TString globalObsName = (*globalObs)[k].GetName();
+            bkgToysTree->Branch(globalObsName, &globalObsVals[k], globalObsName + "/F");
+        }
+        for ( int j = 0; j < nToys; j++ ) {
+            const RooArgSet* globalObsToy = bkgToysGlobalObs->get(j);
+            ntoy                = j;
+            chi2minGlobalBkgToy = chi2minGlobalBkgToysStore[j];
+            scanbestBkg         = scanbestBkgToysStore[j];
+            statusFreeBkg       = statusFreeBkgToysStore[j];
+            for ( int k = 0; k < globalObsToy->getSize(); k++ ) globalObsVals[k] = ((RooRealVar&)(*globalObsToy)[k]).getVal();
+            bkgToysTree->Fill();
+        }
+        bkgToysTree->Write();
+        if ( arg->toycolumns=="full" ) {
+            outputFile->mkdir("bkgToyDatasets")->cd();
+            for ( int j = 0; j < nToys; j++ ) cls_bkgOnlyToys[j]->Write(Form("bkgToy_%i", j));
+        }
+        for ( int j = 0; j < nToys; j++ ) delete cls_bkgOnlyToys[j];
+        delete bkgToysGlobalObs;
+    }
     outputFile->Close();
     delete parsFunctionCall;
+    delete reuse;
+    delete heartbeat;
     return 0;
 }
 
+///
+/// Log densities of the reused toys at the current parameter values,
+/// each with its own global observables, to reweight them to the
+/// current scanpoint. Leaves the global observables of the last toy
+/// set in the workspace.
+///
+vector<double> MethodDatasetsPluginScan::getToyLogDensities(ReusedDatasetToys* reuse)
+{
+    ProfileTimer pt("MethodDatasetsPluginScan::getToyLogDensities");
+    vector<double> logDensities;
+    for ( unsigned int j = 0; j < reuse->toys.size(); j++ ) {
+        Utils::setParameters(w, pdf->getGlobalObsName(), reuse->globalObs->get(j));
+        logDensities.push_back(pdf->getToyLogDensity(reuse->toys[j]));
+    }
+    return logDensities;
+}
+
 
 
 void MethodDatasetsPluginScan::drawDebugPlots(int runMin, int runMax, TString fileNameBaseIn) {
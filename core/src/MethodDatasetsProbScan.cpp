@@ -7,10 +7,14 @@
  */
 
 #include "MethodDatasetsProbScan.h"
+#include "Profiler.h"
+#include "TParameter.h"
 #include "TRandom3.h"
+#include "TSystem.h"
 #include <algorithm>
 #include <ios>
 #include <iomanip>
+#include <unistd.h>
 
 MethodDatasetsProbScan::MethodDatasetsProbScan(PDF_Datasets* PDF, OptParser* opt)
     : MethodProbScan(opt),
@@ -384,7 +388,20 @@ int MethodDatasetsProbScan::scan1d(bool fast, bool reverse)
     // Define outputfile
     system("mkdir -p root");
     TString probResName = Form("root/scan1dDatasetsProb_" + this->pdf->getName() + "_%ip" + "_" + scanVar1 + ".root", arg->npoints1d);
-    TFile* outputFile = new TFile(probResName, "RECREATE");
+
+    // Distribute the scan points over worker processes (--scanworkers).
+    // Each worker has its own copy of the workspace and fits every
+    // nWorkers-th point. The points are independent, as every fit starts
+    // from the parameters at function call. The first worker is this
+    // process, it merges the points of all workers in scan order.
+    int nWorkers = TMath::Max(1, TMath::Min(arg->scanworkers, nPoints1d));
+    vector<pid_t> workers;
+    int iWorker = forkWorkers(nWorkers, workers);
+    if ( iWorker<0 ){
+        cout << "MethodDatasetsProbScan::scan1d() : ERROR : could not start the scan workers" << endl;
+        exit(1);
+    }
+    TFile* outputFile = new TFile(nWorkers>1 ? workerFileName(probResName, iWorker) : probResName, "RECREATE");
 
     // Set up toy root tree
     this->probScanTree = new ToyTree(this->pdf, arg);
@@ -399,8 +416,8 @@ int MethodDatasetsProbScan::scan1d(bool fast, bool reverse)
 
     // start scan
     cout << "MethodDatasetsProbScan::scan1d_prob() : starting ... with " << nPoints1d << " scanpoints..." << endl;
-    ProgressBar progressBar(arg, nPoints1d);
-    for ( int i = 0; i < nPoints1d; i++ )
+    ProgressBar progressBar(arg, (nPoints1d-iWorker+nWorkers-1)/nWorkers);
+    for ( int i = iWorker; i < nPoints1d; i += nWorkers )
     {
         progressBar.progress();
         // scanpoint is calculated using min, max, which are the hCL x-Axis limits set in this->initScan()
@@ -476,6 +493,16 @@ int MethodDatasetsProbScan::scan1d(bool fast, bool reverse)
     if (bkgOnlyFitResult) bkgOnlyFitResult->Write();
     if (dataFreeFitResult) dataFreeFitResult->Write();
     outputFile->Close();
+    if ( nWorkers>1 ){
+        if ( iWorker>0 ) exitWorker(iWorker);
+        waitForWorkers(workers);
+        outputFile = new TFile(probResName, "RECREATE");
+        TTree* merged = mergeWorkerFiles("plugin", probResName, nWorkers, "scanpoint");
+        merged->Write();
+        if (bkgOnlyFitResult) bkgOnlyFitResult->Write();
+        if (dataFreeFitResult) dataFreeFitResult->Write();
+        outputFile->Close();
+    }
     std::cout << "Wrote ToyTree to file" << std::endl;
     delete parsFunctionCall;
 
@@ -484,9 +511,134 @@ int MethodDatasetsProbScan::scan1d(bool fast, bool reverse)
     // \todo: use this->sethCLFromProbScanTree() directly after figuring out the cause of the segfault.
     this->loadScanFromFile();
 
+    if ( arg->asymptoticcls ) this->computeAsymptoticCLs();
+
     return 0;
 }
 
+///
+/// The asymptotic expected CLs at a given CLb, see computeAsymptoticCLs().
+///
+double MethodDatasetsProbScan::asymptoticCLsExpected(double qA, double clb)
+{
+    double clsb = 1. - TMath::Freq( sqrt(qA) - TMath::NormQuantile(clb) );
+    return TMath::Min( clsb / clb, 1. );
+}
+
+///
+/// The asymptotic observed CLs, see computeAsymptoticCLs(). Both CLs+b and
+/// CLb are one-sided, as for the expected CLs. Data at the median
+/// expectation, qObs = qA, gives the median expected CLs.
+///
+double MethodDatasetsProbScan::asymptoticCLsObserved(double qA, double qObs)
+{
+    double clsb = 1. - TMath::Freq( sqrt(qObs) );
+    double clb = TMath::Freq( sqrt(qA) - sqrt(qObs) );
+    if ( clb <= 0. || clsb / clb >= 1. ) return 1.;
+    return clsb / clb;
+}
+
+///
+/// Compute the observed and expected CLs with the asymptotic formulae of
+/// Cowan, Cranmer, Gross, Vitells (arXiv:1007.1727), instead of toys. This fills
+/// hCLsFreq, hCLsExp and the error bands, as MethodDatasetsPluginScan::readScan1dTrees()
+/// does from toys, so that they can be plotted the same way (--cls 2).
+///
+/// The one-sided test statistic q_mu of the background-only Asimov dataset, q_A,
+/// sets the width of its distribution. With N = Phi^-1(CLb):
+///
+///   expected: CLs = (1 - Phi(sqrt(q_A) - N)) / CLb, at the CLb values of the toy bands
+///   observed: CLs+b = 1 - Phi(sqrt(q_obs)), CLb = Phi(sqrt(q_A) - sqrt(q_obs)), CLs = CLs+b / CLb
+///
+/// Data at the median expectation, q_obs = q_A, gives the median expected CLs.
+///
+/// The Asimov dataset is generated at the background-only fit to data, and fitted
+/// once with the scan parameter floating, and once per scan point with the scan
+/// parameter fixed. The global observables are kept at their values in data.
+///
+void MethodDatasetsProbScan::computeAsymptoticCLs()
+{
+    ProfileTimer pt("MethodDatasetsProbScan::computeAsymptoticCLs");
+    if ( !bkgOnlyFitResult ) {
+        cout << "MethodDatasetsProbScan::computeAsymptoticCLs() : ERROR : no background-only fit result, run with --cls" << endl;
+        exit(EXIT_FAILURE);
+    }
+    cout << "MethodDatasetsProbScan::computeAsymptoticCLs() : fitting the background-only Asimov dataset ..." << endl;
+    RooRealVar *parameterToScan = w->var(scanVar1);
+    RooDataSet* parsFunctionCall = new RooDataSet("parsFunctionCall", "parsFunctionCall", *w->set(pdf->getParName()));
+    parsFunctionCall->add(*w->set(pdf->getParName()));
+
+    // generate the Asimov dataset at the background-only fit to data
+    setParameters(w, bkgOnlyFitResult);
+    if ( !pdf->getBkgPdf() ) parameterToScan->setVal(parameterToScan->getMin("scan"));
+    RooDataSet* asimov = pdf->generateBkgAsimov();
+    RooDataSet* parsAsimov = new RooDataSet("parsAsimov", "parsAsimov", *w->set(pdf->getParName()));
+    parsAsimov->add(*w->set(pdf->getParName()));
+
+    // free fit to the Asimov dataset
+    if ( !w->loadSnapshot(pdf->globalObsDataSnapshotName) ) {
+        cout << "MethodDatasetsProbScan::computeAsymptoticCLs() : ERROR : no snapshot " << pdf->globalObsDataSnapshotName << " found" << endl;
+        exit(EXIT_FAILURE);
+    }
+    parameterToScan->setConstant(false);
+    RooFitResult* r = pdf->fit(asimov);
+    double chi2minAsimov = 2 * pdf->getMinNll();
+    double scanbestAsimov = parameterToScan->getVal();
+    delete r;
+    pdf->deleteNLL();
+
+    TH1F** hists[6] = { &hCLsFreq, &hCLsExp, &hCLsErr1Up, &hCLsErr1Dn, &hCLsErr2Up, &hCLsErr2Dn };
+    TString names[6] = { "hCLsFreq", "hCLsExp", "hCLsErr1Up", "hCLsErr1Dn", "hCLsErr2Up", "hCLsErr2Dn" };
+    for ( int k = 0; k < 6; k++ ) {
+        delete *hists[k];
+        *hists[k] = (TH1F*)hCL->Clone(names[k]);
+        (*hists[k])->Reset();
+    }
+
+    // the CLb values of the expected bands, as for the toys (-2, -1, 0, +1, +2 sigma)
+    std::vector<double> clb_vals = { 1.-TMath::Prob(4,1), 1.-TMath::Prob(1,1), 0.5, TMath::Prob(1,1), TMath::Prob(4,1) };
+    TH1F* hBands[5] = { hCLsErr2Up, hCLsErr1Up, hCLsExp, hCLsErr1Dn, hCLsErr2Dn };
+    int iBinBestFit = hCL->GetMaximumBin();
+
+    ProgressBar progressBar(arg, hCL->GetNbinsX());
+    for ( int i = 1; i <= hCL->GetNbinsX(); i++ ) {
+        progressBar.progress();
+        double scanpoint = hCL->GetBinCenter(i);
+
+        // q_A: fit to the Asimov dataset at the scan point
+        setParameters(w, pdf->getParName(), parsAsimov->get(0));
+        parameterToScan->setVal(scanpoint);
+        parameterToScan->setConstant(true);
+        w->loadSnapshot(pdf->globalObsDataSnapshotName);
+        r = pdf->fit(asimov);
+        double qA = scanpoint > scanbestAsimov ? TMath::Max(2 * pdf->getMinNll() - chi2minAsimov, 0.) : 0.;
+        delete r;
+        pdf->deleteNLL();
+
+        // expected
+        for ( int k = 0; k < 5; k++ ) hBands[k]->SetBinContent( i, asymptoticCLsExpected(qA, clb_vals[k]) );
+
+        // observed, with the one-sided CLs+b rather than the two-sided p-value of hCL
+        double qObs = TMath::Max( hChi2min->GetBinContent(i) - chi2minGlobal, 0. );
+        if ( i <= iBinBestFit ) hCLsFreq->SetBinContent(i, 1.);
+        else hCLsFreq->SetBinContent(i, asymptoticCLsObserved(qA, qObs));
+        hCLsFreq->SetBinError(i, 0.);
+
+        if ( arg->debug ) {
+            cout << "DEBUG in MethodDatasetsProbScan::computeAsymptoticCLs() - scanpoint " << scanpoint << " : q_A = " << qA
+                 << " q_obs = " << qObs << " CLs obs = " << hCLsFreq->GetBinContent(i) << " exp = " << hCLsExp->GetBinContent(i) << endl;
+        }
+    }
+
+    // reset
+    setParameters(w, pdf->getParName(), parsFunctionCall->get(0));
+    w->loadSnapshot(pdf->globalObsDataSnapshotName);
+    parameterToScan->setConstant(false);
+    delete asimov;
+    delete parsAsimov;
+    delete parsFunctionCall;
+}
+
 // sanity Checks for 2D scan \TODO: Idea: enlargen this function to be used for all scans
 void MethodDatasetsProbScan::sanityChecks()
 {
@@ -508,6 +660,7 @@ void MethodDatasetsProbScan::sanityChecks()
 // Working at 2D scan by first copying the original ProbScan
 int MethodDatasetsProbScan::scan2d()
 {
+    ProfileTimer pt("MethodDatasetsProbScan::scan2d");
     if ( arg->debug ) cout << "MethodDatasetsProbScan::scan2d() : starting ..." << endl;
     nScansDone++;
     sanityChecks();
@@ -559,6 +712,12 @@ int MethodDatasetsProbScan::scan2d()
     par1->setConstant(true);
     par2->setConstant(true);
 
+    // With several workers (--scanworkers), fit all points in parallel
+    // first, the spiral below then collects the results. With one worker,
+    // the spiral fits them itself.
+    map<pair<int,int>,pair<RooSlimFitResult*,double> > workerResults;
+    if ( arg->scanworkers>1 ) fitPoints2dInWorkers(workerResults);
+
     // Report on the smallest new minimum we come across while scanning.
     // Sometimes the scan doesn't find the minimum
     // that was found before. Warn if this happens.
@@ -594,12 +753,6 @@ int MethodDatasetsProbScan::scan2d()
     hDbgStart->SetBinContent(iStart, jStart, 500.);
     TMarker *startpointmark = new TMarker(par1->getVal(),par2->getVal(),3);
 
-    // timer
-    TStopwatch tFit;
-    TStopwatch tSlimResult;
-    TStopwatch tScan;
-    TStopwatch tMemory;
-
     // set up the scan spiral
     int X = 2*nPoints2dx;
     int Y = 2*nPoints2dy;
@@ -617,7 +770,6 @@ int MethodDatasetsProbScan::scan2d()
             int j = y+jStart;
             if ( i>0 && i<=nPoints2dx && j>0 && j<=nPoints2dy )
             {
-                tScan.Start(false);
 
                 // status bar
                 if (((int)nSteps % (int)(nTotalSteps/printFreq)) == 0){
@@ -636,7 +788,6 @@ int MethodDatasetsProbScan::scan2d()
                 if ( rStartPars ) setParameters(w, parsName, rStartPars);
 
                 // memory management:
-                tMemory.Start(false);
                 // delete old, inner fit results, that we don't need for start parameters anymore
                 // for this we take the second-inner-most turn.
                 int iOld, jOld;
@@ -645,7 +796,6 @@ int MethodDatasetsProbScan::scan2d()
                     deleteIfNotInCurveResults2d(mycurveResults2d[iOld-1][jOld-1]);
                     mycurveResults2d[iOld-1][jOld-1] = 0;
                 }
-                tMemory.Stop();
 
                 // alternative choice for start parameters: always from what we found at function call
                 // setParameters(w, parsName, startPars->get(0));
@@ -657,19 +807,25 @@ int MethodDatasetsProbScan::scan2d()
                 par2->setVal(scanvalue2);
 
                 // fit!
-                tFit.Start(false);
-                RooFitResult *fr;
-                // if ( !arg->probforce ) fr = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
-                // else                   fr = fitToMinForce(w, combiner->getPdfName());
-
-                fr = this->loadAndFit(this->pdf);   //Titus: change fitting strategy to the one from the datasets \todo: should be possible to use the fittominforce etc methods
-                // double chi2minScan = 2 * fr->minNll(); //Titus: take 2*minNll vs. minNll? Where is the squared in the main gammacombo?
-                double chi2minScan = 2 * pdf->getMinNll();
-                tFit.Stop();
-                tSlimResult.Start(false);
-                RooSlimFitResult *r = new RooSlimFitResult(fr); // try to save memory by using the slim fit result
-                tSlimResult.Stop();
-                delete fr;
+                RooSlimFitResult *r;
+                double chi2minScan;
+                map<pair<int,int>,pair<RooSlimFitResult*,double> >::iterator fitted = workerResults.find(make_pair(i,j));
+                if ( fitted!=workerResults.end() ){
+                    // fitted by a worker
+                    r = fitted->second.first;
+                    chi2minScan = fitted->second.second;
+                }
+                else {
+                    RooFitResult *fr;
+                    // if ( !arg->probforce ) fr = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
+                    // else                   fr = fitToMinForce(w, combiner->getPdfName());
+
+                    fr = this->loadAndFit(this->pdf);   //Titus: change fitting strategy to the one from the datasets \todo: should be possible to use the fittominforce etc methods
+                    // double chi2minScan = 2 * fr->minNll(); //Titus: take 2*minNll vs. minNll? Where is the squared in the main gammacombo?
+                    chi2minScan = 2 * pdf->getMinNll();
+                    r = new RooSlimFitResult(fr); // try to save memory by using the slim fit result
+                    delete fr;
+                }
                 allResults.push_back(r);
                 bestMinFoundInScan = TMath::Min((double)chi2minScan, (double)bestMinFoundInScan);
                 mycurveResults2d[i-1][j-1] = r;
@@ -722,7 +878,6 @@ int MethodDatasetsProbScan::scan2d()
                     startpointmark->Draw();
                     cDbg->Update();
                 }
-                tScan.Stop();
             }
         }
         // spiral stuff:
@@ -736,12 +891,6 @@ int MethodDatasetsProbScan::scan2d()
         y += dy;
     }
     cout << "MethodDatasetsProbScan::scan2d() : scan done.            " << endl;
-    if ( arg->debug ){
-        cout << "MethodDatasetsProbScan::scan2d() : full scan time:             "; tScan.Print();
-        cout << "MethodDatasetsProbScan::scan2d() : - fitting:                  "; tFit.Print();
-        cout << "MethodDatasetsProbScan::scan2d() : - create RooSlimFitResults: "; tSlimResult.Print();
-        cout << "MethodDatasetsProbScan::scan2d() : - memory management:        "; tMemory.Print();
-    }
     setParameters(w, parsName, startPars->get(0));
 
     saveSolutions2d();
@@ -764,6 +913,125 @@ int MethodDatasetsProbScan::scan2d()
 }
 
 
+///
+/// Squared distance of two bins of a 2D scan, in bins.
+///
+static int binDistance2(int i1, int j1, int i2, int j2)
+{
+    return (i1-i2)*(i1-i2) + (j1-j2)*(j1-j2);
+}
+
+///
+/// Fit all points of the 2D scan in --scanworkers worker processes.
+/// Each worker has its own copy of the workspace, and fits a contiguous
+/// slice of the grid. Within its slice it starts at the point closest to
+/// the start point of the spiral of scan2d(), from the parameters at the
+/// call of scan2d(), and then goes outwards. Every further point starts
+/// from the parameters of the nearest point already fitted in the same
+/// slice, like the spiral starts from its inner turn. Only the first
+/// point of each slice is fitted without a fitted neighbour, so slices
+/// far from the minimum may end in a different local minimum than the
+/// serial spiral, and the result can depend on the number of workers.
+/// The workers save their fit results to files, from which this process
+/// collects them. Points of failed workers are missing in the results.
+///
+/// \param results - filled with the fit result and chi2 of each point, keyed by the bin numbers (i,j)
+///
+void MethodDatasetsProbScan::fitPoints2dInWorkers(map<pair<int,int>,pair<RooSlimFitResult*,double> >& results)
+{
+    int nPoints = nPoints2dx*nPoints2dy;
+    int nWorkers = TMath::Max(1, TMath::Min(arg->scanworkers, nPoints));
+    system("mkdir -p root");
+    TString fileName = "root/scan2dDatasetsProb_" + this->pdf->getName() + "_" + scanVar1 + "_" + scanVar2 + ".root";
+    RooRealVar *par1 = w->var(scanVar1);
+    RooRealVar *par2 = w->var(scanVar2);
+
+    // the start point of the spiral, see scan2d()
+    int iStart = max(min(hCL2d->GetXaxis()->FindBin(par1->getVal()), hCL2d->GetNbinsX()), 1);
+    int jStart = max(min(hCL2d->GetYaxis()->FindBin(par2->getVal()), hCL2d->GetNbinsY()), 1);
+
+    vector<pid_t> workers;
+    int iWorker = forkWorkers(nWorkers, workers);
+    if ( iWorker<0 ){
+        cout << "MethodDatasetsProbScan::fitPoints2dInWorkers() : ERROR : could not start the scan workers" << endl;
+        exit(1);
+    }
+
+    // the slice of this worker, ordered by the distance to its point
+    // closest to the start point
+    int nFirst = iWorker*nPoints/nWorkers;
+    int nLast = (iWorker+1)*nPoints/nWorkers;
+    int nSeed = nFirst;
+    for ( int n=nFirst; n<nLast; n++ ){
+        if ( binDistance2(n/nPoints2dy+1, n%nPoints2dy+1, iStart, jStart)
+                < binDistance2(nSeed/nPoints2dy+1, nSeed%nPoints2dy+1, iStart, jStart) ) nSeed = n;
+    }
+    vector<pair<int,int> > order; // (squared distance to the seed point, point)
+    for ( int n=nFirst; n<nLast; n++ ){
+        order.push_back(make_pair(binDistance2(n/nPoints2dy+1, n%nPoints2dy+1, nSeed/nPoints2dy+1, nSeed%nPoints2dy+1), n));
+    }
+    sort(order.begin(), order.end());
+
+    TFile *f = new TFile(workerFileName(fileName, iWorker), "RECREATE");
+    ProgressBar progressBar(arg, order.size());
+    vector<RooSlimFitResult*> fitted;
+    vector<int> fittedPoints;
+    for ( unsigned int k=0; k<order.size(); k++ ){
+        progressBar.progress();
+        int i = order[k].second/nPoints2dy+1;
+        int j = order[k].second%nPoints2dy+1;
+
+        // start parameters from the nearest point fitted so far
+        int iNearest = -1;
+        int dNearest = 0;
+        for ( unsigned int l=0; l<fittedPoints.size(); l++ ){
+            int d = binDistance2(i, j, fittedPoints[l]/nPoints2dy+1, fittedPoints[l]%nPoints2dy+1);
+            if ( iNearest<0 || d<dNearest ){
+                iNearest = l;
+                dNearest = d;
+            }
+        }
+        if ( iNearest>=0 ) setParameters(w, parsName, fitted[iNearest]);
+        else setParameters(w, parsName, startPars->get(0));
+
+        par1->setVal(hCL2d->GetXaxis()->GetBinCenter(i));
+        par2->setVal(hCL2d->GetYaxis()->GetBinCenter(j));
+        RooFitResult *fr = this->loadAndFit(this->pdf);
+        TParameter<double> chi2(Form("chi2_%i_%i",i,j), 2 * pdf->getMinNll());
+        RooSlimFitResult *r = new RooSlimFitResult(fr);
+        delete fr;
+        this->pdf->deleteNLL();
+        f->cd();
+        r->Write(Form("fr_%i_%i",i,j));
+        chi2.Write();
+        fitted.push_back(r);
+        fittedPoints.push_back(order[k].second);
+    }
+    f->Close();
+    delete f;
+    for ( unsigned int k=0; k<fitted.size(); k++ ) delete fitted[k];
+    if ( iWorker>0 ) exitWorker(iWorker);
+    waitForWorkers(workers);
+
+    // collect the points of all workers
+    for ( int k=0; k<nWorkers; k++ ){
+        TString workerFile = workerFileName(fileName, k);
+        if ( !FileExists(workerFile) ) continue;
+        TFile fk(workerFile);
+        for ( int n=k*nPoints/nWorkers; n<(k+1)*nPoints/nWorkers; n++ ){
+            int i = n/nPoints2dy+1;
+            int j = n%nPoints2dy+1;
+            RooSlimFitResult *r = (RooSlimFitResult*)fk.Get(Form("fr_%i_%i",i,j));
+            TParameter<double> *chi2 = (TParameter<double>*)fk.Get(Form("chi2_%i_%i",i,j));
+            if ( r && chi2 ) results[make_pair(i,j)] = make_pair(r, chi2->GetVal());
+            delete chi2;
+        }
+        fk.Close();
+        gSystem->Unlink(workerFile);
+    }
+    setParameters(w, parsName, startPars->get(0));
+}
+
 double MethodDatasetsProbScan::getPValueTTestStatistic(double test_statistic_value, bool isCLs) {
     if ( test_statistic_value > 0) {
         // this is the normal case
@@ -810,7 +1078,7 @@ void MethodDatasetsProbScan::plotFitRes(TString fName) {
     leg->SetLineColor(0);
     RooPlot *plot = w->var(fitVar)->frame();
     // data invisible for norm
-    w->data(pdf->getDataName())->plotOn( plot, Invisible() );
+    pdf->getData()->plotOn( plot, Invisible() );
     // bkg pdf
     if( pdf->getBkgPdf() ){
         if ( !bkgOnlyFitResult ) {
@@ -841,7 +1109,7 @@ void MethodDatasetsProbScan::plotFitRes(TString fName) {
     // data unblinded if needed
     map<TString,TString> unblindRegs = pdf->getUnblindRegions();
     if ( unblindRegs.find( fitVar ) != unblindRegs.end() ) {
-      w->data(pdf->getDataName())->plotOn( plot, CutRange(pdf->getUnblindRegions()[fitVar]) );
+      pdf->getData()->plotOn( plot, CutRange(pdf->getUnblindRegions()[fitVar]) );
       leg->AddEntry( plot->getObject(plot->numItems()-1), "Data", "LEP");
     }
     plot->Draw();
@@ -6,6 +6,9 @@
  */
 
 #include "MethodPluginScan.h"
+#include "Profiler.h"
+
+#include <unistd.h>
 
 ///
 /// Initialize from a previous Prob scan, setting the profile
@@ -87,6 +90,18 @@ void MethodPluginScan::setParevolPLH(MethodProbScan* s)
 	parevolPLH = s;
 }
 
+///
+/// Take the current values of the observables as the observed ones.
+/// They are restored after fitting the toys. Use this to reuse one
+/// scanner for several sets of observed values, e.g. the outer toys
+/// of a coverage study.
+///
+void MethodPluginScan::storeObservables()
+{
+	obsDataset->reset();
+	obsDataset->add(*w->set(obsName));
+}
+
 ///
 /// Helper function for scan1d(). Gets point in parameter space (in form
 /// of a RooFitResult) at which the plugin toy should be generated.
@@ -132,13 +147,14 @@ RooSlimFitResult* MethodPluginScan::getParevolPoint(float scanpoint)
 }
 
 ///
-/// Generate toys.
+/// Generate toys. The random generator isn't reseeded here, the scans
+/// seed it once per worker, see Utils::seedWorker().
 ///
 /// \param nToys - generate this many toys
 ///
 RooDataSet* MethodPluginScan::generateToys(int nToys)
 {
-	RooRandom::randomGenerator()->SetSeed(0);
+	ProfileTimer pt("MethodPluginScan::generateToys");
 	RooMsgService::instance().setStreamStatus(0,kFALSE);
 	RooMsgService::instance().setStreamStatus(1,kFALSE);
 	RooDataSet* dataset = w->pdf(pdfName)->generate(*w->set(obsName), nToys, AutoBinned(false));
@@ -259,10 +275,16 @@ RooDataSet* MethodPluginScan::generateToys(int nToys)
 ///                 fitter object can compute some fit statistics for an entire
 ///                 1-CL scan.
 /// \param pb       A progress bar object used to print nice progress output.
+/// \param reuse    Optional toys of an earlier scan point (--reusetoys). If
+///                 their weights at this point leave a large enough effective
+///                 sample size, they are used instead of new toys, and only the
+///                 scan fit is repeated. Else new toys are generated, and replace
+///                 the reused ones.
+/// \param nToysPoint Number of toys to run at this point. Default: -1, nToys.
 /// \return         the p-value.
 ///
 void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id,
-		Fitter* f, ProgressBar *pb)
+		Fitter* f, ProgressBar *pb, ReusedToys* reuse, int nToysPoint)
 {
 	// Check inputs.
 	assert(plhScan);
@@ -320,11 +342,17 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
 
 	// save nuisances for start parameters
 	frCache.storeParsAtGlobalMin(w->set(parsName));
+	frCache.storeParsPredicted(w->set(parsName));
+
+	// Predicts the scan fit of the next toy from the free fit of the
+	// current one, along the slopes of the profile likelihood.
+	ScanPredictor predictor(w, parsName, scanVar1, profileLH ? profileLH->getGlobalMin() : 0);
 
 	// set and fix scan point
 	RooRealVar *par = w->var(scanVar1);
 	par->setConstant(true);
 	float scanpoint = par->getVal();
+	pb->setScanpoint(scanpoint);
 
 	// get the chi2 of the data
 	t->scanpoint = scanpoint;
@@ -335,15 +363,42 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
 	t->chi2minGlobal = chi2minGlobal;
 
 	// Importance sampling
-	int nActualToys = nToys;
+	if ( nToysPoint<0 ) nToysPoint = nToys;
+	int nActualToys = nToysPoint;
 	if ( arg->importance ){
 		float plhPvalue = TMath::Prob(t->chi2min - t->chi2minGlobal,1);
-		nActualToys = nToys*importance(plhPvalue);
-		pb->skipSteps(nToys-nActualToys);
+		nActualToys = nToysPoint*importance(plhPvalue);
+		pb->skipSteps(nToysPoint-nActualToys);
+	}
+
+	// Reuse the toys of an earlier scan point, if their weights at this point
+	// still leave enough effective toys.
+	bool reusing = false;
+	if ( reuse && reuse->toys ){
+		reusing = reuse->reweighter.reweight(getToyLogDensities(reuse->toys));
+		if ( arg->verbose ){
+			cout << "MethodPluginScan::computePvalue1d() : effective sample size of reused toys at "
+				<< scanVar1 << "=" << scanpoint << ": " << Form("%.1f", reuse->reweighter.getEss())
+				<< (reusing ? "" : ", generating new toys") << endl;
+		}
 	}
 
 	// Draw all toy datasets in advance. This is much faster.
-	RooDataSet *toyDataSet = generateToys(nActualToys);
+	RooDataSet *toyDataSet = reusing ? reuse->toys : generateToys(nActualToys);
+	ParameterBinding toyObs(w->set(obsName), toyDataSet->get()); // get(j) loads into the same RooArgSet
+
+	// New toys become the ones to reuse. Their densities are
+	// computed at the parameters they were generated with.
+	if ( reuse && !reusing ){
+		delete reuse->toys;
+		delete reuse->parsFree;
+		reuse->toys = toyDataSet;
+		reuse->parsFree = new RooDataSet("parsFree", "parsFree", *w->set(parsName));
+		reuse->chi2minGlobalToy.clear();
+		reuse->statusFree.clear();
+		reuse->reweighter.setSource(getToyLogDensities(toyDataSet));
+	}
+	if ( reusing ) profileCount("MethodPluginScan reused toy sets");
 
 	for ( int j = 0; j<nActualToys; j++ )
 	{
@@ -354,16 +409,17 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
 		// 1. Generate toys
 		//    (or select the right one)
 		//
-		const RooArgSet* toyData = toyDataSet->get(j);
-		setParameters(w, obsName, toyData);
+		toyDataSet->get(j);
+		toyObs.apply();
 		t->storeObservables();
+		t->weight = reuse ? reuse->reweighter.getWeight(j) : 1.;
 
 		//
 		// 2. scan fit
 		//
 		par->setVal(scanpoint);
 		par->setConstant(true);
-		f->setStartparsFirstFit(frCache.getRoundRobinNminus(0));
+		f->setStartparsFirstFit(arg->scanpredict ? frCache.getParsPredicted() : frCache.getRoundRobinNminus(0));
 		f->setStartparsSecondFit(frCache.getParsAtGlobalMin());
 		f->fit();
 		if ( f->getStatus()==1 ){
@@ -374,31 +430,83 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
 		t->chi2minToy = f->getChi2();
 		t->statusScan = f->getStatus();
 		t->storeParsScan();
+		pb->fitDone(t->statusScan);
 
 		//
 		// 3. free fit
+		//    (it doesn't depend on the scan point, so reused
+		//    toys keep the one from their source point, unless
+		//    the scan fit found a lower minimum: then the free
+		//    fit is redone from the scan fit, as for new toys,
+		//    instead of counting a negative test statistic)
 		//
 		par->setConstant(false);
-		f->fit();
-		if ( f->getStatus()==1 ){
+		bool refit = reusing && t->chi2minToy < reuse->chi2minGlobalToy[j];
+		if ( refit ) profileCount("MethodPluginScan reused free fits redone");
+		if ( reusing && !refit ){
+			setParameters(w, parsName, reuse->parsFree->get(j));
+			t->chi2minGlobalToy = reuse->chi2minGlobalToy[j];
+			t->statusFree = reuse->statusFree[j];
+		}
+		else{
 			f->fit();
+			if ( f->getStatus()==1 ){
+				f->fit();
+			}
+			t->chi2minGlobalToy = f->getChi2();
+			t->statusFree = f->getStatus();
+			pb->fitDone(t->statusFree);
+			if ( reuse && !reusing ){
+				reuse->parsFree->add(*w->set(parsName));
+				reuse->chi2minGlobalToy.push_back(t->chi2minGlobalToy);
+				reuse->statusFree.push_back(t->statusFree);
+			}
 		}
-		t->chi2minGlobalToy = f->getChi2();
-		t->statusFree = f->getStatus();
 		t->scanbest = ((RooRealVar*)w->set(parsName)->find(scanVar1))->getVal();
 		t->storeParsFree();
 
 		//
 		// 4. store
 		//
-		if ( t->statusFree==0 ) frCache.storeParsRoundRobin(w->set(parsName));
+		if ( t->statusFree==0 ){
+			frCache.storeParsRoundRobin(w->set(parsName));
+			if ( arg->scanpredict ){
+				predictor.shift(t->scanbest, scanpoint);
+				frCache.storeParsPredicted(w->set(parsName));
+			}
+		}
 		t->fill();
 	}
 
 	// clean up
-	setParameters(w, parsName, frCache.getParsAtFunctionCall());
+	frCache.getParsAtFunctionCall().apply();
 	setParameters(w, obsName, obsDataset->get(0));
-	delete toyDataSet;
+	t->weight = 1.;
+	if ( !reuse ) delete toyDataSet;
+}
+
+///
+/// Log densities of toys at the current parameters, used to
+/// reweight them to another generating point.
+///
+/// \param toys - toys as generated by generateToys()
+/// \return per toy, the log of the combined PDF, normalized
+///         over the observables
+///
+vector<double> MethodPluginScan::getToyLogDensities(RooDataSet* toys)
+{
+	ProfileTimer pt("MethodPluginScan::getToyLogDensities");
+	RooAbsPdf* pdf = w->pdf(pdfName);
+	const RooArgSet* obs = w->set(obsName);
+	ParameterBinding toyObs(obs, toys->get());
+	vector<double> logDensities;
+	for ( int j=0; j<toys->numEntries(); j++ ){
+		toys->get(j);
+		toyObs.apply();
+		logDensities.push_back(pdf->getLogVal(obs));
+	}
+	setParameters(w, obsName, obsDataset->get(0));
+	return logDensities;
 }
 
 double MethodPluginScan::getPvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id)
@@ -429,6 +537,7 @@ double MethodPluginScan::getPvalue1d(RooSlimFitResult* plhScan, double chi2minGl
 	if ( arg->controlplot ) {
 		ControlPlots cp(myTree);
 		cp.ctrlPlotChi2();
+		cp.makeCtrlPlots();
 	}
 	TH1F *h = analyseToys(myTree, id);
 	float scanpoint = plhScan->getParVal(scanVar1);
@@ -447,7 +556,7 @@ double MethodPluginScan::getPvalue1d(RooSlimFitResult* plhScan, double chi2minGl
 ///
 /// Perform the 1d Plugin scan.
 /// Saves chi2 values in a root tree, together with the full fit result for each toy.
-/// If option --lightfiles is given, the tree will only contain the essentials (min Chi2).
+/// The branches beyond the essentials (min Chi2) are selected by --toycolumns (--lightfiles: core only).
 /// If a combined PDF for the toy generation is given by setParevolPLH(), this
 /// will be used to generate the toys.
 ///
@@ -476,12 +585,41 @@ int MethodPluginScan::scan1d(int nRun)
 		cout << "  scan steps:     " << nPoints1d << endl;
 		cout << "  par. evolution: " << (parevolPLH!=profileLH?parevolPLH->getTitle():"same as combination") << endl;
 		cout << "  nToys:          " << nToys << endl;
+		if ( arg->reusetoys>0 ) cout << "  reuse toys:     down to an effective sample size of " << arg->reusetoys*nToys << endl;
 		cout << endl;
 	}
 
-	// Set up toy root tree
+	// Set up toy root tree. It is created in the output
+	// file, so that it gets flushed to disk while filling.
+	TString dirname = "root/scan1dPlugin";
+  if ( arg->isAction("bb") ) dirname += "BergerBoos";
+  if ( arg->isAction("uniform") ) dirname += "Uniform";
+  if ( arg->isAction("gaus") ) dirname += "Gaus";
+  dirname += "_"+name+"_"+scanVar1;
+	system("mkdir -p "+dirname);
+  TString fname = "/scan1dPlugin";
+  if ( arg->isAction("bb") ) fname += "BergerBoos";
+  if ( arg->isAction("uniform") ) fname += "Uniform";
+  if ( arg->isAction("gaus") ) fname += "Gaus";
+  fname += Form("_"+name+"_"+scanVar1+"_run%i.root",nRun);
+
+	// Split the toys into (scan point, block of toys) tasks, which the
+	// worker processes (--toyworkers) take from a shared queue. Every
+	// worker fills its own toy file, the first one merges them at the end.
+	int nWorkers = arg->toyworkers;
+	// Every worker gets its own seed, derived from one of the whole run.
+	ToyTaskQueue queue(nPoints1d, nToys, (nToys+nWorkers-1)/nWorkers);
+	UInt_t runSeed = RooRandom::randomGenerator()->Integer(kMaxUInt);
+	vector<pid_t> workers;
+	int iWorker = forkWorkers(nWorkers, workers);
+	if ( iWorker<0 ){
+		cout << "MethodPluginScan::scan1d() : ERROR : could not start the toy workers" << endl;
+		exit(1);
+	}
+	seedWorker(runSeed, iWorker);
+	TString fileName = nWorkers>1 ? workerFileName(dirname+fname, iWorker) : dirname+fname;
 	ToyTree t(combiner);
-	t.init();
+	t.init(fileName);
 	t.nrun = nRun;
 
 	// Save parameter values that were active at function
@@ -491,50 +629,93 @@ int MethodPluginScan::scan1d(int nRun)
 	frCache.storeParsAtFunctionCall(w->set(parsName));
 
 	// for the progress bar: if more than 100 steps, show 50 status messages.
+	// The first worker shows the toys of all workers.
 	int allSteps = nPoints1d*nToys;
 	ProgressBar *pb = new ProgressBar(arg, allSteps);
+	if ( iWorker>0 ) pb->setSilent();
+	Heartbeat *hb = arg->heartbeat>0 && iWorker==0 ? new Heartbeat(Heartbeat::getFileName(dirname+fname), allSteps, arg->heartbeat) : 0;
+	pb->setHeartbeat(hb);
+
+	// toys carried over between the scan points
+	ReusedToys *reuse = arg->reusetoys>0 ? new ReusedToys(arg->reusetoys) : 0;
 
 	// start scan
 	if ( arg->debug ) cout << "MethodPluginScan::scan1d() : ";
 	cout << "PLUGIN scan starting ..." << endl;
-	for ( int i=0; i<nPoints1d; i++ )
+	int i, nToysTask;
+	while ( queue.next(i, nToysTask) )
 	{
+		showProgressOfToyWorkers(queue, pb);
 		float scanpoint = min + (max-min)*(double)i/(double)nPoints1d + hCL->GetBinWidth(1)/2.;
 		t.scanpoint = scanpoint;
 
-		// don't scan in unphysical region
-		if ( scanpoint < par->getMin() || scanpoint > par->getMax() ) continue;
+		// don't scan in unphysical region, but count the toys as done
+		if ( scanpoint < par->getMin() || scanpoint > par->getMax() ){
+			queue.done(nToysTask, 0, 0);
+			pb->skipSteps(nToysTask);
+			continue;
+		}
 
 		// Get nuisances. This is the point in parameter space where
 		// the toys need to be generated.
 		RooSlimFitResult* plhScan = getParevolPoint(scanpoint);
 
 		// do the work
-		computePvalue1d(plhScan, profileLH->getChi2minGlobal(), &t, i, myFit, pb);
+		int nFits = pb->getNFits();
+		int nFitsFailed = pb->getNFitsFailed();
+		computePvalue1d(plhScan, profileLH->getChi2minGlobal(), &t, i, myFit, pb, reuse, nToysTask);
+		queue.done(nToysTask, pb->getNFits()-nFits, pb->getNFitsFailed()-nFitsFailed);
 
 		// reset
-		setParameters(w, parsName, frCache.getParsAtFunctionCall());
+		frCache.getParsAtFunctionCall().apply();
 		setParameters(w, obsName, obsDataset->get(0));
 	}
 
 	if ( arg->debug ) myFit->print();
-	TString dirname = "root/scan1dPlugin";
-  if ( arg->isAction("bb") ) dirname += "BergerBoos";
-  if ( arg->isAction("uniform") ) dirname += "Uniform";
-  if ( arg->isAction("gaus") ) dirname += "Gaus";
-  dirname += "_"+name+"_"+scanVar1;
-	system("mkdir -p "+dirname);
-  TString fname = "/scan1dPlugin";
-  if ( arg->isAction("bb") ) fname += "BergerBoos";
-  if ( arg->isAction("uniform") ) fname += "Uniform";
-  if ( arg->isAction("gaus") ) fname += "Gaus";
-  fname += Form("_"+name+"_"+scanVar1+"_run%i.root",nRun);
-	t.writeToFile((dirname+fname).Data());
+	t.writeToFile(fileName.Data());
 	delete myFit;
+	if ( nWorkers>1 ) mergeToyWorkers(dirname+fname, nWorkers, iWorker, workers);
+	showProgressOfToyWorkers(queue, pb);
 	delete pb;
+	delete hb;
+	delete reuse;
 	return 0;
 }
 
+///
+/// Collect the toy files of the workers of a plugin scan into its
+/// output file. Workers other than the first one end here.
+///
+/// \param fileName - the output file, the worker files are derived from it
+/// \param nWorkers - number of workers
+/// \param iWorker - number of this worker
+/// \param workers - process IDs of the other workers, see forkWorkers()
+///
+void MethodPluginScan::mergeToyWorkers(TString fileName, int nWorkers, int iWorker, const vector<pid_t>& workers)
+{
+	if ( iWorker>0 ) exitWorker(iWorker);
+	waitForWorkers(workers);
+	TFile *f = new TFile(fileName, "recreate");
+	if ( arg->toycompression>=0 ) f->SetCompressionSettings(arg->toycompression);
+	TTree *merged = mergeWorkerFiles("plugin", fileName, nWorkers, "scanpoint");
+	merged->Write();
+	f->Close();
+	delete f;
+	cout << "saving toys to: " << fileName << endl;
+}
+
+///
+/// Add the toys and fits other workers finished since the last call
+/// to the progress bar and heartbeat of this worker.
+///
+void MethodPluginScan::showProgressOfToyWorkers(ToyTaskQueue& queue, ProgressBar* pb)
+{
+	pb->skipSteps(queue.getNewToysOfOtherWorkers());
+	int nFits, nFitsFailed;
+	queue.getNewFitsOfOtherWorkers(nFits, nFitsFailed);
+	pb->skipFits(nFits, nFitsFailed);
+}
+
 ///
 /// Perform the 2d Plugin scan.
 /// Saves chi2 values in a root tree, together with the full fit result for each toy.
@@ -570,9 +751,34 @@ void MethodPluginScan::scan2d(int nRun)
 		cout << endl;
 	}
 
-	// Set up root tree.
+	// Set up root tree. It is created in the output
+	// file, so that it gets flushed to disk while filling.
+	TString dirname = "root/scan2dPlugin";
+  if ( arg->isAction("bb") ) dirname += "BergerBoos";
+  if ( arg->isAction("uniform") ) dirname += "Uniform";
+  if ( arg->isAction("gaus") ) dirname += "Gaus";
+  dirname += "_"+name+"_"+scanVar1+"_"+scanVar2;
+	system("mkdir -p "+dirname);
+  TString fname = "/scan2dPlugin";
+  if ( arg->isAction("bb") ) fname += "BergerBoos";
+  if ( arg->isAction("uniform") ) fname += "Uniform";
+  if ( arg->isAction("gaus") ) fname += "Gaus";
+  fname += Form("_"+name+"_"+scanVar1+"_"+scanVar2+"_run%i.root",nRun);
+
+	// the toys are run as (scan point, block of toys) tasks, see scan1d()
+	int nWorkers = arg->toyworkers;
+	ToyTaskQueue queue(nPoints2dx*nPoints2dy, nToys, (nToys+nWorkers-1)/nWorkers);
+	UInt_t runSeed = RooRandom::randomGenerator()->Integer(kMaxUInt);
+	vector<pid_t> workers;
+	int iWorker = forkWorkers(nWorkers, workers);
+	if ( iWorker<0 ){
+		cout << "MethodPluginScan::scan2d() : ERROR : could not start the toy workers" << endl;
+		exit(1);
+	}
+	seedWorker(runSeed, iWorker);
+	TString fileName = nWorkers>1 ? workerFileName(dirname+fname, iWorker) : dirname+fname;
 	ToyTree t(combiner);
-	t.init();
+	t.init(fileName);
 	t.nrun = nRun;
 
 	// Save parameter values that were active at function
@@ -584,6 +790,9 @@ void MethodPluginScan::scan2d(int nRun)
 	// for the status bar
 	int allSteps = nPoints2dx*nPoints2dy*nToys;
 	ProgressBar *pb = new ProgressBar(arg, allSteps);
+	if ( iWorker>0 ) pb->setSilent();
+	Heartbeat *hb = arg->heartbeat>0 && iWorker==0 ? new Heartbeat(Heartbeat::getFileName(dirname+fname), allSteps, arg->heartbeat) : 0;
+	pb->setHeartbeat(hb);
 
 	// limit number of warnings
 	int nWarnExtPointDiffer = 0;
@@ -595,37 +804,44 @@ void MethodPluginScan::scan2d(int nRun)
 
 	// start scan
 	cout << "MethodPluginScan::scan2d() : starting ..." << endl;
-	for ( int i1=0; i1<nPoints2dx; i1++ ) {
-		for ( int i2=0; i2<nPoints2dy; i2++ )
+	int iPoint, nToysTask;
+	while ( queue.next(iPoint, nToysTask) )
+	{
+		showProgressOfToyWorkers(queue, pb);
+		int i1 = iPoint/nPoints2dy;
+		int i2 = iPoint%nPoints2dy;
+		float scanpoint1 = min1 + (max1-min1)*(double)i1/(double)nPoints2dx + hCL2d->GetXaxis()->GetBinWidth(1)/2.;
+		float scanpoint2 = min2 + (max2-min2)*(double)i2/(double)nPoints2dy + hCL2d->GetYaxis()->GetBinWidth(1)/2.;
+		t.scanpoint = scanpoint1;
+		t.scanpointy = scanpoint2;
+
+		// don't scan in unphysical region, but count the toys as done
+		if ( scanpoint1 < par1->getMin() || scanpoint1 > par1->getMax()
+				|| scanpoint2 < par2->getMin() || scanpoint2 > par2->getMax() ){
+			queue.done(nToysTask, 0, 0);
+			pb->skipSteps(nToysTask);
+			continue;
+		}
+
+		// Get the global chi2 minimum from the fit to data.
+		t.chi2minGlobal = profileLH->getChi2minGlobal();
+
+		// Get nuisances. This is the point in parameter space where
+		// the toys need to be generated.
+		RooArgList *extCurveResult = 0;
 		{
-			float scanpoint1 = min1 + (max1-min1)*(double)i1/(double)nPoints2dx + hCL2d->GetXaxis()->GetBinWidth(1)/2.;
-			float scanpoint2 = min2 + (max2-min2)*(double)i2/(double)nPoints2dy + hCL2d->GetYaxis()->GetBinWidth(1)/2.;
-			t.scanpoint = scanpoint1;
-			t.scanpointy = scanpoint2;
-
-			// don't scan in unphysical region
-			if ( scanpoint1 < par1->getMin() || scanpoint1 > par1->getMax() ) continue;
-			if ( scanpoint2 < par2->getMin() || scanpoint2 > par2->getMax() ) continue;
-
-			// Get the global chi2 minimum from the fit to data.
-			t.chi2minGlobal = profileLH->getChi2minGlobal();
-
-			// Get nuisances. This is the point in parameter space where
-			// the toys need to be generated.
-			RooArgList *extCurveResult = 0;
-			{
-				int iCurveRes1 = profileLH->getHCL2d()->GetXaxis()->FindBin(scanpoint1)-1;
-				int iCurveRes2 = profileLH->getHCL2d()->GetYaxis()->FindBin(scanpoint2)-1;
-				if ( !profileLH->curveResults2d[iCurveRes1][iCurveRes2] ) {
-					printf("MethodPluginScan::scan2d() : WARNING : curve result not found, "
+			int iCurveRes1 = profileLH->getHCL2d()->GetXaxis()->FindBin(scanpoint1)-1;
+			int iCurveRes2 = profileLH->getHCL2d()->GetYaxis()->FindBin(scanpoint2)-1;
+			if ( !profileLH->curveResults2d[iCurveRes1][iCurveRes2] ) {
+				printf("MethodPluginScan::scan2d() : WARNING : curve result not found, "
+						"id=[%i,%i], val=[%f,%f]\n", iCurveRes1, iCurveRes2, scanpoint1, scanpoint2);
+			}
+			else {
+				if ( arg->debug ){
+					printf("MethodPluginScan::scan2d() : loading start parameters from external 1-CL curve: "
 							"id=[%i,%i], val=[%f,%f]\n", iCurveRes1, iCurveRes2, scanpoint1, scanpoint2);
 				}
-				else {
-					if ( arg->debug ){
-						printf("MethodPluginScan::scan2d() : loading start parameters from external 1-CL curve: "
-								"id=[%i,%i], val=[%f,%f]\n", iCurveRes1, iCurveRes2, scanpoint1, scanpoint2);
-					}
-					extCurveResult = new RooArgList(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal());
+				extCurveResult = new RooArgList(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal());
 
           // Set nuisances. This is the point in parameter space where
           // the toys need to be generated.
@@ -664,130 +880,129 @@ void MethodPluginScan::scan2d(int nRun)
             }
           }
 
-					t.chi2min = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->minNll();
-
-					// check if the scan variable here differs from that of
-					// the external curve
-					RooArgList list = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal();
-					list.add(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->constPars());
-					RooRealVar* var1 = (RooRealVar*)list.find(scanVar1);
-					RooRealVar* var2 = (RooRealVar*)list.find(scanVar2);
-					if ( var1 && var2 ) {
-						// print warnings
-						if ( fabs((scanpoint1-var1->getVal())/scanpoint1) > 0.01 || fabs((scanpoint2-var2->getVal())/scanpoint2) > 0.01 ) {
-								if ( nWarnExtPointDiffer<nWarnExtPointDifferMax || arg->debug ) {
-										if ( fabs((scanpoint1-var1->getVal())/scanpoint1) > 0.01 )
-												cout << "MethodPluginScan::scan2d() : WARNING : scanpoint1 and external point differ by more than 1%: "
-																					  << "scanpoint1=" << scanpoint1 << " var1=" << var1->getVal() << endl;
-										if ( fabs((scanpoint2-var2->getVal())/scanpoint2) > 0.01 )
-												cout << "MethodPluginScan::scan2d() : WARNING : scanpoint2 and external point differ by more than 1%: "
-																					  << "scanpoint2=" << scanpoint2 << " var2=" << var2->getVal() << endl;
-								}
-								if ( nWarnExtPointDiffer==0 ) {
-										cout << endl;
-										cout << "                                       Try using the same number of scan points for both Plugin and Prob." << endl;
-										cout << "                                       See --npoints, --npoints2dx, --npoints2dy, --npointstoy" << endl;
-										cout << endl;
-								}
-								if ( nWarnExtPointDiffer==nWarnExtPointDifferMax ) {
-										cout << "MethodPluginScan::scan2d() : WARNING : scanpoint1 and external point differ by more than 1%: [further warnings suppressed.]" << endl;
-								}
-								nWarnExtPointDiffer++;
-						}
-					}
-					else {
-						cout << "MethodPluginScan::scan2d() : WARNING : variable 1 or 2 not found"
-										      ", var1=" << scanVar1 << ", var2=" << scanVar1 << endl;
-						cout << "MethodPluginScan::scan2d() : Printout follows:" << endl;
-						profileLH->curveResults2d[iCurveRes1][iCurveRes2]->Print();
-						exit(1);
+				t.chi2min = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->minNll();
+
+				// check if the scan variable here differs from that of
+				// the external curve
+				RooArgList list = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal();
+				list.add(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->constPars());
+				RooRealVar* var1 = (RooRealVar*)list.find(scanVar1);
+				RooRealVar* var2 = (RooRealVar*)list.find(scanVar2);
+				if ( var1 && var2 ) {
+					// print warnings
+					if ( fabs((scanpoint1-var1->getVal())/scanpoint1) > 0.01 || fabs((scanpoint2-var2->getVal())/scanpoint2) > 0.01 ) {
+							if ( nWarnExtPointDiffer<nWarnExtPointDifferMax || arg->debug ) {
+									if ( fabs((scanpoint1-var1->getVal())/scanpoint1) > 0.01 )
+											cout << "MethodPluginScan::scan2d() : WARNING : scanpoint1 and external point differ by more than 1%: "
+																				  << "scanpoint1=" << scanpoint1 << " var1=" << var1->getVal() << endl;
+									if ( fabs((scanpoint2-var2->getVal())/scanpoint2) > 0.01 )
+											cout << "MethodPluginScan::scan2d() : WARNING : scanpoint2 and external point differ by more than 1%: "
+																				  << "scanpoint2=" << scanpoint2 << " var2=" << var2->getVal() << endl;
+							}
+							if ( nWarnExtPointDiffer==0 ) {
+									cout << endl;
+									cout << "                                       Try using the same number of scan points for both Plugin and Prob." << endl;
+									cout << "                                       See --npoints, --npoints2dx, --npoints2dy, --npointstoy" << endl;
+									cout << endl;
+							}
+							if ( nWarnExtPointDiffer==nWarnExtPointDifferMax ) {
+									cout << "MethodPluginScan::scan2d() : WARNING : scanpoint1 and external point differ by more than 1%: [further warnings suppressed.]" << endl;
+							}
+							nWarnExtPointDiffer++;
 					}
 				}
+				else {
+					cout << "MethodPluginScan::scan2d() : WARNING : variable 1 or 2 not found"
+									      ", var1=" << scanVar1 << ", var2=" << scanVar1 << endl;
+					cout << "MethodPluginScan::scan2d() : Printout follows:" << endl;
+					profileLH->curveResults2d[iCurveRes1][iCurveRes2]->Print();
+					exit(1);
+				}
 			}
+		}
+
+		// set and fix scan point
+		par1->setVal(scanpoint1);
+		par2->setVal(scanpoint2);
+		par1->setConstant(true);
+		par2->setConstant(true);
+
+		pb->setScanpoint(scanpoint1, scanpoint2);
+
+		// save nuisances to ToyTree tree
+		t.storeParsPll();
+		t.storeTheory();
 
-			// set and fix scan point
+		// Draw toy datasets in advance. This is much faster.
+		int nFits = pb->getNFits();
+		int nFitsFailed = pb->getNFitsFailed();
+		RooDataSet *toyDataSet = generateToys(nToysTask);
+		ParameterBinding toyObs(w->set(obsName), toyDataSet->get()); // get(j) loads into the same RooArgSet
+
+		for ( int j=0; j<nToysTask; j++ )
+		{
+			// status bar
+			pb->progress();
+
+			//
+			// 1. Load toy dataset
+			//
+			toyDataSet->get(j);
+			toyObs.apply();
+			t.storeObservables();
+
+			//
+			// 2. scan fit
+			//
 			par1->setVal(scanpoint1);
 			par2->setVal(scanpoint2);
 			par1->setConstant(true);
 			par2->setConstant(true);
-
-			// save nuisances to ToyTree tree
-			t.storeParsPll();
-			t.storeTheory();
-
-			// Draw toy datasets in advance. This is much faster.
-			RooDataSet *toyDataSet = generateToys(nToys);
-
-			for ( int j=0; j<nToys; j++ )
-			{
-				// status bar
-				pb->progress();
-
-				//
-				// 1. Load toy dataset
-				//
-				const RooArgSet* toyData = toyDataSet->get(j);
-				setParameters(w, obsName, toyData);
-				t.storeObservables();
-
-				//
-				// 2. scan fit
-				//
-				par1->setVal(scanpoint1);
-				par2->setVal(scanpoint2);
-				par1->setConstant(true);
-				par2->setConstant(true);
-				RooFitResult *r;
-				if ( !arg->scanforce ) r = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
-				else                   r = fitToMinForce(w, name);
-				t.chi2minToy = r->minNll();
-				t.statusScan = 0;
-				t.storeParsScan();
-				delete r;
-
-				//
-				// 3. free fit
-				//
-				par1->setVal(scanpoint1);
-				par2->setVal(scanpoint2);
-				par1->setConstant(false);
-				par2->setConstant(false);
-				if ( !arg->scanforce ) r = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
-				else                   r = fitToMinForce(w, name);
-				t.chi2minGlobalToy = r->minNll();
-				t.statusFree = 0;
-				t.scanbest = ((RooRealVar*)w->set(parsName)->find(scanVar1))->getVal();
-				t.scanbesty = ((RooRealVar*)w->set(parsName)->find(scanVar2))->getVal();
-				t.storeParsFree();
-				delete r;
-
-				//
-				// 4. store
-				//
-				t.fill();
-			}
-
-			// reset
-			setParameters(w, parsName, frCache.getParsAtFunctionCall());
-			setParameters(w, obsName, obsDataset->get(0));
-			delete toyDataSet;
+			RooFitResult *r;
+			if ( !arg->scanforce ) r = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
+			else                   r = fitToMinForce(w, name);
+			t.chi2minToy = r->minNll();
+			t.statusScan = 0;
+			t.storeParsScan();
+			pb->fitDone(r->status());
+			delete r;
+
+			//
+			// 3. free fit
+			//
+			par1->setVal(scanpoint1);
+			par2->setVal(scanpoint2);
+			par1->setConstant(false);
+			par2->setConstant(false);
+			if ( !arg->scanforce ) r = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
+			else                   r = fitToMinForce(w, name);
+			t.chi2minGlobalToy = r->minNll();
+			t.statusFree = 0;
+			t.scanbest = ((RooRealVar*)w->set(parsName)->find(scanVar1))->getVal();
+			t.scanbesty = ((RooRealVar*)w->set(parsName)->find(scanVar2))->getVal();
+			t.storeParsFree();
+			pb->fitDone(r->status());
+			delete r;
+
+			//
+			// 4. store
+			//
+			t.fill();
 		}
+
+		// reset
+		frCache.getParsAtFunctionCall().apply();
+		setParameters(w, obsName, obsDataset->get(0));
+		delete toyDataSet;
+		queue.done(nToysTask, pb->getNFits()-nFits, pb->getNFitsFailed()-nFitsFailed);
 	}
 
 	// save tree
-	TString dirname = "root/scan2dPlugin";
-  if ( arg->isAction("bb") ) dirname += "BergerBoos";
-  if ( arg->isAction("uniform") ) dirname += "Uniform";
-  if ( arg->isAction("gaus") ) dirname += "Gaus";
-  dirname += "_"+name+"_"+scanVar1+"_"+scanVar2;
-	system("mkdir -p "+dirname);
-  TString fname = "/scan2dPlugin";
-  if ( arg->isAction("bb") ) fname += "BergerBoos";
-  if ( arg->isAction("uniform") ) fname += "Uniform";
-  if ( arg->isAction("gaus") ) fname += "Gaus";
-  fname += Form("_"+name+"_"+scanVar1+"_"+scanVar2+"_run%i.root",nRun);
-	t.writeToFile((dirname+fname).Data());
+	t.writeToFile(fileName.Data());
+	if ( nWorkers>1 ) mergeToyWorkers(dirname+fname, nWorkers, iWorker, workers);
+	showProgressOfToyWorkers(queue, pb);
 	delete pb;
+	delete hb;
 }
 
 ///
@@ -818,6 +1033,7 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id)
 	TH1F *h_all        = (TH1F*)hCL->Clone("h_all");
 	TH1F *h_background = (TH1F*)hCL->Clone("h_background");
 	TH1F *h_gof        = (TH1F*)hCL->Clone("h_gof");
+	h_all->Sumw2(); // for the effective number of reweighted toys (--reusetoys)
 
 	Long64_t nentries  = t->GetEntries();
 	Long64_t nfailed   = 0;
@@ -868,23 +1084,23 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id)
 
 		// build test statistic
 		if ( inPhysicalRegion && t->chi2minToy-t->chi2minGlobalToy > t->chi2min-t->chi2minGlobal ){
-			h_better->Fill(t->scanpoint);
+			h_better->Fill(t->scanpoint, t->weight);
 		}
 
 		// goodness-of-fit
 		if ( inPhysicalRegion && t->chi2minGlobalToy > t->chi2minGlobal ){
-			h_gof->Fill(t->scanpoint);
+			h_gof->Fill(t->scanpoint, t->weight);
 		}
 
 		// all toys
 		if ( inPhysicalRegion ){
-			h_all->Fill(t->scanpoint);
+			h_all->Fill(t->scanpoint, t->weight);
 		}
 
 		// use the unphysical events to estimate background (be careful with this,
 		// at least inspect the control plots to judge if this can be at all reasonable)
 		if ( !inPhysicalRegion ){
-			h_background->Fill(t->scanpoint);
+			h_background->Fill(t->scanpoint, t->weight);
 		}
 	}
 
@@ -912,6 +1128,9 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id)
 		float nall = h_all->GetBinContent(i);
 		float nbackground = h_background->GetBinContent(i);
 		if ( nall == 0. ) continue;
+		// effective number of toys, smaller than nall for reweighted toys
+		float nallErr = h_all->GetBinError(i);
+		float neff = nallErr>0. ? nall*nall/(nallErr*nallErr) : nall;
 
 		// subtract background
 		// float p = (nbetter-nbackground)/(nall-nbackground);
@@ -925,7 +1144,7 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id)
 			p = pvalueCorrector->transform(p);
 		}
 		hCL->SetBinContent(i, p);
-		hCL->SetBinError(i, sqrt(p * (1.-p)/nall));
+		hCL->SetBinError(i, sqrt(p * (1.-p)/neff));
 	}
 
 	// goodness-of-fit
@@ -957,6 +1176,7 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id)
 ///
 void MethodPluginScan::readScan1dTrees(int runMin, int runMax, TString fName)
 {
+	ProfileTimer pt("MethodPluginScan::readScan1dTrees");
 
 	TChain *c = new TChain("plugin");
 	int nFilesMissing = 0;
@@ -1023,6 +1243,7 @@ void MethodPluginScan::readScan1dTrees(int runMin, int runMax, TString fName)
 ///
 void MethodPluginScan::readScan2dTrees(int runMin, int runMax)
 {
+	ProfileTimer pt("MethodPluginScan::readScan2dTrees");
 	TChain *chain = new TChain("plugin");
 	int nFilesMissing = 0;
 	int nFilesRead = 0;
@@ -6,6 +6,8 @@
  */
 
 #include "MethodProbScan.h"
+#include "Profiler.h"
+#include "ScanPredictor.h"
 
 	MethodProbScan::MethodProbScan(Combiner *comb)
 : MethodAbsScan(comb)
@@ -96,6 +98,12 @@ int MethodProbScan::scan1d(bool fast, bool reverse)
 	// fix scan parameter
 	par->setConstant(true);
 
+	// Predict the nuisances at each scan point from the previous ones,
+	// instead of just dragging them along. The global minimum provides
+	// the slope for the first step.
+	bool usePredictor = arg->scanpredict && !scanDisableDragMode;
+	ScanPredictor predictor(w, parsName, scanVar1, globalMin);
+
 	// j =
 	// 0 : start value -> upper limit
 	// 1 : upper limit -> start value
@@ -133,6 +141,7 @@ int MethodProbScan::scan1d(bool fast, bool reverse)
 			case 0:
 				// UP
 				setParameters(w, parsName, startPars->get(0));
+				predictor.reset();
 				scanStart = startValue;
 				scanStop  = par->getMax();
 				scanUp = true;
@@ -146,6 +155,7 @@ int MethodProbScan::scan1d(bool fast, bool reverse)
 			case 2:
 				// DOWN
 				setParameters(w, parsName, startPars->get(0));
+				predictor.reset();
 				scanStart = startValue;
 				scanStop  = par->getMin();
 				scanUp = false;
@@ -187,6 +197,9 @@ int MethodProbScan::scan1d(bool fast, bool reverse)
 			// don't scan in unphysical region
 			if ( scanvalue < par->getMin() || scanvalue > par->getMax() ) continue;
 
+			// move the nuisances to where we expect the new minimum
+			if ( usePredictor ) predictor.predict(scanvalue);
+
 			// status bar
 			if ( (((int)nStep % (int)(nTotalSteps/printFreq)) == 0))
 				cout << "MethodProbScan::scan1d() : scanning " << (float)nStep/(float)nTotalSteps*100. << "%   \r" << flush;
@@ -196,6 +209,7 @@ int MethodProbScan::scan1d(bool fast, bool reverse)
 			if ( arg->probforce )         fr = fitToMinForce(w, combiner->getPdfName());
 			else if ( arg->probimprove )  fr = fitToMinImprove(w, combiner->getPdfName());
 			else                          fr = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
+			if ( usePredictor ) predictor.record(scanvalue);
 			double chi2minScan = fr->minNll();
 			if ( std::isinf(chi2minScan) ) chi2minScan=1e4; // else the toys in PDF_testConstraint don't work
 			RooSlimFitResult *r = new RooSlimFitResult(fr); // try to save memory by using the slim fit result
@@ -362,6 +376,7 @@ void MethodProbScan::sanityChecks()
 ///
 int MethodProbScan::scan2d()
 {
+	ProfileTimer pt("MethodProbScan::scan2d");
 	if ( arg->debug ) cout << "MethodProbScan::scan2d() : starting ..." << endl;
 	nScansDone++;
 	sanityChecks();
@@ -400,6 +415,12 @@ int MethodProbScan::scan2d()
 	par1->setConstant(true);
 	par2->setConstant(true);
 
+	// Extrapolates the nuisances outwards along the spiral, from the
+	// two inner turns. Both scan parameters are constant, so it doesn't
+	// matter which one it is told about.
+	bool usePredictor = arg->scanpredict;
+	ScanPredictor predictor(w, parsName, scanVar1);
+
 	// Report on the smallest new minimum we come across while scanning.
 	// Sometimes the scan doesn't find the minimum
 	// that was found before. Warn if this happens.
@@ -434,12 +455,6 @@ int MethodProbScan::scan2d()
 	hDbgStart->SetBinContent(iStart, jStart, 500.);
 	TMarker *startpointmark = new TMarker(par1->getVal(),par2->getVal(),3);
 
-	// timer
-	TStopwatch tFit;
-	TStopwatch tSlimResult;
-	TStopwatch tScan;
-	TStopwatch tMemory;
-
 	// set up the scan spiral
 	int X = 2*nPoints2dx;
 	int Y = 2*nPoints2dy;
@@ -456,7 +471,6 @@ int MethodProbScan::scan2d()
 			int j = y+jStart;
 			if ( i>0 && i<=nPoints2dx && j>0 && j<=nPoints2dy )
 			{
-				tScan.Start(false);
 
 				// status bar
 				if (((int)nSteps % (int)(nTotalSteps/printFreq)) == 0){
@@ -472,19 +486,30 @@ int MethodProbScan::scan2d()
 				int xStartPars, yStartPars;
 				computeInnerTurnCoords(iStart, jStart, i, j, xStartPars, yStartPars, 1);
 				RooSlimFitResult *rStartPars = mycurveResults2d[xStartPars-1][yStartPars-1];
-				if ( rStartPars ) setParameters(w, parsName, rStartPars);
+				int iOld, jOld;
+				bool innerTurnExists = computeInnerTurnCoords(iStart, jStart, i, j, iOld, jOld, 2);
+				RooSlimFitResult *rOldPars = innerTurnExists ? mycurveResults2d[iOld-1][jOld-1] : 0;
+
+				// Predictor: continue the line through the second-inner and the inner
+				// turn up to this point. The distances along it are in bins.
+				double dOld = sqrt(sq(xStartPars-iOld)+sq(yStartPars-jOld));
+				if ( usePredictor && rStartPars && rOldPars && dOld>0 ){
+					predictor.reset();
+					setParameters(w, parsName, rOldPars);
+					predictor.record(0.);
+					setParameters(w, parsName, rStartPars);
+					predictor.record(dOld);
+					predictor.predict(dOld + sqrt(sq(i-xStartPars)+sq(j-yStartPars)));
+				}
+				else if ( rStartPars ) setParameters(w, parsName, rStartPars);
 
 				// memory management:
-				tMemory.Start(false);
 				// delete old, inner fit results, that we don't need for start parameters anymore
 				// for this we take the second-inner-most turn.
-				int iOld, jOld;
-				bool innerTurnExists = computeInnerTurnCoords(iStart, jStart, i, j, iOld, jOld, 2);
 				if ( innerTurnExists ){
 					deleteIfNotInCurveResults2d(mycurveResults2d[iOld-1][jOld-1]);
 					mycurveResults2d[iOld-1][jOld-1] = 0;
 				}
-				tMemory.Stop();
 
 				// alternative choice for start parameters: always from what we found at function call
 				// setParameters(w, parsName, startPars->get(0));
@@ -496,15 +521,11 @@ int MethodProbScan::scan2d()
 				par2->setVal(scanvalue2);
 
 				// fit!
-				tFit.Start(false);
 				RooFitResult *fr;
 				if ( !arg->probforce ) fr = fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
 				else                   fr = fitToMinForce(w, combiner->getPdfName());
 				double chi2minScan = fr->minNll();
-				tFit.Stop();
-				tSlimResult.Start(false);
 				RooSlimFitResult *r = new RooSlimFitResult(fr); // try to save memory by using the slim fit result
-				tSlimResult.Stop();
 				delete fr;
 				allResults.push_back(r);
 				bestMinFoundInScan = TMath::Min((double)chi2minScan, (double)bestMinFoundInScan);
@@ -547,7 +568,6 @@ int MethodProbScan::scan2d()
 					cDbg->Update();
           cDbg->Modified();
 				}
-				tScan.Stop();
 			}
 		}
 		// spiral stuff:
@@ -561,12 +581,6 @@ int MethodProbScan::scan2d()
 		y += dy;
 	}
 	cout << "MethodProbScan::scan2d() : scan done.            " << endl;
-	if ( arg->debug ){
-		cout << "MethodProbScan::scan2d() : full scan time:             "; tScan.Print();
-		cout << "MethodProbScan::scan2d() : - fitting:                  "; tFit.Print();
-		cout << "MethodProbScan::scan2d() : - create RooSlimFitResults: "; tSlimResult.Print();
-		cout << "MethodProbScan::scan2d() : - memory management:        "; tMemory.Print();
-	}
 	setParameters(w, parsName, startPars->get(0));
 	saveSolutions2d();
 	if ( arg->debug ) printLocalMinima();
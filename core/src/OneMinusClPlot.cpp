@@ -764,7 +764,7 @@ void OneMinusClPlot::Draw()
 
     TString legTitle = scanners[i]->getTitle();
     if ( legTitle=="default" ) {
-      if ( scanners[i]->getMethodName().Contains("Prob") ) legTitle = do_CLs[i] ? "Prob CLs" : "Prob";
+      if ( scanners[i]->getMethodName().Contains("Prob") ) legTitle = do_CLs[i]==2 && arg->asymptoticcls ? "Asymptotic CLs" : ( do_CLs[i] ? "Prob CLs" : "Prob" );
       if ( scanners[i]->getMethodName().Contains("Plugin") ) {
         if ( do_CLs[i]==0 ) legTitle    = "Plugin";
         else if (do_CLs[i]==1) legTitle = "Plugin CLs";
@@ -772,7 +772,7 @@ void OneMinusClPlot::Draw()
       }
     }
     else if ( !arg->isQuickhack(29) ) {
-      if ( scanners[i]->getMethodName().Contains("Prob") ) legTitle += do_CLs[i] ? " (Prob CLs)" : " (Prob)";
+      if ( scanners[i]->getMethodName().Contains("Prob") ) legTitle += do_CLs[i]==2 && arg->asymptoticcls ? " (Asymptotic CLs)" : ( do_CLs[i] ? " (Prob CLs)" : " (Prob)" );
       if ( scanners[i]->getMethodName().Contains("Plugin") ) {
         if ( do_CLs[i]==0 )    legTitle += " (Plugin)";
         else if (do_CLs[i]==1) legTitle += " (Plugin CLs)";
@@ -29,6 +29,8 @@ OptParser::OptParser():
 
 	// Initialize the variables.
 	// For more complex arguments these are also the default values.
+	asymptoticcls = false;
+	combcache = false;
 	controlplot = false;
 	coverageCorrectionID = 0;
 	coverageCorrectionPoint = 0;
@@ -36,8 +38,11 @@ OptParser::OptParser():
 	digits = -99;
 	enforcePhysRange = false;
     filenamechange = "";
+	compiledtheory = false;
+	gradient = false;
 	group = "GammaCombo";
 	groupPos = "";
+	heartbeat = 0;
   hfagLabel = "";
   hfagLabelPos = "";
 	id = -99;
@@ -62,6 +67,10 @@ OptParser::OptParser():
 	npoints2dy = -99;
 	npointstoy = -99;
   ncoveragetoys = -99;
+	ncpu = 1;
+	coverageworkers = 1;
+	controlplotthreads = 1;
+	covCorrectThreads = 1;
 	nrun = -99;
 	ntoys = -99;
 	nsmooth = 1;
@@ -96,16 +105,25 @@ OptParser::OptParser():
 	printcor = false;
   printSolX = -999.;
   printSolY = -999.;
+	profile = "";
   queue = "";
+	reusetoys = 0.;
   save = "";
   saveAtMin = false;
 	scanforce = false;
+	scanworkers = 1;
+	scanpredict = true;
 	scanrangeMax = -101;
 	scanrangeMin = -101;
 	scanrangeyMax = -102;
 	scanrangeyMin = -102;
 	smooth2d = false;
   toyFiles = "";
+	toybasket = 32000;
+	toycolumns = "full";
+	toycompression = -1;
+	toyflush = -5000000;
+	toyworkers = 1;
 	usage = false;
 	verbose = false;
 }
@@ -119,13 +137,17 @@ void OptParser::defineOptions()
 	availableOptions.push_back("action");
 	availableOptions.push_back("asimov");
 	availableOptions.push_back("asimovfile");
+	availableOptions.push_back("asymptoticcls");
   availableOptions.push_back("batchstartn");
   availableOptions.push_back("batcheos");
 	availableOptions.push_back("cls");
 	availableOptions.push_back("combid");
 	availableOptions.push_back("color");
 	availableOptions.push_back("controlplots");
+	availableOptions.push_back("controlplotthreads");
 	availableOptions.push_back("covCorrect");
+	availableOptions.push_back("covCorrectThreads");
+	availableOptions.push_back("coverageworkers");
 	availableOptions.push_back("covCorrectPoint");
 	availableOptions.push_back("debug");
 	availableOptions.push_back("digits");
@@ -134,6 +156,7 @@ void OptParser::defineOptions()
   availableOptions.push_back("fillstyle");
 	availableOptions.push_back("fix");
 	availableOptions.push_back("ext");
+	availableOptions.push_back("heartbeat");
   availableOptions.push_back("hfagLabel");
   availableOptions.push_back("hfagLabelPos");
 	availableOptions.push_back("id");
@@ -147,6 +170,9 @@ void OptParser::defineOptions()
 	availableOptions.push_back("leg");
 	availableOptions.push_back("legsize");
   availableOptions.push_back("legstyle");
+	availableOptions.push_back("gradient");
+	availableOptions.push_back("compiledtheory");
+	availableOptions.push_back("combcache");
 	availableOptions.push_back("group");
 	availableOptions.push_back("grouppos");
 	availableOptions.push_back("lightfiles");
@@ -156,12 +182,14 @@ void OptParser::defineOptions()
   availableOptions.push_back("nbatchjobs");
   //availableOptions.push_back("nBBpoints");
 	availableOptions.push_back("noconfsols");
+	availableOptions.push_back("nopredict");
 	availableOptions.push_back("nosyst");
 	availableOptions.push_back("npoints");
 	availableOptions.push_back("npoints2dx");
 	availableOptions.push_back("npoints2dy");
 	availableOptions.push_back("npointstoy");
 	availableOptions.push_back("ncoveragetoys");
+	availableOptions.push_back("ncpu");
 	availableOptions.push_back("nrun");
 	availableOptions.push_back("ntoys");
 	availableOptions.push_back("nsmooth");
@@ -187,15 +215,22 @@ void OptParser::defineOptions()
   availableOptions.push_back("randomizeToyVars");
   availableOptions.push_back("readfromfile");
   availableOptions.push_back("removeRange");
+	availableOptions.push_back("reusetoys");
   availableOptions.push_back("save");
   availableOptions.push_back("saveAtMin");
 	availableOptions.push_back("sn");
 	availableOptions.push_back("sn2d");
 	availableOptions.push_back("scanforce");
 	availableOptions.push_back("scanrange");
+	availableOptions.push_back("scanworkers");
 	availableOptions.push_back("scanrangey");
 	availableOptions.push_back("smooth2d");
   availableOptions.push_back("toyFiles");
+	availableOptions.push_back("toybasket");
+	availableOptions.push_back("toycolumns");
+	availableOptions.push_back("toycompression");
+	availableOptions.push_back("toyflush");
+	availableOptions.push_back("toyworkers");
 	availableOptions.push_back("title");
 	availableOptions.push_back("usage");
 	availableOptions.push_back("unoff");
@@ -208,6 +243,7 @@ void OptParser::defineOptions()
 	availableOptions.push_back("ndiv");
 	availableOptions.push_back("ndivy");
 	availableOptions.push_back("printcor");
+	availableOptions.push_back("profile");
 }
 
 ///
@@ -254,11 +290,16 @@ void OptParser::bookPluginOptions()
   bookedOptions.push_back("batchstartn");
   bookedOptions.push_back("batcheos");
   bookedOptions.push_back("controlplots");
+	bookedOptions.push_back("controlplotthreads");
 	bookedOptions.push_back("id");
 	bookedOptions.push_back("importance");
 	bookedOptions.push_back("jobs");
 	bookedOptions.push_back("lightfiles");
   bookedOptions.push_back("nbatchjobs");
+	bookedOptions.push_back("ncpu");
+	bookedOptions.push_back("nopredict");
+	bookedOptions.push_back("gradient");
+	bookedOptions.push_back("compiledtheory");
 	//bookedOptions.push_back("nBBpoints");
 	bookedOptions.push_back("npointstoy");
 	bookedOptions.push_back("nrun");
@@ -270,6 +311,13 @@ void OptParser::bookPluginOptions()
 	bookedOptions.push_back("intprob");
 	bookedOptions.push_back("po");
 	bookedOptions.push_back("pluginplotrange");
+	bookedOptions.push_back("heartbeat");
+	bookedOptions.push_back("reusetoys");
+	bookedOptions.push_back("toybasket");
+	bookedOptions.push_back("toycolumns");
+	bookedOptions.push_back("toycompression");
+	bookedOptions.push_back("toyflush");
+	bookedOptions.push_back("toyworkers");
 }
 
 ///
@@ -288,10 +336,16 @@ void OptParser::bookProbOptions()
 	bookedOptions.push_back("sn");
 	bookedOptions.push_back("sn2d");
 	bookedOptions.push_back("probforce");
+	bookedOptions.push_back("nopredict");
+	bookedOptions.push_back("gradient");
+	bookedOptions.push_back("compiledtheory");
+	bookedOptions.push_back("combcache");
 	//bookedOptions.push_back("probimprove");
 	bookedOptions.push_back("pulls");
 	bookedOptions.push_back("scanforce");
 	bookedOptions.push_back("scanforce");
+	bookedOptions.push_back("scanworkers");
+	bookedOptions.push_back("asymptoticcls");
 }
 
 ///
@@ -399,6 +453,9 @@ void OptParser::parseArguments(int argc, char* argv[])
 			"for one coordinate, use 'def': --grouppos def:y.", false, "default", "string");
   TCLAP::ValueArg<float> printSolXArg("","printsolx", "x coordinate to print solution at in 1D plots", false, -999., "float");
   TCLAP::ValueArg<float> printSolYArg("","printsoly", "y coordinate to shift solution by in 1D plots", false, -999., "float");
+	TCLAP::ValueArg<string> profileArg("", "profile", "Time the fits, toy generation, parameter loading and "
+			"ToyTree I/O, and write a breakdown (calls, total, mean, p99 in seconds) to the given file at exit. "
+			"The file is CSV if its name ends in .csv, else JSON.", false, "", "string");
   TCLAP::ValueArg<string> queueArg("q","queue","Batch queue to submit to. If none is given then the scripts will be written but not submitted.", false, "", "string");
   TCLAP::ValueArg<int> batchstartnArg("","batchstartn", "number of first batch job (e.g. if you have already submitted 100 you can submit another 100 starting from 101)", false, 1, "int");
   TCLAP::ValueArg<int> nbatchjobsArg("","nbatchjobs", "number of jobs to write scripts for and submit to batch system", false, 0, "int");
@@ -416,6 +473,33 @@ void OptParser::parseArguments(int argc, char* argv[])
 	TCLAP::ValueArg<int> npoints2dxArg("", "npoints2dx", "Number of 2D scan points, x axis. Default: 50", false, -1, "int");
 	TCLAP::ValueArg<int> npoints2dyArg("", "npoints2dy", "Number of 2D scan points, y axis. Default: 50", false, -1, "int");
 	TCLAP::ValueArg<int> npointstoyArg("", "npointstoy", "Number of scan points used by the plugin method. Default: 100", false, 100, "int");
+	TCLAP::ValueArg<int> ncpuArg("", "ncpu", "Number of CPU cores used to evaluate the likelihood "
+			"of a single fit to a dataset (datasets scans only). The events are split into "
+			"contiguous blocks whose partial sums are always added in the same order. Default: 1", false, 1, "int");
+	TCLAP::ValueArg<int> controlplotthreadsArg("", "controlplotthreads", "Number of threads reading the "
+			"toy files for --controlplots. Default: 1", false, 1, "int");
+	TCLAP::ValueArg<int> covCorrectThreadsArg("", "covCorrectThreads", "Number of threads reading the "
+			"coverage files for --covCorrect. Default: 1", false, 1, "int");
+	TCLAP::ValueArg<int> coverageworkersArg("", "coverageworkers", "Number of worker processes running the "
+			"toys of --action coverage. Each worker is a fork with its own copy of the combination. Default: 1",
+			false, 1, "int");
+	TCLAP::ValueArg<int> scanworkersArg("", "scanworkers", "Number of worker processes fitting the points of a "
+			"Prob scan on datasets in parallel (datasets scans only). Each worker has its own copy of the "
+			"workspace. In 1D scans every point is fitted starting from the same parameters, so the result "
+			"doesn't depend on the number of workers. In 2D scans each worker fits a slice of the grid, every "
+			"point starting from the nearest point already fitted in its slice. The first point of a slice "
+			"has no fitted neighbour, so far from the minimum a fit may end in a different local minimum "
+			"than the serial scan, which starts every point from a neighbour. Can be combined with --ncpu. "
+			"Default: 1", false, 1, "int");
+	TCLAP::ValueArg<int> heartbeatArg("", "heartbeat", "Write a machine-readable heartbeat of plugin scans "
+			"every this many seconds: a small JSON file next to the output file, with the toys done, "
+			"the toys per second, the fit failure rate, the current scan point, the memory used and "
+			"the expected remaining time. Default: 0 (off)", false, 0, "int");
+	TCLAP::ValueArg<float> reusetoysArg("", "reusetoys", "Reuse the toys of a plugin scan point at the following "
+			"scan points, reweighted by the ratio of the densities they are generated with at both points, "
+			"instead of generating and fitting new toys at every point. Fresh toys are generated as soon as "
+			"the effective sample size of the reweighted toys drops below the given fraction of --ntoys, "
+			"e.g. 0.8. 1D scans only, not with --importance or -a uniform/gaus. Default: 0 (off)", false, 0., "float");
 	TCLAP::ValueArg<int> ncoveragetoysArg("", "ncoveragetoys", "Number of toys to throw in the coverage method. Default: 100", false, 100, "int");
 	TCLAP::MultiArg<string> jobsArg("j", "jobs", "Range of toy job ids to be considered. "
 			"To be used with --action plugin. "
@@ -424,6 +508,25 @@ void OptParser::parseArguments(int argc, char* argv[])
 			"Format (range):  -j min-max \n"
 			"Format (single): -j n", false, "string");
 	TCLAP::ValueArg<string> jobdirArg("", "jobdir", "Give absolute job-directory if working on batch systems.", false, "default", "string");
+	TCLAP::ValueArg<int> toybasketArg("", "toybasket", "Initial basket size in bytes of the branches "
+			"of the toy trees. ROOT adapts the sizes at the first flush. Default: 32000", false, 32000, "int");
+	TCLAP::ValueArg<string> toycolumnsArg("", "toycolumns", "Branches written to the toy trees: "
+			"'core' (test statistics, scan points and fit status only - same as --lightfiles), "
+			"'poi' (core, plus the fit results of the scan variables), "
+			"'full' (core, plus all parameters, observables, theory values and global observables). Default: full",
+			false, "full", "string");
+	TCLAP::ValueArg<string> toycompressionArg("", "toycompression", "Compression of the toy files. "
+			"Format: --toycompression alg[:level] with alg one of zlib, lzma, lz4, zstd, and level 1-9. "
+			"lz4 is fastest, zstd and lzma give the smallest files for archiving (zstd needs ROOT 6.20). "
+			"Default: ROOT default.", false, "default", "string");
+	TCLAP::ValueArg<int> toyflushArg("", "toyflush", "Flush the toy trees to disk every N entries (N>0), "
+			"or every -N bytes (N<0). This bounds the memory used by large productions. Default: -5000000 (5 MB)",
+			false, -5000000, "int");
+	TCLAP::ValueArg<int> toyworkersArg("", "toyworkers", "Number of worker processes running the toys of a plugin "
+			"scan (not datasets scans). The toys of each scan point are split into one block per worker, "
+			"and the workers take these (scan point, block) tasks from a shared queue, so that slow "
+			"scan points are shared by all workers. The toys are merged into the usual output file. "
+			"Not with --reusetoys. Default: 1", false, 1, "int");
   TCLAP::ValueArg<string> toyFilesArg("", "toyFiles", "Pass some different toy files, for example if you want 1D projection of 2D FC.", false, "default", "string" );
   TCLAP::ValueArg<string> saveArg("","save", "Save the workspace this file name", false, "", "string");
 
@@ -460,8 +563,21 @@ void OptParser::parseArguments(int argc, char* argv[])
 			"'phys' limit. However, toy generation of observables is not affected.", false);
   TCLAP::SwitchArg infoArg("", "info", "Print information about the passed combiners and exit", false);
 	TCLAP::SwitchArg importanceArg("", "importance", "Enable importance sampling for plugin toys.", false);
+	TCLAP::SwitchArg gradientArg("", "gradient", "Minimize combinations of Gaussian measurements with Minuit2, using analytic gradients of the chi2. Needs fewer chi2 evaluations for many parameters. Other PDFs are fitted as usual.", false);
+	TCLAP::SwitchArg combcacheArg("", "combcache", "Build all combinations of a Prob scan in one shared workspace, "
+			"importing every PDF only once. Saves time when running many variants of a combination, e.g. -c 26 -c 26:+12 -c 26:-13. "
+			"The combinations share their parameters, so it is not used for combinations with --asimov, --prange, --removeRange, "
+			"--randomizeToyVars, fixed parameters, or observables loaded from a file, nor together with --save.", false);
+	TCLAP::SwitchArg asymptoticclsArg("", "asymptoticcls", "Compute the observed and expected CLs (--cls 2) of a Prob scan on datasets "
+			"with asymptotic formulae, from fits to the background-only Asimov dataset, instead of toys. "
+			"Needs --cls. Use the Plugin scan to validate the final result.", false);
+	TCLAP::SwitchArg compiledtheoryArg("", "compiledtheory", "With --gradient, compile the theory relations of every "
+			"Gaussian measurement into one C++ function, instead of evaluating the formulas relation by relation. "
+			"Each compiled function is checked against the formulas first. Relations that aren't formulas are "
+			"evaluated as usual.", false);
 	TCLAP::SwitchArg nosystArg("", "nosyst", "Sets all systematic errors to zero.", false);
 	TCLAP::SwitchArg noconfsolsArg("", "noconfsols", "Do not confirm solutions.", false);
+	TCLAP::SwitchArg nopredictArg("", "nopredict", "Do not extrapolate the nuisances of the previous scan points to the next one before fitting it, but start from where the previous fit ended (Prob scans), or from the last toy (Plugin toys).", false);
 	TCLAP::SwitchArg printcorArg("", "printcor", "Print the correlation matrix of each solution found.", false);
 	TCLAP::SwitchArg smooth2dArg("", "smooth2d", "Smooth 2D p-value or cl histograms for nicer contour (particularly useful for 2D plugin)", false);
   TCLAP::SwitchArg saveAtMinArg("","saveAtMin","Save workspace after minimization", false);
@@ -637,7 +753,12 @@ void OptParser::parseArguments(int argc, char* argv[])
 	if ( isIn<TString>(bookedOptions, "usage" ) ) cmd.add( usageArg );
 	if ( isIn<TString>(bookedOptions, "unoff" ) ) cmd.add( plotunoffArg );
 	if ( isIn<TString>(bookedOptions, "title" ) ) cmd.add( titleArg );
+	if ( isIn<TString>(bookedOptions, "toyflush" ) ) cmd.add( toyflushArg );
+	if ( isIn<TString>(bookedOptions, "toyworkers" ) ) cmd.add( toyworkersArg );
   if ( isIn<TString>(bookedOptions, "toyFiles" ) ) cmd.add( toyFilesArg );
+	if ( isIn<TString>(bookedOptions, "toycompression" ) ) cmd.add( toycompressionArg );
+	if ( isIn<TString>(bookedOptions, "toycolumns" ) ) cmd.add( toycolumnsArg );
+	if ( isIn<TString>(bookedOptions, "toybasket" ) ) cmd.add( toybasketArg );
 	if ( isIn<TString>(bookedOptions, "sn2d" ) ) cmd.add(sn2dArg);
 	if ( isIn<TString>(bookedOptions, "sn" ) ) cmd.add(snArg);
 	if ( isIn<TString>(bookedOptions, "smooth2d" ) ) cmd.add( smooth2dArg );
@@ -655,6 +776,7 @@ void OptParser::parseArguments(int argc, char* argv[])
 	if ( isIn<TString>(bookedOptions, "pulls" ) ) cmd.add( plotpullsArg );
 	if ( isIn<TString>(bookedOptions, "ps" ) ) cmd.add( plotsolutionsArg );
   if ( isIn<TString>(bookedOptions, "plotsoln" ) ) cmd.add( plotsolnArg );
+	if ( isIn<TString>(bookedOptions, "profile" ) ) cmd.add( profileArg );
 	if ( isIn<TString>(bookedOptions, "probimprove" ) ) cmd.add( probimproveArg );
 	if ( isIn<TString>(bookedOptions, "probforce" ) ) cmd.add( probforceArg );
   if ( isIn<TString>(bookedOptions, "probScanResult" ) ) cmd.add(probScanResultArg);
@@ -677,12 +799,20 @@ void OptParser::parseArguments(int argc, char* argv[])
 	if ( isIn<TString>(bookedOptions, "ntoys" ) ) cmd.add(ntoysArg);
 	if ( isIn<TString>(bookedOptions, "nrun" ) ) cmd.add(nrunArg);
 	if ( isIn<TString>(bookedOptions, "npointstoy" ) ) cmd.add(npointstoyArg);
+	if ( isIn<TString>(bookedOptions, "ncpu" ) ) cmd.add(ncpuArg);
+	if ( isIn<TString>(bookedOptions, "controlplotthreads" ) ) cmd.add(controlplotthreadsArg);
+	if ( isIn<TString>(bookedOptions, "covCorrectThreads" ) ) cmd.add(covCorrectThreadsArg);
+	if ( isIn<TString>(bookedOptions, "coverageworkers" ) ) cmd.add(coverageworkersArg);
+	if ( isIn<TString>(bookedOptions, "scanworkers" ) ) cmd.add(scanworkersArg);
+	if ( isIn<TString>(bookedOptions, "reusetoys" ) ) cmd.add(reusetoysArg);
+	if ( isIn<TString>(bookedOptions, "heartbeat" ) ) cmd.add(heartbeatArg);
 	if ( isIn<TString>(bookedOptions, "ncoveragetoys" ) ) cmd.add(ncoveragetoysArg);
 	if ( isIn<TString>(bookedOptions, "npoints2dy" ) ) cmd.add(npoints2dyArg);
 	if ( isIn<TString>(bookedOptions, "npoints2dx" ) ) cmd.add(npoints2dxArg);
 	if ( isIn<TString>(bookedOptions, "npoints" ) ) cmd.add(npointsArg);
 	if ( isIn<TString>(bookedOptions, "nosyst" ) ) cmd.add( nosystArg );
 	if ( isIn<TString>(bookedOptions, "noconfsols" ) ) cmd.add( noconfsolsArg );
+	if ( isIn<TString>(bookedOptions, "nopredict" ) ) cmd.add( nopredictArg );
 	if ( isIn<TString>(bookedOptions, "ndivy" ) ) cmd.add(ndivyArg);
 	if ( isIn<TString>(bookedOptions, "ndiv" ) ) cmd.add(ndivArg);
 	if ( isIn<TString>(bookedOptions, "nBBpoints" ) ) cmd.add(nBBpointsArg);
@@ -704,6 +834,10 @@ void OptParser::parseArguments(int argc, char* argv[])
 	if ( isIn<TString>(bookedOptions, "id" ) ) cmd.add(idArg);
   if ( isIn<TString>(bookedOptions, "hfagLabel" ) ) cmd.add(hfagLabelArg);
   if ( isIn<TString>(bookedOptions, "hfagLabelPos" ) ) cmd.add(hfagLabelPosArg);
+	if ( isIn<TString>(bookedOptions, "gradient" ) ) cmd.add( gradientArg );
+	if ( isIn<TString>(bookedOptions, "compiledtheory" ) ) cmd.add( compiledtheoryArg );
+	if ( isIn<TString>(bookedOptions, "combcache" ) ) cmd.add( combcacheArg );
+	if ( isIn<TString>(bookedOptions, "asymptoticcls" ) ) cmd.add( asymptoticclsArg );
 	if ( isIn<TString>(bookedOptions, "group" ) ) cmd.add( plotgroupArg );
 	if ( isIn<TString>(bookedOptions, "grouppos" ) ) cmd.add( plotgroupposArg );
 	if ( isIn<TString>(bookedOptions, "fix" ) ) cmd.add(fixArg);
@@ -730,6 +864,7 @@ void OptParser::parseArguments(int argc, char* argv[])
 	// copy over parsed values into data members
 	//
 	asimov            = asimovArg.getValue();
+	asymptoticcls     = asymptoticclsArg.getValue();
 	cls 			  = clsArg.getValue();
 	color             = colorArg.getValue();
 	controlplot       = controlplotArg.getValue();
@@ -740,6 +875,9 @@ void OptParser::parseArguments(int argc, char* argv[])
   filenamechange    = filenamechangeArg.getValue();
   fillstyle         = fillstyleArg.getValue();
   hfagLabel         = hfagLabelArg.getValue();
+	gradient          = gradientArg.getValue();
+	compiledtheory    = compiledtheoryArg.getValue();
+	combcache         = combcacheArg.getValue();
 	group             = plotgroupArg.getValue();
 	id                = idArg.getValue();
 	importance        = importanceArg.getValue();
@@ -762,6 +900,13 @@ void OptParser::parseArguments(int argc, char* argv[])
 	npoints2dy        = npoints2dyArg.getValue()==-1 ? (npointsArg.getValue()==-1 ? 50 : npointsArg.getValue()) : npoints2dyArg.getValue();
 	npointstoy        = npointstoyArg.getValue();
   ncoveragetoys     = ncoveragetoysArg.getValue();
+	ncpu              = ncpuArg.getValue();
+	controlplotthreads = controlplotthreadsArg.getValue();
+	covCorrectThreads = covCorrectThreadsArg.getValue();
+	coverageworkers   = coverageworkersArg.getValue();
+	scanworkers       = scanworkersArg.getValue();
+	reusetoys         = reusetoysArg.getValue();
+	heartbeat         = heartbeatArg.getValue();
 	nrun	            = nrunArg.getValue();
 	ntoys	            = ntoysArg.getValue();
   nsmooth           = nsmoothArg.getValue();
@@ -783,14 +928,19 @@ void OptParser::parseArguments(int argc, char* argv[])
 	probforce         = probforceArg.getValue();
 	probimprove       = probimproveArg.getValue();
   probScanResult    = probScanResultArg.getValue();
+	profile           = profileArg.getValue();
 	qh                = qhArg.getValue();
   queue             = TString(queueArg.getValue());
   save              = saveArg.getValue();
   saveAtMin         = saveAtMinArg.getValue();
 	savenuisances1d   = snArg.getValue();
 	scanforce         = scanforceArg.getValue();
+	scanpredict       = ! nopredictArg.getValue();
 	smooth2d          = smooth2dArg.getValue();
   toyFiles          = toyFilesArg.getValue();
+	toybasket         = toybasketArg.getValue();
+	toyflush          = toyflushArg.getValue();
+	toyworkers        = toyworkersArg.getValue();
 	usage             = usageArg.getValue();
 	verbose           = verboseArg.getValue();
 
@@ -868,6 +1018,102 @@ void OptParser::parseArguments(int argc, char* argv[])
 	}
 	coverageCorrectionPoint = coverageCorrectionPointArg.getValue();
 
+	// --ncpu
+	if ( ncpu < 1 ){
+		cout << "Argument error: ncpu has to be at least 1" << endl;
+		exit(1);
+	}
+
+	// --controlplotthreads, --covCorrectThreads, --coverageworkers
+	if ( controlplotthreads < 1 || covCorrectThreads < 1 || coverageworkers < 1 ){
+		cout << "Argument error: --controlplotthreads, --covCorrectThreads and --coverageworkers have to be at least 1" << endl;
+		exit(1);
+	}
+
+	// --scanworkers
+	if ( scanworkers < 1 ){
+		cout << "Argument error: scanworkers has to be at least 1" << endl;
+		exit(1);
+	}
+
+	// --reusetoys
+	if ( reusetoys < 0. || reusetoys > 1. ){
+		cout << "Argument error: --reusetoys has to be a fraction in [0,1]" << endl;
+		exit(1);
+	}
+	if ( reusetoys > 0. && ( importance || isAction("uniform") || isAction("gaus") ) ){
+		cout << "Argument error: --reusetoys cannot be combined with --importance or -a uniform/gaus" << endl;
+		exit(1);
+	}
+
+	// --toyworkers
+	if ( toyworkers < 1 ){
+		cout << "Argument error: --toyworkers has to be at least 1" << endl;
+		exit(1);
+	}
+	if ( toyworkers > 1 && reusetoys > 0. ){
+		cout << "Argument error: --toyworkers cannot be combined with --reusetoys" << endl;
+		exit(1);
+	}
+
+	// --compiledtheory
+	if ( compiledtheory && !gradient ){
+		cout << "Argument error: --compiledtheory needs --gradient" << endl;
+		exit(1);
+	}
+
+	// --heartbeat
+	if ( heartbeat < 0 ){
+		cout << "Argument error: --heartbeat has to be a number of seconds, or 0 (off)" << endl;
+		exit(1);
+	}
+
+	// --asymptoticcls
+	if ( asymptoticcls && cls.empty() ){
+		cout << "Argument error: --asymptoticcls needs --cls" << endl;
+		exit(1);
+	}
+
+	// --toycolumns
+	toycolumns = toycolumnsArg.getValue();
+	if ( lightfiles ) toycolumns = "core";
+	if ( toycolumns!="core" && toycolumns!="poi" && toycolumns!="full" ){
+		cout << "Argument error --toycolumns: choose one of core, poi, full." << endl;
+		exit(1);
+	}
+
+	// --toycompression
+	// Convert to ROOT's compression settings, 100*algorithm+level.
+	TString toycompressionStr = toycompressionArg.getValue();
+	if ( toycompressionStr!="default" ){
+		TString alg = toycompressionStr;
+		int level = 4;
+		if ( alg.Contains(":") ){
+			TString levelStr = alg;
+			alg.Replace(alg.Index(":"), alg.Sizeof(), "");
+			levelStr.Replace(0, levelStr.Index(":")+1, "");
+			level = convertToDigitWithCheck(levelStr, "Argument error --toycompression: level has to be a digit 1-9.");
+			if ( level<1 || level>9 ){
+				cout << "Argument error --toycompression: level has to be a digit 1-9." << endl;
+				exit(1);
+			}
+		}
+		if      ( alg=="zlib" ) toycompression = 100 + level;
+		else if ( alg=="lzma" ) toycompression = 200 + level;
+		else if ( alg=="lz4"  ) toycompression = 400 + level;
+		else if ( alg=="zstd" ) toycompression = 500 + level;
+		else {
+			cout << "Argument error --toycompression: choose one of zlib, lzma, lz4, zstd." << endl;
+			exit(1);
+		}
+	}
+
+	// --toybasket
+	if ( toybasket < 1000 ){
+		cout << "Argument error: toybasket has to be at least 1000 bytes" << endl;
+		exit(1);
+	}
+
 	// --sn2d
 	for ( int i = 0; i < sn2dArg.getValue().size(); i++ ){
 		TString parseMe = sn2dArg.getValue()[i];
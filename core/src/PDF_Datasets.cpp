@@ -8,6 +8,8 @@
  **/
 
 #include "PDF_Datasets.h"
+#include "Profiler.h"
+#include "RooStats/AsymptoticCalculator.h"
 
 
 PDF_Datasets::PDF_Datasets(RooWorkspace* w, int nObs, OptParser* opt)
@@ -26,9 +28,13 @@ PDF_Datasets::PDF_Datasets(RooWorkspace* w, int nObs, OptParser* opt)
     arg             = opt;
     fitStatus       = -10;
     _NLL            = NULL;
+    _constraintPdf  = NULL;
+    data            = NULL;
+    isDataOwned     = false;
     minNllFree      = 0;
     minNllScan      = 0;
     minNll          = 0;
+    NCPU            = opt ? opt->ncpu : 1;
 };
 
 PDF_Datasets::PDF_Datasets(RooWorkspace* w)
@@ -39,6 +45,7 @@ PDF_Datasets::PDF_Datasets(RooWorkspace* w)
 };
 
 PDF_Datasets::~PDF_Datasets() {
+    if (isDataOwned) delete data;
     if (wspc) delete wspc;
     if (_constraintPdf) delete _constraintPdf;
 };
@@ -72,6 +79,72 @@ void PDF_Datasets::initData(const TString& name) {
     return;
 };
 
+/*! \brief Initializes the data through a columnar cache file
+ *
+ *  If the cache file exists, the dataset is filled from its mapped columns,
+ *  so the workspace doesn't need to contain it: all jobs on a node then read
+ *  the data from one shared copy in the page cache, instead of each streaming
+ *  it from the workspace file. Else the dataset is taken from the workspace,
+ *  as initData(name) does, and exported to the cache file for the next jobs.
+ *
+ *  The cache is only used if it was made from the same source: the dataset
+ *  name and the name, size and modification time of sourceFile, usually the
+ *  file the dataset was saved to. If the workspace holds the dataset, also
+ *  the number of entries has to match. Otherwise the cache is rebuilt from
+ *  the workspace.
+ */
+void PDF_Datasets::initData(const TString& name, const TString& cacheFile, const TString& sourceFile) {
+    ProfileTimer pt("PDF_Datasets::initData");
+    TString source = DatasetCache::fingerprint(name, sourceFile);
+    if (source == "") {
+        std::cout << "WARNING in PDF_Datasets::initData -- Source file " << sourceFile << " not found, not using the cache " << cacheFile << std::endl;
+        initData(name);
+        return;
+    }
+    DatasetCache cache(cacheFile);
+    bool upToDate = cache.isValid() && cache.getSource() == source;
+    RooAbsData* wsData = wspc->data(name);
+    if (upToDate && wsData && wsData->numEntries() != cache.getNEntries()) upToDate = false;
+    if (!upToDate) {
+        if (cache.isValid()) {
+            std::cout << "WARNING in PDF_Datasets::initData -- Cache " << cacheFile << " was made from " << cache.getSource()
+                      << ", not from " << source << ". Rebuilding it." << std::endl;
+        }
+        if (!wsData) {
+            std::cout << "FATAL in PDF_Datasets::initData -- No valid cache " << cacheFile << " for " << source
+                      << ", and no dataset " << name << " in the workspace to rebuild it from" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        initData(name);
+        if (DatasetCache::exportDataSet(data, cacheFile, source)) {
+            std::cout << "INFO in PDF_Datasets::initData -- Data exported to cache " << cacheFile << std::endl;
+        }
+        return;
+    }
+    if (isDataSet) {
+        std::cout << "WARNING in PDF_Datasets::initData -- Data already set" << std::endl;
+        std::cout << "WARNING in PDF_Datasets::initData -- Data will not be overwritten" << std::endl;
+        std::cout << "WARNING in PDF_Datasets::initData -- !!!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    RooArgSet vars;
+    for (const TString& column : cache.getColumnNames()) {
+        RooAbsArg* var = wspc->arg(column);
+        if (!var) {
+            std::cout << "FATAL in PDF_Datasets::initData -- Variable " << column << " of cache " << cacheFile << " not found in workspace" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        vars.add(*var);
+    }
+    dataName    = name;
+    data        = cache.makeDataSet(vars, name);
+    isDataSet   = true;
+    isDataOwned = true;
+    if(pdf) this->minNll = pdf->createNLL(*data)->getVal();
+    std::cout << "INFO in PDF_Datasets::initData -- Data initialized from cache " << cacheFile << std::endl;
+    return;
+};
+
 //
 // Sets the name of the set containing the observables, minus the global observables.
 //
@@ -234,6 +307,7 @@ OptParser*   PDF_Datasets::getArg() {
 }
 
 void  PDF_Datasets::generateBkgToysGlobalObservables(int SeedShift) {
+    ProfileTimer pt("PDF_Datasets::generateBkgToysGlobalObservables");
 
     initializeRandomGenerator(SeedShift);
 
@@ -246,8 +320,9 @@ void  PDF_Datasets::generateBkgToysGlobalObservables(int SeedShift) {
         wspc->var(genVal->GetName())->setVal(genVal->getVal());
     }
 
-    // take a snapshot of the global variables in the workspace so they can be loaded later
-    wspc->saveSnapshot(globalObsToySnapshotName, *wspc->set(globalObsName));
+    // take a snapshot of the global variables in the workspace so they can be loaded later.
+    // Use a separate snapshot so that it doesn't overwrite the one of the signal+background toy.
+    wspc->saveSnapshot(globalObsBkgToySnapshotName, *wspc->set(globalObsName));
 }
 
 
@@ -270,6 +345,7 @@ void  PDF_Datasets::generateToysGlobalObservables(int SeedShift) {
 
 
 RooFitResult* PDF_Datasets::fit(RooDataSet* dataToFit) {
+    ProfileTimer pt("PDF_Datasets::fit");
 
     if (this->getWorkspace()->set(constraintName) == NULL) {
         std::cout << std::endl;
@@ -288,7 +364,10 @@ RooFitResult* PDF_Datasets::fit(RooDataSet* dataToFit) {
     RooMsgService::instance().setSilentMode(kTRUE);
     // Choose Dataset to fit to
 
-    RooFitResult* result  = pdf->fitTo( *dataToFit, RooFit::Save() , RooFit::ExternalConstraints(*this->getWorkspace()->set(constraintName)), RooFit::Minimizer("Minuit2", "Migrad"));
+    // With NCPU>1 the NLL is evaluated in NCPU processes, each summing a
+    // contiguous block of events (bulk partitioning). The partial sums are
+    // always added in the same order, so results do not depend on timing.
+    RooFitResult* result  = pdf->fitTo( *dataToFit, RooFit::Save() , RooFit::ExternalConstraints(*this->getWorkspace()->set(constraintName)), RooFit::Minimizer("Minuit2", "Migrad"), RooFit::NumCPU(NCPU, 0));
 
     RooMsgService::instance().setSilentMode(kFALSE);
     RooMsgService::instance().setGlobalKillBelow(INFO);
@@ -301,6 +380,7 @@ RooFitResult* PDF_Datasets::fit(RooDataSet* dataToFit) {
 };
 
 RooFitResult* PDF_Datasets::fitBkg(RooDataSet* dataToFit) {
+    ProfileTimer pt("PDF_Datasets::fitBkg");
 
     if (this->getWorkspace()->set(constraintName) == NULL) {
         std::cout << std::endl;
@@ -325,7 +405,8 @@ RooFitResult* PDF_Datasets::fitBkg(RooDataSet* dataToFit) {
     RooMsgService::instance().setSilentMode(kTRUE);
     // Choose Dataset to fit to
 
-    RooFitResult* result  = pdfBkg->fitTo( *dataToFit, RooFit::Save() , RooFit::ExternalConstraints(*this->getWorkspace()->set(constraintName)), RooFit::Minimizer("Minuit2", "Migrad"));
+    // NCPU: see PDF_Datasets::fit()
+    RooFitResult* result  = pdfBkg->fitTo( *dataToFit, RooFit::Save() , RooFit::ExternalConstraints(*this->getWorkspace()->set(constraintName)), RooFit::Minimizer("Minuit2", "Migrad"), RooFit::NumCPU(NCPU, 0));
 
     RooMsgService::instance().setSilentMode(kFALSE);
     RooMsgService::instance().setGlobalKillBelow(INFO);
@@ -338,9 +419,10 @@ RooFitResult* PDF_Datasets::fitBkg(RooDataSet* dataToFit) {
 };
 
 void   PDF_Datasets::generateToys(int SeedShift) {
+    ProfileTimer pt("PDF_Datasets::generateToys");
 
     initializeRandomGenerator(SeedShift);
-    RooDataSet* toys = this->pdf->generate(*observables, RooFit::NumEvents(wspc->data(dataName)->numEntries()), RooFit::Extended(kTRUE));
+    RooDataSet* toys = this->pdf->generate(*observables, RooFit::NumEvents(data->numEntries()), RooFit::Extended(kTRUE));
 
     // Having the delete in here causes a segmentation fault, likely due to a double free
     // related to Root's internal memory management. Therefore we do not delete,
@@ -351,11 +433,12 @@ void   PDF_Datasets::generateToys(int SeedShift) {
 }
 
 void   PDF_Datasets::generateBkgToys(int SeedShift) {
+    ProfileTimer pt("PDF_Datasets::generateBkgToys");
 
     initializeRandomGenerator(SeedShift);
 
     if(isBkgPdfSet){
-        RooDataSet* toys = pdfBkg->generate(*observables, RooFit::NumEvents(wspc->data(dataName)->numEntries()), RooFit::Extended(kTRUE));
+        RooDataSet* toys = pdfBkg->generate(*observables, RooFit::NumEvents(data->numEntries()), RooFit::Extended(kTRUE));
         this->toyBkgObservables  = toys;
     }
     else{
@@ -364,6 +447,51 @@ void   PDF_Datasets::generateBkgToys(int SeedShift) {
     }
 }
 
+/*! \brief Generates the background-only Asimov dataset
+ *
+ *  The Asimov dataset is the expected distribution of the observables,
+ *  binned in their default binning, with every bin weighted by its expected
+ *  number of events. It is generated from the background pdf at the current
+ *  parameter values. Without background pdf, the signal+background pdf is used,
+ *  so the parameter of interest has to be set to its background value before.
+ *  The caller owns the returned dataset.
+ */
+RooDataSet* PDF_Datasets::generateBkgAsimov() {
+    ProfileTimer pt("PDF_Datasets::generateBkgAsimov");
+
+    RooAbsPdf* p = isBkgPdfSet ? pdfBkg : pdf;
+    RooMsgService::instance().setGlobalKillBelow(ERROR);
+    RooAbsData* asimov = RooStats::AsymptoticCalculator::GenerateAsimovData(*p, RooArgSet(*observables));
+    RooMsgService::instance().setGlobalKillBelow(INFO);
+    RooDataSet* asimovSet = dynamic_cast<RooDataSet*>(asimov);
+    if ( !asimovSet ) {
+        std::cerr << "Error in PDF_Datasets::generateBkgAsimov: could not generate the Asimov dataset." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    asimovSet->SetName("bkgAsimov");
+    return asimovSet;
+}
+
+/*! \brief Log density of a toy at the current parameter values
+ *
+ *  The log of the probability density to generate the toy dataset together
+ *  with the global observables currently set in the workspace, as done by
+ *  generateToys() and generateToysGlobalObservables(). The number of events
+ *  of a toy is drawn around the number of events in the data, independent
+ *  of the parameters, so only the shape of the pdf enters, plus the
+ *  constraint terms of the global observables. Used to reweight toys from
+ *  one set of parameter values to another.
+ */
+double PDF_Datasets::getToyLogDensity(RooDataSet* toy) {
+    RooMsgService::instance().setGlobalKillBelow(ERROR);
+    RooAbsReal* nll = pdf->createNLL(*toy, RooFit::Extended(kFALSE));
+    double logDensity = -nll->getVal();
+    delete nll;
+    RooMsgService::instance().setGlobalKillBelow(INFO);
+    if (_constraintPdf) logDensity += _constraintPdf->getLogVal(wspc->set(globalObsName));
+    return logDensity;
+}
+
 /*! \brief Initializes the random generator
  *
  *  If seedShift is set to zero, the machine environment is used to generate
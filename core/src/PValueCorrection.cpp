@@ -1,13 +1,28 @@
 #include "PValueCorrection.h"
+#include "Profiler.h"
 
 #include <cassert>
 #include <cmath>
+#include <thread>
+
+#include "RVersion.h"
+#include "TNamed.h"
+#include "TROOT.h"
+#include "TSystem.h"
+
+// Reading files from several threads needs ROOT::EnableThreadSafety().
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+#define PVALUECORRECTION_THREADS
+#endif
 
 using namespace std;
 
 PValueCorrection::PValueCorrection(TString _transFunc, bool _verbose):
 	transFunc(_transFunc),
-	verbose(_verbose)
+	verbose(_verbose),
+	nThreads(1),
+	h_pvalue_before(0),
+	h_pvalue_after(0)
 {
 	allowedFuncs.push_back("none");
 	allowedFuncs.push_back("p1");
@@ -18,7 +33,10 @@ PValueCorrection::PValueCorrection(TString _transFunc, bool _verbose):
 
 PValueCorrection::PValueCorrection(int id, bool _verbose):
 	transFunc(""),
-	verbose(_verbose)
+	verbose(_verbose),
+	nThreads(1),
+	h_pvalue_before(0),
+	h_pvalue_after(0)
 {
 	if (id==0) transFunc = "none";
 	else if (id==1) transFunc = "p1";
@@ -65,6 +83,18 @@ void PValueCorrection::checkParams()
 	if (transFunc=="p1+1/x") assert(fitParams.size()==4);
 }
 
+///
+/// Set up the fit function of the transform.
+///
+void PValueCorrection::setFitFunc()
+{
+	if (transFunc=="none") return;
+	if (transFunc=="p1") fitString = "pol1";
+	if (transFunc=="p1+exp") fitString = "[0] + [1]*x + [2]*exp(-1.*[3]*x)";
+	if (transFunc=="p1+1/x") fitString = "[0] + [1]*x + [2]/(x+[3])";
+	fitFunc = TF1("fit",fitString,0.,1.);
+}
+
 void PValueCorrection::fitHist(TH1 *h)
 {
 
@@ -72,11 +102,7 @@ void PValueCorrection::fitHist(TH1 *h)
 	fitParams.clear();
 
 	if (transFunc=="none") return;
-	if (transFunc=="p1") fitString = "pol1";
-	if (transFunc=="p1+exp") fitString = "[0] + [1]*x + [2]*exp(-1.*[3]*x)";
-	if (transFunc=="p1+1/x") fitString = "[0] + [1]*x + [2]/(x+[3])";
-
-	fitFunc = TF1("fit",fitString,0.,1.);
+	setFitFunc();
 	verbose ? h->Fit(&fitFunc,"N") : h->Fit(&fitFunc,"NQ");
 	for (int f=0; f<fitFunc.GetNumberFreeParameters(); f++){
 		fitParams.push_back(fitFunc.GetParameter(f));
@@ -142,14 +168,28 @@ void PValueCorrection::write(TFile *f){
 	fitFunc.Write();
 }
 
+///
+/// Read the coverage test files of a combination, fill the p-value
+/// histograms before and after the correction, and fit the transform.
+/// The result is cached next to the directory of the files, keyed by
+/// the names, sizes and modification times of all files that are read,
+/// so that it is only recomputed when the coverage test changes.
+/// The files are read by setNThreads() threads.
+///
+/// \param name - name of the directory in root/ holding the files
+/// \param id - only read files of this scan point
+/// \param isPlugin - correct the plugin p-value, else the prob one
+///
 void PValueCorrection::readFiles(TString name, int id, bool isPlugin){
 
-	// read coverage test files
+	ProfileTimer pt("PValueCorrection::readFiles");
+
+	// find coverage test files, sorted so that the result
+	// doesn't depend on the order of the directory listing
 	name = "root/"+name;
 	TSystemDirectory dir(name,name);
 	TList *files = dir.GetListOfFiles();
-	TChain *fChain = new TChain("tree");
-	int foundFiles=0;
+	vector<TString> fileNames;
 	if (files){
 		TSystemFile *file;
 		TString fname;
@@ -157,78 +197,154 @@ void PValueCorrection::readFiles(TString name, int id, bool isPlugin){
 		while ((file=(TSystemFile*)next())) {
 			fname = file->GetName();
 			if (!file->IsDirectory() && fname.Contains(Form("id%d",id)) && fname.EndsWith(".root")) {
-				//cout << fname << endl;
-				fChain->Add(name+"/"+fname);
-				foundFiles++;
+				fileNames.push_back(name+"/"+fname);
 			}
 		}
+		delete files;
 	}
+	sort(fileNames.begin(), fileNames.end());
+
+	// everything the correction depends on
+	TString key = Form("%s;%s;id%d", transFunc.Data(), isPlugin ? "plugin" : "prob", id);
+	for (unsigned int i=0; i<fileNames.size(); i++){
+		FileStat_t st;
+		gSystem->GetPathInfo(fileNames[i], st);
+		key += Form(";%s:%lld:%ld", fileNames[i].Data(), (long long)st.fSize, st.fMtime);
+	}
+	TString cacheName = name+Form("_pvalueCorrection_id%d_%s.root", id, isPlugin ? "plugin" : "prob");
 
-	cout << "PValueCorrector::readFiles() -- found " << foundFiles << " files in " << dir.GetName() << " with total of " << fChain->GetEntries() << " entries" << endl;
+	cout << "PValueCorrector::readFiles() -- found " << fileNames.size() << " files in " << dir.GetName() << endl;
 	cout << "PValueCorrector::readFiles() -- will apply on the fly correction of type ";
 	isPlugin ? cout << " plugin"<< endl : cout << " prob" << endl;
 
-	// fill histogram from tree
-	h_pvalue_before = new TH1F("h_pvalue_before","p-value",50,0.,1.);
-	h_pvalue_after = new TH1F("h_pvalue_after","p-value",50,0.,1.);
-
-
-	// set up root tree for reading
-  float tSol = 0.0;
-  float tChi2free = 0.0;
-  float tChi2scan = 0.0;
-  float tSolGen = 0.0;
-  float tPvalue = 0.0;
-  fChain->SetBranchAddress("sol",      &tSol);
-  fChain->SetBranchAddress("chi2free", &tChi2free);
-  fChain->SetBranchAddress("chi2scan", &tChi2scan);
-  fChain->SetBranchAddress("solGen",   &tSolGen);
-  fChain->SetBranchAddress("pvalue",   &tPvalue);
-
-	// initialize loop variables
-  Long64_t nentries = fChain->GetEntries();
-  Long64_t nfailed = 0;
-  float n68 =0.;
-  float n95 =0.;
-  float n99 =0.;
+	if ( loadCache(cacheName, key) ){
+		cout << "PValueCorrector::readFiles() -- loaded correction from " << cacheName << endl;
+		return;
+	}
 
-	for (Long64_t i = 0; i < nentries; i++)
-	{
-		fChain->GetEntry(i);
-    // apply cuts (we'll count the failed ones later)
-    if ( ! (tChi2free > -1e10 && tChi2scan > -1e10
-         && tChi2scan-tChi2free>0
-         && tSol != 0.0 ///< exclude some pathological jobs from when tSol wasn't set yet
-         && tChi2free < 500 && tChi2scan < 500
-      )){
-			nfailed++;
-      continue;
-    }
-		float pvalue = -999.;
-		if (isPlugin) {
-			pvalue = tPvalue;
+	// read the p-values of all toys passing the cuts
+	vector<float> pvalues;
+	Long64_t nentries = 0;
+	int nUsed = 1;
+	#ifdef PVALUECORRECTION_THREADS
+	nUsed = TMath::Min(nThreads, (int)fileNames.size());
+	#endif
+	if ( nUsed<=1 ){
+		readPvalues(fileNames, 0, fileNames.size(), isPlugin, pvalues, nentries);
+	}
+	#ifdef PVALUECORRECTION_THREADS
+	else {
+		ROOT::EnableThreadSafety();
+		vector<vector<float> > threadPvalues(nUsed);
+		vector<Long64_t> threadEntries(nUsed, 0);
+		vector<thread> workers;
+		for ( int k=0; k<nUsed; k++ ){
+			int first = fileNames.size()*k/nUsed;
+			int last = fileNames.size()*(k+1)/nUsed;
+			workers.push_back(thread([this, k, first, last, isPlugin, &fileNames, &threadPvalues, &threadEntries](){
+				readPvalues(fileNames, first, last, isPlugin, threadPvalues[k], threadEntries[k]);
+			}));
 		}
-		else {
-			pvalue = TMath::Prob(tChi2scan-tChi2free,1);
+		for ( unsigned int k=0; k<workers.size(); k++ ) workers[k].join();
+
+		// merge in file order, so the result doesn't depend on timing
+		for ( int k=0; k<nUsed; k++ ){
+			pvalues.insert(pvalues.end(), threadPvalues[k].begin(), threadPvalues[k].end());
+			nentries += threadEntries[k];
 		}
+	}
+	#endif
+	cout << "PValueCorrector::readFiles() -- read " << nentries << " entries, "
+		<< nentries-pvalues.size() << " failed the cuts" << endl;
 
+	// fill histogram
+	if (h_pvalue_before) delete h_pvalue_before;
+	if (h_pvalue_after) delete h_pvalue_after;
+	h_pvalue_before = new TH1F("h_pvalue_before","p-value",50,0.,1.);
+	h_pvalue_after = new TH1F("h_pvalue_after","p-value",50,0.,1.);
+	h_pvalue_before->SetDirectory(0);
+	h_pvalue_after->SetDirectory(0);
+
+	float n = pvalues.size();
+	float n68 =0.;
+	float n95 =0.;
+	float n99 =0.;
+	for (unsigned int i = 0; i < pvalues.size(); i++)
+	{
+		float pvalue = pvalues[i];
 		if ( pvalue > TMath::Prob(1,1) ) n68++;
 		if ( pvalue > TMath::Prob(4,1) ) n95++;
 		if ( pvalue > TMath::Prob(9,1) ) n99++;
-
 		h_pvalue_before->Fill(pvalue);
 	}
+	TVectorD coverage(7);
+	coverage[0] = n68;
+	coverage[1] = n95;
+	coverage[2] = n99;
+	coverage[6] = n;
 
 	fitHist(h_pvalue_before);
-	if (verbose) printCoverage(n68,n95,n99,float(nentries-nfailed),"Before Correction");
+	if (verbose) printCoverage(n68,n95,n99,n,"Before Correction");
 
 	n68=0.;
 	n95=0.;
 	n99=0.;
+	for (unsigned int i = 0; i < pvalues.size(); i++)
+	{
+		float pvalue = transform(pvalues[i]);
+		if ( pvalue > TMath::Prob(1,1) ) n68++;
+		if ( pvalue > TMath::Prob(4,1) ) n95++;
+		if ( pvalue > TMath::Prob(9,1) ) n99++;
+		h_pvalue_after->Fill(pvalue);
+	}
+	coverage[3] = n68;
+	coverage[4] = n95;
+	coverage[5] = n99;
+
+	if (verbose) printCoverage(n68,n95,n99,n,"After Correction");
+	checkParams();
+	saveCache(cacheName, key, coverage);
+}
+
+///
+/// Read the p-values of the toys passing the cuts from some of the
+/// coverage test files. Safe to call from several threads.
+///
+/// \param files - all files
+/// \param first - first file to read
+/// \param last - one past the last file to read
+/// \param isPlugin - read the plugin p-value, else compute the prob one
+/// \param pvalues - the p-values get appended here
+/// \param nentries - number of entries read, including those failing the cuts
+///
+void PValueCorrection::readPvalues(const vector<TString>& files, int first, int last, bool isPlugin,
+		vector<float>& pvalues, Long64_t& nentries) const
+{
+	nentries = 0;
+	if ( first>=last ) return;
+	TChain chain("tree");
+	for (int i=first; i<last; i++) chain.Add(files[i]);
+
+	// set up root tree for reading
+  float tSol = 0.0;
+  float tChi2free = 0.0;
+  float tChi2scan = 0.0;
+  float tPvalue = 0.0;
+  chain.SetBranchStatus("*", 0);
+  chain.SetBranchStatus("sol", 1);
+  chain.SetBranchStatus("chi2free", 1);
+  chain.SetBranchStatus("chi2scan", 1);
+  chain.SetBranchStatus("pvalue", 1);
+  chain.SetBranchAddress("sol",      &tSol);
+  chain.SetBranchAddress("chi2free", &tChi2free);
+  chain.SetBranchAddress("chi2scan", &tChi2scan);
+  chain.SetBranchAddress("pvalue",   &tPvalue);
+
+	nentries = chain.GetEntries();
 	for (Long64_t i = 0; i < nentries; i++)
 	{
-		fChain->GetEntry(i);
-    // apply cuts (we'll count the failed ones later)
+		chain.GetEntry(i);
+    // apply cuts
     if ( ! (tChi2free > -1e10 && tChi2scan > -1e10
          && tChi2scan-tChi2free>0
          && tSol != 0.0 ///< exclude some pathological jobs from when tSol wasn't set yet
@@ -236,21 +352,77 @@ void PValueCorrection::readFiles(TString name, int id, bool isPlugin){
       )){
       continue;
     }
-		float pvalue = -999.;
-		if (isPlugin) {
-			pvalue = transform(tPvalue);
-		}
-		else {
-			pvalue = transform(TMath::Prob(tChi2scan-tChi2free,1));
-		}
-
-		if ( pvalue > TMath::Prob(1,1) ) n68++;
-		if ( pvalue > TMath::Prob(4,1) ) n95++;
-		if ( pvalue > TMath::Prob(9,1) ) n99++;
+		if (isPlugin) pvalues.push_back(tPvalue);
+		else pvalues.push_back(TMath::Prob(tChi2scan-tChi2free,1));
+	}
+}
 
-		h_pvalue_after->Fill(pvalue);
+///
+/// Load the histograms and the transform from a cache file
+/// written by saveCache().
+///
+/// \return false if the file doesn't exist or was made from different inputs
+///
+bool PValueCorrection::loadCache(TString fname, TString key)
+{
+	if ( gSystem->AccessPathName(fname) ) return false;
+	TFile f(fname);
+	TNamed *cachedKey = (TNamed*)f.Get("key");
+	TH1F *hBefore = (TH1F*)f.Get("h_pvalue_before");
+	TH1F *hAfter = (TH1F*)f.Get("h_pvalue_after");
+	TVectorD *params = (TVectorD*)f.Get("fitParams");
+	TVectorD *coverage = (TVectorD*)f.Get("coverage");
+	// detach the histograms from the file, so that we own all of them
+	if (hBefore) hBefore->SetDirectory(0);
+	if (hAfter) hAfter->SetDirectory(0);
+	if ( !cachedKey || !hBefore || !hAfter || !params || !coverage || key!=cachedKey->GetTitle() ){
+		delete cachedKey;
+		delete hBefore;
+		delete hAfter;
+		delete params;
+		delete coverage;
+		return false;
 	}
+	delete cachedKey;
 
-	if (verbose) printCoverage(n68,n95,n99,float(nentries-nfailed),"After Correction");
+	if (h_pvalue_before) delete h_pvalue_before;
+	if (h_pvalue_after) delete h_pvalue_after;
+	h_pvalue_before = hBefore;
+	h_pvalue_after = hAfter;
+	fitParams.clear();
+	for (int i=0; i<params->GetNrows(); i++) fitParams.push_back((*params)[i]);
+	delete params;
+	setFitFunc();
+	for (unsigned int i=0; i<fitParams.size(); i++) fitFunc.SetParameter(i, fitParams[i]);
 	checkParams();
+
+	const TVectorD& c = *coverage;
+	if (verbose) printCoverage(c[0],c[1],c[2],c[6],"Before Correction");
+	if (verbose) printCoverage(c[3],c[4],c[5],c[6],"After Correction");
+	delete coverage;
+	return true;
+}
+
+///
+/// Save the histograms and the transform, so that the next
+/// readFiles() of the same inputs can load them.
+///
+/// \param coverage - coverage counts before and after the correction, and the number of toys
+///
+void PValueCorrection::saveCache(TString fname, TString key, const TVectorD& coverage)
+{
+	TFile f(fname, "recreate");
+	if ( f.IsZombie() ){
+		cout << "PValueCorrection::saveCache() : WARNING : could not write " << fname << endl;
+		return;
+	}
+	TNamed cachedKey("key", key);
+	TVectorD params(fitParams.size());
+	for (unsigned int i=0; i<fitParams.size(); i++) params[i] = fitParams[i];
+	cachedKey.Write();
+	h_pvalue_before->Write();
+	h_pvalue_after->Write();
+	params.Write("fitParams");
+	coverage.Write("coverage");
+	f.Close();
 }
@@ -0,0 +1,58 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "ParameterBinding.h"
+
+///
+/// Set the parameters of the schema to the stored values.
+///
+/// \param floatingOnly - only set parameters that are not constant
+///
+void ParameterSnapshot::apply(bool floatingOnly) const
+{
+	if ( !_schema ) return;
+	for ( unsigned int i=0; i<_schema->size(); i++ ){
+		RooRealVar *p = (*_schema)[i];
+		if ( floatingOnly && p->isConstant() ) continue;
+		p->setVal(_values[i]);
+	}
+}
+
+ParameterBinding::ParameterBinding(const RooAbsCollection* setMe, const RooAbsCollection* values)
+{
+	bind(setMe, values);
+}
+
+///
+/// Pair each parameter in setMe with the one of the same name in values.
+/// Parameters not found in values are left out, like in Utils::setParameters().
+///
+void ParameterBinding::bind(const RooAbsCollection* setMe, const RooAbsCollection* values)
+{
+	_dst.clear();
+	_src.clear();
+	TIterator* it = setMe->createIterator();
+	while ( RooRealVar* p = (RooRealVar*)it->Next() ){
+		RooRealVar *var = (RooRealVar*)values->find(p->GetName());
+		if ( !var ) continue;
+		_dst.push_back(p);
+		_src.push_back(var);
+	}
+	delete it;
+}
+
+///
+/// Copy the values.
+///
+/// \param floatingOnly - only set parameters that are not constant,
+///                       like Utils::setParametersFloating()
+///
+void ParameterBinding::apply(bool floatingOnly) const
+{
+	for ( unsigned int i=0; i<_dst.size(); i++ ){
+		if ( floatingOnly && _dst[i]->isConstant() ) continue;
+		_dst[i]->setVal(_src[i]->getVal());
+	}
+}
@@ -0,0 +1,273 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+bool Profiler::_enabled = false;
+
+ProfilerEntry::ProfilerEntry()
+	: isCounter(false), calls(0), total(0), max(0), hist(nBins, 0)
+{}
+
+///
+/// Book one call of duration ns.
+///
+void ProfilerEntry::add(long long ns)
+{
+	calls++;
+	total += ns;
+	if ( ns>max ) max = ns;
+	int bin = ns>0 ? (int)(4.*log2((double)ns)) : 0;
+	if ( bin<0 ) bin = 0;
+	if ( bin>=nBins ) bin = nBins-1;
+	hist[bin]++;
+}
+
+void ProfilerEntry::merge(const ProfilerEntry& other)
+{
+	isCounter = other.isCounter;
+	calls += other.calls;
+	total += other.total;
+	if ( other.max>max ) max = other.max;
+	for ( int i=0; i<nBins; i++ ) hist[i] += other.hist[i];
+}
+
+///
+/// Estimate a percentile of the call durations from the histogram.
+/// Returns the upper edge of the bin containing the percentile, but
+/// never more than the longest call.
+/// \param p percentile, e.g. 0.99
+/// \return duration in ns
+///
+double ProfilerEntry::percentile(double p) const
+{
+	if ( calls==0 ) return 0.;
+	unsigned long long sum = 0;
+	for ( int i=0; i<nBins; i++ ){
+		sum += hist[i];
+		if ( sum>=p*calls ) return min(pow(2., (i+1)/4.), (double)max);
+	}
+	return max;
+}
+
+Profiler::Profiler()
+	: _fileName(""), _written(false)
+{}
+
+Profiler& Profiler::instance()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+///
+/// Switch on profiling. The report gets written to fileName when
+/// the program exits, also when exit() is called. If fileName ends
+/// in .csv, a CSV table is written, else JSON.
+///
+void Profiler::enable(TString fileName)
+{
+	_fileName = fileName;
+	if ( !_enabled ) atexit(Profiler::writeReportAtExit);
+	_enabled = true;
+}
+
+///
+/// Return the table of the calling thread, and create it
+/// on the first call.
+///
+Profiler::Table& Profiler::threadTable()
+{
+	static thread_local Table* table = 0;
+	if ( !table ){
+		table = new Table();
+		lock_guard<mutex> lock(_mutex);
+		_tables.push_back(table);
+	}
+	return *table;
+}
+
+void Profiler::addTime(const char* name, long long ns)
+{
+	threadTable()[name].add(ns);
+}
+
+void Profiler::addCount(const char* name, long long n)
+{
+	ProfilerEntry& e = threadTable()[name];
+	e.isCounter = true;
+	e.calls += n;
+}
+
+///
+/// Merge the tables of all threads, and those of the worker
+/// processes. Entries are keyed by name, so that equal string
+/// literals from different translation units end up in the
+/// same entry.
+///
+map<string, ProfilerEntry> Profiler::mergeTables()
+{
+	lock_guard<mutex> lock(_mutex);
+	map<string, ProfilerEntry> merged = _workerEntries;
+	for ( int i=0; i<_tables.size(); i++ ){
+		for ( Table::const_iterator it=_tables[i]->begin(); it!=_tables[i]->end(); ++it ){
+			merged[it->first].merge(it->second);
+		}
+	}
+	return merged;
+}
+
+///
+/// Print a summary table to stdout, sorted by name.
+///
+void Profiler::print()
+{
+	map<string, ProfilerEntry> entries = mergeTables();
+	cout << "Profiler::print() : time spent in instrumented code:" << endl;
+	printf("  %-45s %12s %12s %12s %12s\n", "name", "calls", "total [s]", "mean [ms]", "p99 [ms]");
+	for ( map<string, ProfilerEntry>::const_iterator it=entries.begin(); it!=entries.end(); ++it ){
+		const ProfilerEntry& e = it->second;
+		if ( e.isCounter ){
+			printf("  %-45s %12llu\n", it->first.c_str(), e.calls);
+			continue;
+		}
+		printf("  %-45s %12llu %12.3f %12.3f %12.3f\n", it->first.c_str(), e.calls,
+				e.total*1e-9, e.total*1e-6/e.calls, e.percentile(0.99)*1e-6);
+	}
+}
+
+///
+/// Write the report file. Times are given in seconds.
+///
+void Profiler::writeReport()
+{
+	if ( _fileName=="" ) return;
+	map<string, ProfilerEntry> entries = mergeTables();
+	ofstream out(_fileName.Data());
+	if ( !out.is_open() ){
+		cout << "Profiler::writeReport() : ERROR : can't open file " << _fileName << endl;
+		return;
+	}
+	bool csv = _fileName.EndsWith(".csv");
+	if ( csv ) out << "name,type,calls,total,mean,p99,max" << endl;
+	else out << "{" << endl << "  \"timers\": [" << endl;
+	bool first = true;
+	for ( map<string, ProfilerEntry>::const_iterator it=entries.begin(); it!=entries.end(); ++it ){
+		const ProfilerEntry& e = it->second;
+		if ( e.isCounter ) continue;
+		double mean = e.total*1e-9/e.calls;
+		if ( csv ){
+			out << it->first << ",timer," << e.calls << "," << e.total*1e-9 << "," << mean
+				<< "," << e.percentile(0.99)*1e-9 << "," << e.max*1e-9 << endl;
+			continue;
+		}
+		if ( !first ) out << "," << endl;
+		out << "    {\"name\": \"" << it->first << "\", \"calls\": " << e.calls
+			<< ", \"total\": " << e.total*1e-9 << ", \"mean\": " << mean
+			<< ", \"p99\": " << e.percentile(0.99)*1e-9 << ", \"max\": " << e.max*1e-9 << "}";
+		first = false;
+	}
+	if ( !csv ) out << endl << "  ]," << endl << "  \"counters\": [" << endl;
+	first = true;
+	for ( map<string, ProfilerEntry>::const_iterator it=entries.begin(); it!=entries.end(); ++it ){
+		const ProfilerEntry& e = it->second;
+		if ( !e.isCounter ) continue;
+		if ( csv ){
+			out << it->first << ",counter," << e.calls << ",,,," << endl;
+			continue;
+		}
+		if ( !first ) out << "," << endl;
+		out << "    {\"name\": \"" << it->first << "\", \"count\": " << e.calls << "}";
+		first = false;
+	}
+	if ( !csv ) out << endl << "  ]" << endl << "}" << endl;
+	out.close();
+	cout << "Profiler::writeReport() : written " << _fileName << endl;
+	_written = true;
+}
+
+void Profiler::writeReportAtExit()
+{
+	Profiler& p = Profiler::instance();
+	if ( p._written ) return;
+	p.print();
+	p.writeReport();
+}
+
+///
+/// Called in a new worker process right after the fork. Drops
+/// what the parent had booked before, so that it isn't counted
+/// twice, and keeps the worker from writing the report.
+///
+void Profiler::startWorker()
+{
+	lock_guard<mutex> lock(_mutex);
+	for ( int i=0; i<_tables.size(); i++ ) _tables[i]->clear();
+	_workerEntries.clear();
+	_written = true;
+}
+
+TString Profiler::workerTablesFileName(int iWorker, int parentPid)
+{
+	return Form("%s.%i.worker%i", _fileName.Data(), parentPid, iWorker);
+}
+
+///
+/// Save the tables of a worker process, so that the parent can
+/// merge them with mergeWorkerTables(). To be called before the
+/// worker leaves.
+///
+/// \param iWorker - number of this worker, see Utils::forkWorkers()
+///
+void Profiler::writeWorkerTables(int iWorker)
+{
+	if ( _fileName=="" ) return;
+	TString fileName = workerTablesFileName(iWorker, getppid());
+	map<string, ProfilerEntry> entries = mergeTables();
+	ofstream out(fileName.Data());
+	if ( !out.is_open() ){
+		cout << "Profiler::writeWorkerTables() : ERROR : can't open file " << fileName << endl;
+		return;
+	}
+	// one entry per line, the name last, as it may contain spaces
+	for ( map<string, ProfilerEntry>::const_iterator it=entries.begin(); it!=entries.end(); ++it ){
+		const ProfilerEntry& e = it->second;
+		out << e.isCounter << " " << e.calls << " " << e.total << " " << e.max;
+		for ( int i=0; i<ProfilerEntry::nBins; i++ ) out << " " << e.hist[i];
+		out << " " << it->first << endl;
+	}
+	out.close();
+}
+
+///
+/// Add the tables a finished worker process saved with
+/// writeWorkerTables(), and delete its file.
+///
+/// \param iWorker - number of the worker
+///
+void Profiler::mergeWorkerTables(int iWorker)
+{
+	if ( _fileName=="" ) return;
+	TString fileName = workerTablesFileName(iWorker, getpid());
+	ifstream in(fileName.Data());
+	if ( !in.is_open() ){
+		cout << "Profiler::mergeWorkerTables() : WARNING : no profile of worker " << iWorker << endl;
+		return;
+	}
+	ProfilerEntry e;
+	while ( in >> e.isCounter >> e.calls >> e.total >> e.max ){
+		for ( int i=0; i<ProfilerEntry::nBins; i++ ) in >> e.hist[i];
+		string name;
+		in.ignore(1);
+		getline(in, name);
+		lock_guard<mutex> lock(_mutex);
+		_workerEntries[name].merge(e);
+	}
+	in.close();
+	remove(fileName.Data());
+}
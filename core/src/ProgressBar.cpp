@@ -9,6 +9,10 @@ ProgressBar::ProgressBar(OptParser *arg, unsigned int n)
 	_width = 50;
 	_resolution = _width;
 	_batch = _arg->isAction("pluginbatch") || _arg->isAction("bbbatch");
+	_heartbeat = 0;
+	_silent = false;
+	_nFits = 0;
+	_nFitsFailed = 0;
 }
 
 ProgressBar::~ProgressBar()
@@ -20,6 +24,8 @@ ProgressBar::~ProgressBar()
 void ProgressBar::progress()
 {
 	_x++;
+	if ( _heartbeat ) _heartbeat->step();
+	if ( _silent ) return;
 	if ( (_x != _n) && (_x % (_n/_resolution+1) != 0) ) return;
 	if ( _batch ) progressPercentage();
 	else progressBar();
@@ -67,4 +73,37 @@ void ProgressBar::progressPercentage()
 void ProgressBar::skipSteps(unsigned int n)
 {
 	_x += n;
+	if ( _heartbeat && n>0 ) _heartbeat->step(n);
+}
+
+///
+/// Report the status of a fit to the heartbeat, if any.
+///
+void ProgressBar::fitDone(int status)
+{
+	_nFits++;
+	if ( status!=0 ) _nFitsFailed++;
+	if ( _heartbeat ) _heartbeat->fitDone(status);
+}
+
+///
+/// Report fits done elsewhere, e.g. by other worker processes,
+/// to the heartbeat, if any.
+///
+void ProgressBar::skipFits(int n, int nFailed)
+{
+	if ( _heartbeat && n>0 ) _heartbeat->fitsDone(n, nFailed);
+}
+
+///
+/// Report the current scan point to the heartbeat, if any.
+///
+void ProgressBar::setScanpoint(double x)
+{
+	if ( _heartbeat ) _heartbeat->setScanpoint(x);
+}
+
+void ProgressBar::setScanpoint(double x, double y)
+{
+	if ( _heartbeat ) _heartbeat->setScanpoint(x, y);
 }
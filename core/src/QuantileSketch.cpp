@@ -0,0 +1,256 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "QuantileSketch.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+///
+/// \param compression - the accuracy parameter delta. The sketch holds
+///                      about this many centroids once compressed. The
+///                      default keeps the +/-1 and 2 sigma quantiles of
+///                      1e5 toys well within their statistical error.
+///
+QuantileSketch::QuantileSketch(double compression)
+{
+	this->compression = compression;
+	sorted = true;
+	nCompressed = 0;
+	total = 0.;
+	min = 0.;
+	max = 0.;
+}
+
+///
+/// Restore a sketch stored with toVector().
+///
+QuantileSketch::QuantileSketch(const TVectorD& v)
+{
+	if ( v.GetNrows()<3 || (v.GetNrows()-3)%3!=0 ){
+		cout << "QuantileSketch::QuantileSketch() : ERROR : not a stored sketch, wrong size: " << v.GetNrows() << endl;
+		exit(1);
+	}
+	compression = v[0];
+	min = v[1];
+	max = v[2];
+	total = 0.;
+	for ( int i=3; i<v.GetNrows(); i+=3 ){
+		Centroid c;
+		c.mean = v[i];
+		c.weight = v[i+1];
+		c.atom = v[i+2]!=0.;
+		c.n = v[i+2];
+		centroids.push_back(c);
+		total += c.weight;
+	}
+	sorted = false;
+	nCompressed = centroids.size();
+}
+
+QuantileSketch::~QuantileSketch()
+{}
+
+///
+/// Add a value, optionally weighted.
+///
+void QuantileSketch::add(double value, double weight)
+{
+	if ( total==0. || value<min ) min = value;
+	if ( total==0. || value>max ) max = value;
+	Centroid c;
+	c.mean = value;
+	c.weight = weight;
+	c.atom = true;
+	c.n = 1.;
+	centroids.push_back(c);
+	total += weight;
+	sorted = false;
+	if ( centroids.size() > nCompressed+5.*compression ) compress();
+}
+
+///
+/// Add all values of another sketch.
+///
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+	if ( other.total==0. ) return;
+	if ( total==0. || other.min<min ) min = other.min;
+	if ( total==0. || other.max>max ) max = other.max;
+	centroids.insert(centroids.end(), other.centroids.begin(), other.centroids.end());
+	total += other.total;
+	sorted = false;
+	if ( centroids.size() > nCompressed+5.*compression ) compress();
+}
+
+///
+/// Sort the centroids, and join adjacent atoms of the same value.
+///
+void QuantileSketch::sort()
+{
+	if ( sorted ) return;
+	std::stable_sort(centroids.begin(), centroids.end());
+	vector<Centroid> joined;
+	for ( unsigned int i=0; i<centroids.size(); i++ ){
+		const Centroid& c = centroids[i];
+		if ( !joined.empty() && c.atom && joined.back().atom && c.mean==joined.back().mean ){
+			joined.back().weight += c.weight;
+			joined.back().n += c.n;
+			continue;
+		}
+		joined.push_back(c);
+	}
+	centroids.swap(joined);
+	sorted = true;
+}
+
+///
+/// Merge neighbouring centroids as long as they stay within one unit
+/// of the k1 scale function k(q) = delta/(2pi) asin(2q-1), which
+/// keeps the centroids small at the tails.
+///
+void QuantileSketch::compress()
+{
+	profileCount("QuantileSketch::compress");
+	sort();
+	if ( centroids.empty() ) return;
+	const double norm = compression/(2.*TMath::Pi());
+	vector<Centroid> merged;
+	Centroid cur = centroids[0];
+	double wBefore = 0.;
+	for ( unsigned int i=1; i<centroids.size(); i++ ){
+		const Centroid& c = centroids[i];
+		bool join;
+		if ( cur.atom && c.atom && cur.mean==c.mean ) join = true;
+		else if ( (cur.atom && cur.n>1.) || (c.atom && c.n>1.) ) join = false;
+		else{
+			double qLeft = wBefore/total;
+			double qRight = TMath::Min((wBefore+cur.weight+c.weight)/total, 1.);
+			join = norm*(asin(2.*qRight-1.)-asin(2.*qLeft-1.)) <= 1.;
+		}
+		if ( join ){
+			if ( cur.mean!=c.mean ){
+				cur.mean = (cur.mean*cur.weight + c.mean*c.weight)/(cur.weight+c.weight);
+				cur.atom = false;
+			}
+			cur.weight += c.weight;
+			cur.n += c.n;
+			continue;
+		}
+		merged.push_back(cur);
+		wBefore += cur.weight;
+		cur = c;
+	}
+	merged.push_back(cur);
+	centroids.swap(merged);
+	nCompressed = centroids.size();
+}
+
+///
+/// Half the weight of a centroid is spread below its mean, half above,
+/// except for atoms, which sit exactly at their value.
+///
+double QuantileSketch::halfWeight(int i) const
+{
+	return centroids[i].atom ? 0. : 0.5*centroids[i].weight;
+}
+
+///
+/// The p-quantile. Like Utils::Quantile(), the i-th of n sorted values
+/// is at rank i+0.5, and ranks in between are interpolated linearly.
+///
+double QuantileSketch::quantile(double p)
+{
+	if ( total==0. ) return 0.;
+	sort();
+	double r = p*total;
+	double start = 0.;
+	double mPrev = 0.;
+	double rPrev = 0.;
+	for ( unsigned int i=0; i<centroids.size(); i++ ){
+		const Centroid& c = centroids[i];
+		// the ranks [lo,hi] at which the quantile is exactly the centroid mean
+		double lo, hi;
+		if ( c.atom ){
+			lo = start + TMath::Min(0.5, 0.5*c.weight);
+			hi = start + c.weight - TMath::Min(0.5, 0.5*c.weight);
+		}
+		else lo = hi = start + 0.5*c.weight;
+		if ( r<lo ){
+			if ( i>0 ) return mPrev + (c.mean-mPrev)*(r-rPrev)/(lo-rPrev);
+			if ( c.atom ) return c.mean;
+			return min + (c.mean-min)*r/lo;
+		}
+		if ( r<=hi ) return c.mean;
+		start += c.weight;
+		mPrev = c.mean;
+		rPrev = hi;
+	}
+	if ( centroids.back().atom || rPrev>=total ) return mPrev;
+	return mPrev + (max-mPrev)*(r-rPrev)/(total-rPrev);
+}
+
+///
+/// Several quantiles at once, with the interface of Utils::Quantile().
+///
+vector<double> QuantileSketch::quantiles(const vector<double>& probs)
+{
+	vector<double> q;
+	if ( total==0. ) return q;
+	for ( unsigned int k=0; k<probs.size(); k++ ) q.push_back(quantile(probs[k]));
+	return q;
+}
+
+///
+/// The fraction of values >= value, like Utils::getVectorFracAboveValue().
+/// The cumulative weight is interpolated linearly between the means
+/// of neighbouring centroids.
+///
+double QuantileSketch::fracAbove(double value)
+{
+	if ( total==0. ) return 0.;
+	if ( value<=min ) return 1.;
+	if ( value>max ) return 0.;
+	sort();
+	int n = centroids.size();
+	int i = 0;
+	double before = 0.;
+	while ( i<n && centroids[i].mean<value ){
+		before += centroids[i].weight;
+		i++;
+	}
+	double below;
+	if ( i==0 ){
+		below = halfWeight(0)*(value-min)/(centroids[0].mean-min);
+	}
+	else if ( i==n ){
+		below = total - halfWeight(n-1)*(max-value)/(max-centroids[n-1].mean);
+	}
+	else{
+		double frac = (value-centroids[i-1].mean)/(centroids[i].mean-centroids[i-1].mean);
+		below = before - halfWeight(i-1) + (halfWeight(i-1)+halfWeight(i))*frac;
+	}
+	return 1. - below/total;
+}
+
+///
+/// Store the sketch in a vector, e.g. to write it to a file:
+/// compression, min, max, and then mean, weight and, for atoms,
+/// the number of values (0 for other centroids) of each centroid.
+///
+TVectorD QuantileSketch::toVector()
+{
+	sort();
+	TVectorD v(3+3*centroids.size());
+	v[0] = compression;
+	v[1] = min;
+	v[2] = max;
+	for ( unsigned int i=0; i<centroids.size(); i++ ){
+		v[3+3*i] = centroids[i].mean;
+		v[4+3*i] = centroids[i].weight;
+		v[5+3*i] = centroids[i].atom ? centroids[i].n : 0.;
+	}
+	return v;
+}
@@ -0,0 +1,162 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "ScanPredictor.h"
+#include "Profiler.h"
+
+///
+/// \param w - the workspace holding the parameters
+/// \param parsName - name of the set of parameters to predict. The
+///                   scan parameter may be part of it, it is skipped.
+/// \param scanVar - name of the scan parameter
+/// \param cov - optional fit result with the scan parameter floating,
+///              e.g. the global minimum. Its covariance matrix provides
+///              the slope for the first step. Not owned, only read here.
+///
+ScanPredictor::ScanPredictor(RooWorkspace* w, TString parsName, TString scanVar, const RooFitResult* cov)
+{
+	if ( !w->var(scanVar) ){
+		cout << "ScanPredictor::ScanPredictor() : ERROR : scan parameter not found in workspace: " << scanVar << endl;
+		exit(1);
+	}
+
+	// the slopes need an accurate covariance matrix with the scan parameter floating
+	int iScan = -1;
+	if ( cov && cov->covQual()>=2 ) iScan = cov->floatParsFinal().index(scanVar);
+	double varScan = iScan>=0 ? cov->covarianceMatrix()(iScan,iScan) : 0.;
+
+	TIterator* it = w->set(parsName)->createIterator();
+	while ( RooRealVar* p = (RooRealVar*)it->Next() ){
+		if ( TString(p->GetName())==scanVar ) continue;
+		_pars.push_back(p);
+		_isAngle.push_back(isAngle(p));
+		double s = 0.;
+		if ( varScan>0. ){
+			int i = cov->floatParsFinal().index(p->GetName());
+			if ( i>=0 ) s = cov->covarianceMatrix()(i,iScan)/varScan;
+		}
+		_slopes.push_back(s);
+	}
+	delete it;
+}
+
+ScanPredictor::~ScanPredictor()
+{}
+
+///
+/// Forget all recorded points, e.g. when the scan restarts
+/// from its start parameters.
+///
+void ScanPredictor::reset()
+{
+	_x.clear();
+	_points.clear();
+}
+
+///
+/// Record the current parameter values, usually right after
+/// a scan point was fitted. Only the last few points are kept.
+///
+/// \param scanvalue - coordinate of the point along the scan, usually
+///                    the value of the scan parameter
+///
+void ScanPredictor::record(double scanvalue)
+{
+	vector<double> values(_pars.size());
+	for ( unsigned int i=0; i<_pars.size(); i++ ){
+		values[i] = _pars[i]->getVal();
+		// unwrap angles relative to the previous point
+		if ( _isAngle[i] && !_points.empty() ){
+			double prev = _points.back()[i];
+			values[i] += 2.*TMath::Pi()*TMath::Nint((prev-values[i])/(2.*TMath::Pi()));
+		}
+	}
+	if ( _points.size()==_nPoints ){
+		_points.erase(_points.begin());
+		_x.erase(_x.begin());
+	}
+	_points.push_back(values);
+	_x.push_back(scanvalue);
+}
+
+///
+/// Set the floating parameters to their prediction at a new
+/// value of the scan parameter. The scan parameter itself
+/// is left untouched.
+///
+/// \param scanvalue - the new value of the scan parameter
+/// \return false if nothing was recorded yet, then the parameters are unchanged
+///
+bool ScanPredictor::predict(double scanvalue)
+{
+	if ( _points.empty() ) return false;
+	profileCount("predictions");
+	int n = _points.size();
+	for ( unsigned int i=0; i<_pars.size(); i++ ){
+		const double p2 = _points[n-1][i];
+		const double x2 = _x[n-1];
+		if ( n==1 ){
+			set(i, p2 + _slopes[i]*(scanvalue-x2));
+			continue;
+		}
+		const double p1 = _points[n-2][i];
+		const double x1 = _x[n-2];
+		if ( x1==x2 ){
+			set(i, p2);
+			continue;
+		}
+		double linear = p2 + (p2-p1)/(x2-x1)*(scanvalue-x2);
+		if ( n==2 ){
+			set(i, linear);
+			continue;
+		}
+		const double p0 = _points[n-3][i];
+		const double x0 = _x[n-3];
+		if ( x0==x1 || x0==x2 ){
+			set(i, linear);
+			continue;
+		}
+		// Lagrange interpolation through the last three points
+		double quadratic = p0*(scanvalue-x1)*(scanvalue-x2)/((x0-x1)*(x0-x2))
+			+ p1*(scanvalue-x0)*(scanvalue-x2)/((x1-x0)*(x1-x2))
+			+ p2*(scanvalue-x0)*(scanvalue-x1)/((x2-x0)*(x2-x1));
+		// don't trust the curvature if it dominates the step, e.g. at a kink
+		if ( fabs(quadratic-linear) > fabs(linear-p2) ) set(i, linear);
+		else set(i, quadratic);
+	}
+	return true;
+}
+
+///
+/// Move the floating parameters along the covariance slope, from
+/// their current values at scan parameter value 'from' to the
+/// conditional expectation at 'to'. This is the one-point prediction
+/// for a point that was not recorded, e.g. a fit with the scan
+/// parameter floating.
+///
+void ScanPredictor::shift(double from, double to)
+{
+	for ( unsigned int i=0; i<_pars.size(); i++ ){
+		if ( _slopes[i]==0. ) continue;
+		set(i, _pars[i]->getVal() + _slopes[i]*(to-from));
+	}
+}
+
+///
+/// Set a parameter to a predicted value, if it is floating.
+/// Angles are wrapped into their range, other parameters
+/// are clipped to it.
+///
+void ScanPredictor::set(int i, double value)
+{
+	RooRealVar* p = _pars[i];
+	if ( p->isConstant() ) return;
+	if ( _isAngle[i] && (value<p->getMin() || value>p->getMax()) ){
+		value = p->getMin() + bringBackAngle(value-p->getMin());
+	}
+	if ( value<p->getMin() ) value = p->getMin();
+	if ( value>p->getMax() ) value = p->getMax();
+	p->setVal(value);
+}
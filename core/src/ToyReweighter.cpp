@@ -0,0 +1,97 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "ToyReweighter.h"
+
+///
+/// \param minEssFraction - reweighted toys are accepted as long as their
+///                         effective sample size is at least this fraction
+///                         of the number of toys, in (0,1].
+///
+ToyReweighter::ToyReweighter(float minEssFraction)
+{
+	if ( !(minEssFraction>0. && minEssFraction<=1.) ){
+		cout << "ToyReweighter::ToyReweighter() : ERROR : minimum ESS fraction has to be in (0,1]: " << minEssFraction << endl;
+		exit(1);
+	}
+	this->minEssFraction = minEssFraction;
+	ess = 0.;
+}
+
+ToyReweighter::~ToyReweighter()
+{}
+
+///
+/// Forget the source toys.
+///
+void ToyReweighter::clear()
+{
+	logDensitySource.clear();
+	weights.clear();
+	ess = 0.;
+}
+
+///
+/// Make a new toy ensemble the source. All weights are 1.
+///
+/// \param logDensity - per toy, the log density at the point the toys
+///                     were generated at
+///
+void ToyReweighter::setSource(const vector<double>& logDensity)
+{
+	logDensitySource = logDensity;
+	weights.assign(logDensity.size(), 1.);
+	ess = logDensity.size();
+}
+
+///
+/// Compute the weights of the source toys at a new point.
+/// Toys whose density is not finite at either point get weight 0.
+///
+/// \param logDensity - per toy, the log density at the new point
+/// \return true if the effective sample size is large enough to use
+///         the reweighted toys
+///
+bool ToyReweighter::reweight(const vector<double>& logDensity)
+{
+	if ( logDensity.size()!=logDensitySource.size() ){
+		cout << "ToyReweighter::reweight() : ERROR : got " << logDensity.size()
+			<< " log densities for " << logDensitySource.size() << " toys." << endl;
+		exit(1);
+	}
+	int n = logDensity.size();
+	if ( n==0 ) return false;
+
+	// subtract the largest log ratio before exponentiating, the
+	// normalization removes it again
+	vector<double> logRatio(n, 0.);
+	vector<bool> finite(n, false);
+	double maxLogRatio = 0.;
+	bool anyFinite = false;
+	for ( int j=0; j<n; j++ ){
+		logRatio[j] = logDensity[j]-logDensitySource[j];
+		finite[j] = TMath::Finite(logRatio[j]);
+		if ( !finite[j] ) continue;
+		if ( !anyFinite || logRatio[j]>maxLogRatio ) maxLogRatio = logRatio[j];
+		anyFinite = true;
+	}
+
+	double sumW = 0.;
+	double sumW2 = 0.;
+	vector<double> w(n, 0.);
+	for ( int j=0; j<n; j++ ){
+		if ( finite[j] ) w[j] = exp(logRatio[j]-maxLogRatio);
+		sumW += w[j];
+		sumW2 += w[j]*w[j];
+	}
+	if ( sumW==0. ){
+		weights.assign(n, 0.);
+		ess = 0.;
+		return false;
+	}
+	for ( int j=0; j<n; j++ ) weights[j] = w[j]*n/sumW;
+	ess = sumW*sumW/sumW2;
+	return ess >= minEssFraction*n;
+}
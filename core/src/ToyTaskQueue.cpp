@@ -0,0 +1,112 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "ToyTaskQueue.h"
+
+#include <cstdlib>
+#include <sys/mman.h>
+
+///
+/// \param nPoints - number of scan points
+/// \param nToys - toys per scan point
+/// \param blockSize - toys per task, the last block of a point may be smaller
+///
+ToyTaskQueue::ToyTaskQueue(int nPoints, int nToys, int blockSize)
+{
+	if ( blockSize<1 ){
+		cout << "ToyTaskQueue::ToyTaskQueue() : ERROR : block size has to be at least 1: " << blockSize << endl;
+		exit(1);
+	}
+	this->nPoints = nPoints;
+	this->nToys = nToys;
+	this->blockSize = blockSize;
+	nBlocks = (nToys+blockSize-1)/blockSize;
+	toysDoneHere = 0;
+	toysSeenHere = 0;
+	fitsDoneHere = 0;
+	fitsFailedHere = 0;
+	fitsSeenHere = 0;
+	fitsFailedSeenHere = 0;
+	void* mem = mmap(0, sizeof(Shared), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+	if ( mem==MAP_FAILED ){
+		cout << "ToyTaskQueue::ToyTaskQueue() : ERROR : could not allocate shared memory." << endl;
+		exit(1);
+	}
+	shared = (Shared*)mem;
+	shared->nextTask = 0;
+	shared->toysDone = 0;
+	shared->fitsDone = 0;
+	shared->fitsFailed = 0;
+}
+
+ToyTaskQueue::~ToyTaskQueue()
+{
+	munmap(shared, sizeof(Shared));
+}
+
+///
+/// Take the next task.
+///
+/// \param point - set to the index of the scan point
+/// \param nToys - set to the number of toys to run at that point
+/// \return false if there are no tasks left
+///
+bool ToyTaskQueue::next(int& point, int& nToys)
+{
+	int task = __sync_fetch_and_add(&shared->nextTask, 1);
+	if ( task>=getNTasks() ) return false;
+	point = task/nBlocks;
+	int block = task%nBlocks;
+	nToys = block<nBlocks-1 ? blockSize : this->nToys-block*blockSize;
+	return true;
+}
+
+///
+/// Report the toys and fits of a finished task. Tasks at unphysical
+/// scan points are reported as well, with no fits, so that the
+/// progress of all workers still adds up to all toys.
+///
+/// \param nToys - toys of the task
+/// \param nFits - fits done for the task
+/// \param nFitsFailed - of those, fits with a status other than 0
+///
+void ToyTaskQueue::done(int nToys, int nFits, int nFitsFailed)
+{
+	toysDoneHere += nToys;
+	fitsDoneHere += nFits;
+	fitsFailedHere += nFitsFailed;
+	__sync_fetch_and_add(&shared->fitsDone, nFits);
+	__sync_fetch_and_add(&shared->fitsFailed, nFitsFailed);
+	__sync_fetch_and_add(&shared->toysDone, nToys);
+}
+
+///
+/// The number of toys other workers finished since the last call,
+/// to show the progress of all workers in one progress bar.
+///
+int ToyTaskQueue::getNewToysOfOtherWorkers()
+{
+	int others = __sync_fetch_and_add(&shared->toysDone, 0)-toysDoneHere;
+	int n = others-toysSeenHere;
+	toysSeenHere = others;
+	return n;
+}
+
+///
+/// The number of fits other workers did since the last call,
+/// to report the fits of all workers in one heartbeat.
+///
+/// \param nFits - set to the number of new fits
+/// \param nFitsFailed - set to the number of new failed fits
+///
+void ToyTaskQueue::getNewFitsOfOtherWorkers(int& nFits, int& nFitsFailed)
+{
+	int others = __sync_fetch_and_add(&shared->fitsDone, 0)-fitsDoneHere;
+	int othersFailed = __sync_fetch_and_add(&shared->fitsFailed, 0)-fitsFailedHere;
+	nFits = others-fitsSeenHere;
+	nFitsFailed = othersFailed-fitsFailedSeenHere;
+	fitsSeenHere = others;
+	fitsFailedSeenHere = othersFailed;
+}
@@ -1,4 +1,5 @@
 #include "ToyTree.h"
+#include "Profiler.h"
 
 ToyTree::ToyTree(Combiner *c, TChain* t)
 {
@@ -63,6 +64,7 @@ void ToyTree::initMembers(TChain* t){
 	nBergerBoos         = 0.;
 	BergerBoos_id       = 0.;
 	genericProbPValue   = 0.;
+	weight              = 1.;
 	covQualFree         = -2.;
 	covQualScan         = -2.;
 	covQualScanData     = -2.;
@@ -102,6 +104,7 @@ void ToyTree::setCombiner(Combiner* c)
 ///
 void ToyTree::fill()
 {
+	ProfileTimer pt("ToyTree::fill");
 	if ( t ) t->Fill();
 }
 
@@ -110,28 +113,62 @@ void ToyTree::fill()
 ///
 void ToyTree::writeToFile(TString fName)
 {
+	ProfileTimer pt("ToyTree::writeToFile");
 	assert(t);
 	if ( arg->debug ) cout << "ToyTree::writeToFile() : ";
 	cout << "saving toys to: " << fName << endl;
-	TFile *f = new TFile(fName, "recreate");
+	TFile *f = t->GetCurrentFile();
+	if ( f && fName==f->GetName() ){
+		// The tree was set up in this file by init(fName), most entries
+		// are on disk already. Closing the file also deletes the tree.
+		f->cd();
+		t->Write(0, TObject::kOverwrite);
+		f->Close();
+		delete f;
+		t = 0;
+		return;
+	}
+	f = new TFile(fName, "recreate");
+	if ( arg->toycompression>=0 ) f->SetCompressionSettings(arg->toycompression);
 	t->Write();
 	f->Close();
 }
 
 void ToyTree::writeToFile()
 {
+	ProfileTimer pt("ToyTree::writeToFile");
 	assert(t);
 	if ( arg->debug ){
 		cout << "ToyTree::writeToFile() : ";
 		cout << "saving toys to ... " << endl;
 	}
 	t->GetCurrentFile()->cd();
-	t->Write();
+	t->Write(0, TObject::kOverwrite);
+}
+
+///
+/// Initialize a new TTree inside a newly created output file.
+/// Unlike a tree held in memory until writeToFile(), this one gets
+/// flushed to the file while it is filled (see --toyflush), which
+/// keeps the memory bounded in large productions. Call
+/// writeToFile(fName) with the same name at the end.
+///
+/// \param fName - the output file, gets recreated
+///
+void ToyTree::init(TString fName)
+{
+	TDirectory *dir = gDirectory;
+	TFile *f = new TFile(fName, "recreate");
+	if ( arg->toycompression>=0 ) f->SetCompressionSettings(arg->toycompression);
+	init();
+	dir->cd(); // the tree stays in f, everything else shouldn't end up there
 }
 
 ///
 /// Initialize a new TTree, set up all its leaves, connect
-/// them to the proxy variables.
+/// them to the proxy variables. The tree is created in the current
+/// directory. Which branches are booked besides the core ones is
+/// controlled by --toycolumns (core, poi, full).
 ///
 void ToyTree::init()
 {
@@ -161,11 +198,14 @@ void ToyTree::init()
 	t->Branch("statusFree",          &statusFree,          "statusFree/F");
 	t->Branch("statusScan",          &statusScan,          "statusScan/F");
 	t->Branch("statusScanData",      &statusScanData,      "statusScanData/F");
-	if ( !arg->lightfiles )
+	t->Branch("weight",              &weight,              "weight/F");
+	if ( arg->toycolumns!="core" )
 	{
+		// the "poi" profile only keeps the scan variables
 		TIterator* it = w->set(parsName)->createIterator();
 		while ( RooRealVar* p = (RooRealVar*)it->Next() )
 		{
+			if ( arg->toycolumns=="poi" && !isIn<TString>(arg->var, p->GetName()) ) continue;
 			parametersScan.insert(pair<string,float>(p->GetName(),p->getVal()));
 			t->Branch(TString(p->GetName())+"_scan", &parametersScan[p->GetName()], TString(p->GetName())+"_scan/F");
 			parametersFree.insert(pair<string,float>(p->GetName(),p->getVal()));
@@ -173,27 +213,33 @@ void ToyTree::init()
 			parametersPll.insert(pair<string,float>(p->GetName(),p->getVal()));
 			t->Branch(TString(p->GetName())+"_start", &parametersPll[p->GetName()], TString(p->GetName())+"_start/F");
 		}
+		delete it;
+	}
+	if ( arg->toycolumns=="full" )
+	{
+		TIterator* it = 0;
 		// observables
 		if(this->storeObs){
-			delete it; it = w->set(obsName)->createIterator();
+			it = w->set(obsName)->createIterator();
 			while ( RooRealVar* p = (RooRealVar*)it->Next() )
 			{
 				observables.insert(pair<string,float>(p->GetName(),p->getVal()));
 				t->Branch(TString(p->GetName()), &observables[p->GetName()], TString(p->GetName())+"/F");
 			}
+			delete it;
 		}
 		// theory
 		if(this->storeTh){
-			delete it; it = w->set(thName)->createIterator();
+			it = w->set(thName)->createIterator();
 			while ( RooRealVar* p = (RooRealVar*)it->Next() )
 			{
 				theory.insert(pair<string,float>(p->GetName(),p->getVal()));
 				t->Branch(TString(p->GetName()), &theory[p->GetName()], TString(p->GetName())+"/F");
 			}
+			delete it;
 		}
 		// global observables
 	    if(this->storeGlob){
-	      delete it;
 	      if(w->set(globName)==NULL){
 	      	cerr<<"Unable to store parameters of global constraints because no set called "+globName
 	      		<<" is defined in the workspace. "<<endl;
@@ -206,9 +252,20 @@ void ToyTree::init()
 	        constraintMeans.insert(pair<TString,float>(p->GetName(),p->getVal()));
 	        t->Branch(TString(p->GetName()), &constraintMeans[p->GetName()], TString(p->GetName())+"/F");
 	      }
+	      delete it;
 	    }
-	    delete it;
 	}
+
+	// I/O tuning: compression per branch, so that it also applies to
+	// trees that are only written to a file at the end; initial basket
+	// size; flush interval, after which ROOT also optimizes the baskets
+	TObjArray* branches = t->GetListOfBranches();
+	for ( int i=0; i<branches->GetEntries(); i++ ){
+		TBranch* b = (TBranch*)branches->At(i);
+		if ( arg->toycompression>=0 ) b->SetCompressionSettings(arg->toycompression);
+		b->SetBasketSize(arg->toybasket);
+	}
+	t->SetAutoFlush(arg->toyflush);
 }
 
 ///
@@ -247,6 +304,7 @@ void ToyTree::open()
 	if(branches->FindObject("statusFreePDF"      )) t->SetBranchAddress("statusFreePDF",      &statusFreePDF);
 	if(branches->FindObject("statusScanData"     )) t->SetBranchAddress("statusScanData",     &statusScanData);
 	if(branches->FindObject("statusScanPDF"      )) t->SetBranchAddress("statusScanPDF",      &statusScanPDF);
+	if(branches->FindObject("weight"             )) t->SetBranchAddress("weight",             &weight);
 }
 
 ///
@@ -281,6 +339,7 @@ void ToyTree::activateCoreBranchesOnly()
 	if(branches->FindObject("statusFreePDF"))         t->SetBranchStatus("statusFreePDF",      1);
 	if(branches->FindObject("statusScanData"))        t->SetBranchStatus("statusScanData",     1);
 	if(branches->FindObject("statusScanPDF"))         t->SetBranchStatus("statusScanPDF",      1);
+	if(branches->FindObject("weight"))                t->SetBranchStatus("weight",             1);
 }
 
 ///
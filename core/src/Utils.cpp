@@ -6,20 +6,54 @@
  **/
 
 #include "Utils.h"
+#include "GaussianChi2.h"
+#include "Profiler.h"
 
-int Utils::countFitBringBackAngle;      ///< counts how many times an angle needed to be brought back
+#include <algorithm>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TChain.h"
+#include "TSystem.h"
+
+int Utils::countFitBringBackAngle;      ///< counts how many times an angle needed to be brought back by a refit
+int Utils::countFitWrapAngle;           ///< counts how many times angles were brought back without a refit
 int Utils::countAllFitBringBackAngle;   ///< counts how many times fitBringBackAngle() was called
+bool Utils::fitWithGradient = false;    ///< let fitToMin() minimize Gaussian combinations with analytic gradients
+bool Utils::fitWithCompiledTheory = false; ///< let GaussianChi2 evaluate the theory relations with compiled kernels
 
 ///
 /// Fit PDF to minimum.
+/// If fitWithGradient is set and the PDF is a product of
+/// RooMultiVarGaussians, Minuit2 minimizes it using the analytic
+/// gradient of the chi2, see GaussianChi2. With fitWithCompiledTheory,
+/// its theory relations are evaluated by compiled kernels.
 /// \param pdf The PDF.
 /// \param thorough Activate Hesse and Minos
 /// \param printLevel -1 = no output, 1 verbose output
 ///
 RooFitResult* Utils::fitToMin(RooAbsPdf *pdf, bool thorough, int printLevel)
 {
+	ProfileTimer pt("Utils::fitToMin");
 	RooMsgService::instance().setGlobalKillBelow(ERROR);
 
+	if ( fitWithGradient ){
+		GaussianChi2 chi2(pdf, fitWithCompiledTheory);
+		RooFitResult *r = chi2.isValid() ? chi2.minimize(thorough, printLevel) : 0;
+		if ( r ){
+			RooMsgService::instance().setGlobalKillBelow(INFO);
+			return r;
+		}
+		static bool first = true;
+		if ( first ){
+			cout << "Utils::fitToMin() : WARNING : can't fit " << pdf->GetName() << " with analytic gradients"
+				<< (chi2.isValid() ? " (Minuit2 not available)" : " (not a product of RooMultiVarGaussians)")
+				<< ". Using RooMinuit." << endl;
+			first = false;
+		}
+	}
+
 	RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*pdf));
 	bool quiet = printLevel<0;
 	RooMinuit m(ll);
@@ -32,7 +66,6 @@ RooFitResult* Utils::fitToMin(RooAbsPdf *pdf, bool thorough, int printLevel)
 	m.setErrorLevel(1.0);
 	m.setStrategy(2);
 	m.setProfile(0); // 1 enables migrad timer
-	unsigned long long start = rdtsc();
 	int status = m.migrad();
 	// m.simplex();
 	// m.migrad();
@@ -53,8 +86,6 @@ RooFitResult* Utils::fitToMin(RooAbsPdf *pdf, bool thorough, int printLevel)
 		// IMPROVE doesn't really improve much
 		// //m.improve();
 	}
-	unsigned long long stop = rdtsc();
-	if (!quiet) std::printf("Fit took %llu clock cycles.\n", stop - start);
 	RooFitResult *r = m.save();
 	// if (!quiet) r->Print("v");
 	RooMsgService::instance().setGlobalKillBelow(INFO);
@@ -92,32 +123,59 @@ double Utils::angularDifference(double angle1, double angle2)
 ///
 /// Fit a pdf to the minimum, but keep angular parameters in a range of
 /// [0,2pi]. If after an initial fit, a parameter has walked outside this
-/// interval, add multiples of 2pi to bring it back. Then, refit.
+/// interval, add multiples of 2pi to bring it back.
 /// All variables that have unit 'rad' are taken to be angles.
 ///
+/// Usually the likelihood is periodic in the angles, so the wrapped point
+/// is the same minimum. This is checked by evaluating the likelihood
+/// before and after wrapping; if it agrees, the angles are also wrapped
+/// in the fit result, and no second fit is needed. Only if it doesn't
+/// (e.g. an angle is measured directly), the fit is repeated from the
+/// wrapped point.
+///
 RooFitResult* Utils::fitToMinBringBackAngles(RooAbsPdf *pdf, bool thorough, int printLevel)
 {
+	ProfileTimer pt("Utils::fitToMinBringBackAngles");
 	countAllFitBringBackAngle++;
 	RooFitResult* r = fitToMin(pdf, thorough, printLevel);
-	bool refit = false;
+
+	// collect the angles that left [0,2pi]
+	vector<RooRealVar*> outside;
 	TIterator* it = r->floatParsFinal().createIterator();
 	while ( RooRealVar* p = (RooRealVar*)it->Next() ){
 		if ( ! isAngle(p) ) continue;
-		if ( p->getVal()<0.0 || p->getVal()>2.*TMath::Pi() ){
-			RooArgSet *pdfPars = pdf->getParameters(RooArgSet());
-			RooRealVar *pdfPar = (RooRealVar*)pdfPars->find(p->GetName());
-			pdfPar->setVal(bringBackAngle(p->getVal()));
-			refit = true;
-			delete pdfPars;
-		}
-	}
-	if ( refit ){
-		countFitBringBackAngle++;
-		delete r;
-		r = fitToMin(pdf, thorough, printLevel);
+		if ( p->getVal()<0.0 || p->getVal()>2.*TMath::Pi() ) outside.push_back(p);
 	}
 	delete it;
-	return r;
+	if ( outside.empty() ) return r;
+
+	// wrap them in the pdf, which RooMinuit left at the minimum
+	RooMsgService::instance().setGlobalKillBelow(ERROR);
+	RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*pdf));
+	double llBefore = ll.getVal();
+	RooArgSet *pdfPars = pdf->getParameters(RooArgSet());
+	for ( unsigned int i=0; i<outside.size(); i++ ){
+		RooRealVar *pdfPar = (RooRealVar*)pdfPars->find(outside[i]->GetName());
+		pdfPar->setVal(bringBackAngle(outside[i]->getVal()));
+	}
+	delete pdfPars;
+	double llAfter = ll.getVal();
+	RooMsgService::instance().setGlobalKillBelow(INFO);
+
+	if ( fabs(llAfter-llBefore) < 1e-6*max(1.,fabs(llBefore)) ){
+		// same minimum, only the fit result needs to follow
+		countFitWrapAngle++;
+		profileCount("Utils::fitToMinBringBackAngles wraps");
+		for ( unsigned int i=0; i<outside.size(); i++ ){
+			outside[i]->setVal(bringBackAngle(outside[i]->getVal()));
+		}
+		return r;
+	}
+
+	countFitBringBackAngle++;
+	profileCount("Utils::fitToMinBringBackAngles refits");
+	delete r;
+	return fitToMin(pdf, thorough, printLevel);
 }
 
 ///
@@ -137,6 +195,7 @@ RooFitResult* Utils::fitToMinBringBackAngles(RooAbsPdf *pdf, bool thorough, int
 ///
 RooFitResult* Utils::fitToMinForce(RooWorkspace *w, TString name, TString forceVariables)
 {
+	ProfileTimer pt("Utils::fitToMinForce");
 	bool debug = true;
 
 	TString parsName = "par_"+name;
@@ -196,11 +255,10 @@ RooFitResult* Utils::fitToMinForce(RooWorkspace *w, TString name, TString forceV
 
 	// We define a binary mask where each bit corresponds
 	// to parameter at max or at min.
-	for ( int i=0; i<pow(2.,nPars); i++ )
+	int nStarts = pow(2.,nPars);
+	auto setStartParameters = [&](int i)
 	{
-		if ( debug ) cout << "Utils::fitToMinForce() : fit " << i << "        \r" << flush;
 		setParameters(w, parsName, startPars->get(0));
-
 		for ( int ip=0; ip<nPars; ip++ )
 		{
 			RooRealVar *p = (RooRealVar*)varyPars->at(ip);
@@ -211,10 +269,28 @@ RooFitResult* Utils::fitToMinForce(RooWorkspace *w, TString name, TString forceV
 			if ( i/(int)pow(2.,ip) % 2==1 ) { p->setVal(p->getMax()); }
 			p->setRange(oldMin, oldMax);
 		}
+	};
+
+	// check if start parameters are sensible, all at once
+	vector<double> startParChi2(1);
+	if ( nPars>0 ){
+		vector<vector<double> > startValues(nPars, vector<double>(nStarts));
+		for ( int i=0; i<nStarts; i++ ){
+			setStartParameters(i);
+			for ( int ip=0; ip<nPars; ip++ ) startValues[ip][i] = ((RooRealVar*)varyPars->at(ip))->getVal();
+		}
+		setParameters(w, parsName, startPars->get(0));
+		startParChi2 = getChi2(w->pdf(pdfName), *varyPars, startValues);
+	}
+	else startParChi2[0] = getChi2(w->pdf(pdfName));
+
+	for ( int i=0; i<nStarts; i++ )
+	{
+		if ( debug ) cout << "Utils::fitToMinForce() : fit " << i << "        \r" << flush;
+		setStartParameters(i);
 
-		// check if start parameters are sensible, skip if they're not
-		double startParChi2 = getChi2(w->pdf(pdfName));
-		if ( startParChi2>2000 ){
+		// skip start parameters that aren't sensible
+		if ( startParChi2[i]>2000 ){
 			nErrors += 1;
 			continue;
 		}
@@ -269,20 +345,24 @@ RooFitResult* Utils::fitToMinForce(RooWorkspace *w, TString name, TString forceV
 ///
 RooFitResult* Utils::fitToMinImprove(RooWorkspace *w, TString name)
 {
+	ProfileTimer pt("Utils::fitToMinImprove");
 	TString parsName = "par_"+name;
 	TString obsName  = "obs_"+name;
 	TString pdfName  = "pdf_"+name;
 	int printlevel = -1;
 	RooMsgService::instance().setGlobalKillBelow(ERROR);
 
+	// The nominal fcn and its minimizer are used for both step 1 and step 3.
+	// RooMinuit picks up the current parameter values at every migrad() call.
+	RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*w->pdf(pdfName)));
+	RooMinuit m(ll);
+	m.setPrintLevel(-2);
+	m.setNoWarn();
+
 	// step 1: find a minimum to start with
 	RooFitResult *r1 = 0;
 	{
-		RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*w->pdf(pdfName)));
 		// RooFitResult* r1 = fitToMin(&ll, printlevel);
-		RooMinuit m(ll);
-		m.setPrintLevel(-2);
-		m.setNoWarn();
 		m.setErrorLevel(4.0); ///< define 2 sigma errors. This will make the hesse PDF 2 sigma wide!
 		int status = m.migrad();
 		r1 = m.save();
@@ -313,32 +393,29 @@ RooFitResult* Utils::fitToMinImprove(RooWorkspace *w, TString name)
 	}
 
 	// step 2: build and fit the improved fcn
-	RooFitResult *r2 = 0;
 	{
-		// create a Hesse PDF, import both PDFs into a new workspace,
-		// so that their parameters are linked
+		// The Hesse PDF is a Gaussian in the floating parameters of the
+		// workspace itself, centered at the step 1 minimum with its
+		// covariance. Unnormalized, it adds a penalty of at most 16
+		// evaluated directly on the current parameter values, so no
+		// copy of the PDF is needed. The fit leaves the workspace
+		// parameters at the improved minimum.
 		RooAbsPdf* hessePdf = r1->createHessePdf(*w->set(parsName));
-		if ( !hessePdf ) return r1;
-		// RooWorkspace* wImprove = (RooWorkspace*)w->Clone();
-		RooWorkspace* wImprove = new RooWorkspace();
-		wImprove->import(*w->pdf(pdfName));
-		wImprove->import(*hessePdf);
-		hessePdf = wImprove->pdf(hessePdf->GetName());
-		RooAbsPdf* fullPdf = wImprove->pdf(pdfName);
-
-		RooFormulaVar ll("ll", "ll", "-2*log(@0) +16*@1", RooArgSet(*fullPdf, *hessePdf));
-		// RooFitResult *r2 = fitToMin(&ll, printlevel);
-		RooMinuit m(ll);
-		m.setPrintLevel(-2);
-		m.setNoWarn();
-		m.setErrorLevel(1.0);
-		int status = m.migrad();
-		r2 = m.save();
+		if ( !hessePdf ){
+			RooMsgService::instance().setGlobalKillBelow(INFO);
+			return r1;
+		}
+		RooFormulaVar llImprove("llImprove", "llImprove", "-2*log(@0) +16*@1", RooArgSet(*w->pdf(pdfName), *hessePdf));
+		RooMinuit mImprove(llImprove);
+		mImprove.setPrintLevel(-2);
+		mImprove.setNoWarn();
+		mImprove.setErrorLevel(1.0);
+		int status = mImprove.migrad();
 
 		// if ( 102<RadToDeg(w->var("g")->getVal())&&RadToDeg(w->var("g")->getVal())<103 )
 		// {
-		//   cout << "step 3" << endl;
-		//   r2->Print("v");
+		//   cout << "step 2" << endl;
+		//   mImprove.save()->Print("v");
 		//
 		//   gStyle->SetPalette(1);
 		//   float xmin = 0.;
@@ -351,27 +428,22 @@ RooFitResult* Utils::fitToMinImprove(RooWorkspace *w, TString name)
 		//   {
 		//     float x = xmin + (xmax-xmin)*(double)ix/(double)100;
 		//     float y = ymin + (ymax-ymin)*(double)iy/(double)100;
-		//     wImprove->var("d_dk")->setVal(x);
-		//     wImprove->var("r_dk")->setVal(y);
-		//     histo->SetBinContent(ix+1,iy+1,ll.getVal());
+		//     w->var("d_dk")->setVal(x);
+		//     w->var("r_dk")->setVal(y);
+		//     histo->SetBinContent(ix+1,iy+1,llImprove.getVal());
 		//   }
 		//   newNoWarnTCanvas("c7");
 		//   histo->GetZaxis()->SetRangeUser(0,20);
 		//   histo->Draw("colz");
 		//   // setParameters(wImprove, parsName, r1);
 		// }
-		delete wImprove;
+		delete hessePdf;
 	}
 
 	// step 3: use the fit result of the improved fit as
 	// start parameters for the nominal fcn
 	RooFitResult* r3;
 	{
-		setParameters(w, parsName, r2);
-		RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*w->pdf(pdfName)));
-		RooMinuit m(ll);
-		m.setPrintLevel(-2);
-		m.setNoWarn();
 		m.setErrorLevel(1.0);
 		int status = m.migrad();
 		r3 = m.save();
@@ -399,8 +471,8 @@ RooFitResult* Utils::fitToMinImprove(RooWorkspace *w, TString name)
 
 	RooMsgService::instance().setGlobalKillBelow(INFO);
 
-	// set to best parameters
-	setParameters(w, parsName, r);
+	// set to best parameters, the step 3 fit left them at r3 already
+	if ( r==r1 ) setParameters(w, parsName, r);
 	return r;
 }
 
@@ -411,6 +483,62 @@ double Utils::getChi2(RooAbsPdf *pdf)
 	return ll.getVal();
 }
 
+///
+/// The chi2 = -2ln(pdf) at many parameter points, given as one array of
+/// values per parameter. With fitWithGradient, the chi2 of a PDF that is
+/// a product of Gaussians is computed for all points in one call to
+/// GaussianChi2::evaluate(). Otherwise the points are evaluated one by
+/// one. The parameters are left at their values.
+///
+/// \param pdf - the PDF
+/// \param pars - the parameters to vary, the others stay at their values
+/// \param values - values[k][p] is the value of parameter k of pars at point p
+/// \return the chi2 at each point
+///
+vector<double> Utils::getChi2(RooAbsPdf *pdf, const RooArgList& pars, const vector<vector<double> >& values)
+{
+	if ( (int)values.size()!=pars.getSize() ){
+		cout << "Utils::getChi2() : ERROR : need values for " << pars.getSize() << " parameters, got " << values.size() << endl;
+		exit(1);
+	}
+	int nPoints = values.empty() ? 0 : values[0].size();
+	vector<double> chi2(nPoints);
+	if ( nPoints==0 ) return chi2;
+
+	if ( fitWithGradient ){
+		GaussianChi2 g(pdf, fitWithCompiledTheory);
+		const vector<RooRealVar*>& gPars = g.getParameters();
+		bool all = g.isValid();
+		for ( int i=0; i<pars.getSize() && all; i++ ){
+			all = find(gPars.begin(), gPars.end(), pars.at(i))!=gPars.end();
+		}
+		if ( all ){
+			vector<vector<double> > constant(gPars.size());
+			vector<const double*> x(gPars.size());
+			for ( unsigned int k=0; k<gPars.size(); k++ ){
+				int i = pars.index(gPars[k]);
+				if ( i>=0 ){
+					x[k] = &values[i][0];
+					continue;
+				}
+				constant[k].assign(nPoints, gPars[k]->getVal());
+				x[k] = &constant[k][0];
+			}
+			g.evaluate(nPoints, x.data(), &chi2[0]);
+			return chi2;
+		}
+	}
+
+	vector<double> saved(pars.getSize());
+	for ( int i=0; i<pars.getSize(); i++ ) saved[i] = ((RooAbsReal*)pars.at(i))->getVal();
+	for ( int p=0; p<nPoints; p++ ){
+		for ( int i=0; i<pars.getSize(); i++ ) ((RooRealVar*)pars.at(i))->setVal(values[i][p]);
+		chi2[p] = getChi2(pdf);
+	}
+	for ( int i=0; i<pars.getSize(); i++ ) ((RooRealVar*)pars.at(i))->setVal(saved[i]);
+	return chi2;
+}
+
 //
 // Randomize all parameters of a set defined in a given
 // workspace.
@@ -481,6 +609,7 @@ void Utils::randomizeParametersUniform(RooWorkspace* w, TString setname, RooSlim
 /// in the fit result
 ///
 void Utils::setParameters(RooWorkspace* w, RooFitResult* values){
+	ProfileTimer pt("Utils::setParameters");
 	RooArgList list = values->floatParsFinal();
 	list.add(values->constPars());
 	TIterator* it = list.createIterator();
@@ -503,6 +632,7 @@ void Utils::setParameters(RooWorkspace* w, RooFitResult* values){
 ///
 void Utils::setParameters(const RooAbsCollection* setMe, const RooAbsCollection* values)
 {
+	ProfileTimer pt("Utils::setParameters");
 	TIterator* it = setMe->createIterator();
 	while ( RooRealVar* p = (RooRealVar*)it->Next() ){
 		RooRealVar *var = (RooRealVar*)values->find(p->GetName());
@@ -517,6 +647,7 @@ void Utils::setParameters(const RooAbsCollection* setMe, const RooAbsCollection*
 ///
 void Utils::setParametersFloating(const RooAbsCollection* setMe, const RooAbsCollection* values)
 {
+	ProfileTimer pt("Utils::setParametersFloating");
 	TIterator* it = setMe->createIterator();
 	while ( RooRealVar* p = (RooRealVar*)it->Next() ){
 		if ( p->isConstant() ) continue;
@@ -756,15 +887,27 @@ TMatrixDSym* Utils::buildCovMatrix(TMatrixDSym &cor, vector<double> &err)
 /// Duplicate variables will only be contained once.
 ///
 void Utils::mergeNamedSets(RooWorkspace *w, TString mergedSet, TString set1, TString set2)
+{
+	vector<TString> sets;
+	sets.push_back(set1);
+	sets.push_back(set2);
+	mergeNamedSets(w, mergedSet, sets);
+}
+
+///
+/// Merge any number of named sets of variables inside a RooWorkspace
+/// in one go. Duplicate variables will only be contained once. The
+/// merged set is sorted by name.
+///
+void Utils::mergeNamedSets(RooWorkspace *w, TString mergedSet, const vector<TString>& sets)
 {
 	// 1. fill all variables into a vector
 	vector<string> varsAll;
-	TIterator* it = w->set(set1)->createIterator();
-	while ( RooRealVar* p = (RooRealVar*)it->Next() ) varsAll.push_back(p->GetName());
-	delete it;
-	it = w->set(set2)->createIterator();
-	while ( RooRealVar* p = (RooRealVar*)it->Next() ) varsAll.push_back(p->GetName());
-	delete it;
+	for ( unsigned int i=0; i<sets.size(); i++ ){
+		TIterator* it = w->set(sets[i])->createIterator();
+		while ( RooRealVar* p = (RooRealVar*)it->Next() ) varsAll.push_back(p->GetName());
+		delete it;
+	}
 
 	// 2. remove duplicates
 	sort(varsAll.begin(), varsAll.end());
@@ -1251,6 +1394,149 @@ void Utils::assertFileExists( TString strFilename ){
     }
 }
 
+///
+/// Start worker processes. Each worker is a fork of this process,
+/// with its own copy of all workspaces, so that fits can run in
+/// parallel (RooFit is not thread safe). The calling process is
+/// worker 0. Workers should save their results with workerFileName(),
+/// and leave with exitWorker(), worker 0 collects them after waitForWorkers().
+///
+/// \param nWorkers - total number of workers, including this process
+/// \param pids - filled with the process IDs of the started workers (in worker 0 only)
+/// \return the number of this worker, or -1 if a worker couldn't be started.
+///         Then the workers started before are stopped, and no worker is running.
+///
+int Utils::forkWorkers(int nWorkers, vector<pid_t>& pids)
+{
+	pids.clear();
+	cout.flush();
+	for ( int k=1; k<nWorkers; k++ ){
+		pid_t pid = fork();
+		if ( pid<0 ){
+			cout << "Utils::forkWorkers() : ERROR : could not start worker " << k << ". Stopping the workers already started." << endl;
+			for ( int i=0; i<pids.size(); i++ ){
+				kill(pids[i], SIGKILL);
+				waitpid(pids[i], 0, 0);
+			}
+			pids.clear();
+			return -1;
+		}
+		if ( pid==0 ){
+			pids.clear();
+			if ( Profiler::isEnabled() ) Profiler::instance().startWorker();
+			return k;
+		}
+		pids.push_back(pid);
+	}
+	return 0;
+}
+
+///
+/// Leave a worker started by forkWorkers(). Saves its profile
+/// for waitForWorkers(), and exits without running the exit
+/// handlers and destructors of the parent's objects.
+///
+/// \param iWorker - number of this worker, as returned by forkWorkers()
+///
+void Utils::exitWorker(int iWorker)
+{
+	if ( Profiler::isEnabled() ) Profiler::instance().writeWorkerTables(iWorker);
+	cout.flush();
+	_exit(0);
+}
+
+///
+/// Wait until all workers started by forkWorkers() are done,
+/// and add their profiles to that of this process.
+/// Warns about workers that failed.
+///
+void Utils::waitForWorkers(const vector<pid_t>& pids)
+{
+	for ( int k=0; k<pids.size(); k++ ){
+		int status = 0;
+		waitpid(pids[k], &status, 0);
+		if ( !WIFEXITED(status) || WEXITSTATUS(status)!=0 ){
+			cout << "Utils::waitForWorkers() : WARNING : worker " << k+1 << " failed. Its results are missing." << endl;
+			continue;
+		}
+		if ( Profiler::isEnabled() ) Profiler::instance().mergeWorkerTables(k+1);
+	}
+}
+
+///
+/// Seed the random generator of a worker started by forkWorkers().
+/// All workers start with the random generator state of the process
+/// that forked them, so without this they would generate the same
+/// toys. The seed is derived from a seed of the whole run, drawn
+/// before the fork, and the number of the worker, and is printed,
+/// so that the toys of a worker can be reproduced.
+///
+/// \param runSeed - seed of the run, the same in all workers
+/// \param iWorker - number of this worker, as returned by forkWorkers()
+/// \return the seed of this worker
+///
+UInt_t Utils::seedWorker(UInt_t runSeed, int iWorker)
+{
+	UInt_t seed = runSeed + 2654435769u*(UInt_t)iWorker; // spread the seeds of neighbouring workers
+	if ( seed==0 ) seed = 1; // 0 would ask for a random seed
+	RooRandom::randomGenerator()->SetSeed(seed);
+	cout << "Utils::seedWorker() : worker " << iWorker << " uses random seed " << seed
+		<< " (run seed " << runSeed << ")" << endl;
+	return seed;
+}
+
+///
+/// Name of the file a worker saves its part of fileName to.
+///
+TString Utils::workerFileName(TString fileName, int iWorker)
+{
+	TString workerFile = fileName;
+	workerFile.ReplaceAll(".root", Form("_worker%i.root", iWorker));
+	return workerFile;
+}
+
+///
+/// Merge the trees the workers saved to their workerFileName()s into
+/// a new tree in the current directory, ordered by the value of a
+/// branch, so that the result doesn't depend on the number of workers.
+/// Deletes the worker files.
+///
+/// \param treeName - name of the tree in the worker files
+/// \param fileName - the name the worker files were derived from
+/// \param nWorkers - number of workers
+/// \param sortBranch - name of a float branch to order the entries by
+/// \return the merged tree
+///
+TTree* Utils::mergeWorkerFiles(TString treeName, TString fileName, int nWorkers, TString sortBranch)
+{
+	TDirectory *outDir = gDirectory;
+	TTree *merged = 0;
+	{
+		TChain c(treeName);
+		for ( int k=0; k<nWorkers; k++ ){
+			if ( FileExists(workerFileName(fileName, k)) ) c.Add(workerFileName(fileName, k));
+		}
+		float key;
+		c.SetBranchAddress(sortBranch, &key);
+		vector<pair<float,Long64_t> > order;
+		for ( Long64_t i=0; i<c.GetEntries(); i++ ){
+			c.GetEntry(i);
+			order.push_back(make_pair(key, i));
+		}
+		sort(order.begin(), order.end());
+
+		outDir->cd();
+		merged = c.CloneTree(0);
+		for ( int i=0; i<order.size(); i++ ){
+			c.GetEntry(order[i].second);
+			merged->Fill();
+		}
+		merged->ResetBranchAddresses(); // they point into the chain
+	}
+	for ( int k=0; k<nWorkers; k++ ) gSystem->Unlink(workerFileName(fileName, k));
+	return merged;
+}
+
 std::vector<double> Utils::computeNormalQuantiles( std::vector<double> &values, int nsigma ) {
 
   //std::sort( values.begin(), values.end() );
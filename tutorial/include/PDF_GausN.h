@@ -0,0 +1,37 @@
+/**
+ * Gamma Combination
+ *
+ * Synthetic measurement of scalable size for the benchmarks:
+ * nObs Gaussian observables that depend on a set of nPars
+ * parameters shared between all instances.
+ *
+ **/
+
+#ifndef PDF_GausN_h
+#define PDF_GausN_h
+
+#include "PDF_Abs.h"
+#include "ParametersAbs.h"
+
+using namespace RooFit;
+using namespace std;
+
+class PDF_GausN : public PDF_Abs
+{
+	public:
+		PDF_GausN(int nObs, int nPars, int firstObs=0);
+		~PDF_GausN();
+		void          buildPdf();
+		void          initObservables();
+		virtual void  initParameters();
+		virtual void  initRelations();
+		void          setCorrelations(TString c);
+		void          setObservables(TString c);
+		void          setUncertainties(TString c);
+
+	private:
+		int           nPars;     ///< number of shared parameters bench_a0 ... bench_a<nPars-1>
+		int           firstObs;  ///< global index of the first observable, keeps names distinct between instances
+};
+
+#endif
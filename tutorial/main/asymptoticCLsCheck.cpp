@@ -0,0 +1,41 @@
+/**
+ * Gamma Combination
+ *
+ * Checks the asymptotic CLs formulae used by --asymptoticcls (see
+ * MethodDatasetsProbScan::computeAsymptoticCLs()). Built with the
+ * tutorial, and run by ctest:
+ *
+ *   make
+ *   ctest -R asymptoticCLsCheck
+ *
+ * Data at the median expectation, q_obs = q_A, has to give the median
+ * expected CLs, to 1e-9 relatively. Exits with 1 otherwise.
+ *
+ **/
+
+#include <stdlib.h>
+
+#include "MethodDatasetsProbScan.h"
+
+#include "TMath.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	int nFailed = 0;
+	for ( double qA = 0.5; qA < 20.; qA *= 2. ){
+		double obs = MethodDatasetsProbScan::asymptoticCLsObserved(qA, qA);
+		double exp = MethodDatasetsProbScan::asymptoticCLsExpected(qA, 0.5);
+		if ( fabs(obs-exp) <= 1e-9*TMath::Max(1., exp) ) continue;
+		cout << "asymptoticCLsCheck : FAILED : observed CLs " << Form("%.17g", obs)
+			<< " instead of the median expected CLs " << Form("%.17g", exp) << " at q_obs = q_A = " << qA << endl;
+		nFailed++;
+	}
+	if ( nFailed>0 ){
+		cout << "asymptoticCLsCheck : " << nFailed << " failures" << endl;
+		return 1;
+	}
+	cout << "asymptoticCLsCheck : OK" << endl;
+	return 0;
+}
@@ -0,0 +1,157 @@
+/**
+ * Gamma Combination
+ *
+ * Checks that the compiled theory relations (see CompiledTheory) give
+ * the same numbers as the RooFormulaVars they are compiled from, for
+ * the PDFs of the tutorial. Built with the tutorial, and run by ctest:
+ *
+ *   make
+ *   ctest -R compiledTheoryCheck
+ *
+ * For every PDF, at random points within the parameter ranges, the
+ * relations have to agree to 1e-12 relatively, and the chi2 of
+ * GaussianChi2 with and without compiled relations, and from
+ * GaussianChi2::evaluate(), to 1e-10. The single derivatives of
+ * GaussianChi2 have to agree with its gradient to 1e-12. Exits
+ * with 1 otherwise.
+ *
+ **/
+
+#include <stdlib.h>
+
+#include "CompiledTheory.h"
+#include "GaussianChi2.h"
+#include "PDF_Abs.h"
+#include "Utils.h"
+
+#include "TMath.h"
+#include "TRandom3.h"
+
+#include "PDF_Cartesian.h"
+#include "PDF_Circle.h"
+#include "PDF_Gaus.h"
+#include "PDF_Gaus2d.h"
+#include "PDF_GausN.h"
+#include "PDF_rb.h"
+
+using namespace std;
+
+///
+/// Set the parameters of a PDF to a random point within their ranges.
+///
+void randomizeParameters(PDF_Abs* pdf, TRandom3& rnd)
+{
+	RooArgList* pars = pdf->getParameters();
+	for ( int k=0; k<pars->getSize(); k++ ){
+		RooRealVar* p = (RooRealVar*)pars->at(k);
+		if ( p->isConstant() ) continue;
+		if ( p->hasMin() && p->hasMax() ) p->setVal(rnd.Uniform(p->getMin(), p->getMax()));
+		else p->setVal(rnd.Gaus(p->getVal(), 1.));
+	}
+}
+
+///
+/// \return true if a and b agree to tol, relatively
+///
+bool same(double a, double b, double tol)
+{
+	if ( !TMath::Finite(b) ) return !TMath::Finite(a);
+	return fabs(a-b)<=tol*TMath::Max(1., fabs(b));
+}
+
+///
+/// Check one PDF.
+/// \return the number of failures
+///
+int check(PDF_Abs* pdf, TRandom3& rnd)
+{
+	int nFailed = 0;
+	vector<RooAbsReal*> relations;
+	for ( int i=0; i<pdf->getTheory()->getSize(); i++ ) relations.push_back((RooAbsReal*)pdf->getTheory()->at(i));
+	Utils::fixParameters(pdf->getObservables()); // as MethodAbsScan::initScan() does
+	CompiledTheory compiled(relations);
+	if ( !compiled.isValid() ){
+		cout << "compiledTheoryCheck : FAILED : the relations of " << pdf->getName() << " weren't compiled" << endl;
+		return 1;
+	}
+	GaussianChi2 chi2Formula(pdf->getPdf());
+	GaussianChi2 chi2Compiled(pdf->getPdf(), true);
+	if ( !chi2Formula.isValid() || !chi2Compiled.isValid() ){
+		cout << "compiledTheoryCheck : FAILED : no GaussianChi2 for " << pdf->getName() << endl;
+		return 1;
+	}
+
+	int nPoints = 100;
+	int nDim = chi2Formula.NDim();
+	vector<vector<double> > columns(nDim, vector<double>(nPoints));
+	vector<double> chi2s(nPoints);
+	vector<double> out(relations.size());
+	for ( int p=0; p<nPoints; p++ ){
+		randomizeParameters(pdf, rnd);
+		compiled.evaluate(&out[0]);
+		for ( unsigned int i=0; i<relations.size(); i++ ){
+			if ( same(out[i], relations[i]->getVal(), 1e-12) ) continue;
+			cout << "compiledTheoryCheck : FAILED : " << relations[i]->GetName() << " = " << Form("%.17g", out[i])
+				<< " instead of " << Form("%.17g", relations[i]->getVal()) << endl;
+			nFailed++;
+		}
+		vector<double> x(nDim);
+		for ( int k=0; k<nDim; k++ ){
+			x[k] = chi2Formula.getParameters()[k]->getVal();
+			columns[k][p] = x[k];
+		}
+		chi2s[p] = chi2Formula(&x[0]);
+		double chi2 = chi2Compiled(&x[0]);
+		if ( !same(chi2, chi2s[p], 1e-10) ){
+			cout << "compiledTheoryCheck : FAILED : " << pdf->getName() << " : compiled chi2 = " << Form("%.17g", chi2)
+				<< " instead of " << Form("%.17g", chi2s[p]) << endl;
+			nFailed++;
+		}
+		vector<double> grad(nDim);
+		chi2Formula.Gradient(&x[0], &grad[0]);
+		for ( int k=0; k<nDim; k++ ){
+			double d = chi2Formula.Derivative(&x[0], k);
+			if ( same(d, grad[k], 1e-12) ) continue;
+			cout << "compiledTheoryCheck : FAILED : " << pdf->getName() << " : derivative " << k << " = " << Form("%.17g", d)
+				<< " instead of the gradient component " << Form("%.17g", grad[k]) << endl;
+			nFailed++;
+		}
+	}
+
+	vector<const double*> x(nDim);
+	for ( int k=0; k<nDim; k++ ) x[k] = &columns[k][0];
+	vector<double> chi2Batch(nPoints);
+	chi2Compiled.evaluate(nPoints, x.data(), &chi2Batch[0]);
+	for ( int p=0; p<nPoints; p++ ){
+		if ( same(chi2Batch[p], chi2s[p], 1e-10) ) continue;
+		cout << "compiledTheoryCheck : FAILED : " << pdf->getName() << " : GaussianChi2::evaluate() = " << Form("%.17g", chi2Batch[p])
+			<< " instead of " << Form("%.17g", chi2s[p]) << endl;
+		nFailed++;
+	}
+
+	if ( nFailed==0 ) cout << "compiledTheoryCheck : " << pdf->getName() << " OK" << endl;
+	return nFailed;
+}
+
+int main(int argc, char* argv[])
+{
+	vector<PDF_Abs*> pdfs;
+	pdfs.push_back(new PDF_Gaus("year2013","year2013","year2013"));
+	pdfs.push_back(new PDF_Gaus2d("year2013","year2013","year2013"));
+	pdfs.push_back(new PDF_Circle("year2013","year2013","year2013"));
+	pdfs.push_back(new PDF_Cartesian("year2014","year2014","year2014"));
+	pdfs.push_back(new PDF_rb("year2013","year2013","year2013"));
+	pdfs.push_back(new PDF_GausN(10, 3));
+
+	TRandom3 rnd(4357);
+	int nFailed = 0;
+	for ( unsigned int i=0; i<pdfs.size(); i++ ){
+		nFailed += check(pdfs[i], rnd);
+		delete pdfs[i];
+	}
+	if ( nFailed>0 ){
+		cout << "compiledTheoryCheck : " << nFailed << " failures" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,433 @@
+/**
+ * Gamma Combination
+ *
+ * Throughput benchmarks on synthetic combinations of scalable size,
+ * to spot performance regressions between commits. Built by the
+ * (not default) target gammacomboBenchmarks:
+ *
+ *   make gammacomboBenchmarks
+ *   bin/gammacomboBenchmarks --nmeas 20 --npars 5 --npdfs 4 --nevents 5000 \
+ *     --npoints 50 --npoints2dx 15 --npoints2dy 15 --npointstoy 10 --ntoys 50 --tag abc1234
+ *
+ * Size of the synthetic combination:
+ *   --nmeas N    number of Gaussian measurements (default 10)
+ *   --npars M    number of parameters shared between them (default 3)
+ *   --npdfs P    number of PDF_GausN the measurements are split into (default 2)
+ *   --nevents K  events in the dataset of the PDF_Datasets benchmark (default 5000)
+ *   --nfits F    number of fits for the fits/s benchmarks (default 200)
+ *   --out file   results are appended to this file as one JSON object per run (default benchmarks.jsonl)
+ *   --tag string free label stored with the results, e.g. the commit hash
+ * All other arguments are passed on to the usual option parser
+ * (--npoints, --npoints2dx, --npoints2dy, --npointstoy, --ntoys, --ncpu, --profile, -v, -d).
+ *
+ **/
+
+#include <fstream>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "Fitter.h"
+#include "GaussianChi2.h"
+#include "MethodPluginScan.h"
+#include "MethodProbScan.h"
+#include "OptParser.h"
+#include "Profiler.h"
+#include "ToyTree.h"
+#include "Utils.h"
+
+#include "RooAddPdf.h"
+#include "RooExponential.h"
+#include "RooExtendPdf.h"
+#include "RooFormulaVar.h"
+#include "TDatime.h"
+
+#include "PDF_GausN.h"
+
+using namespace std;
+using namespace RooFit;
+using namespace Utils;
+
+///
+/// Gives access to the protected toy loop and toy analysis of
+/// the plugin method, so they can be timed separately.
+///
+class BenchmarkPluginScan : public MethodPluginScan
+{
+	public:
+		BenchmarkPluginScan(MethodProbScan* s) : MethodPluginScan(s){};
+		using MethodPluginScan::computePvalue1d;
+		using MethodPluginScan::analyseToys;
+};
+
+///
+/// One benchmark result: n items of 'unit' processed in 'seconds'.
+///
+struct BenchmarkResult
+{
+	TString name;
+	TString unit;
+	double  n;
+	double  seconds;
+};
+
+///
+/// Peak resident set size of this process in MB.
+///
+double getPeakRSS()
+{
+	struct rusage r;
+	getrusage(RUSAGE_SELF, &r);
+#ifdef __APPLE__
+	return r.ru_maxrss/1024./1024.;
+#else
+	return r.ru_maxrss/1024.;
+#endif
+}
+
+///
+/// Build the workspace of the dataset tutorial (see tutorial_dataset_build_workspace.cpp),
+/// but with nEvents events, and without plots and the initial fit.
+///
+RooWorkspace* buildDatasetWorkspace(int nEvents)
+{
+	RooRealVar mass("mass","mass", 4360., 6360., "MeV");
+	RooRealVar mean("mean","mean",5370);
+	RooRealVar sigma("sigma","sigma", 20.9);
+	RooGaussian signal_model("g","g", mass, mean, sigma);
+	RooRealVar exponent("exponent","exponent", -1e-3, -1., 1.);
+	RooRealVar n_bkg("Nbkg","Nbkg", 0.98*nEvents, 0, 2.*nEvents);
+	RooExponential background_model("background_model", "background_model", mass, exponent);
+	RooExponential bkg_only_model("bkg_only_model", "bkg_only_model", mass, exponent);
+	RooExtendPdf extended_bkg_model("extended_bkg_model", "extended_bkg_model", bkg_only_model, n_bkg);
+	RooRealVar norm_constant_obs("norm_constant_glob_obs", "global observable of normalization constant", 1e-8, 1e-20, 1e-6);
+	RooRealVar norm_constant("norm_constant","norm_constant", 1e-8, 1e-20,  1e-6);
+	RooRealVar norm_constant_sigma("norm_constant_sigma","norm_constant_sigma", 5e-10);
+	RooGaussian norm_constant_constraint("norm_constant_constraint","norm_constant_constraint", norm_constant_obs, norm_constant, norm_constant_sigma);
+	RooRealVar branchingRatio("branchingRatio", "branchingRatio", 0.02*nEvents*1e-8, 0, 0.0001);
+	RooFormulaVar n_sig("Nsig", "branchingRatio/norm_constant", RooArgList(branchingRatio, norm_constant));
+	RooAddPdf mass_model("mass_model","mass_model", RooArgList(signal_model, background_model), RooArgList(n_sig, n_bkg));
+
+	RooRandom::randomGenerator()->SetSeed(4357);
+	RooDataSet* data = mass_model.generate(RooArgSet(mass), nEvents);
+	data->SetName("data");
+	norm_constant_obs.setConstant();
+
+	RooWorkspace* w = new RooWorkspace("dataset_workspace");
+	w->import(mass_model);
+	w->import(extended_bkg_model);
+	w->import(*data);
+	w->defineSet("constraint_set", RooArgSet(norm_constant_constraint), true);
+	w->defineSet("global_observables_set", RooArgSet(norm_constant_obs), true);
+	w->defineSet("datasetObservables", RooArgSet(mass), true);
+	w->defineSet("parameters", RooArgSet(branchingRatio, norm_constant, exponent, n_bkg), true);
+	delete data;
+	return w;
+}
+
+///
+/// Take the benchmark argument 'name' and its value out of argv,
+/// so that the rest can go to the OptParser.
+/// \return false if the argument wasn't given
+///
+bool takeBenchmarkArgument(int& argc, char* argv[], const char* name, TString& value)
+{
+	for ( int i=1; i<argc; i++ ){
+		if ( TString(argv[i])!=name ) continue;
+		if ( i+1>=argc ){
+			cout << "Argument error: " << name << " needs a value." << endl;
+			exit(1);
+		}
+		value = argv[i+1];
+		for ( int j=i; j+2<argc; j++ ) argv[j] = argv[j+2];
+		argc -= 2;
+		return true;
+	}
+	return false;
+}
+
+int parseBenchmarkArgument(int& argc, char* argv[], const char* name, int def)
+{
+	TString value;
+	if ( !takeBenchmarkArgument(argc, argv, name, value) ) return def;
+	if ( !value.IsDigit() || value.Atoi()<1 ){
+		cout << "Argument error: " << name << " has to be a positive integer." << endl;
+		exit(1);
+	}
+	return value.Atoi();
+}
+
+TString parseBenchmarkArgument(int& argc, char* argv[], const char* name, TString def)
+{
+	TString value;
+	if ( !takeBenchmarkArgument(argc, argv, name, value) ) return def;
+	return value;
+}
+
+int main(int argc, char* argv[])
+{
+	int nMeas       = parseBenchmarkArgument(argc, argv, "--nmeas", 10);
+	int nPars       = parseBenchmarkArgument(argc, argv, "--npars", 3);
+	int nPdfs       = parseBenchmarkArgument(argc, argv, "--npdfs", 2);
+	int nEvents     = parseBenchmarkArgument(argc, argv, "--nevents", 5000);
+	int nFits       = parseBenchmarkArgument(argc, argv, "--nfits", 200);
+	TString outFile = parseBenchmarkArgument(argc, argv, "--out", TString("benchmarks.jsonl"));
+	TString tag     = parseBenchmarkArgument(argc, argv, "--tag", TString(""));
+	if ( nPdfs>nMeas ){
+		cout << "Argument error: --npdfs can't be larger than --nmeas." << endl;
+		exit(1);
+	}
+
+	OptParser* arg = new OptParser();
+	arg->bookOption("ncpu");
+	arg->bookOption("npoints");
+	arg->bookOption("npoints2dx");
+	arg->bookOption("npoints2dy");
+	arg->bookOption("npointstoy");
+	arg->bookOption("ntoys");
+	arg->bookOption("profile");
+	arg->parseArguments(argc, argv);
+	if ( arg->profile!="" ) Profiler::instance().enable(arg->profile);
+	RooMsgService::instance().setGlobalKillBelow(ERROR);
+
+	vector<BenchmarkResult> results;
+	TStopwatch t;
+
+	///////////////////////////////////////////////////
+	//
+	// build the synthetic combination
+	//
+	///////////////////////////////////////////////////
+
+	t.Start();
+	Combiner* cmb = new Combiner(arg, "benchmark", "benchmark");
+	for ( int i=0; i<nPdfs; i++ ){
+		int first = i*nMeas/nPdfs;
+		int last  = (i+1)*nMeas/nPdfs;
+		cmb->addPdf(new PDF_GausN(last-first, nPars, first));
+	}
+	cmb->combine();
+	t.Stop();
+	BenchmarkResult rCombine = {"Combiner::combine", "combinations", 1, t.RealTime()};
+	results.push_back(rCombine);
+	RooWorkspace* w = cmb->getWorkspace();
+	TString pdfName = "pdf_"+cmb->getPdfName();
+
+	///////////////////////////////////////////////////
+	//
+	// fits/s of Utils::fitToMin
+	//
+	///////////////////////////////////////////////////
+
+	RooDataSet* startPars = new RooDataSet("startPars", "startPars", *w->set("par_"+cmb->getPdfName()));
+	startPars->add(*w->set("par_"+cmb->getPdfName()));
+	t.Start();
+	for ( int i=0; i<nFits; i++ ){
+		setParameters(w, "par_"+cmb->getPdfName(), startPars->get(0));
+		RooFitResult* r = fitToMin(w->pdf(pdfName), false, -1);
+		delete r;
+	}
+	t.Stop();
+	BenchmarkResult rFit = {"Utils::fitToMin", "fits", (double)nFits, t.RealTime()};
+	results.push_back(rFit);
+	setParameters(w, "par_"+cmb->getPdfName(), startPars->get(0));
+
+	///////////////////////////////////////////////////
+	//
+	// chi2 evaluations/s of GaussianChi2, with the theory
+	// relations as RooFormulaVars and compiled, and of
+	// GaussianChi2::evaluate() for all points at once. All
+	// have to give the same chi2.
+	//
+	///////////////////////////////////////////////////
+
+	GaussianChi2 chi2Formula(w->pdf(pdfName));
+	GaussianChi2 chi2Compiled(w->pdf(pdfName), true);
+	if ( chi2Formula.isValid() ){
+		int nEvals = 100*nFits;
+		vector<vector<double> > points(nEvals, vector<double>(chi2Formula.NDim()));
+		TRandom3 rnd(1);
+		for ( int i=0; i<nEvals; i++ ){
+			for ( unsigned int k=0; k<chi2Formula.NDim(); k++ ){
+				points[i][k] = chi2Formula.getParameters()[k]->getVal()*(1.+0.1*rnd.Gaus());
+			}
+		}
+		vector<double> chi2s(nEvals);
+		t.Start();
+		for ( int i=0; i<nEvals; i++ ) chi2s[i] = chi2Formula(&points[i][0]);
+		t.Stop();
+		BenchmarkResult rFormula = {"GaussianChi2 (RooFormulaVar)", "evaluations", (double)nEvals, t.RealTime()};
+		results.push_back(rFormula);
+		t.Start();
+		for ( int i=0; i<nEvals; i++ ){
+			double chi2 = chi2Compiled(&points[i][0]);
+			if ( fabs(chi2-chi2s[i])>1e-10*TMath::Max(1., fabs(chi2s[i])) ){
+				cout << "gammacomboBenchmarks : ERROR : compiled relations give chi2=" << Form("%.17g", chi2)
+					<< " instead of " << Form("%.17g", chi2s[i]) << endl;
+				exit(1);
+			}
+		}
+		t.Stop();
+		BenchmarkResult rCompiled = {"GaussianChi2 (compiled)", "evaluations", (double)nEvals, t.RealTime()};
+		results.push_back(rCompiled);
+		vector<vector<double> > columns(chi2Compiled.NDim(), vector<double>(nEvals));
+		vector<const double*> x(chi2Compiled.NDim());
+		for ( unsigned int k=0; k<chi2Compiled.NDim(); k++ ){
+			for ( int i=0; i<nEvals; i++ ) columns[k][i] = points[i][k];
+			x[k] = &columns[k][0];
+		}
+		vector<double> chi2Batch(nEvals);
+		t.Start();
+		chi2Compiled.evaluate(nEvals, x.data(), &chi2Batch[0]);
+		t.Stop();
+		for ( int i=0; i<nEvals; i++ ){
+			if ( fabs(chi2Batch[i]-chi2s[i])>1e-10*TMath::Max(1., fabs(chi2s[i])) ){
+				cout << "gammacomboBenchmarks : ERROR : GaussianChi2::evaluate() gives chi2=" << Form("%.17g", chi2Batch[i])
+					<< " instead of " << Form("%.17g", chi2s[i]) << endl;
+				exit(1);
+			}
+		}
+		BenchmarkResult rBatch = {"GaussianChi2::evaluate (compiled)", "evaluations", (double)nEvals, t.RealTime()};
+		results.push_back(rBatch);
+		setParameters(w, "par_"+cmb->getPdfName(), startPars->get(0));
+	}
+
+	///////////////////////////////////////////////////
+	//
+	// points/s of MethodProbScan::scan1d (fast mode: one pass)
+	//
+	///////////////////////////////////////////////////
+
+	arg->var.clear();
+	arg->var.push_back("bench_a0");
+	MethodProbScan* scanner = new MethodProbScan(cmb);
+	scanner->initScan();
+	t.Start();
+	scanner->scan1d(true);
+	t.Stop();
+	BenchmarkResult rScan1d = {"MethodProbScan::scan1d", "points", (double)arg->npoints1d, t.RealTime()};
+	results.push_back(rScan1d);
+
+	///////////////////////////////////////////////////
+	//
+	// points/s of MethodProbScan::scan2d
+	//
+	///////////////////////////////////////////////////
+
+	if ( nPars>1 ){
+		setParameters(w, "par_"+cmb->getPdfName(), startPars->get(0));
+		arg->var.push_back("bench_a1");
+		MethodProbScan* scanner2d = new MethodProbScan(cmb);
+		scanner2d->initScan();
+		t.Start();
+		scanner2d->scan2d();
+		t.Stop();
+		BenchmarkResult rScan2d = {"MethodProbScan::scan2d", "points", (double)arg->npoints2dx*arg->npoints2dy, t.RealTime()};
+		results.push_back(rScan2d);
+		delete scanner2d;
+		arg->var.pop_back();
+	}
+
+	///////////////////////////////////////////////////
+	//
+	// toys/s of MethodPluginScan::computePvalue1d, and
+	// entries/s of MethodPluginScan::analyseToys
+	//
+	///////////////////////////////////////////////////
+
+	BenchmarkPluginScan* plugin = new BenchmarkPluginScan(scanner);
+	plugin->initScan();
+	ToyTree* toyTree = new ToyTree(cmb);
+	toyTree->init();
+	Fitter* fitter = new Fitter(arg, w, cmb->getPdfName());
+	ProgressBar* pb = new ProgressBar(arg, arg->npointstoy*arg->ntoys);
+	int nToysDone = 0;
+	t.Start();
+	for ( int i=0; i<arg->npointstoy; i++ ){
+		int iCurveRes = (i+0.5)*arg->npoints1d/arg->npointstoy;
+		RooSlimFitResult* plhScan = scanner->getCurveResults()[iCurveRes];
+		if ( !plhScan ) continue;
+		plugin->computePvalue1d(plhScan, scanner->getChi2minGlobal(), toyTree, i, fitter, pb);
+		nToysDone += arg->ntoys;
+	}
+	t.Stop();
+	cout << endl;
+	BenchmarkResult rToys = {"MethodPluginScan::computePvalue1d", "toys", (double)nToysDone, t.RealTime()};
+	results.push_back(rToys);
+
+	t.Start();
+	TH1F* hCL = plugin->analyseToys(toyTree, -1);
+	t.Stop();
+	BenchmarkResult rAnalyse = {"MethodPluginScan::analyseToys", "entries", (double)toyTree->GetEntries(), t.RealTime()};
+	results.push_back(rAnalyse);
+	delete hCL;
+	delete pb;
+	delete fitter;
+	delete toyTree;
+	delete plugin;
+	delete scanner;
+
+	///////////////////////////////////////////////////
+	//
+	// fits/s of PDF_Datasets::fit on toys of nEvents events
+	//
+	///////////////////////////////////////////////////
+
+	PDF_Datasets* pdf = new PDF_Datasets(buildDatasetWorkspace(nEvents));
+	pdf->initData("data");
+	pdf->initBkgPDF("extended_bkg_model");
+	pdf->initPDF("mass_model");
+	pdf->initObservables("datasetObservables");
+	pdf->initGlobalObservables("global_observables_set");
+	pdf->initParameters("parameters");
+	pdf->initConstraints("constraint_set");
+	pdf->setNCPU(arg->ncpu);
+	int nDatasetFits = max(1, nFits/10);
+	t.Start();
+	for ( int i=0; i<nDatasetFits; i++ ){
+		pdf->generateToys(i+1);
+		RooFitResult* r = pdf->fit(pdf->getToyObservables());
+		delete r;
+	}
+	t.Stop();
+	BenchmarkResult rDatasets = {"PDF_Datasets::generateToys+fit", "fits", (double)nDatasetFits, t.RealTime()};
+	results.push_back(rDatasets);
+	delete pdf;
+
+	///////////////////////////////////////////////////
+	//
+	// report
+	//
+	///////////////////////////////////////////////////
+
+	double peakRSS = getPeakRSS();
+	cout << "\nBenchmark results:" << endl;
+	cout << "==================\n" << endl;
+	for ( int i=0; i<results.size(); i++ ){
+		printf("  %-40s %10.1f %s/s\n", results[i].name.Data(), results[i].n/results[i].seconds, results[i].unit.Data());
+	}
+	printf("  %-40s %10.1f MB\n\n", "peak RSS", peakRSS);
+
+	ofstream out(outFile.Data(), ios::app);
+	if ( !out.is_open() ){
+		cout << "gammacomboBenchmarks : ERROR : can't open file " << outFile << endl;
+		exit(1);
+	}
+	TDatime date;
+	out << "{\"tag\": \"" << tag << "\", \"date\": \"" << date.AsSQLString() << "\""
+		<< ", \"nmeas\": " << nMeas << ", \"npars\": " << nPars << ", \"npdfs\": " << nPdfs
+		<< ", \"nevents\": " << nEvents << ", \"nfits\": " << nFits
+		<< ", \"npoints\": " << arg->npoints1d << ", \"npoints2dx\": " << arg->npoints2dx
+		<< ", \"npoints2dy\": " << arg->npoints2dy << ", \"npointstoy\": " << arg->npointstoy
+		<< ", \"ntoys\": " << arg->ntoys << ", \"ncpu\": " << arg->ncpu
+		<< ", \"results\": [";
+	for ( int i=0; i<results.size(); i++ ){
+		if ( i>0 ) out << ", ";
+		out << "{\"name\": \"" << results[i].name << "\", \"unit\": \"" << results[i].unit << "\""
+			<< ", \"n\": " << results[i].n << ", \"seconds\": " << results[i].seconds
+			<< ", \"rate\": " << results[i].n/results[i].seconds << "}";
+	}
+	out << "], \"peakRSSMB\": " << peakRSS << "}" << endl;
+	out.close();
+	cout << "gammacomboBenchmarks : results appended to " << outFile << endl;
+	return 0;
+}
@@ -43,8 +43,14 @@ int main(int argc, char* argv[])
   //
   // If you have any problems contact Matthew Kenzie (matthew.kenzie@cern.ch) or Titus Mombächer (titus.mombacher@cern.ch)
 
+  // For many batch jobs on one node, set this to read the dataset through the columnar cache file written
+  // by tutorial_dataset_build_workspace, with a workspace saved without the dataset. All jobs map the cache
+  // read-only and share it in the page cache, and none of them reads or decompresses the dataset from the
+  // workspace file. Each job still fills its own RooDataSet from the cache, as RooFit needs.
+  bool useDatasetCache = false;
+
   // Load the workspace from its file
-  TFile f("workspace.root");
+  TFile f(useDatasetCache ? "workspace_nodata.root" : "workspace.root");
   RooWorkspace* workspace = (RooWorkspace*)f.Get("dataset_workspace");
   if (workspace==NULL){
 	  std::cout<<"No workspace found:"<<std::endl;
@@ -67,7 +73,8 @@ int main(int argc, char* argv[])
 
   PDF_Datasets* pdf = new PDF_Datasets(workspace);
   // PDF_Datasets* pdf = new PDF_DatasetTutorial(workspace); // put your inherited fitter if you want to
-  pdf->initData("data"); // this is the name of the dataset in the workspace
+  if ( useDatasetCache ) pdf->initData("data", "workspace_data.cache", "workspace.root"); // the cache is rebuilt when workspace.root changes
+  else pdf->initData("data"); // this is the name of the dataset in the workspace
   pdf->initBkgPDF("extended_bkg_model"); // this the name of the background pdf in the workspace (without the constraints)
   pdf->initPDF("mass_model"); // this the name of the pdf in the workspace (without the constraints)
   pdf->initObservables("datasetObservables"); // non-global observables whose measurements are stored in the dataset (for example the mass).
@@ -13,6 +13,7 @@
 #include "RooWorkspace.h"
 #include "TFile.h"
 #include "TCanvas.h"
+#include "DatasetCache.h"
 
 
 
@@ -138,6 +139,21 @@ int main()
 
   // Save the workspace to a file
   workspace.SaveAs("workspace.root");
+
+  // For many batch jobs on one node, also save the workspace without the dataset, and the dataset
+  // as a columnar cache file, which all jobs map read-only (see tutorial_dataset.cpp). The jobs then
+  // don't read and decompress the dataset from the workspace file. The cache remembers that it was
+  // made from workspace.root, and is rebuilt from it when that changes.
+  RooWorkspace workspaceNoData("dataset_workspace");
+  workspaceNoData.import(mass_model);
+  workspaceNoData.import(extended_bkg_model);
+  workspaceNoData.import(rooFitResult, "data_fit_result");
+  workspaceNoData.defineSet("constraint_set", constraint_set, true);
+  workspaceNoData.defineSet("global_observables_set", global_observables_set, true);
+  workspaceNoData.defineSet("datasetObservables", dataset_observables_set, true);
+  workspaceNoData.defineSet("parameters", parameters_set, true);
+  workspaceNoData.SaveAs("workspace_nodata.root");
+  DatasetCache::exportDataSet(&data, "workspace_data.cache", DatasetCache::fingerprint("data", "workspace.root"));
   
   return 0;
 }
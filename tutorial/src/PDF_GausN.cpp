@@ -0,0 +1,135 @@
+/**
+ * Gamma Combination
+ *
+ **/
+
+#include "PDF_GausN.h"
+
+	PDF_GausN::PDF_GausN(int nObs, int nPars, int firstObs)
+: PDF_Abs(nObs), nPars(nPars), firstObs(firstObs)
+{
+	name = "GausN";
+	initParameters();
+	initRelations();
+	initObservables();
+	setObservables("benchmark");
+	setUncertainties("benchmark");
+	setCorrelations("benchmark");
+	buildCov();
+	buildPdf();
+}
+
+
+PDF_GausN::~PDF_GausN(){}
+
+
+void PDF_GausN::initParameters()
+{
+	ParametersAbs p;
+	parameters = new RooArgList("parameters");
+	for ( int i=0; i<nPars; i++ ){
+		Parameter *par = p.newParameter(Form("bench_a%i",i));
+		par->title = Form("a_{%i}",i);
+		par->startvalue = 0;
+		par->unit = "";
+		par->scan = p.range(-3, 3);
+		par->force = p.range(-3, 3);
+		par->bboos = p.range(-3, 3);
+		parameters->add(*(p.get(par->name)));
+	}
+}
+
+///
+/// Observable i measures a_j + 0.5*a_k with j = i mod nPars and
+/// k = (i+1) mod nPars, so that every parameter is constrained by
+/// several observables, and neighbouring parameters are correlated.
+///
+void PDF_GausN::initRelations()
+{
+	theory = new RooArgList("theory"); ///< the order of this list must match that of the COR matrix!
+	for ( int i=0; i<nObs; i++ ){
+		int iGlobal = firstObs+i;
+		TString thName = Form("bench%i_th", iGlobal);
+		RooAbsArg* a = parameters->at(iGlobal%nPars);
+		if ( nPars==1 ){
+			theory->add(*(new RooFormulaVar(thName, thName, "@0", RooArgList(*a))));
+			continue;
+		}
+		RooAbsArg* b = parameters->at((iGlobal+1)%nPars);
+		theory->add(*(new RooFormulaVar(thName, thName, "@0+0.5*@1", RooArgList(*a, *b))));
+	}
+}
+
+
+void PDF_GausN::initObservables()
+{
+	observables = new RooArgList("observables"); ///< the order of this list must match that of the COR matrix!
+	for ( int i=0; i<nObs; i++ ){
+		TString obsName = Form("bench%i_obs", firstObs+i);
+		observables->add(*(new RooRealVar(obsName, obsName, 0, -1e4, 1e4)));
+	}
+}
+
+///
+/// The "benchmark" values scatter deterministically around zero,
+/// so that runs are comparable between commits.
+///
+void PDF_GausN::setObservables(TString c)
+{
+	if ( c.EqualTo("truth") ){
+		setObservablesTruth();
+	}
+	else if ( c.EqualTo("toy") ){
+		setObservablesToy();
+	}
+	else if ( c.EqualTo("benchmark") ){
+		obsValSource = c;
+		for ( int i=0; i<nObs; i++ ){
+			int iGlobal = firstObs+i;
+			setObservable(Form("bench%i_obs", iGlobal), 0.1*((iGlobal*7)%11-5));
+		}
+	}
+	else{
+		cout << "PDF_GausN::setObservables() : ERROR : config "+c+" not found." << endl;
+		exit(1);
+	}
+}
+
+
+void PDF_GausN::setUncertainties(TString c)
+{
+	if ( c.EqualTo("benchmark") ){
+		obsErrSource = c;
+		for ( int i=0; i<nObs; i++ ){
+			StatErr[i] = 0.3 + 0.05*((firstObs+i)%5);
+			SystErr[i] = 0.1;
+		}
+	}
+	else{
+		cout << "PDF_GausN::setUncertainties() : ERROR : config "+c+" not found." << endl;
+		exit(1);
+	}
+}
+
+
+void PDF_GausN::setCorrelations(TString c)
+{
+	resetCorrelations();
+	if ( c.EqualTo("benchmark") ){
+		corSource = "neighbouring observables correlated";
+		for ( int i=1; i<nObs; i++ ){
+			corStatMatrix[i][i-1] = 0.2;
+			corSystMatrix[i][i-1] = 0.3;
+		}
+	}
+	else{
+		cout << "PDF_GausN::setCorrelations() : ERROR : config "+c+" not found." << endl;
+		exit(1);
+	}
+}
+
+
+void PDF_GausN::buildPdf()
+{
+	pdf = new RooMultiVarGaussian("pdf_"+name, "pdf_"+name, *(RooArgSet*)observables, *(RooArgSet*)theory, covMatrix);
+}